@@ -9,6 +9,8 @@
 
 #include "systems/map_object_system.h"
 
+// a door the map places, the cells it moves and how it moves them. the MapObjectSystem keeps the state of every door together
+// and only updates the ones that are moving, the component passes trigger events on to it
 class DoorControllerComponent : public Component
 {
 public:
@@ -16,7 +18,8 @@ public:
 
     DoorControllerComponent(GameObject* owner, size_t doorId) : Component(owner) { Doors.push_back(doorId); }
 
-    std::vector<size_t> Doors = { 0 };
+    // the indexes of the map cells the door moves, set before the first update
+    std::vector<size_t> Doors;
 
     bool MustOpenBeforClose = true;
 
@@ -29,8 +32,6 @@ public:
 
     void OnAddedToObject() override;
 
-    void Update();
-
     static constexpr char DoorOpening[] = "DoorOpening";
     static constexpr char DoorOpened[] = "DoorOpened";
     static constexpr char DoorClosing[] = "DoorClosing";
@@ -40,24 +41,9 @@ public:
     static constexpr char DoorSecurityFailed[] = "DoorSecurityFailed";
 
 protected:
-    void OnTriggerEnter(GameObject* sender, GameObject* subject);
-    void OnTriggerExit(GameObject* sender, GameObject* subject);
-
-    void SetDoorParams(float param);
-    void SetDoorBlocked(bool blocked);
-
-    enum class State
-    {
-        Closed,
-        Opening,
-        Open,
-        WaitingForClose,
-        Closing
-    };
-
-    State OpenState = State::Closed;
-
-    bool NeedCloseASAP = false;
+    friend class MapObjectSystem;
 
-    float Param = 0;
+    // the door's row in the MapObjectSystem door table
+    static constexpr size_t NoDoorIndex = size_t(-1);
+    size_t DoorIndex = NoDoorIndex;
 };
\ No newline at end of file
@@ -1,37 +1,81 @@
 #pragma once
 #include "component.h"
 #include "systems/mobile_object_system.h"
+#include "services/pathfinding.h"
+#include "utilities/behavior_tree.h"
 
 #include "utilities/debug_draw_utility.h"
 
+#include <string>
+
+class TransformComponent;
+
 class MobBehaviorComponent : public Component
 {
 public:
     DEFINE_COMPONENT_WITH_SYSTEM_NO_CONSTRUCTOR(MobBehaviorComponent, MobSystem);
 
     MobBehaviorComponent(GameObject* owner);
+    ~MobBehaviorComponent();
+
+    // evaluates the behavior tree when it is due, and keeps the running action going every frame in between.
+    // true when the tree was evaluated
+    bool Process(const BehaviorTree& tree, BehaviorBlackboard& blackboard, const FlowField* playerField, const Vector3& playerPos);
+
+    // for the behavior tree
+    bool CheckCondition(const BehaviorNode& node);
+    void StartAction(const BehaviorNode& node, BehaviorBlackboard& blackboard);
+    BehaviorStatus RunAction(const BehaviorNode& node, BehaviorBlackboard& blackboard);
+
+    // slides along walls and solid props, true when it ran into something
+    bool Move(Vector3 desiredMotion);
 
-    void Process();
+    // the behavior from the behavior manifest, when empty it is the one the mob's character names or the default
+    std::string Behavior;
 
     bool FollowPath = false;
     bool LoopPath = true;
 
+    // heads for the player along the shared flow field while the player is close enough, then goes back to what it was doing
+    bool ChasePlayer = false;
+    float ChaseRange = 24;
+    float ChaseStopDistance = 1.5f;
+
+    // how long after losing sight of the player it keeps chasing
+    float ChaseMemory = 5;
+
+    // what the mob knows about the player, kept up to date a few mobs at a time by the PerceptionSystem
+    float SightRange = 20;
+    float FieldOfView = 140;
+    bool CanSeePlayer = false;
+    Vector3 LastSeenPlayerPosition = { 0, 0, 0 };
+    float TimeSinceSeenPlayer = FLT_MAX;
+
+    // how much longer the last line of sight check is trusted, and how long ago it was done
+    float SightCheckTimeLeft = 0;
+    float TimeSinceSightCheck = FLT_MAX;
+
+    float Radius = 0.25f;
     float MoveSpeed = 2;
     float RotationSpeed = 180;
 
     std::vector<Vector3> Path;
 
 protected:
-    enum class AIState
+    friend class MobSystem;
+
+    // where the MobSystem keeps this mob's blackboard
+    static constexpr size_t NoBehaviorGroup = size_t(-1);
+    size_t BehaviorGroup = NoBehaviorGroup;
+    size_t BehaviorSlot = 0;
+
+    // the wander action waits, then walks to a random spot
+    enum class WanderPhase : uint8_t
     {
-        Unknown,
-        Moving,
         Waiting,
+        Moving,
     };
 
-    AIState State = AIState::Unknown;
-
-    float WaitTime = 0;
     size_t CurrentPathIndex = 0;
 
     Vector3 DesiredPostion = { 0, 0, 0 };
@@ -39,7 +83,31 @@ protected:
 
     DebugDrawUtility::DebugDraw Visualizer;
 
+    // wandering asks the pathfinding service for a route to a random spot, and waits until it comes back
+    Pathfinding::RequestID PendingPath = Pathfinding::InvalidRequest;
+    Vector3 WanderTarget = { 0, 0, 0 };
+    std::vector<Vector3> Route;
+    size_t RouteIndex = 0;
+
+    // looked up once at the start of Process for the conditions and actions to use
+    TransformComponent* CurrentTransform = nullptr;
+    MobComponent* CurrentMob = nullptr;
+    const FlowField* PlayerField = nullptr;
+    float PlayerDistance = FLT_MAX;
+
 protected:
     float GetAngleToPathPoint() const;
     float GetDistanceToPlathPoint() const;
-};
+
+    void StartWander(const Vector3& target);
+    bool CheckWanderPath();
+
+    void SetMoving(bool moving);
+
+    // the flow field distance from the mob's cell to the player, FLT_MAX without a field
+    float GetFieldDistance() const;
+
+    BehaviorStatus Chase();
+    BehaviorStatus Patrol();
+    BehaviorStatus Wander(BehaviorBlackboard& blackboard);
+};
\ No newline at end of file
@@ -18,8 +18,14 @@ class MobComponent : public Component
 public:
     DEFINE_COMPONENT(MobComponent)
 
+    // every mob is this character for now
+    static constexpr char CharacterName[] = "walker";
+
     void OnAddedToObject() override;
 
+    // advances the animation, the pose is only evaluated as often as the distance allows and not at all when the mob can't be seen
+    void Animate(float viewDistance, bool visible);
+
     void Draw();
 
     ModelInstance* GetModelInstance();
@@ -36,5 +42,6 @@ protected:
     std::shared_ptr<CharacterInfo> Character = nullptr;
     CharacterAnimationState AnimationState = CharacterAnimationState::None;
 
-    Texture ShadowTexture = { 0 };
+    // empty until the texture finishes loading
+    const Texture* ShadowTexture = nullptr;
 };
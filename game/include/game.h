@@ -53,6 +53,7 @@ namespace App
     void AddEventHandler(size_t hash, GameObjectEventHandler handler, ObjectLifetimeToken::Ptr token);
     void AddEventHandler(std::string_view name, GameObjectEventHandler handler, ObjectLifetimeToken::Ptr token);
     void CallEvent(size_t hash, GameObject* sender, GameObject* target);
+    void CallEvent(std::string_view name, GameObject* sender, GameObject* target);
 
     void Quit();
 
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "map/map.h"
+
+// shared layout for compiled map files, written by the map compiler from LDtk projects and read by the map reader.
+// the file is a header followed by flat arrays, the chunk positions, the cells of each chunk, the tile rects, the light zones,
+// the entities, the entity path points and door cells, the regions, then a block of strings. everything the LDtk reader used
+// to work out while loading, cell positions, door tiles and light zone cells, is already resolved.
+// only chunks with something in them are stored, the rest of the map is empty.
+// every level of the LDtk world is a region, placed where the world layout puts it. the cells of all regions are in
+// the one set of chunks, the entities of each region are a range of the entity array so they can be spawned on their own
+namespace CompiledMap
+{
+    static constexpr char Magic[4] = { 'M', 'B', 'S', 'M' };
+    static constexpr uint32_t Version = 3;
+
+    static constexpr char Extension[] = ".cmap";
+
+    // a string in the string block
+    struct StringRef
+    {
+        uint32_t Offset = 0;
+        uint32_t Length = 0;
+    };
+
+    struct MapHeader
+    {
+        char Magic[4] = { 0 };
+        uint32_t Version = 0;
+
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        uint32_t ChunkCount = 0;
+
+        uint32_t TileRectCount = 0;
+        uint32_t LightZoneCount = 0;
+        uint32_t EntityCount = 0;
+        uint32_t PathPointCount = 0;
+        uint32_t DoorCellCount = 0;
+        uint32_t StringsSize = 0;
+
+        StringRef Tilemap;
+        StringRef Skybox;
+
+        float ExteriorAmbientLevel = 1;
+        float InteriorAmbientLevel = 0.75f;
+        float AmbientAngle = 45;
+        uint32_t RegionCount = 0;
+    };
+
+    // light zone fields that were set in the map, the rest keep their defaults
+    namespace LightZoneFields
+    {
+        static constexpr uint32_t MaxLevel = 1u << 0;
+        static constexpr uint32_t MinLevel = 1u << 1;
+        static constexpr uint32_t SequenceLength = 1u << 2;
+    }
+
+    struct LightZoneRecord
+    {
+        uint32_t Fields = 0;
+        float MaxLevel = 1;
+        float MinLevel = 0.25f;
+        float SequenceLength = 1;
+
+        // the sequence is looked up in the light_sequences table when the map loads, so table edits still apply
+        StringRef Sequence;
+    };
+
+    enum class EntityType : uint32_t
+    {
+        PlayerSpawn = 0,
+        Model,
+        Trigger,
+        Mob,
+        DoorTrigger,
+    };
+
+    // entity fields that were set in the map, the rest keep their component defaults
+    namespace EntityFields
+    {
+        static constexpr uint32_t Facing = 1u << 0;
+        static constexpr uint32_t Solid = 1u << 1;
+        static constexpr uint32_t TriggerId = 1u << 2;
+        static constexpr uint32_t FollowPath = 1u << 3;
+        static constexpr uint32_t MoveSpeed = 1u << 4;
+        static constexpr uint32_t RotationSpeed = 1u << 5;
+        static constexpr uint32_t FullyOpenBeforeClose = 1u << 6;
+        static constexpr uint32_t OpenSpeed = 1u << 7;
+        static constexpr uint32_t CloseSpeed = 1u << 8;
+        static constexpr uint32_t StayOpen = 1u << 9;
+        static constexpr uint32_t MinimumOpenTime = 1u << 10;
+        static constexpr uint32_t ChasePlayer = 1u << 11;
+    }
+
+    // one record for every kind of entity, each kind uses the parts it needs
+    struct EntityRecord
+    {
+        EntityType Type = EntityType::PlayerSpawn;
+        uint32_t Fields = 0;
+
+        float PositionX = 0;
+        float PositionY = 0;
+        float Facing = 0;
+
+        // trigger and door trigger bounds
+        Rectangle Bounds = { 0 };
+
+        // mob move and rotation speed, door open and close speed
+        float Speed = 0;
+        float SecondSpeed = 0;
+
+        // door minimum open time
+        float Time = 0;
+
+        int32_t TriggerId = 0;
+
+        // model solid, mob follow path, door fully open before close
+        uint8_t Flag = 0;
+
+        // door stay open, mob chase player
+        uint8_t SecondFlag = 0;
+        uint16_t Reserved = 0;
+
+        // the model name
+        StringRef Name;
+
+        // mob path points or door cells, a range in their arrays
+        uint32_t FirstItem = 0;
+        uint32_t ItemCount = 0;
+    };
+
+    // where a chunk is, in chunks, its cells follow all the chunk positions
+    struct ChunkRecord
+    {
+        uint32_t X = 0;
+        uint32_t Y = 0;
+    };
+
+    // a cell position, with y going up like the map
+    struct CellCoordinate
+    {
+        uint32_t X = 0;
+        uint32_t Y = 0;
+    };
+
+    struct PathPoint
+    {
+        float X = 0;
+        float Y = 0;
+    };
+
+    struct RegionRecord
+    {
+        StringRef Name;
+
+        // in cells, with y going up like the map
+        uint32_t X = 0;
+        uint32_t Y = 0;
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+
+        uint32_t FirstEntity = 0;
+        uint32_t EntityCount = 0;
+    };
+
+    static_assert(sizeof(MapCell) == 16, "map cells are stored as they are in memory");
+    static_assert(sizeof(Rectangle) == 16, "tile rects are stored as they are in memory");
+    static_assert(sizeof(MapHeader) == 76, "map header must not have padding");
+    static_assert(sizeof(LightZoneRecord) == 24, "light zone record must not have padding");
+    static_assert(sizeof(EntityRecord) == 72, "entity record must not have padding");
+    static_assert(sizeof(RegionRecord) == 32, "region record must not have padding");
+
+    // maps/level.ldtk compiles to maps/level.cmap
+    inline std::string GetCompiledName(std::string_view sourceName)
+    {
+        size_t extension = sourceName.find_last_of('.');
+        size_t folder = sourceName.find_last_of("/\\");
+        if (extension != std::string_view::npos && (folder == std::string_view::npos || extension > folder))
+            sourceName = sourceName.substr(0, extension);
+
+        return std::string(sourceName) + Extension;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "map/navigation_grid.h"
+
+#include <cfloat>
+#include <vector>
+
+// the distance from every cell in a square around a target to the target, and the step each cell should take to get closer.
+// everything that heads for the same target shares one field, and looking a cell up is a couple of array reads.
+// doors are walkable, things that follow the field open them
+class FlowField
+{
+public:
+    // the field covers radius cells each way from the target, the buffers are kept when it is built again.
+    // when the grid is the one the field was last built from, the walkable cells the old and new windows share are copied
+    // instead of looked up again. every distance depends on where the target is, so the search always covers the whole window
+    void Build(const NavigationGrid& grid, const MapCoordinate& target, int radius);
+
+    inline const MapCoordinate& GetTarget() const { return Target; }
+
+    inline bool IsInField(int x, int y) const { return x >= Origin.X && y >= Origin.Y && x < Origin.X + Width && y < Origin.Y + Width; }
+
+    // in cells, FLT_MAX when the cell is outside the field or the target can't be reached from it
+    inline float GetDistance(int x, int y) const
+    {
+        if (!IsInField(x, y))
+            return FLT_MAX;
+
+        return Distances[GetIndex(x, y)];
+    }
+
+    // the neighbour to move to, false at the target and where there is no way to it
+    inline bool GetStep(int x, int y, MapCoordinate& step) const
+    {
+        if (!IsInField(x, y))
+            return false;
+
+        uint8_t direction = Directions[GetIndex(x, y)];
+        if (direction == NoDirection)
+            return false;
+
+        step = MapCoordinate{ x + DirectionX[direction], y + DirectionY[direction] };
+        return true;
+    }
+
+private:
+    static constexpr uint8_t NoDirection = 0xff;
+    static constexpr int DirectionX[8] = { 1, -1, 0, 0, 1, -1, 1, -1 };
+    static constexpr int DirectionY[8] = { 0, 0, 1, -1, 1, 1, -1, -1 };
+
+    inline size_t GetIndex(int x, int y) const { return size_t(y - Origin.Y) * size_t(Width) + size_t(x - Origin.X); }
+
+    MapCoordinate Target;
+    MapCoordinate Origin;
+    int Width = 0;
+
+    const NavigationGrid* Grid = nullptr;
+    uint32_t GridVersion = 0;
+
+    std::vector<bool> Walkable;
+    std::vector<bool> PreviousWalkable;
+    std::vector<float> Distances;
+    std::vector<uint8_t> Directions;
+
+    std::vector<std::pair<float, int>> OpenList;
+};
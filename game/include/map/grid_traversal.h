@@ -0,0 +1,103 @@
+#pragma once
+
+#include "raylib.h"
+
+#include <algorithm>
+#include <cmath>
+
+// a cell a ray passes through, they are visited in the order the ray reaches them
+struct GridStep
+{
+    int X = 0;
+    int Y = 0;
+
+    // where along the ray the cell starts and ends, in lengths of the direction the ray was traced with
+    float Distance = 0;
+    float ExitDistance = 0;
+
+    // the cell the ray started in, Distance is 0 and it wasn't entered through a side
+    bool Start = false;
+
+    // the ray came in through a north or south side of the cell, otherwise an east or west one
+    bool SideY = false;
+
+    // which way the ray is stepping on each axis, -1 or 1
+    int StepX = 0;
+    int StepY = 0;
+};
+
+// the DDA (digital differential analyzer) walk used by everything that traces rays across the map grid.
+// visits the cell the ray starts in and then every cell it passes through until visit returns true or the ray goes past maxDistance.
+// distances are in lengths of direction, so with a unit direction they are how far the ray has gone.
+// returns true when visit stopped the walk
+template<typename Visit>
+bool TraceGrid(const Vector2& origin, const Vector2& direction, float maxDistance, Visit&& visit)
+{
+    GridStep step;
+    step.X = int(floorf(origin.x));
+    step.Y = int(floorf(origin.y));
+
+    // the length of ray from one x or y side to the next, which is |direction| / direction.x, but only the ratio
+    // between the two matters for the stepping, so it is left scaled to the length of direction
+    float deltaDistX = (direction.x == 0) ? 1e30f : fabsf(1.0f / direction.x);
+    float deltaDistY = (direction.y == 0) ? 1e30f : fabsf(1.0f / direction.y);
+
+    // the length of ray from the origin to the next x or y side
+    float sideDistX = 0;
+    float sideDistY = 0;
+
+    if (direction.x < 0)
+    {
+        step.StepX = -1;
+        sideDistX = (origin.x - step.X) * deltaDistX;
+    }
+    else
+    {
+        step.StepX = 1;
+        sideDistX = (step.X + 1.0f - origin.x) * deltaDistX;
+    }
+
+    if (direction.y < 0)
+    {
+        step.StepY = -1;
+        sideDistY = (origin.y - step.Y) * deltaDistY;
+    }
+    else
+    {
+        step.StepY = 1;
+        sideDistY = (step.Y + 1.0f - origin.y) * deltaDistY;
+    }
+
+    step.Start = true;
+    step.ExitDistance = std::min(sideDistX, sideDistY);
+    if (visit(step))
+        return true;
+
+    step.Start = false;
+
+    while (true)
+    {
+        // jump to the next cell, either in x or in y
+        if (sideDistX < sideDistY)
+        {
+            step.Distance = sideDistX;
+            sideDistX += deltaDistX;
+            step.X += step.StepX;
+            step.SideY = false;
+        }
+        else
+        {
+            step.Distance = sideDistY;
+            sideDistY += deltaDistY;
+            step.Y += step.StepY;
+            step.SideY = true;
+        }
+
+        if (step.Distance > maxDistance)
+            return false;
+
+        step.ExitDistance = std::min(sideDistX, sideDistY);
+        if (visit(step))
+            return true;
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "map/navigation_grid.h"
+#include "map/path_finder.h"
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// a route across the clusters of the map, each piece between two waypoints stays inside one cluster or steps across a cluster edge
+struct HierarchicalPath
+{
+    std::vector<MapCoordinate> Waypoints;
+    float Cost = 0;
+    size_t Expanded = 0;
+};
+
+// HPA*, the grid is split into clusters the size of a map chunk. cells where a cluster can be walked into from the next one are the
+// nodes of a small graph, with the distances between the nodes of a cluster worked out when the cluster is first used.
+// searches run on that graph and only the pieces of the route that are needed are searched cell by cell.
+// clusters are built lazily, so huge sparse maps only pay for the parts that are walked through. not thread safe, one thread uses a graph
+class HierarchicalGraph
+{
+public:
+    // doorsAlwaysOpen is for things that open doors by walking into them, otherwise only the doors set open are walkable.
+    // the grid has to outlive the graph, or the next SetGrid
+    void SetGrid(const NavigationGrid& grid, bool doorsAlwaysOpen);
+    void Clear();
+
+    // rebuilds the clusters that touch the door the next time they are used, and drops the cached routes
+    void SetDoorOpen(int x, int y, bool open);
+
+    // maxExpansions is in abstract nodes, 0 is no limit
+    bool FindAbstractPath(const MapCoordinate& start, const MapCoordinate& goal, HierarchicalPath& path, size_t maxExpansions = 0);
+
+    // the cells from one waypoint to the next, not including the first
+    bool RefineSegment(const HierarchicalPath& path, size_t segment, std::vector<MapCoordinate>& cells);
+
+    // the abstract path refined all the way, points are where the route changes direction like PathFinder's JPS results
+    bool FindPath(const MapCoordinate& start, const MapCoordinate& goal, PathSearchResult& result, size_t maxExpansions = 0);
+
+    struct Stats
+    {
+        size_t ClustersBuilt = 0;
+        size_t CacheHits = 0;
+        size_t CacheMisses = 0;
+    };
+
+    inline const Stats& GetStats() const { return CurrentStats; }
+
+private:
+    struct ClusterNode
+    {
+        MapCoordinate Cell;
+
+        // the cell across the cluster edge this node steps to
+        MapCoordinate Exit;
+    };
+
+    struct Cluster
+    {
+        bool Built = false;
+        std::vector<ClusterNode> Nodes;
+
+        // Nodes.size() squared, FLT_MAX when the nodes can't reach each other inside the cluster
+        std::vector<float> Distances;
+    };
+
+    struct SearchNode
+    {
+        float G = 0;
+        uint64_t Parent = 0;
+        bool Closed = false;
+        MapCoordinate Cell;
+    };
+
+    struct OpenEntry
+    {
+        float F = 0;
+        float G = 0;
+        uint64_t Node = 0;
+
+        bool operator > (const OpenEntry& other) const { return F > other.F || (F == other.F && G < other.G); }
+    };
+
+    struct CachedRoute
+    {
+        std::vector<uint64_t> Nodes;
+        float Cost = 0;
+    };
+
+    bool IsWalkable(int x, int y) const;
+
+    size_t GetClusterSlot(int x, int y) const { return Grid->GetChunkSlot(x, y); }
+    Cluster& GetCluster(int x, int y);
+    void BuildCluster(Cluster& cluster, int x, int y);
+    void AddEntrances(Cluster& cluster, int insideX, int insideY, int stepX, int stepY, int outX, int outY);
+    int FindNode(const Cluster& cluster, const MapCoordinate& cell, const MapCoordinate& exit) const;
+    void InvalidateCluster(int x, int y);
+
+    // reads which cells of the cluster the cell is in can be walked on, for SearchCluster
+    void LoadClusterCells(const MapCoordinate& cell);
+
+    // dijkstra over the cells of the loaded cluster, fills LocalDistances and LocalParents. stops early when it reaches the target
+    void SearchCluster(const MapCoordinate& from, const MapCoordinate* target);
+
+    void AddOpen(uint64_t node, const MapCoordinate& cell, float g, uint64_t parent);
+
+    const NavigationGrid* Grid = nullptr;
+    bool DoorsAlwaysOpen = true;
+    std::unordered_set<uint64_t> OpenDoors;
+
+    std::vector<uint32_t> ClusterSlots;
+    std::vector<std::unique_ptr<Cluster>> Clusters;
+
+    std::array<bool, MapChunkCellCount> LocalWalkable = { false };
+    std::array<float, MapChunkCellCount> LocalDistances = { 0 };
+    std::array<int16_t, MapChunkCellCount> LocalParents = { 0 };
+    std::vector<std::pair<float, int>> LocalOpenList;
+
+    MapCoordinate SearchGoal;
+
+    std::unordered_map<uint64_t, SearchNode> SearchNodes;
+    std::vector<OpenEntry> OpenList;
+
+    // routes between the edges of two clusters, shared by everything that searches this graph
+    std::unordered_map<uint64_t, CachedRoute> RouteCache;
+
+    Stats CurrentStats;
+};
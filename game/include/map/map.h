@@ -1,6 +1,8 @@
 #pragma once
 
 #include <stdint.h>
+#include <climits>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -8,11 +10,11 @@
 
 struct MapCoordinate
 {
-    uint16_t X = 0;
-    uint16_t Y = 0;
+    int32_t X = 0;
+    int32_t Y = 0;
 
-    inline uint32_t GetHash() const { return ((X << 16) | ((Y) & 0xffff)); }
-    static uint32_t GetHash(uint16_t x, uint16_t y) { return ((x << 16) | ((y) & 0xffff)); }
+    inline uint64_t GetHash() const { return GetHash(X, Y); }
+    static uint64_t GetHash(int32_t x, int32_t y) { return (uint64_t(uint32_t(x)) << 32) | uint32_t(y); }
 };
 
 enum class MapCellState : uint8_t
@@ -33,17 +35,44 @@ namespace MapCellFlags
     static constexpr uint8_t Reversed = (1u << 5);
 }
 
-static constexpr uint8_t MapCellInvalidTile = 0xff;
-static constexpr uint8_t MapCellInvalidLightZone = 0xff;
+static constexpr uint16_t MapCellInvalidTile = 0xffff;
+static constexpr uint16_t MapCellInvalidLightZone = 0xffff;
 
-struct MapCell  //pad to 64 bits
+struct MapCell  //pad to 128 bits
 {
     MapCellState State = MapCellState::Empty;
     uint8_t Flags = 0;
-    uint8_t LightZone = MapCellInvalidLightZone;
     uint8_t ParamState = 0;
+    uint8_t Reserved = 0;
 
-    uint8_t Tiles[4] = { MapCellInvalidTile, MapCellInvalidTile, MapCellInvalidTile, MapCellInvalidTile };
+    uint16_t LightZone = MapCellInvalidLightZone;
+    uint16_t Reserved2 = 0;
+
+    uint16_t Tiles[4] = { MapCellInvalidTile, MapCellInvalidTile, MapCellInvalidTile, MapCellInvalidTile };
+};
+
+// the map is split into square chunks of cells, chunks that have nothing in them are never allocated
+static constexpr int MapChunkShift = 4;
+static constexpr int MapChunkSize = 1 << MapChunkShift;
+static constexpr int MapChunkMask = MapChunkSize - 1;
+static constexpr int MapChunkCellCount = MapChunkSize * MapChunkSize;
+
+// the chunk table has a slot for every chunk in the map, this keeps it to 256MB, a map about 130000 cells square
+static constexpr uint64_t MapMaxChunkSlots = uint64_t(1) << 26;
+
+inline bool IsValidMapSize(uint64_t width, uint64_t height)
+{
+    uint64_t chunksX = (width + MapChunkMask) >> MapChunkShift;
+    uint64_t chunksY = (height + MapChunkMask) >> MapChunkShift;
+    return width <= uint64_t(INT32_MAX) && height <= uint64_t(INT32_MAX) && chunksX * chunksY <= MapMaxChunkSlots;
+}
+
+struct MapChunk
+{
+    // where the chunk is, in chunks
+    MapCoordinate Origin;
+
+    MapCell Cells[MapChunkCellCount];
 };
 
 struct LightingInfo
@@ -72,31 +101,126 @@ struct LightZoneInfo
     void Reset();
 };
 
+// a part of the map that comes from one level of the world, its objects are spawned and removed as the player moves around
+struct MapRegion
+{
+    std::string Name;
+
+    // in cells
+    Rectangle Bounds = { 0 };
+
+    bool Loaded = false;
+};
+
 struct Map
 {
-    std::vector<MapCell> Cells;
+    // in cells
     MapCoordinate Size;
+
+    // in chunks, each slot is the index of the chunk + 1, or 0 if there is nothing in that part of the map
+    MapCoordinate ChunkCount;
+    std::vector<uint32_t> ChunkSlots;
+    std::vector<std::unique_ptr<MapChunk>> Chunks;
+
     Texture Tilemap = { 0 };
+
+    // the tilemap texture is referenced by name, it is released when the map is cleared
+    std::string TilemapName;
     std::vector<Rectangle> TileSourceRects;
 
     LightingInfo LightInfo;
 
     std::vector<LightZoneInfo> LightZones;
 
-    MapCell GetCell(int x, int y) const;
+    std::vector<MapRegion> Regions;
+
+    static inline const MapCell InvalidCell = { MapCellState::Invalid };
+    static inline const MapCell EmptyCell = {};
+
+    // sets the size of the map in cells and removes all the chunks
+    void SetSize(int width, int height)
+    {
+        Size.X = width;
+        Size.Y = height;
+        ChunkCount.X = (width + MapChunkMask) >> MapChunkShift;
+        ChunkCount.Y = (height + MapChunkMask) >> MapChunkShift;
+
+        Chunks.clear();
+        ChunkSlots.assign(size_t(ChunkCount.X) * size_t(ChunkCount.Y), 0);
+    }
+
+    inline bool IsInMap(int x, int y) const { return x >= 0 && y >= 0 && x < Size.X && y < Size.Y; }
+
+    inline size_t GetChunkSlot(int x, int y) const { return size_t(y >> MapChunkShift) * size_t(ChunkCount.X) + size_t(x >> MapChunkShift); }
+    static inline size_t GetChunkCellIndex(int x, int y) { return (size_t(y & MapChunkMask) << MapChunkShift) | size_t(x & MapChunkMask); }
+
+    // the chunk that holds a cell, null if it is outside the map or has not been allocated
+    inline const MapChunk* FindChunk(int x, int y) const
+    {
+        if (!IsInMap(x, y))
+            return nullptr;
+
+        uint32_t slot = ChunkSlots[GetChunkSlot(x, y)];
+        return slot == 0 ? nullptr : Chunks[slot - 1].get();
+    }
+
+    // the chunk that holds a cell, allocated if needed, the cell must be in the map
+    MapChunk& AddChunk(int x, int y)
+    {
+        uint32_t& slot = ChunkSlots[GetChunkSlot(x, y)];
+        if (slot == 0)
+        {
+            auto chunk = std::make_unique<MapChunk>();
+            chunk->Origin = MapCoordinate{ x >> MapChunkShift, y >> MapChunkShift };
+            Chunks.push_back(std::move(chunk));
+            slot = uint32_t(Chunks.size());
+        }
+
+        return *Chunks[slot - 1];
+    }
+
+    // adds a chunk that was built elsewhere, its origin must be in the map and not already have a chunk
+    void InsertChunk(std::unique_ptr<MapChunk> chunk)
+    {
+        uint32_t& slot = ChunkSlots[size_t(chunk->Origin.Y) * size_t(ChunkCount.X) + size_t(chunk->Origin.X)];
+        Chunks.push_back(std::move(chunk));
+        slot = uint32_t(Chunks.size());
+    }
+
+    // cells in chunks that were never allocated are empty, cells outside the map are invalid
+    inline const MapCell& GetCellRef(int x, int y) const
+    {
+        if (!IsInMap(x, y))
+            return InvalidCell;
+
+        uint32_t slot = ChunkSlots[GetChunkSlot(x, y)];
+        if (slot == 0)
+            return EmptyCell;
+
+        return Chunks[slot - 1]->Cells[GetChunkCellIndex(x, y)];
+    }
+
+    inline MapCell GetCell(int x, int y) const { return GetCellRef(x, y); }
+
+    // allocates the chunk the cell is in, writes outside the map go to a scratch cell
     MapCell& GetCellRef(int x, int y);
-    const MapCell& GetCellRef(int x, int y) const;
+
+    // for cells kept by index, like door cells
+    MapCell& GetCellRef(size_t index) { return GetCellRef(int(index % size_t(Size.X)), int(index / size_t(Size.X))); }
+
     bool IsCellSolid(int x, int y) const;
     bool IsCellPassable(int x, int y) const;
     bool IsCellCapped(int x, int y) const;
     void Clear();
 
-    inline size_t GetCellIndex(int x, int y) const { return y * Size.X + x; }
+    inline size_t GetCellIndex(int x, int y) const { return size_t(y) * size_t(Size.X) + size_t(x); }
 
+    // slides along the walls, desiredMotion becomes the motion that can really be made. see SweptCollision
     bool MoveEntity(Vector3& position, Vector3& desiredMotion, float radius);
 
-    std::vector<size_t> DoorCells;
+    // the first cell that can't be walked on that a circle moving from start by motion touches, time is from 0 to 1 along the motion.
+    // the whole path is checked however long it is, so fast movers can't skip over a wall
+    bool SweepCircle(const Vector2& start, const Vector2& motion, float radius, float* time, Vector2* normal) const;
 
-private:
-    void PointNearesGridPoint(int x, int y, const Vector3 point, Vector3* nearest, Vector3* normal);
+    std::vector<size_t> DoorCells;
 };
\ No newline at end of file
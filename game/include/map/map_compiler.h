@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// converts LDtk projects into compiled maps, LDtk stays the format maps are made in.
+// used by the map tool ahead of time and by the map reader when there is no up to date compiled map
+namespace MapCompiler
+{
+    // returns false and sets the error if the project can't be read or is missing the layers a map needs
+    bool CompileLDtk(const uint8_t* data, size_t size, std::vector<uint8_t>& output, std::string& error);
+}
@@ -1,5 +1,50 @@
 #pragma once
 
+#include <cstddef>
+#include <string>
+
 class Scene;
 
-void ReadWorld(const char* fileName, Scene& world);
\ No newline at end of file
+// spawns the objects of the regions of a loaded map, the scene keeps it while the map is loaded so regions can come and go
+class MapRegionLoader
+{
+public:
+    virtual ~MapRegionLoader() = default;
+
+    // the scene has made the region's root object, every object is added to it with Scene::AddMapObject
+    virtual void LoadRegion(size_t region) = 0;
+
+    // the scene has removed the region's objects, this puts back anything they changed in the map
+    virtual void UnloadRegion(size_t region) = 0;
+};
+
+// how long each phase of a map load took, in milliseconds
+struct MapLoadReport
+{
+    std::string MapName;
+
+    // reading the compiled map, or compiling the LDtk project when there is no up to date one
+    double ParseMS = 0;
+
+    // copying and checking the cells of every chunk, split across the job pool threads
+    double DecodeMS = 0;
+
+    // finding the models and textures the regions around the start use
+    double CollectMS = 0;
+
+    // loading all of those at once, this is as long as the slowest of them
+    double PrefetchMS = 0;
+
+    // spawning the objects of the regions around the start
+    double SpawnMS = 0;
+
+    double TotalMS = 0;
+
+    size_t ChunkCount = 0;
+    size_t AssetCount = 0;
+    size_t EntityCount = 0;
+};
+
+void ReadWorld(const char* fileName, Scene& world);
+
+const MapLoadReport& GetMapLoadReport();
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "map/map.h"
+
+#include <array>
+#include <vector>
+
+// what a cell is to something walking around the map
+enum class NavCell : uint8_t
+{
+    Blocked = 0,
+    Open,
+    Door,
+};
+
+// a copy of which cells of a map can be walked on, so searches can run on another thread while the game changes the map.
+// it is stored in the same chunks as the map, cells in chunks the map never allocated are open like the empty cells they are
+class NavigationGrid
+{
+public:
+    void Build(const Map& map);
+    void Clear();
+
+    inline const MapCoordinate& GetSize() const { return Size; }
+    inline const MapCoordinate& GetChunkCount() const { return ChunkCount; }
+    inline size_t GetChunkSlotCount() const { return ChunkSlots.size(); }
+    inline size_t GetChunkSlot(int x, int y) const { return size_t(y >> MapChunkShift) * size_t(ChunkCount.X) + size_t(x >> MapChunkShift); }
+
+    // changes every time any grid is built, so anything that keeps data per cell knows to throw it away
+    inline uint32_t GetVersion() const { return Version; }
+
+    inline bool IsInGrid(int x, int y) const { return x >= 0 && y >= 0 && x < Size.X && y < Size.Y; }
+
+    inline NavCell GetCell(int x, int y) const
+    {
+        if (!IsInGrid(x, y))
+            return NavCell::Blocked;
+
+        uint32_t slot = ChunkSlots[GetChunkSlot(x, y)];
+        if (slot == 0)
+            return NavCell::Open;
+
+        return Chunks[slot - 1][Map::GetChunkCellIndex(x, y)];
+    }
+
+    // doors open when something walks into them, so a search can go through them or treat them as walls
+    inline bool IsWalkable(int x, int y, bool openDoors) const
+    {
+        NavCell cell = GetCell(x, y);
+        return cell == NavCell::Open || (openDoors && cell == NavCell::Door);
+    }
+
+private:
+    MapCoordinate Size;
+    MapCoordinate ChunkCount;
+
+    std::vector<uint32_t> ChunkSlots;
+    std::vector<std::array<NavCell, MapChunkCellCount>> Chunks;
+
+    uint32_t Version = 0;
+};
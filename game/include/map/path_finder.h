@@ -0,0 +1,102 @@
+#pragma once
+
+#include "map/navigation_grid.h"
+
+#include <memory>
+#include <vector>
+
+enum class PathAlgorithm : uint8_t
+{
+    // jump point search, only the cells where the path turns are put on the open list
+    JPS = 0,
+
+    // plain A* over every cell, kept to check JPS against
+    AStar,
+
+    // a search over the clusters of the map first, then over the cells of each piece of that route. PathFinder treats it as JPS
+    Hierarchical,
+};
+
+struct PathQuery
+{
+    MapCoordinate Start;
+    MapCoordinate Goal;
+
+    bool OpenDoors = true;
+    PathAlgorithm Algorithm = PathAlgorithm::JPS;
+
+    // the search gives up after this many nodes, 0 is no limit. an unreachable goal on a big open map searches all of it otherwise
+    size_t MaxExpansions = 0;
+};
+
+struct PathSearchResult
+{
+    bool Found = false;
+
+    // from the start to the goal, JPS gives the cells where the path changes direction, A* gives every cell
+    std::vector<MapCoordinate> Points;
+
+    // in cells, diagonal steps cost the square root of 2
+    float Cost = 0;
+
+    size_t Expanded = 0;
+};
+
+// finds paths on a navigation grid moving in 8 directions, diagonals can't cut the corner of a blocked cell.
+// the node memory is kept between searches and only cleared when the grid is built again, so one finder should be used per thread
+class PathFinder
+{
+public:
+    bool FindPath(const NavigationGrid& grid, const PathQuery& query, PathSearchResult& result);
+
+private:
+    struct Node
+    {
+        uint32_t Generation = 0;
+        bool Closed = false;
+        float G = 0;
+        MapCoordinate Parent;
+    };
+
+    using NodeBlock = std::array<Node, MapChunkCellCount>;
+
+    struct OpenEntry
+    {
+        float F = 0;
+        float G = 0;
+        MapCoordinate Cell;
+
+        bool operator > (const OpenEntry& other) const { return F > other.F || (F == other.F && G < other.G); }
+    };
+
+    void StartSearch(const NavigationGrid& grid, const PathQuery& query);
+
+    Node& GetNode(int x, int y);
+
+    inline bool IsWalkable(int x, int y) const { return Grid->IsWalkable(x, y, OpenDoors); }
+
+    float GetHeuristic(int x, int y) const;
+
+    void AddOpen(int x, int y, float g, const MapCoordinate& parent);
+
+    void ExpandAStar(const MapCoordinate& cell, float g);
+    void ExpandJPS(const MapCoordinate& cell, const Node& node, float g);
+
+    bool JumpStraight(int x, int y, int dx, int dy, MapCoordinate& jumpPoint) const;
+    bool Jump(int x, int y, int dx, int dy, MapCoordinate& jumpPoint) const;
+
+    const NavigationGrid* Grid = nullptr;
+    uint32_t GridVersion = 0;
+
+    bool OpenDoors = true;
+    MapCoordinate Goal;
+
+    // nodes are stamped with the search that last used them, so nothing is cleared between searches
+    uint32_t Generation = 0;
+
+    // node blocks are made for each map chunk a search reaches, and kept
+    std::vector<uint32_t> NodeSlots;
+    std::vector<std::unique_ptr<NodeBlock>> NodeBlocks;
+
+    std::vector<OpenEntry> OpenList;
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "map/map.h"
+#include "utilities/spatial_grid.h"
+
+#include "raylib.h"
+
+#include <cstdint>
+#include <vector>
+
+class GameObject;
+
+enum class RayHitType : uint8_t
+{
+    None = 0,
+    Wall,
+    Door,
+    Floor,
+    Ceiling,
+    Object,
+    Mob,
+    Player,
+};
+
+// what a ray can hit
+namespace RayHitMask
+{
+    static constexpr uint8_t Walls = (1u << 0);
+    static constexpr uint8_t Doors = (1u << 1);
+    static constexpr uint8_t FloorAndCeiling = (1u << 2);
+    static constexpr uint8_t Objects = (1u << 3);
+    static constexpr uint8_t Mobs = (1u << 4);
+    static constexpr uint8_t Player = (1u << 5);
+
+    static constexpr uint8_t All = 0xff;
+
+    // what blocks seeing something, but not the things that could be looked at
+    static constexpr uint8_t Sight = Walls | Doors | Objects;
+}
+
+// a ray in map space, z is up from the floor. a 2D ray is one with no z in its direction
+struct RayQuery
+{
+    Vector3 Origin = { 0, 0, 0.5f };
+
+    // doesn't have to be normalized
+    Vector3 Direction = { 1, 0, 0 };
+
+    float MaxDistance = 100;
+    uint8_t Mask = RayHitMask::All;
+
+    // skipped, like the mob doing the shooting
+    const GameObject* Ignore = nullptr;
+};
+
+struct RayHit
+{
+    RayHitType Type = RayHitType::None;
+
+    // along the ray from its origin
+    float Distance = 0;
+
+    Vector3 Point = { 0, 0, 0 };
+    Vector3 Normal = { 0, 0, 0 };
+
+    // the cell the hit is in, or the wall or door cell that was hit
+    MapCoordinate Cell;
+
+    // the object, mob or player that was hit
+    GameObject* Object = nullptr;
+};
+
+// finds the first thing rays hit, walls and closed doors come from walking the map grid the same way the renderer does,
+// boxes for solid objects and upright capsules for mobs and the player are found through a spatial grid of the cells they cover.
+// add the bodies and build the index once a frame, then cast as many rays as needed. casting is read only, so batches of rays are
+// spread over the job pool threads
+class RayQueryWorld
+{
+public:
+    // walls are as tall as a cell is wide
+    static constexpr float WallHeight = 1;
+
+    void SetMap(const Map* map) { WorldMap = map; }
+
+    void ClearBodies();
+    void AddBox(const BoundingBox& bounds, GameObject* owner);
+
+    // base is the bottom of the capsule
+    void AddCapsule(const Vector3& base, float radius, float height, RayHitType type, GameObject* owner);
+
+    // after the bodies are added and before rays are cast
+    void BuildIndex();
+
+    inline size_t GetBodyCount() const { return Bodies.size(); }
+
+    bool CastRay(const RayQuery& query, RayHit& hit) const;
+
+    // hits is resized to match the queries, rays that hit nothing have the type None
+    void CastRays(const std::vector<RayQuery>& queries, std::vector<RayHit>& hits) const;
+
+private:
+    static constexpr size_t RaysPerBatch = 64;
+
+    // below this the rays are all cast on the calling thread
+    static constexpr size_t ParallelRayCount = 256;
+
+    struct Body
+    {
+        RayHitType Type = RayHitType::Object;
+        GameObject* Owner = nullptr;
+
+        // boxes
+        Vector3 Min = { 0, 0, 0 };
+        Vector3 Max = { 0, 0, 0 };
+
+        // capsules, the line between the centers of the two end spheres
+        Vector3 Bottom = { 0, 0, 0 };
+        Vector3 Top = { 0, 0, 0 };
+        float Radius = 0;
+    };
+
+    static uint8_t GetMask(RayHitType type);
+    static bool IntersectBody(const Body& body, const Vector3& origin, const Vector3& direction, float& distance, Vector3& normal);
+
+    const Map* WorldMap = nullptr;
+
+    std::vector<Body> Bodies;
+    std::vector<Rectangle> Footprints;
+    SpatialGrid BodyGrid;
+};
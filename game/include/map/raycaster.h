@@ -3,6 +3,8 @@
 #include "map.h"
 #include "raymath.h"
 
+#include <array>
+
 // used to know what side of a grid was hit
 enum class HitNormals : uint8_t
 {
@@ -25,9 +27,9 @@ struct RayResult
     HitNormals Normal;
 
     // what kind of grid cell was hit
-    uint8_t HitGridType = 0;
+    uint16_t HitGridType = 0;
 
-    int HitCellIndex = -1;
+    int64_t HitCellIndex = -1;
     MapCoordinate TargetCell;
 };
 
@@ -69,7 +71,9 @@ protected:
     Vector2 CameraPlane;
     Vector2 NominalCameraPlane;
 
-    std::vector<uint8_t> CellStatus;
-    std::vector<size_t> HitCells;
+    // cell visibility is kept per map chunk, and only for chunks a ray has reached
+    std::vector<uint32_t> VisibilitySlots;
+    std::vector<std::array<uint8_t, MapChunkCellCount>> VisibilityChunks;
+
     std::vector<MapCoordinate> HitCellLocs;
 };
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "game_object.h"
 #include "system.h"
 #include "map/map.h"
+#include "map/map_reader.h"
 #include "map/raycaster.h"
 
 #include "game.h"
@@ -21,17 +22,49 @@ public:
     void Cleanup();
 
     void Load(std::string_view map);
+
+    // reads the current map again, replacing everything that came from it. objects that are not from the map, like the player, are kept
     void ReloadMap();
 
+    const std::string& GetMapName() const { return CurrentWorldMap; }
+
+    // sent to the app after the map is reloaded
+    static constexpr char MapReloaded[] = "MapReloaded";
+
     GameObject* AddObject();
 
+    // adds an object that belongs to a region of the map, it is removed when the region is unloaded or the map is reloaded
+    GameObject* AddMapObject(size_t region);
+
+    // spawns or removes the objects of one region of the map, the cells of every region are always loaded
+    void LoadRegion(size_t region);
+    void UnloadRegion(size_t region);
+
+    // loads the regions near a position and unloads the far ones, keeping to the region budget.
+    // at most maxLoads regions are spawned per call, so walking into a new area doesn't spawn everything in one frame
+    void UpdateRegions(const Vector3& position, size_t maxLoads);
+
+    // the regions UpdateRegions would keep loaded at a position, nearest first
+    std::vector<size_t> GetWantedRegions(const Vector3& position) const;
+
+    size_t GetLoadedRegionCount() const;
+
+    // set by the map reader, it spawns the objects of each region
+    void SetRegionLoader(std::unique_ptr<MapRegionLoader> loader) { RegionLoader = std::move(loader); }
+
     Map& GetMap() { return WorldMap; }
     const Map& GetMap() const { return WorldMap; }
 
     Raycaster& GetRaycaster() { return WorldRaycaster; }
 
+protected:
+    // removes every map object, then the map
+    void ClearMap();
+
 protected:
     std::unique_ptr<GameObject> RootObject;
+    std::vector<std::unique_ptr<GameObject>> RegionRootObjects;
+    std::unique_ptr<MapRegionLoader> RegionLoader;
 
     Map WorldMap;
     Raycaster WorldRaycaster;
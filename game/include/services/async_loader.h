@@ -0,0 +1,35 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+namespace AsyncLoader
+{
+    // a load split into the part that can run on a worker thread (file reads and decoding),
+    // and the part that has to run on the main thread (anything that touches the GPU or audio device)
+    class LoadJob;
+    using JobPtr = std::shared_ptr<LoadJob>;
+
+    void Init();
+
+    // stops the workers, jobs that have not been uploaded are dropped without running their upload step
+    void Cleanup();
+
+    // queues a load, the work step runs on a worker thread and the upload step runs on the main thread during ProcessUploads.
+    // when async loading is off both steps run before this returns
+    JobPtr QueueLoad(std::function<void()> work, std::function<void()> upload);
+
+    // runs the upload steps of finished jobs until the time budget is used up, at least one runs per call so loading always moves forward
+    void ProcessUploads(float budgetSeconds);
+
+    // finishes a job right now, doing or waiting for its work step and then running its upload, for code that can't wait for the result
+    void Complete(JobPtr job);
+
+    // finishes every queued job
+    void CompleteAll();
+
+    bool IsDone(const JobPtr& job);
+
+    // jobs that have been queued and not yet uploaded
+    size_t GetPendingCount();
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "utilities/behavior_tree.h"
+
+#include <memory>
+#include <string_view>
+
+// the behavior trees mobs run, compiled from the tables listed in the behavior manifest the first time each one is asked for.
+// a behavior that is missing or doesn't compile falls back to the built in default, so a broken table never leaves a mob with nothing to do
+namespace BehaviorManager
+{
+    static constexpr char DefaultBehavior[] = "mob";
+
+    void Init();
+    void Cleanup();
+
+    std::shared_ptr<const BehaviorTree> GetBehavior(std::string_view name);
+
+    // forgets the compiled trees so the next request reads the tables again, mobs keep the tree they have until they are respawned
+    void Reload();
+};
@@ -29,6 +29,9 @@ struct CharacterInfo
     bool IsYUp = false;
     std::unordered_map<CharacterAnimationState, std::string> SequenceNames;
     std::string ShadowTexture;
+
+    // the behavior from the behavior manifest the character runs, the default when it is empty
+    std::string BehaviorName;
 };
 
 namespace CharacterManager
@@ -10,6 +10,28 @@ namespace GlobalVars
     extern int FPSCap;
     extern bool UseMouseDrag;
 
+    extern bool UseAnimationLOD;
+    extern float AnimationLODScale;
+
+    extern bool UseAsyncLoading;
+    extern float UploadBudgetMS;
+
+    extern bool UseLooseFileOverlay;
+    extern bool ShowCacheStats;
+
+    extern bool UseCompressedTextures;
+
+    extern bool UseHotReload;
+
+    extern bool UseCompiledMaps;
+
+    extern int MaxLoadedRegions;
+    extern float RegionLoadDistance;
+    extern float RegionUnloadDistance;
+
+    extern bool UseCrowdSeparation;
+    extern int PerceptionRaysPerFrame;
+
     extern float MasterVolume;
 
     extern bool Paused;
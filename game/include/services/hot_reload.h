@@ -0,0 +1,20 @@
+#pragma once
+
+// watches the resource folder and reloads what changed while the game runs, tables, textures, shaders, models and the map.
+// everything happens on the main thread at the start of a frame
+namespace HotReload
+{
+    // sent to the app after shaders were rebuilt, everything that holds a shader has to get it again
+    static constexpr char ShadersReloaded[] = "ShadersReloaded";
+
+    void Init();
+    void Cleanup();
+
+    // starts or stops watching, for when GlobalVars::UseHotReload changes
+    void SetEnabled(bool enabled);
+
+    // true if the kernel reports changes, false if the files are polled
+    bool UsesNotifications();
+
+    void Update();
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+// worker threads for splitting a frame's work across the cores, separate from the async loader so
+// gameplay batches never wait behind an asset that is decoding, and keep running when async loading is off
+namespace JobPool
+{
+    void Init();
+
+    // waits for the batch running now, then stops the workers
+    void Cleanup();
+
+    inline size_t GetBatchCount(size_t count, size_t batchSize)
+    {
+        return batchSize > 0 ? (count + batchSize - 1) / batchSize : 0;
+    }
+
+    // splits count items into batches of batchSize and calls work(first, last, batch) for each one on the workers and this thread,
+    // returns once every batch is done. batches run at the same time, so each one should only write to its own items.
+    // a call made while another is running, or from inside a batch, runs its batches on the calling thread
+    void ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t first, size_t last, size_t batch)>& work);
+};
@@ -8,29 +8,49 @@
 #include <string_view>
 #include <string>
 #include <unordered_map>
+#include <map>
 
 class ModelInstance;
-
+class ResourceCache;
 
 class ModelRecord
 {
 public:
-    virtual ~ModelRecord() = default;
+    virtual ~ModelRecord();
 
     Models::AnimateableModel ModelGeometry;
 
+    // false while the model is loading in the background, nothing in the geometry or animations can be used until it is set.
+    // a model that fails to load is never ready
+    bool Ready = false;
+
     BoundingBox GetBounds();
 
     Matrix OrientationTransform = MatrixIdentity();
 
+    // the files the model and its animations were read from
+    std::string SourceFile;
+    std::string AnimationFile;
+
+    // counts each time the geometry is replaced after it was ready, instances set themselves up again when it changes
+    int Generation = 0;
+
+    // called after the geometry or animations were replaced, drops anything built from the old ones
+    virtual void GeometryChanged();
+
+    // the cache the record is in, instances are its references. records that are never evicted have no cache
+    ResourceCache* Cache = nullptr;
+    size_t CacheKey = 0;
+
 protected:
-    size_t ReferenceCount = 0;
     BoundingBox Bounds = { 0 };
     bool BoundsValid = false;
 protected:
     friend ModelInstance;
-    std::shared_ptr<ModelInstance> GetModelInstance();
 
+    void AddInstance();
+
+    // the record can be evicted and deleted by this, so nothing can use it after
     void ReleaseInstance();
 
     void CheckBounds();
@@ -40,6 +60,27 @@ class AnimatedModelRecord : public ModelRecord
 {
 public:
     Models::AnimationSet Animations;
+
+    // gets the reduced skeleton for a bone depth, building it the first time it is asked for
+    const Models::AnimatableBoneLOD& GetBoneLOD(int maxDepth);
+
+    void GeometryChanged() override;
+
+protected:
+    std::map<int, Models::AnimatableBoneLOD> BoneLODs;
+};
+
+// how often and how completely an animated instance's pose is evaluated
+struct AnimationLOD
+{
+    // the distance from the viewer this level is used up to, 0 for no limit
+    float MaxDistance = 0;
+
+    // seconds between pose updates, 0 updates every frame
+    float UpdateInterval = 0;
+
+    // bones deeper than this in the skeleton follow their parent, negative evaluates every bone
+    int MaxBoneDepth = -1;
 };
 
 class ModelInstance
@@ -51,10 +92,28 @@ public:
     virtual void Draw(class TransformComponent& transform);
     ModelInstance(ModelRecord* geomeetry);
 
+    // each instance is one reference to the geometry
+    ModelInstance(const ModelInstance&) = delete;
+    ModelInstance& operator = (const ModelInstance&) = delete;
+
     void SetShader(Shader shader);
 
+    // true once the geometry has loaded, the first time it is seen the instance sets itself up for it.
+    // an instance of a model that is still loading draws nothing
+    bool CheckGeometry();
+
 protected:
     std::vector<Material> MaterialOverrides;
+
+    // kept so it can be applied when the geometry arrives
+    Shader OverrideShader = { 0 };
+
+    bool GeometryReady = false;
+
+    // the generation of the geometry the instance was set up for
+    int GeometryGeneration = 0;
+
+    virtual void OnGeometryReady();
 };
 
 class AnimatedModelInstance : public ModelInstance
@@ -65,6 +124,13 @@ public:
     AnimatedModelInstance(AnimatedModelRecord* model);
 
     void Advance(float dt);
+
+    // advances the animation, only evaluating the pose as often and as completely as the level of detail allows
+    void Advance(float dt, const AnimationLOD& lod);
+
+    // advances the animation time without updating the pose, for instances that can not be seen
+    void AdvanceTime(float dt);
+
     void Draw(class TransformComponent& transform) override;
     
     void SetSequence(const std::string& name, int startFrame = 0);
@@ -80,11 +146,27 @@ protected:
     float CurrentParam = 0;
 
     Models::AnimatableSequence* CurrentAnimaton = nullptr;
+    std::string CurrentSequenceName;
 
     Models::AnimateablePose CurrentPose;
 
+    // a sequence set before the model finished loading, it starts once the model is ready
+    std::string PendingSequence;
+    int PendingStartFrame = 0;
+
+    // the pose shared from the baked pose cache, used instead of the current pose when set
+    Models::AnimationPoseCache::PosePtr SharedPose;
+
     float AnimationAccumulator = 0;
     float AnimationFPSMultiply = 1;
+
+    // time since the pose was last evaluated
+    float PoseAge = 0;
+    bool PoseValid = false;
+
+    void UpdatePose(int maxBoneDepth);
+
+    void OnGeometryReady() override;
 };
 
 namespace ModelManager
@@ -95,4 +177,24 @@ namespace ModelManager
     std::shared_ptr<ModelInstance> GetModel(std::string_view name);
     std::shared_ptr<AnimatedModelInstance> GetAnimatedModel(std::string_view name);
     void UnloadAll();
+
+    Models::AnimationPoseCache& GetPoseCache();
+
+    // gets the level of detail to use for an animated model at a distance from the viewer
+    const AnimationLOD& GetAnimationLOD(float distance);
+
+    // the largest difference between the packed pose kernel and the reference interpolation, across every loaded animation.
+    // with one sample per frame only the keyframes are compared
+    float GetPoseKernelError(int samplesPerFrame);
+
+    // runs the binary reader checks, then feeds cut off and damaged copies of every loaded model and animation file through the readers.
+    // returns how many checks failed, with a line for each in failures
+    int RunReaderChecks(std::vector<std::string>& failures);
+
+    // reads the models and animations that use a file that changed again, the instances of them keep their state.
+    // a model that can't be read keeps its old geometry. returns true if any were reloaded
+    bool ReloadModels(std::string_view fileName);
+
+    // gets the textures of every loaded model again, after a reload replaced some of them
+    void RefreshTextures();
 };
\ No newline at end of file
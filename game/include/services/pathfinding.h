@@ -0,0 +1,87 @@
+#pragma once
+
+#include "map/flow_field.h"
+#include "map/hierarchical_graph.h"
+#include "map/path_finder.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// finds paths across the current map on a worker thread, so mobs can ask for a path and pick it up on a later frame.
+// the searches run on a copy of the map's walkable cells taken when the map loads, doors in the copy stay doors whatever state they are in.
+// hierarchical requests share the cluster graphs and their cached routes, one where doors open for whatever walks into them
+// and one that follows which doors are open right now. the shared flow field is built on a thread of its own
+namespace Pathfinding
+{
+    using RequestID = uint64_t;
+    static constexpr RequestID InvalidRequest = 0;
+
+    enum class PathStatus
+    {
+        // the request was never made, was canceled or its result was already taken
+        Unknown,
+        Pending,
+        Found,
+        NotFound,
+    };
+
+    void Init();
+
+    // stops the workers, pending requests are dropped
+    void Cleanup();
+
+    // copies the walkable cells of the map for the searches, requests that have not finished are answered with NotFound
+    void SetMap(const Map& map);
+
+    RequestID RequestPath(const MapCoordinate& start, const MapCoordinate& goal, bool openDoors = true, PathAlgorithm algorithm = PathAlgorithm::Hierarchical);
+
+    // when the search is done the points are moved out and the request is forgotten
+    PathStatus GetPath(RequestID request, std::vector<MapCoordinate>& points);
+
+    void CancelPath(RequestID request);
+
+    // the cell the shared flow field leads to, usually the player's. the field is only built again when the cell changes
+    void SetFlowTarget(const MapCoordinate& cell);
+
+    // the latest field, it can be a frame or so behind the target. hold on to it for the frame instead of asking for every mob
+    std::shared_ptr<const FlowField> GetFlowField();
+
+    // for the doors the map changes while it runs, hierarchical searches that don't open doors go around the closed ones
+    void SetDoorOpen(const MapCoordinate& cell, bool open);
+
+    // searches on the calling thread, only call this from the main thread. hierarchical queries are searched with JPS,
+    // the cluster graphs belong to the worker
+    bool FindPathNow(const PathQuery& query, PathSearchResult& result);
+
+    struct BenchmarkReport
+    {
+        int MapSize = 0;
+        int Queries = 0;
+
+        double JPSMS = 0;
+        double AStarMS = 0;
+
+        // the first pass builds the clusters it walks through, the second runs the same queries again with the clusters and cached routes
+        double HierarchicalMS = 0;
+        double HierarchicalCachedMS = 0;
+
+        size_t JPSExpanded = 0;
+        size_t AStarExpanded = 0;
+        size_t HierarchicalExpanded = 0;
+
+        size_t ClustersBuilt = 0;
+        size_t CacheHits = 0;
+
+        int Found = 0;
+
+        // queries where the searches disagree on whether there is a path, or JPS and A* on what it costs, should always be 0
+        int Mismatches = 0;
+
+        // how much longer the hierarchical paths are than the best ones, in percent
+        float HierarchicalOverhead = 0;
+    };
+
+    // generates a square map of rooms with doors and rubble, then times JPS, A* and the hierarchical search on the same random start and goal pairs
+    BenchmarkReport RunBenchmark(int mapSize, int queries, uint32_t seed);
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class Table;
+
+// keeps the books for a service that loads things, how much memory each entry uses and how many users it has.
+// entries with no users are kept, most recently used first, until the cache goes over budget, then the oldest are evicted through the callback.
+// the cache only tracks entries, the owning service stores and frees them.
+// it is not thread safe, a service used from the loader threads locks around it and gives the cache its mutex,
+// which SetBudget and GetStats take, since the console and overlay call those
+class ResourceCache
+{
+public:
+    using EvictCallback = std::function<void(size_t key)>;
+
+    struct Stats
+    {
+        size_t Entries = 0;
+        size_t ReferencedEntries = 0;
+
+        size_t CPUBytes = 0;
+        size_t GPUBytes = 0;
+
+        size_t Hits = 0;
+        size_t Misses = 0;
+        size_t Evictions = 0;
+    };
+
+    // budgets are in bytes, 0 is no limit
+    ResourceCache(std::string_view name, EvictCallback onEvict, size_t cpuBudget = 0, size_t gpuBudget = 0, std::mutex* ownerMutex = nullptr);
+    ~ResourceCache();
+
+    ResourceCache(const ResourceCache&) = delete;
+    ResourceCache& operator = (const ResourceCache&) = delete;
+
+    // adds an entry, or updates the size of one that is already there and adds to its users.
+    // when that makes the cache bigger, older unused entries are evicted to get back in budget, but never the one being added or sized,
+    // so the owner can still use it when this returns
+    void Add(size_t key, size_t cpuBytes, size_t gpuBytes = 0, size_t references = 0);
+    void SetSize(size_t key, size_t cpuBytes, size_t gpuBytes = 0);
+
+    bool Contains(size_t key) const;
+
+    // adds a user to an entry, returns false if the entry is not in the cache. every call counts as a hit or a miss
+    bool AddReference(size_t key);
+
+    // removes a user, once an entry has no users it can be evicted
+    void ReleaseReference(size_t key);
+
+    size_t GetReferenceCount(size_t key) const;
+    size_t GetGPUBytes(size_t key) const;
+
+    // drops an entry without calling the evict callback, for owners that unload it themselves
+    void Remove(size_t key);
+    void Clear();
+
+    void SetBudget(size_t cpuBytes, size_t gpuBytes);
+    size_t GetCPUBudget() const { return CPUBudget; }
+    size_t GetGPUBudget() const { return GPUBudget; }
+
+    // evicts unused entries, oldest first, until the cache is within budget
+    void Trim();
+
+    const std::string& GetName() const { return Name; }
+    Stats GetStats() const;
+
+    // every cache that exists, for the stats overlay and budget settings
+    static const std::vector<ResourceCache*>& GetCaches();
+    static ResourceCache* FindCache(std::string_view name);
+
+    // sets the budgets of the caches from a table of cache name to cpu kb:gpu kb
+    static void LoadBudgets(const Table* budgetTable);
+
+protected:
+    struct CacheEntry
+    {
+        size_t References = 0;
+        size_t CPUBytes = 0;
+        size_t GPUBytes = 0;
+
+        // the place in the unused list, only valid while there are no references
+        std::list<size_t>::iterator UnusedItr;
+    };
+
+    std::string Name;
+    EvictCallback OnEvict;
+    std::mutex* OwnerMutex = nullptr;
+
+    std::unordered_map<size_t, CacheEntry> Entries;
+
+    // entries with no users, the most recently released at the front
+    std::list<size_t> UnusedEntries;
+
+    size_t CPUBudget = 0;
+    size_t GPUBudget = 0;
+
+    size_t CPUBytes = 0;
+    size_t GPUBytes = 0;
+
+    size_t Hits = 0;
+    size_t Misses = 0;
+    size_t Evictions = 0;
+
+    bool IsOverBudget() const;
+
+    // Trim, leaving the keep entry if there is one
+    void EvictUnused(const size_t* keep);
+};
@@ -3,6 +3,8 @@
 #include <string_view>
 #include <memory>
 
+class MappedFile;
+
 struct ResoureInfo
 {
     size_t NameHash = 0;
@@ -10,17 +12,39 @@ struct ResoureInfo
     uint8_t* DataBuffer = nullptr;
     size_t DataSize = 0;
 
+    // set when the data is a read only view of a memory mapped file or pack instead of a loaded copy
+    std::shared_ptr<MappedFile> Mapping;
+
     ~ResoureInfo();
 };
 
+// resources can be opened and released from any thread, the async loader reads through here from its workers.
+// files are found in the mounted packs first, then in the resource folder, unless the loose file overlay is on,
+// then loose files win over pack entries
 namespace ResourceManager
 {
     void Init(std::string_view rootFolder);
     void Cleanup();
 
+    // mounts a pack file, entries in packs mounted later replace the same entries in earlier ones
+    bool MountPack(std::string_view packPath);
+    size_t GetMountedPackCount();
+    size_t GetPackEntryCount();
+
+    // true if the resource can be opened, without reading it
+    bool HasResource(std::string_view filePath);
+
     std::shared_ptr<ResoureInfo> OpenResource(std::string_view filePath, bool asText = false);
 
+    // maps a resource into memory instead of reading it, the data is read only and falls back to a normal load if the file can't be mapped
+    std::shared_ptr<ResoureInfo> MapResource(std::string_view filePath);
+
+    // every open or map is one reference that must be released, released resources stay cached until the memory budget needs the room
     void ReleaseResource(std::shared_ptr<ResoureInfo> resource);
     void ReleaseResource(const char* resourceName);
     void ReleaseResourceByData(void* resourceData);
+
+    // forgets the cached copy of a file that changed on disk, so the next open reads it again.
+    // anything still holding the old copy keeps using it until it is released
+    void InvalidateResource(std::string_view filePath);
 };
\ No newline at end of file
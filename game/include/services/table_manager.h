@@ -25,5 +25,9 @@ namespace TableManager
     void Cleanup();
 
     const Table* GetTable(std::string_view name);
+
+    // reads a table that is already loaded again, the table keeps its address so pointers to it stay valid.
+    // returns false if the table was never loaded
+    bool ReloadTable(std::string_view name);
     void UnloadAll();
 };
\ No newline at end of file
@@ -8,11 +8,39 @@ namespace TextureManager
     void Init();
     void Cleanup();
 
+    // gets a texture, loading it right away if it is not already loaded. the texture stays loaded until everything is unloaded
     Texture2D GetTexture(std::string_view name);
+
+    // gets a texture like GetTexture, but as a reference that must be released, once nothing references it the texture can be evicted
+    Texture2D AcquireTexture(std::string_view name);
+    void ReleaseTexture(std::string_view name);
+
+    // starts loading a texture in the background, the returned texture is empty until the load is done and then becomes the real one.
+    // the pointer is valid until the textures are unloaded
+    const Texture2D* RequestTexture(std::string_view name);
+
+    // starts loading a texture in the background without holding it, so a later GetTexture or AcquireTexture doesn't wait as long
+    void PrefetchTexture(std::string_view name);
+
+    // loads and decodes a texture's image without touching the GPU, this is safe to call from any thread
+    Image DecodeTexture(std::string_view name);
+
+    // adds a texture from an image decoded with DecodeTexture, the image is always unloaded.
+    // if the texture is already loaded the image is just dropped
+    Texture2D AddTexture(std::string_view name, Image& image);
+
     Texture2D GetTextureCubemap(std::string_view name);
     void UnloadAll();
 
     Shader GetShader(std::string_view name);
 
+    // reloads the textures that come from a file that changed. a texture with the same size and format is updated in place,
+    // otherwise it is replaced and true is returned, copies of the texture held elsewhere still have the old one until they get it again
+    bool ReloadTexture(std::string_view fileName);
+
+    // rebuilds the shaders that use a file that changed, returns true if any were rebuilt.
+    // shaders are handed out by value, so everything that holds one has to get it again
+    bool ReloadShaders(std::string_view fileName);
+
     size_t GetUsedVRAM();
 };
\ No newline at end of file
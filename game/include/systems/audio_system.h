@@ -1,6 +1,7 @@
 #pragma once
 
 #include "system.h"
+#include "services/resource_cache.h"
 
 #include <vector>
 #include <string>
@@ -19,11 +20,15 @@ public:
     bool IsPlaying(int instanceID);
     void Stop(int instanceID);
     void StopAll();
+    bool IsAnyPlaying() const;
 
     using Ptr = std::shared_ptr<SoundInstance>;
 
     SoundInstance(Sound sound);
     ~SoundInstance();
+
+    // replaces the sound, for placeholder instances when their sound finishes loading
+    void SetSource(Sound sound);
 private:
     Sound SourceSound = { 0 };
     std::vector<Sound> Aliases;
@@ -54,7 +59,21 @@ private:
     Sound* LoadSound(const std::string& name, const std::string_view& file);
 
 private:
-    std::unordered_map<std::string, SoundInstance::Ptr> LoadedSounds;
+    struct LoadedSound
+    {
+        SoundInstance::Ptr Instance;
+
+        // true while anything other than the system holds the instance, or it is playing
+        bool InUse = false;
+    };
+
+    void UpdateSoundReferences();
+
+    std::unordered_map<size_t, LoadedSound> LoadedSounds;
+    std::hash<std::string> StringHasher;
+
+    // sounds are shared pointers, so their references are found from the pointer use counts each update
+    ResourceCache SoundCache = ResourceCache("sounds", [this](size_t key) { LoadedSounds.erase(key); }, 64 * 1024 * 1024);
     const Table* AudioManifestTable = nullptr;
     std::thread AudioLoaderThread;
 
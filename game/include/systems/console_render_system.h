@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
 #include <functional>
 
 namespace ConsoleCommands
@@ -16,9 +17,34 @@ namespace ConsoleCommands
     static constexpr char ToggleDebug[] = "toggle_debug";
     static constexpr char ToggleShowCoordinates[] = "show_coordinates";
     static constexpr char ToggleVSync[] = "toggle_vsync";
+    static constexpr char ToggleAnimationLOD[] = "toggle_anim_lod";
+    static constexpr char ToggleAsyncLoading[] = "toggle_async_loading";
+    static constexpr char ToggleLooseFiles[] = "toggle_loose_files";
+    static constexpr char ToggleCacheStats[] = "toggle_cache_stats";
+    static constexpr char ToggleCompressedTextures[] = "toggle_compressed_textures";
+    static constexpr char ToggleHotReload[] = "toggle_hot_reload";
+    static constexpr char ToggleCrowdSeparation[] = "toggle_crowd";
 
     static constexpr char SetConsoleFontSize[] = "set_console_font";
     static constexpr char SetFPSCap[] = "set_fps_cap";
+    static constexpr char SetAnimationLODScale[] = "set_anim_lod_scale";
+    static constexpr char SetUploadBudget[] = "set_upload_budget";
+    static constexpr char SetCacheBudget[] = "set_cache_budget";
+    static constexpr char SetRegionBudget[] = "set_region_budget";
+    static constexpr char SetPerceptionBudget[] = "set_perception_budget";
+
+    static constexpr char CheckAnimationKernel[] = "check_anim_kernel";
+    static constexpr char CheckCollision[] = "check_collision";
+    static constexpr char CheckModelReader[] = "check_model_reader";
+    static constexpr char CheckTextureCompression[] = "check_texture_compression";
+    static constexpr char ShowMapLoadReport[] = "map_load_report";
+    static constexpr char BenchmarkPaths[] = "bench_paths";
+    static constexpr char BenchmarkRays[] = "bench_rays";
+    static constexpr char SpawnCrowd[] = "crowd_stress";
+    static constexpr char ShowCrowdReport[] = "crowd_report";
+    static constexpr char ShowPerceptionReport[] = "perception_report";
+    static constexpr char ShowBehaviorReport[] = "behavior_report";
+    static constexpr char ShowDoorReport[] = "door_report";
 
     static constexpr char ListCommands[] = "list";
 }
@@ -60,6 +86,10 @@ protected:
 
     std::deque<std::string> ConsoleOutput;
 
+    // log lines can come from the loader threads, so they wait here until the next update
+    std::mutex PendingLogMutex;
+    std::deque<std::string> PendingLog;
+
     std::vector<std::string> ConsoleLog;
     size_t CurrentHistoryLogItem = 0;
 
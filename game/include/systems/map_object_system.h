@@ -4,8 +4,10 @@
 #include "systems/audio_system.h"
 #include "components/map_object_component.h"
 #include "component.h"
+#include "utilities/spatial_grid.h"
 #include "raylib.h"
 
+#include <unordered_map>
 #include <vector>
 
 class TriggerComponent;
@@ -22,9 +24,29 @@ public:
     SystemComponentList<TriggerComponent> Triggers;
     SystemComponentList<DoorControllerComponent> Doors;
 
+    // slides against the walls of the map and the solid objects, desiredMotion becomes the motion that can really be made
     bool MoveEntity(Vector3& position, Vector3& desiredMotion, float radius, GameObject* entity = nullptr);
+
+    // the boxes of the solid objects in cells, for SweptCollision
+    const std::vector<Rectangle>& GetSolidBounds();
+
+    // queues the entity to be tested against the triggers where it is now. the enter and exit events for everything that moved
+    // are sent together at the start of the next update, after every trigger knows who is in it
     void CheckTriggers(GameObject* entity, float radius, bool hitSomething);
 
+    // what a door does when something walks into or out of its trigger
+    void DoorTriggerEnter(DoorControllerComponent* door, GameObject* subject);
+    void DoorTriggerExit(DoorControllerComponent* door, GameObject* sender, GameObject* subject);
+
+    // the indexes of the door cells that moved, or started or stopped blocking, in the last update
+    inline const std::vector<size_t>& GetChangedDoorCells() const { return ChangedDoorCells; }
+
+    // the indexes of the door cells that started or stopped blocking in the last update, a subset of the changed cells
+    inline const std::vector<size_t>& GetBlockingChangedDoorCells() const { return BlockingChangedDoorCells; }
+
+    inline size_t GetDoorCount() const { return DoorTable.Controllers.size(); }
+    inline size_t GetActiveDoorCount() const { return ActiveDoors.size(); }
+
 protected:
     void OnSetup() override;
     void OnUpdate() override;
@@ -36,4 +58,112 @@ protected:
 
     SoundInstance::Ptr OpenDoorSound;
     SoundInstance::Ptr CloseDoorSound;
+
+    std::vector<Rectangle> SolidBounds;
+    bool SolidBoundsDirty = true;
+
+    // works out who went in or out of which trigger from the entities queued by CheckTriggers, and sends the events
+    void UpdateTriggers();
+    void BuildTriggerGrid();
+
+    // a grid of the trigger bounds, gathered again after triggers are added or removed
+    static constexpr float TriggerGridCellSize = 2;
+
+    std::vector<TriggerComponent*> TriggerList;
+    std::vector<Rectangle> TriggerBounds;
+    SpatialGrid TriggerGrid;
+    bool TriggersDirty = true;
+
+    // a trigger in more than one grid cell is only tested once for each entity
+    std::vector<uint32_t> TriggerStamps;
+    uint32_t TriggerStamp = 0;
+
+    struct TriggerMover
+    {
+        ObjectLifetimeToken::Ptr Token;
+        Vector2 Position = { 0, 0 };
+        float Radius = 0;
+    };
+
+    std::vector<TriggerMover> TriggerMovers;
+
+    // the triggers each entity was in the last time it moved, entries go when the entity does
+    struct TriggerOccupant
+    {
+        ObjectLifetimeToken::Ptr Token;
+        std::vector<TriggerComponent*> Inside;
+    };
+
+    std::unordered_map<GameObject*, TriggerOccupant> TriggerOccupants;
+
+    struct TriggerEvent
+    {
+        TriggerComponent* Trigger = nullptr;
+        ObjectLifetimeToken::Ptr Entity;
+        bool Enter = false;
+    };
+
+    std::vector<TriggerEvent> TriggerEvents;
+    std::vector<TriggerComponent*> TriggersTouched;
+
+    // adds the doors added since the last update to the table, their settings are filled in after the component is added
+    void AddPendingDoors();
+    void RemoveDoor(DoorControllerComponent* door);
+
+    void UpdateDoors();
+    void ActivateDoor(uint32_t door);
+    void SetDoorParam(uint32_t door, float param);
+    void SetDoorBlocked(uint32_t door, bool blocked);
+
+    enum class DoorState : uint8_t
+    {
+        Closed,
+        Opening,
+        Open,
+        WaitingForClose,
+        Closing
+    };
+
+    struct DoorFlags
+    {
+        static constexpr uint8_t MustOpenBeforeClose = 1 << 0;
+        static constexpr uint8_t StayOpen = 1 << 1;
+        static constexpr uint8_t NeedCloseASAP = 1 << 2;
+        static constexpr uint8_t Active = 1 << 3;
+    };
+
+    // every door as arrays of each value, a row for each door controller
+    struct DoorData
+    {
+        std::vector<DoorControllerComponent*> Controllers;
+        std::vector<DoorState> States;
+        std::vector<float> Params;
+        std::vector<float> OpenSpeeds;
+        std::vector<float> CloseSpeeds;
+        std::vector<float> MinimumOpenTimes;
+        std::vector<float> WaitTimes;
+        std::vector<uint8_t> Flags;
+        std::vector<uint32_t> FirstCells;
+        std::vector<uint32_t> CellCounts;
+
+        // the map cells of all the doors, the ones for a door are next to each other
+        std::vector<size_t> Cells;
+    };
+
+    DoorData DoorTable;
+
+    // the doors that are moving or waiting to close, closed doors and doors that stay open aren't looked at
+    std::vector<uint32_t> ActiveDoors;
+    std::vector<DoorControllerComponent*> PendingDoors;
+
+    std::vector<size_t> ChangedDoorCells;
+    std::vector<size_t> BlockingChangedDoorCells;
+
+    struct DoorEvent
+    {
+        DoorControllerComponent* Door = nullptr;
+        const char* Name = nullptr;
+    };
+
+    std::vector<DoorEvent> DoorEvents;
 };
\ No newline at end of file
@@ -3,6 +3,12 @@
 #include "game_object.h"
 
 #include "components/mobile_object_component.h"
+#include "utilities/behavior_tree.h"
+#include "utilities/crowd_simulation.h"
+#include "utilities/swept_collision.h"
+
+#include <memory>
+#include <vector>
 
 class MobBehaviorComponent;
 
@@ -14,10 +20,73 @@ public:
     SystemComponentList<MobComponent> Mobs;
     SystemComponentList<MobBehaviorComponent> MobBehaviors;
 
+    // what the crowd separation pass cost, times are averaged over the frames since the last report was taken
+    struct CrowdReport
+    {
+        size_t Frames = 0;
+
+        // from the last frame
+        size_t Agents = 0;
+        size_t Overlaps = 0;
+        size_t Batches = 0;
+
+        double GatherMS = 0;
+        double GridMS = 0;
+        double SolveMS = 0;
+        double ApplyMS = 0;
+    };
+
+    CrowdReport TakeCrowdReport();
+
+    // what running the behaviors cost, averaged over the frames since the last report was taken
+    struct BehaviorReport
+    {
+        size_t Frames = 0;
+
+        // from the last frame
+        size_t Behaviors = 0;
+        size_t Agents = 0;
+
+        double Evaluations = 0;
+        double MS = 0;
+    };
+
+    BehaviorReport TakeBehaviorReport();
+
+    // spawns mobs that chase the player on open cells up to range cells away from them, for seeing how big crowds hold up
+    size_t SpawnCrowd(size_t count, float range);
+
 protected:
     void OnUpdate() override;
     void OnAddObject(GameObject* object) override;
     void OnRemoveObject(GameObject* object) override;
 
+    // puts mobs added since the last frame in the group for their behavior
+    void AssignBehaviors();
+
+    // pushes mobs out of each other and the player after they have all moved
+    void SeparateCrowd();
+
 protected:
-};
\ No newline at end of file
+    // how fast in cells per second overlapping mobs are pushed apart
+    static constexpr float CrowdPushSpeed = 3;
+
+    CrowdSimulation Crowd;
+    std::vector<MobBehaviorComponent*> CrowdMembers;
+    std::vector<SweptCollision::Mover> CrowdMovers;
+
+    CrowdReport CrowdTotals;
+
+    // every mob running the same behavior is ticked together, with their blackboards side by side
+    struct BehaviorGroup
+    {
+        std::shared_ptr<const BehaviorTree> Tree;
+        std::vector<MobBehaviorComponent*> Agents;
+        std::vector<BehaviorBlackboard> Blackboards;
+    };
+
+    std::vector<BehaviorGroup> BehaviorGroups;
+    std::vector<MobBehaviorComponent*> PendingBehaviors;
+
+    BehaviorReport BehaviorTotals;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "system.h"
+#include "map/ray_query.h"
+
+#include <vector>
+
+class MapObjectSystem;
+class MobBehaviorComponent;
+class MobSystem;
+class PlayerManagementSystem;
+class RayQuerySystem;
+
+// works out which mobs can see the player. cheap tests go first, range and field of view, then whether the player's own view
+// reached the mob's cell last frame, which works both ways. the mobs left over get a line of sight ray, but only a few each frame,
+// the ones that have waited longest for how close they are go first and the rest keep what they saw last time until they get a turn.
+// a door that starts or stops blocking between a mob and the player ends the mob's last result early.
+// when a mob spots or loses the player it sends PlayerSpotted or PlayerLost to the player object
+class PerceptionSystem : public System
+{
+public:
+    DEFINE_SYSTEM(PerceptionSystem)
+
+    static constexpr char PlayerSpotted[] = "PlayerSpotted";
+    static constexpr char PlayerLost[] = "PlayerLost";
+
+    // how high the eyes of a mob are, and the point on the player they look for, in cells
+    static constexpr float MobEyeHeight = 0.7f;
+    static constexpr float PlayerTargetHeight = 0.5f;
+
+    // how long a line of sight result is trusted, from close up to the edge of sight range
+    static constexpr float NearCheckInterval = 0.1f;
+    static constexpr float FarCheckInterval = 0.5f;
+
+    // averaged over the frames since the last report was taken
+    struct PerceptionReport
+    {
+        size_t Frames = 0;
+
+        // from the last frame
+        size_t Mobs = 0;
+        size_t CanSee = 0;
+
+        double OutOfSight = 0;
+        double VisibleCells = 0;
+        double Cached = 0;
+        double Waiting = 0;
+        double Rays = 0;
+
+        double MS = 0;
+    };
+
+    PerceptionReport TakePerceptionReport();
+
+protected:
+    void OnSetup() override;
+    void OnUpdate() override;
+
+    void SetCanSeePlayer(MobBehaviorComponent* mob, bool canSee, const Vector3& playerPos, GameObject* player);
+
+    // true if a door cell that started or stopped blocking this frame is in the box of cells between the two points
+    bool DoorChangedBetween(const Vector3& from, const Vector3& to) const;
+
+    MapObjectSystem* MapObjects = nullptr;
+    MobSystem* Mobs = nullptr;
+    PlayerManagementSystem* PlayerManager = nullptr;
+    RayQuerySystem* RayQueries = nullptr;
+
+    struct Candidate
+    {
+        MobBehaviorComponent* Mob = nullptr;
+        float Priority = 0;
+        float Distance = 0;
+    };
+
+    std::vector<Candidate> Candidates;
+    std::vector<RayQuery> Queries;
+    std::vector<RayHit> Hits;
+
+    PerceptionReport Totals;
+};
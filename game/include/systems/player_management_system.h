@@ -18,6 +18,10 @@ public:
 
     float GetPlayerPitch() const;
 
+    inline GameObject* GetPlayerObject() const { return PlayerObject; }
+
+    static constexpr float PlayerRadius = 0.25f;
+
     static constexpr char PlayerHitWall[] = "PlayerHitWall";
     static constexpr char PlayerHitObstacle[] = "PlayerHitObstacle";
 
@@ -25,6 +29,10 @@ protected:
     void OnSetup() override;
     void OnUpdate() override;
     void OnAddObject(GameObject* object) override;
+    void OnRemoveObject(GameObject* object) override;
+
+    // keeps the player where they were when the map is reloaded, unless that is now inside a wall
+    void OnMapReloaded();
 
 protected:
     class InputSystem* Input = nullptr;
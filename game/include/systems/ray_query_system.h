@@ -0,0 +1,37 @@
+#pragma once
+
+#include "system.h"
+#include "map/ray_query.h"
+
+#include <vector>
+
+class MapObjectSystem;
+class MobSystem;
+class PlayerManagementSystem;
+
+// keeps a RayQueryWorld of the map, the solid objects, the mobs and the player, rebuilt at the start of each frame.
+// anything that needs to know what a shot or a line of sight hits asks here, ideally with all its rays in one call
+class RayQuerySystem : public System
+{
+public:
+    DEFINE_SYSTEM(RayQuerySystem)
+
+    // how tall the capsules for mobs and the player are, in cells
+    static constexpr float MobHeight = 0.9f;
+    static constexpr float PlayerHeight = 0.6f;
+
+    inline bool CastRay(const RayQuery& query, RayHit& hit) const { return World.CastRay(query, hit); }
+    inline void CastRays(const std::vector<RayQuery>& queries, std::vector<RayHit>& hits) const { World.CastRays(queries, hits); }
+
+    inline const RayQueryWorld& GetWorld() const { return World; }
+
+protected:
+    void OnSetup() override;
+    void OnUpdate() override;
+
+    MapObjectSystem* MapObjects = nullptr;
+    MobSystem* Mobs = nullptr;
+    PlayerManagementSystem* PlayerManager = nullptr;
+
+    RayQueryWorld World;
+};
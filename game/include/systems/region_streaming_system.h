@@ -0,0 +1,21 @@
+#pragma once
+
+#include "system.h"
+
+class PlayerManagementSystem;
+
+// spawns the regions of the map near the player and removes the far ones, after the player has moved for the frame
+class RegionStreamingSystem : public System
+{
+public:
+    DEFINE_SYSTEM(RegionStreamingSystem)
+
+    // how many regions can be spawned in one frame
+    static constexpr size_t MaxRegionLoadsPerFrame = 1;
+
+protected:
+    void OnSetup() override;
+    void OnUpdate() override;
+
+    PlayerManagementSystem* PlayerManager = nullptr;
+};
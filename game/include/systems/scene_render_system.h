@@ -22,6 +22,9 @@ protected:
     void OnSetup() override;
     void OnUpdate() override;
 
+    // gets the shaders and map lighting and applies them to everything drawn
+    void SetupRendering();
+
 protected:
     MapRenderer Render;
     PlayerManagementSystem* PlayerManager = nullptr;
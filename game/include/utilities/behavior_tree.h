@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class Table;
+
+enum class BehaviorStatus : uint8_t
+{
+    Failure,
+    Success,
+    Running,
+};
+
+enum class BehaviorNodeType : uint8_t
+{
+    // the first child that doesn't fail
+    Selector,
+
+    // the children in order until one doesn't succeed
+    Sequence,
+
+    // swaps success and failure of its child
+    Invert,
+
+    Condition,
+    Action,
+};
+
+// the tests and actions a behavior table can use, the mob implements them
+enum class BehaviorCondition : uint8_t
+{
+    ChaseEnabled,
+    SawPlayer,
+    CanSeePlayer,
+    PlayerInRange,
+    PlayerWithin,
+    HasPath,
+};
+
+enum class BehaviorAction : uint8_t
+{
+    Idle,
+    ChasePlayer,
+    FollowPath,
+    Wander,
+};
+
+static constexpr uint16_t NoBehaviorNode = 0xffff;
+
+// the nodes are stored in the order a depth first walk visits them, so the first child of a node is the one after it
+// and End is where the next sibling starts
+struct BehaviorNode
+{
+    BehaviorNodeType Type = BehaviorNodeType::Selector;
+
+    // the BehaviorCondition or BehaviorAction
+    uint8_t Leaf = 0;
+
+    uint16_t End = 0;
+
+    // from the table, like the distance for player_within:8
+    float Param = 0;
+};
+
+// what one mob is doing in its behavior, all the mobs using a behavior keep these in one array
+struct BehaviorBlackboard
+{
+    // until the tree is evaluated again, the running action is updated every frame in between
+    float TickTimer = 0;
+
+    uint16_t RunningNode = NoBehaviorNode;
+
+    // what the running action is in the middle of, and how long it waits for
+    uint8_t Phase = 0;
+    float WaitTime = 0;
+};
+
+// a behavior tree read from a table, one line per node:
+//   root;selector:chase,patrol,wander
+//   chase;sequence:chase_enabled,saw_player,player_in_range,chase_player
+//   close;condition:player_within:8
+// children that aren't lines of the table, and lines that aren't a selector, sequence or invert, are conditions or actions
+// by name with an optional parameter after a ':'.
+// tick_lod;8:0,24:0.1,48:0.25 sets how often the tree is evaluated by distance from the player, in seconds, past the last
+// distance the last interval is used. the tree is shared and read only, everything that changes is in the blackboards
+class BehaviorTree
+{
+public:
+    // false with a message when the table doesn't make a tree, the tree is left empty
+    bool Compile(std::string_view name, const Table& table, std::string& error);
+
+    inline const std::string& GetName() const { return Name; }
+    inline size_t GetNodeCount() const { return Nodes.size(); }
+    inline const BehaviorNode& GetNode(uint16_t index) const { return Nodes[index]; }
+
+    float GetTickInterval(float distance) const;
+    float GetLongestTickInterval() const;
+
+    // evaluates the tree when the blackboard is due, or nothing is running, otherwise only updates the running action.
+    // the agent provides:
+    //   bool CheckCondition(const BehaviorNode& node);
+    //   void StartAction(const BehaviorNode& node, BehaviorBlackboard& blackboard);
+    //   BehaviorStatus RunAction(const BehaviorNode& node, BehaviorBlackboard& blackboard);
+    // returns true when the tree was evaluated
+    template<typename Agent>
+    bool Tick(Agent& agent, BehaviorBlackboard& blackboard, float distance, float deltaTime) const
+    {
+        if (Nodes.empty())
+            return false;
+
+        blackboard.TickTimer -= deltaTime;
+        bool due = blackboard.TickTimer <= 0;
+
+        if (!due && blackboard.RunningNode != NoBehaviorNode)
+        {
+            if (agent.RunAction(Nodes[blackboard.RunningNode], blackboard) != BehaviorStatus::Running)
+                blackboard.RunningNode = NoBehaviorNode;
+
+            return false;
+        }
+
+        if (due)
+            blackboard.TickTimer = GetTickInterval(distance);
+
+        uint16_t previous = blackboard.RunningNode;
+        blackboard.RunningNode = NoBehaviorNode;
+        Evaluate(0, agent, blackboard, previous);
+
+        return true;
+    }
+
+private:
+    template<typename Agent>
+    BehaviorStatus Evaluate(uint16_t index, Agent& agent, BehaviorBlackboard& blackboard, uint16_t previous) const
+    {
+        const BehaviorNode& node = Nodes[index];
+
+        switch (node.Type)
+        {
+        case BehaviorNodeType::Selector:
+            for (uint16_t child = index + 1; child < node.End; child = Nodes[child].End)
+            {
+                BehaviorStatus status = Evaluate(child, agent, blackboard, previous);
+                if (status != BehaviorStatus::Failure)
+                    return status;
+            }
+            return BehaviorStatus::Failure;
+
+        case BehaviorNodeType::Sequence:
+            for (uint16_t child = index + 1; child < node.End; child = Nodes[child].End)
+            {
+                BehaviorStatus status = Evaluate(child, agent, blackboard, previous);
+                if (status != BehaviorStatus::Success)
+                    return status;
+            }
+            return BehaviorStatus::Success;
+
+        case BehaviorNodeType::Invert:
+        {
+            BehaviorStatus status = Evaluate(index + 1, agent, blackboard, previous);
+            if (status == BehaviorStatus::Running)
+                return status;
+
+            return status == BehaviorStatus::Success ? BehaviorStatus::Failure : BehaviorStatus::Success;
+        }
+
+        case BehaviorNodeType::Condition:
+            return agent.CheckCondition(node) ? BehaviorStatus::Success : BehaviorStatus::Failure;
+
+        default:
+        case BehaviorNodeType::Action:
+        {
+            // an action that was running last time carries on, anything else starts over
+            if (index != previous)
+                agent.StartAction(node, blackboard);
+
+            BehaviorStatus status = agent.RunAction(node, blackboard);
+            if (status == BehaviorStatus::Running)
+                blackboard.RunningNode = index;
+
+            return status;
+        }
+        }
+    }
+
+    bool CompileNode(const Table& table, std::string_view name, int depth, std::string& error);
+    bool CompileLeaf(std::string_view expression, std::string& error);
+
+    std::string Name;
+    std::vector<BehaviorNode> Nodes;
+
+    // distance and seconds between evaluations, sorted by distance
+    std::vector<std::pair<float, float>> TickLOD;
+};
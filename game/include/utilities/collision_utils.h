@@ -10,5 +10,9 @@ namespace CollisionUtils
     void PointNearestRect(const Rectangle& rect, const Vector2& point, Vector2* nearest, Vector2* normal);
     void PointNearestBoundsXY(const BoundingBox& rect, const Vector3& position, const Vector3& point, Vector3* nearest, Vector3* normal);
 
+    // the first time from 0 to 1 that a circle moving from start by motion touches the rectangle, and the normal of the surface it touches.
+    // a circle that starts out touching the rectangle hits it at time 0, unless it is moving away from it
+    bool SweepCircleRect(const Vector2& start, const Vector2& motion, float radius, const Rectangle& rect, float* time, Vector2* normal);
+
     void SetUnitAngleDeg(float& angle);
 }
\ No newline at end of file
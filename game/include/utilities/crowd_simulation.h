@@ -0,0 +1,63 @@
+#pragma once
+
+#include "utilities/spatial_grid.h"
+
+#include <cstdint>
+#include <vector>
+
+// pushes circles that overlap apart, so a crowd of mobs spreads out instead of walking into each other.
+// the agents are kept as arrays of each value, neighbours come from a spatial grid, and each agent only writes its own push,
+// so big crowds are split into batches that run on the job pool at the same time
+class CrowdSimulation
+{
+public:
+    void Clear();
+
+    // fixed agents push the others away but are never pushed themselves, like the player
+    size_t AddAgent(float x, float y, float radius, bool fixed = false);
+
+    // works out how far to move each agent to get out of the ones it overlaps, no more than maxPush.
+    // overlaps are split between the two agents, so a pile up spreads out over a few frames
+    void Solve(float maxPush);
+
+    inline size_t GetAgentCount() const { return PositionX.size(); }
+    inline float GetPushX(size_t agent) const { return PushX[agent]; }
+    inline float GetPushY(size_t agent) const { return PushY[agent]; }
+
+    struct Stats
+    {
+        size_t Agents = 0;
+        size_t Overlaps = 0;
+        size_t Batches = 0;
+
+        double GridMS = 0;
+        double SolveMS = 0;
+    };
+
+    inline const Stats& GetStats() const { return LastStats; }
+
+private:
+    static constexpr size_t AgentsPerBatch = 256;
+
+    // overlaps smaller than this part of the two radii are ignored
+    static constexpr float OverlapSlop = 0.01f;
+
+    // below this everything is solved on the calling thread, handing out the batches costs more than it saves
+    static constexpr size_t ParallelAgentCount = 512;
+
+    size_t SolveRange(size_t first, size_t last, float maxPush);
+
+    std::vector<float> PositionX;
+    std::vector<float> PositionY;
+    std::vector<float> Radius;
+    std::vector<uint8_t> Fixed;
+
+    std::vector<float> PushX;
+    std::vector<float> PushY;
+
+    float MaxRadius = 0;
+
+    SpatialGrid Grid;
+
+    Stats LastStats;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// watches every file under a folder for changes. on linux the kernel reports them through inotify,
+// everywhere else, or if inotify can't be used, the modification times are polled
+class FileWatcher
+{
+public:
+    FileWatcher() = default;
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator = (const FileWatcher&) = delete;
+
+    bool Start(std::string_view rootFolder);
+    void Stop();
+
+    bool IsWatching() const { return Watching; }
+    bool UsesNotifications() const { return NotifyHandle >= 0; }
+
+    // the files that changed since the last call, relative to the root folder with / separators.
+    // a file is only reported once it has not changed for a moment, so a file that is still being saved is not read half written
+    std::vector<std::string> GetChangedFiles();
+
+protected:
+    std::string RootFolder;
+    bool Watching = false;
+
+    // each changed file and the time it last changed
+    std::unordered_map<std::string, double> PendingChanges;
+
+    int NotifyHandle = -1;
+
+    // the folder of each watch, relative to the root
+    std::unordered_map<int, std::string> WatchedFolders;
+
+    // the modification time of every file when polling
+    std::unordered_map<std::string, long> FileTimes;
+    double LastPollTime = 0;
+
+    bool StartNotifications();
+    void AddWatches(const std::string& folder);
+    void ReadNotifications();
+
+    void PollFiles(bool reportChanges);
+
+    void AddChange(const std::string& path);
+};
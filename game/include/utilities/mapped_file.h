@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// a read only view of a whole file mapped into memory, the data is valid until the file is closed
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator = (const MappedFile&) = delete;
+
+    bool Open(std::string_view filePath);
+    void Close();
+
+    bool IsOpen() const { return Data != nullptr; }
+
+    const uint8_t* GetData() const { return Data; }
+    size_t GetSize() const { return Size; }
+
+protected:
+    uint8_t* Data = nullptr;
+    size_t Size = 0;
+
+#if defined(_WIN32)
+    void* FileHandle = nullptr;
+    void* MappingHandle = nullptr;
+#endif
+};
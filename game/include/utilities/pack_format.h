@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// shared layout for resource pack files, written by the pack tool and mounted by the resource manager.
+// the file is a header, a table of entries sorted by path hash, a block of entry names, then the entry data.
+// every entry starts aligned and is followed by at least one zero byte, so uncompressed entries can be used straight
+// out of a mapped pack, including text
+namespace PackFormat
+{
+    static constexpr char Magic[4] = { 'M', 'B', 'S', 'P' };
+    static constexpr uint32_t Version = 1;
+
+    // matches the mesh stream alignment, so meshes can still be read in place from inside a pack
+    static constexpr size_t EntryAlignment = 16;
+
+    // entry flags
+    static constexpr uint32_t Compressed = 0x01;
+
+    struct PackHeader
+    {
+        char Magic[4] = { 0 };
+        uint32_t Version = 0;
+        uint32_t EntryCount = 0;
+        uint32_t Reserved = 0;
+
+        // offsets from the start of the file
+        uint64_t EntriesOffset = 0;
+        uint64_t NamesOffset = 0;
+        uint64_t NamesSize = 0;
+    };
+
+    struct PackEntry
+    {
+        uint64_t PathHash = 0;
+
+        uint64_t DataOffset = 0;
+        uint64_t StoredSize = 0;
+        uint64_t Size = 0;
+
+        // the normalized path, in the name block, used to reject hash collisions
+        uint32_t NameOffset = 0;
+        uint32_t NameLength = 0;
+
+        uint32_t Flags = 0;
+        uint32_t Reserved = 0;
+    };
+
+    static_assert(sizeof(PackHeader) == 40, "pack header must not have padding");
+    static_assert(sizeof(PackEntry) == 48, "pack entry must not have padding");
+
+    inline size_t AlignOffset(size_t offset)
+    {
+        return (offset + EntryAlignment - 1) & ~(EntryAlignment - 1);
+    }
+
+    // paths are stored with forward slashes and without a leading ./
+    inline std::string NormalizePath(std::string_view path)
+    {
+        while (path.size() >= 2 && path[0] == '.' && (path[1] == '/' || path[1] == '\\'))
+            path.remove_prefix(2);
+
+        std::string normalized(path);
+        for (char& c : normalized)
+        {
+            if (c == '\\')
+                c = '/';
+        }
+
+        return normalized;
+    }
+
+    // FNV-1a of the normalized path, stable across compilers and platforms unlike std::hash
+    inline uint64_t HashPath(std::string_view path)
+    {
+        while (path.size() >= 2 && path[0] == '.' && (path[1] == '/' || path[1] == '\\'))
+            path.remove_prefix(2);
+
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : path)
+        {
+            if (c == '\\')
+                c = '/';
+
+            hash ^= uint8_t(c);
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+}
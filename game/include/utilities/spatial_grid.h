@@ -0,0 +1,84 @@
+#pragma once
+
+#include "raylib.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// points or boxes bucketed into the square cells of a uniform grid, for finding what is near something without checking everything.
+// the cells are hashed into a table about twice the size of the entry count, so the grid costs the same however big the world is.
+// it is built again from scratch whenever things move, which is a couple of passes over them
+class SpatialGrid
+{
+public:
+    // each point goes in the cell it is in, x and y are count long
+    void Build(const float* x, const float* y, size_t count, float cellSize);
+
+    // each box goes in every cell it covers
+    void BuildBoxes(const Rectangle* boxes, size_t count, float cellSize);
+
+    void Clear();
+
+    inline float GetCellSize() const { return CellSize; }
+    inline int32_t GetCell(float value) const { return int32_t(floorf(value * InverseCellSize)); }
+
+    // calls back with the index of everything in one cell
+    template<typename Callback>
+    void ForEachInCell(int32_t cellX, int32_t cellY, Callback&& callback) const
+    {
+        if (EntryItems.empty())
+            return;
+
+        uint32_t bucket = GetBucket(cellX, cellY);
+        for (uint32_t i = BucketStarts[bucket]; i < BucketStarts[bucket + 1]; i++)
+        {
+            // other cells can hash to the same bucket, only take what is really in this one
+            if (EntryCellX[i] == cellX && EntryCellY[i] == cellY)
+                callback(size_t(EntryItems[i]));
+        }
+    }
+
+    // calls back with the index of everything in the cells that overlap the rectangle, some of them can be a cell outside it.
+    // a box that covers more than one of the cells comes back once for each of them
+    template<typename Callback>
+    void ForEachInRange(float minX, float minY, float maxX, float maxY, Callback&& callback) const
+    {
+        int32_t firstX = GetCell(minX);
+        int32_t firstY = GetCell(minY);
+        int32_t lastX = GetCell(maxX);
+        int32_t lastY = GetCell(maxY);
+
+        for (int32_t cellY = firstY; cellY <= lastY; cellY++)
+        {
+            for (int32_t cellX = firstX; cellX <= lastX; cellX++)
+                ForEachInCell(cellX, cellY, callback);
+        }
+    }
+
+private:
+    inline uint32_t GetBucket(int32_t x, int32_t y) const
+    {
+        return (uint32_t(x) * 73856093u ^ uint32_t(y) * 19349663u) & BucketMask;
+    }
+
+    void SetCellSize(float cellSize);
+
+    // counting sort of the pending entries into the buckets
+    void SortEntries();
+
+    float CellSize = 1;
+    float InverseCellSize = 1;
+    uint32_t BucketMask = 0;
+
+    // the entries of bucket b are from BucketStarts[b] up to BucketStarts[b + 1]
+    std::vector<uint32_t> BucketStarts;
+    std::vector<int32_t> EntryCellX;
+    std::vector<int32_t> EntryCellY;
+    std::vector<uint32_t> EntryItems;
+
+    std::vector<int32_t> PendingCellX;
+    std::vector<int32_t> PendingCellY;
+    std::vector<uint32_t> PendingItems;
+    std::vector<uint32_t> FillCursors;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "raylib.h"
+
+#include <string>
+#include <vector>
+
+struct Map;
+
+// moves circles across the map without passing through walls or solid objects, however far they go in one frame.
+// a move is traced to the first thing it touches, then what is left of it slides along that surface, a few times at most
+namespace SweptCollision
+{
+    // how many times one move can slide off a surface before the rest of it is dropped
+    static constexpr int MaxSlides = 4;
+
+    // how far off a surface a move stops, so sliding along a wall doesn't catch on the corners of the cells in it
+    static constexpr float SkinWidth = 0.001f;
+
+    // obstacles are boxes in cells, like the bounds of solid map objects. motion becomes the motion that can really be made,
+    // true when the move hit something
+    bool MoveCircle(const Map& map, const std::vector<Rectangle>& obstacles, const Vector3& position, Vector3& motion, float radius);
+
+    struct Mover
+    {
+        Vector3 Position = { 0, 0, 0 };
+        Vector3 Motion = { 0, 0, 0 };
+        float Radius = 0.25f;
+
+        // set by MoveCircles
+        bool Hit = false;
+    };
+
+    // moves every mover by its motion, which becomes what was really moved. movers don't collide with each other,
+    // big batches are split across the job pool threads and give the same results as moving them one at a time
+    void MoveCircles(const Map& map, const std::vector<Rectangle>& obstacles, std::vector<Mover>& movers);
+
+    // moves with known results on a small made up map, plus a seeded random run that checks nothing ends up in a wall or
+    // somewhere it could not walk to. returns how many checks failed, with a line for each in failures
+    int RunRegressionChecks(std::vector<std::string>& failures);
+};
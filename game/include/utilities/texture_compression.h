@@ -0,0 +1,53 @@
+#pragma once
+
+#include "raylib.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// GPU memory accounting for every raylib pixel format, and the CPU side conversion of images into
+// block compressed textures with a precomputed mip chain. nothing in here touches the GPU
+namespace TextureCompression
+{
+    // bytes one mip level uses in a pixel format, block compressed formats always store whole blocks
+    size_t GetLevelSize(int width, int height, int format);
+
+    // bytes a texture and all its mip levels use
+    size_t GetTextureSize(int width, int height, int mipmaps, int format);
+
+    bool IsCompressedFormat(int format);
+
+    // true if any pixel of an 8 bit RGBA image is not fully opaque
+    bool HasAlpha(const Image& image);
+
+    // the number of levels a block compressed chain can have, every level must be a whole number of blocks
+    int GetCompressedMipCount(int width, int height);
+
+    // builds an 8 bit RGBA image with a box filtered mip chain of the given number of levels
+    Image BuildMipChain(const Image& image, int mipmaps);
+
+    // compresses an 8 bit RGBA image, with all of its mip levels, to DXT1 (PIXELFORMAT_COMPRESSED_DXT1_RGB) or DXT5.
+    // the size must be a multiple of 4, returns an empty image if it can't be compressed
+    Image CompressImage(const Image& image, int format);
+
+    // expands a DXT1 or DXT5 image, with all its mip levels, back to 8 bit RGBA, for checking the compression error
+    Image DecompressImage(const Image& image);
+
+    // the root mean squared error of the first level of two 8 bit RGBA images of the same size
+    float GetImageError(const Image& a, const Image& b);
+
+    // single 4x4 block codecs, pixels are 16 RGBA values in rows
+    void CompressBlockDXT1(const uint8_t pixels[64], uint8_t block[8]);
+    void CompressBlockDXT5(const uint8_t pixels[64], uint8_t block[16]);
+    void DecompressBlockDXT1(const uint8_t block[8], uint8_t pixels[64]);
+    void DecompressBlockDXT5(const uint8_t block[16], uint8_t pixels[64]);
+
+    // writes a compressed image and its mip levels as a DDS file that raylib can load
+    bool ExportDDS(const Image& image, const char* fileName);
+
+    // known level and chain sizes for the pixel formats, plus DXT1 and DXT5 round trips of made up images that must stay
+    // under an error bound. returns how many checks failed, with a line for each in failures
+    int RunRegressionChecks(std::vector<std::string>& failures);
+}
@@ -73,118 +73,309 @@ MobBehaviorComponent::MobBehaviorComponent(GameObject* owner)
                 }
                 rlPopMatrix();
             }
+            else if (!Route.empty())
+            {
+                rlPushMatrix();
+                rlTranslatef(0, 0, 0.125f);
+                for (size_t i = RouteIndex; i + 1 < Route.size(); i++)
+                {
+                    DrawLine3D(Route[i], Route[i + 1], PURPLE);
+                }
+                rlPopMatrix();
+            }
         });
 }
 
-void MobBehaviorComponent::Process()
+MobBehaviorComponent::~MobBehaviorComponent()
 {
-    auto* transform = GetOwner()->GetComponent<TransformComponent>();
-    if (!transform)
+    Pathfinding::CancelPath(PendingPath);
+}
+
+void MobBehaviorComponent::StartWander(const Vector3& target)
+{
+    WanderTarget = target;
+    Route.clear();
+    RouteIndex = 0;
+
+    Pathfinding::CancelPath(PendingPath);
+    PendingPath = Pathfinding::RequestPath(MapCoordinate{ int(floorf(CurrentTransform->Position.x)), int(floorf(CurrentTransform->Position.y)) },
+        MapCoordinate{ int(floorf(target.x)), int(floorf(target.y)) });
+}
+
+// true when the route is back, or there isn't one and the mob should walk straight at the target
+bool MobBehaviorComponent::CheckWanderPath()
+{
+    std::vector<MapCoordinate> points;
+    auto status = Pathfinding::GetPath(PendingPath, points);
+    if (status == Pathfinding::PathStatus::Pending)
+        return false;
+
+    PendingPath = Pathfinding::InvalidRequest;
+
+    // the first point is the cell the mob is standing in
+    for (size_t i = 1; i < points.size(); i++)
+        Route.push_back(Vector3{ points[i].X + 0.5f, points[i].Y + 0.5f, 0 });
+
+    if (Route.empty())
+        DesiredPostion = WanderTarget;
+    else
+        DesiredPostion = Route[0];
+
+    return true;
+}
+
+void MobBehaviorComponent::SetMoving(bool moving)
+{
+    if (!CurrentMob)
         return;
 
-    auto* mob = GetOwner()->GetComponent<MobComponent>();
-    
-    switch (State)
+    CurrentMob->SetSpeedFactor(moving ? MoveSpeed : 1);
+    CurrentMob->SetAnimationState(moving ? CharacterAnimationState::Walking : CharacterAnimationState::Idle);
+}
+
+float MobBehaviorComponent::GetFieldDistance() const
+{
+    if (!PlayerField)
+        return FLT_MAX;
+
+    return PlayerField->GetDistance(int(floorf(CurrentTransform->Position.x)), int(floorf(CurrentTransform->Position.y)));
+}
+
+// fails when there is no way to the player
+BehaviorStatus MobBehaviorComponent::Chase()
+{
+    float distance = GetFieldDistance();
+    if (distance == FLT_MAX)
+        return BehaviorStatus::Failure;
+
+    if (distance <= ChaseStopDistance)
     {
-    case MobBehaviorComponent::AIState::Unknown:
-        if (!FollowPath || Path.empty())
+        SetMoving(false);
+        return BehaviorStatus::Running;
+    }
+
+    // head for the middle of the next cell, the field only steps between cells that can be walked between
+    MapCoordinate step = PlayerField->GetTarget();
+    PlayerField->GetStep(int(floorf(CurrentTransform->Position.x)), int(floorf(CurrentTransform->Position.y)), step);
+    DesiredPostion = Vector3{ step.X + 0.5f, step.Y + 0.5f, 0 };
+
+    float maxMoveThisFrame = MoveSpeed * GameTime::GetDeltaTime();
+    float maxRotationThisFrame = RotationSpeed * GameTime::GetDeltaTime();
+
+    Vector3 desiredMotion = AIUtils::MoveTo(CurrentTransform->Position, CurrentTransform->Forward, DesiredPostion, maxMoveThisFrame, maxRotationThisFrame);
+
+    bool hitSomething = Move(desiredMotion);
+
+    SetMoving(true);
+
+    App::GetSystem<MapObjectSystem>()->CheckTriggers(GetOwner(), Radius, hitSomething);
+
+    return BehaviorStatus::Running;
+}
+
+// walks the points of the path in a loop, running into something doesn't count as getting to a point
+BehaviorStatus MobBehaviorComponent::Patrol()
+{
+    if (Path.empty())
+        return BehaviorStatus::Failure;
+
+    float maxMoveThisFrame = MoveSpeed * GameTime::GetDeltaTime();
+    float maxRotationThisFrame = RotationSpeed * GameTime::GetDeltaTime();
+
+    Vector3 desiredMotion = AIUtils::MoveTo(CurrentTransform->Position, CurrentTransform->Forward, DesiredPostion, maxMoveThisFrame, maxRotationThisFrame);
+
+    bool done = Vector3LengthSqr((desiredMotion + CurrentTransform->Position) - DesiredPostion) < 0.001f;
+
+    bool hitSomething = Move(desiredMotion);
+    if (hitSomething)
+        done = false;
+
+    if (CurrentMob)
+        CurrentMob->SetSpeedFactor(MoveSpeed);
+
+    App::GetSystem<MapObjectSystem>()->CheckTriggers(GetOwner(), Radius, hitSomething);
+
+    if (done)
+    {
+        ++CurrentPathIndex;
+        if (CurrentPathIndex >= Path.size())
+            CurrentPathIndex = 0;
+
+        DesiredPostion = Vector3{ Path[CurrentPathIndex].x, Path[CurrentPathIndex].y, 0 };
+    }
+
+    return BehaviorStatus::Running;
+}
+
+// idles for a while, then walks a route to a random spot a few cells away and does it again
+BehaviorStatus MobBehaviorComponent::Wander(BehaviorBlackboard& blackboard)
+{
+    if (WanderPhase(blackboard.Phase) == WanderPhase::Waiting)
+    {
+        if (PendingPath != Pathfinding::InvalidRequest)
         {
-            State = AIState::Waiting;
-            if (mob)
-            {
-                mob->SetSpeedFactor(1);
-                mob->SetAnimationState(CharacterAnimationState::Idle);
-            }
+            // keep idling until the route comes back
+            if (!CheckWanderPath())
+                return BehaviorStatus::Running;
+
+            blackboard.Phase = uint8_t(WanderPhase::Moving);
+            SetMoving(true);
+            return BehaviorStatus::Running;
         }
-        else
+
+        blackboard.WaitTime -= GameTime::GetDeltaTime();
+
+        if (blackboard.WaitTime <= 0)
         {
-            DesiredPostion = Vector3{ Path[CurrentPathIndex].x, Path[CurrentPathIndex].y, 0 };
-            State = AIState::Moving;
-            if (mob)
-            {
-                mob->SetSpeedFactor(MoveSpeed);
-                mob->SetAnimationState(CharacterAnimationState::Walking);
-            }
+            blackboard.WaitTime = 0;
+
+            float angle = CurrentTransform->GetFacing() + float(GetRandomValue(180 - 30, 180 + 30));
+            Vector3 newVec = { cosf((angle + 90) * DEG2RAD), sinf((angle + 90) * DEG2RAD), 0 };
+            StartWander(CurrentTransform->Position + newVec * float(GetRandomValue(4, 10)));
         }
-        break;
+        return BehaviorStatus::Running;
+    }
+
+    float maxMoveThisFrame = MoveSpeed * GameTime::GetDeltaTime();
+    float maxRotationThisFrame = RotationSpeed * GameTime::GetDeltaTime();
+
+    Vector3 desiredMotion = AIUtils::MoveTo(CurrentTransform->Position, CurrentTransform->Forward, DesiredPostion, maxMoveThisFrame, maxRotationThisFrame);
+
+    bool done = Vector3LengthSqr((desiredMotion + CurrentTransform->Position) - DesiredPostion) < 0.001f;
 
-    case MobBehaviorComponent::AIState::Moving:
+    bool hitSomething = Move(desiredMotion);
+    if (hitSomething)
+        done = true;
+
+    if (CurrentMob)
+        CurrentMob->SetSpeedFactor(MoveSpeed);
+
+    App::GetSystem<MapObjectSystem>()->CheckTriggers(GetOwner(), Radius, hitSomething);
+
+    if (!done)
+        return BehaviorStatus::Running;
+
+    if (!hitSomething && RouteIndex + 1 < Route.size())
+    {
+        ++RouteIndex;
+        DesiredPostion = Route[RouteIndex];
+    }
+    else if (hitSomething)
+    {
+        Route.clear();
+        CurrentTransform->SetFacing(CurrentTransform->GetFacing() + float(GetRandomValue(180 - 30, 180 + 30)));
+        DesiredPostion = CurrentTransform->Position + CurrentTransform->Forward * float(GetRandomValue(1, 3));
+    }
+    else
     {
-        bool done = false;
+        blackboard.Phase = uint8_t(WanderPhase::Waiting);
+        blackboard.WaitTime = float(GetRandomValue(2, 10));
+        SetMoving(false);
+    }
 
-        float maxMoveThisFrame = MoveSpeed * GameTime::GetDeltaTime();
-        float maxRotationThisFrame = RotationSpeed * GameTime::GetDeltaTime();
+    return BehaviorStatus::Running;
+}
 
-        Vector3 desiredMotion = AIUtils::MoveTo(transform->Position, transform->Forward, DesiredPostion, maxMoveThisFrame, maxRotationThisFrame);
+bool MobBehaviorComponent::Move(Vector3 desiredMotion)
+{
+    auto* transform = GetOwner()->GetComponent<TransformComponent>();
+    if (!transform)
+        return false;
 
-        if (Vector3LengthSqr((desiredMotion + transform->Position) - DesiredPostion) < 0.001f)
-            done = true;
+    bool hitSomething = App::GetSystem<MapObjectSystem>()->MoveEntity(transform->Position, desiredMotion, Radius, GetOwner());
+    transform->Position += desiredMotion;
 
-        bool hitSomething = false;
-        if (App::GetScene().GetMap().MoveEntity(transform->Position, desiredMotion, 0.25f))
-        {
-            hitSomething = true;
-            done = !FollowPath;
-        }
+    return hitSomething;
+}
 
-        transform->Position += desiredMotion;
+bool MobBehaviorComponent::CheckCondition(const BehaviorNode& node)
+{
+    switch (BehaviorCondition(node.Leaf))
+    {
+    case BehaviorCondition::ChaseEnabled:
+        return ChasePlayer;
 
-        if (mob)
-            mob->SetSpeedFactor(MoveSpeed);
+    case BehaviorCondition::SawPlayer:
+        return TimeSinceSeenPlayer <= ChaseMemory;
 
-        App::GetSystem<MapObjectSystem>()->CheckTriggers(GetOwner(), 0.25f, hitSomething);
+    case BehaviorCondition::CanSeePlayer:
+        return CanSeePlayer;
 
-        if (done)
-        {
-            if (FollowPath && !Path.empty())
-            {
-                ++CurrentPathIndex;
-                if (CurrentPathIndex >= Path.size())
-                    CurrentPathIndex = 0;
+    case BehaviorCondition::PlayerInRange:
+        return GetFieldDistance() <= ChaseRange;
 
-                DesiredPostion = Vector3{ Path[CurrentPathIndex].x, Path[CurrentPathIndex].y, 0 };
-            }
-            else
-            {
-                if (hitSomething)
-                {
-                    transform->SetFacing(transform->GetFacing() + float(GetRandomValue(180 - 30, 180 + 30)));
-                    DesiredPostion = transform->Position + transform->Forward * float(GetRandomValue(1, 3));
-                }
-                else
-                {
-                    State = AIState::Waiting;
-                    WaitTime = float(GetRandomValue(2, 10));
-                    if (mob)
-                    {
-                        mob->SetSpeedFactor(1);
-                        mob->SetAnimationState(CharacterAnimationState::Idle);
-                    }
-                }
-            }
-        }
+    case BehaviorCondition::PlayerWithin:
+        return PlayerDistance <= node.Param;
+
+    case BehaviorCondition::HasPath:
+        return FollowPath && !Path.empty();
     }
+
+    return false;
+}
+
+void MobBehaviorComponent::StartAction(const BehaviorNode& node, BehaviorBlackboard& blackboard)
+{
+    switch (BehaviorAction(node.Leaf))
+    {
+    case BehaviorAction::Idle:
+        SetMoving(false);
         break;
 
-    default:
-    case MobBehaviorComponent::AIState::Waiting:
-        WaitTime -= GameTime::GetDeltaTime();
+    case BehaviorAction::ChasePlayer:
+        // whatever route it was on is no use now
+        Pathfinding::CancelPath(PendingPath);
+        PendingPath = Pathfinding::InvalidRequest;
+        Route.clear();
+        break;
 
-        if (WaitTime <= 0)
-        {
-            WaitTime = 0;
-            State = AIState::Moving;
+    case BehaviorAction::FollowPath:
+        if (!Path.empty())
+            DesiredPostion = Vector3{ Path[CurrentPathIndex].x, Path[CurrentPathIndex].y, 0 };
+        SetMoving(true);
+        break;
 
-            if (mob)
-            {
-                mob->SetSpeedFactor(MoveSpeed);
-                mob->SetAnimationState(CharacterAnimationState::Walking);
-            }
+    case BehaviorAction::Wander:
+        Pathfinding::CancelPath(PendingPath);
+        PendingPath = Pathfinding::InvalidRequest;
+        Route.clear();
 
-            float angle = transform->GetFacing() + float(GetRandomValue(180 - 30, 180 + 30));
-            Vector3 newVec = { cosf((angle + 90) * DEG2RAD), sinf((angle + 90) * DEG2RAD), 0 };
-            DesiredPostion = transform->Position + newVec * float(GetRandomValue(4, 10));
-        }
+        blackboard.Phase = uint8_t(WanderPhase::Waiting);
+        blackboard.WaitTime = 0;
+        SetMoving(false);
         break;
     }
 }
+
+BehaviorStatus MobBehaviorComponent::RunAction(const BehaviorNode& node, BehaviorBlackboard& blackboard)
+{
+    switch (BehaviorAction(node.Leaf))
+    {
+    case BehaviorAction::Idle:
+        return BehaviorStatus::Running;
+
+    case BehaviorAction::ChasePlayer:
+        return Chase();
+
+    case BehaviorAction::FollowPath:
+        return Patrol();
+
+    case BehaviorAction::Wander:
+        return Wander(blackboard);
+    }
+
+    return BehaviorStatus::Failure;
+}
+
+bool MobBehaviorComponent::Process(const BehaviorTree& tree, BehaviorBlackboard& blackboard, const FlowField* playerField, const Vector3& playerPos)
+{
+    CurrentTransform = GetOwner()->GetComponent<TransformComponent>();
+    if (!CurrentTransform)
+        return false;
+
+    CurrentMob = GetOwner()->GetComponent<MobComponent>();
+    PlayerField = playerField;
+    PlayerDistance = Vector2Distance(Vector2{ CurrentTransform->Position.x, CurrentTransform->Position.y }, Vector2{ playerPos.x, playerPos.y });
+
+    return tree.Tick(*this, blackboard, PlayerDistance, GameTime::GetDeltaTime());
+}
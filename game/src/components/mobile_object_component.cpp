@@ -4,6 +4,7 @@
 #include "services/model_manager.h"
 #include "services/character_manager.h"
 #include "services/texture_manager.h"
+#include "services/global_vars.h"
 
 #include "raylib.h"
 #include "rlgl.h"
@@ -24,6 +25,19 @@ void MobComponent::OnAddedToObject()
     AddToSystem<MobSystem>();
 }
 
+void MobComponent::Animate(float viewDistance, bool visible)
+{
+    if (!Instance)
+        return;
+
+    if (!GlobalVars::UseAnimationLOD)
+        Instance->Advance(GetFrameTime());
+    else if (visible)
+        Instance->Advance(GetFrameTime(), ModelManager::GetAnimationLOD(viewDistance));
+    else
+        Instance->AdvanceTime(GetFrameTime());
+}
+
 void MobComponent::Draw()
 {
     auto* transform = GetOwner()->GetComponent<TransformComponent>();
@@ -32,7 +46,6 @@ void MobComponent::Draw()
 
     if (Instance)
     {
-        Instance->Advance(GetFrameTime());
         Instance->Draw(*transform);
     }
     else
@@ -50,14 +63,14 @@ void MobComponent::Draw()
     rlPushMatrix();
     rlTranslatef(transform->Position.x, transform->Position.y, transform->Position.z + 0.01f);
     rlRotatef(transform->GetFacing(), 0, 0, 1);
-    if (IsTextureValid(ShadowTexture))
+    if (ShadowTexture && IsTextureValid(*ShadowTexture))
     {
         rlBegin(RL_QUADS);
 
         float shadowSize = 0.45f;
         float shadowAlpha = 0.25f;
 
-        rlSetTexture(ShadowTexture.id);
+        rlSetTexture(ShadowTexture->id);
 
         rlNormal3f(0, 0, 1);
         rlColor4f(1, 1, 1, shadowAlpha);
@@ -82,7 +95,7 @@ void MobComponent::Draw()
 
 void MobComponent::OnCreate()
 {
-    Character = CharacterManager::GetCharacter("walker");
+    Character = CharacterManager::GetCharacter(CharacterName);
 
     if (!Character)
         return;
@@ -97,7 +110,7 @@ void MobComponent::OnCreate()
 
     SetAnimationState(CharacterAnimationState::Idle);
     if (!Character->ShadowTexture.empty())
-        ShadowTexture = TextureManager::GetTexture(Character->ShadowTexture);
+        ShadowTexture = TextureManager::RequestTexture(Character->ShadowTexture);
 }
 
 void MobComponent::SetAnimationState(CharacterAnimationState state)
@@ -45,9 +45,13 @@ void TriggerComponent::RemovObject(ObjectLifetimeToken::Ptr token)
     if (!token->IsValid())
         return;
 
+    // the order doesn't matter, so the last one fills the gap
     auto itr = std::find(ConainedObjects.begin(), ConainedObjects.end(), token);
     if (itr != ConainedObjects.end())
-        ConainedObjects.erase(itr);
+    {
+        *itr = ConainedObjects.back();
+        ConainedObjects.pop_back();
+    }
 }
 
 bool TriggerComponent::HasObject(GameObject* object)
@@ -58,7 +62,7 @@ bool TriggerComponent::HasObject(GameObject* object)
 
         if (!tokenPtr->IsValid())
         {
-            ConainedObjects.erase(itr);
+            itr = ConainedObjects.erase(itr);
         }
         else
         {
@@ -79,7 +83,7 @@ bool TriggerComponent::HasAnyObjects()
 
         if (!tokenPtr->IsValid())
         {
-            ConainedObjects.erase(itr);
+            itr = ConainedObjects.erase(itr);
         }
         else
         {
@@ -5,7 +5,13 @@
 #include "scene.h"
 
 // services
+#include "services/async_loader.h"
+#include "services/behavior_manager.h"
 #include "services/global_vars.h"
+#include "services/hot_reload.h"
+#include "services/job_pool.h"
+#include "services/pathfinding.h"
+#include "services/resource_cache.h"
 #include "services/resource_manager.h"
 #include "services/texture_manager.h"
 #include "services/table_manager.h"
@@ -20,7 +26,10 @@
 #include "systems/map_object_system.h"
 #include "systems/menu_render_system.h"
 #include "systems/overlay_render_system.h"
+#include "systems/perception_system.h"
 #include "systems/player_management_system.h"
+#include "systems/ray_query_system.h"
+#include "systems/region_streaming_system.h"
 #include "systems/scene_render_system.h"
 #include "systems/mobile_object_system.h"
 
@@ -55,9 +64,12 @@ namespace App
         // register standard systems
         RegisterSystem<InputSystem>(SystemStage::PreUpdate);
         RegisterSystem<MapObjectSystem>(SystemStage::PreUpdate);
+        RegisterSystem<RayQuerySystem>(SystemStage::PreUpdate);
 
+        RegisterSystem<PerceptionSystem>(SystemStage::Update);
         RegisterSystem<MobSystem>(SystemStage::Update);
         RegisterSystem<PlayerManagementSystem>(SystemStage::Update);
+        RegisterSystem<RegionStreamingSystem>(SystemStage::Update);
 
         RegisterSystem<AudioSystem>(SystemStage::PostUpdate);
 
@@ -146,6 +158,18 @@ namespace App
         // tell the resource manager where the game resources are
         ResourceManager::Init("resources");
 
+        // start the background loader threads
+        AsyncLoader::Init();
+
+        // start the threads that share out the per frame work
+        JobPool::Init();
+
+        // start the path search thread
+        Pathfinding::Init();
+
+        // watch the resources for changes, the resource folder is now the working directory
+        HotReload::Init();
+
         // Setup all systems
         SetupSystems();
 
@@ -182,10 +206,14 @@ namespace App
                     return;
                 }
  
+                // cpu and gpu memory budgets for everything that is cached
+                ResourceCache::LoadBudgets(table->GetFieldAsTable("cache_budgets"));
+
                 // initialize the GPU shared resource managers
                 TextureManager::Init();
                 ModelManager::Init();
                 CharacterManager::Init();
+                BehaviorManager::Init();
 
                 // setup scene
                 GameWorld.Init();
@@ -202,6 +230,13 @@ namespace App
             }
         }
 
+        // bring in whatever finished loading in the background, a little each frame so a big load doesn't hitch
+        AsyncLoader::ProcessUploads(GlobalVars::UploadBudgetMS / 1000.0f);
+
+        // reload anything that was saved since the last frame
+        if (AppState == GameState::Playing)
+            HotReload::Update();
+
         // have all systems update
         for (auto& system : PreUpdateSystems)
             system->Update();
@@ -233,6 +268,12 @@ namespace App
 
     void Cleanup()
     {
+        // stop loading before the things being loaded into, and the console the loaders log to, go away
+        AsyncLoader::Cleanup();
+        JobPool::Cleanup();
+        Pathfinding::Cleanup();
+        HotReload::Cleanup();
+
         GameWorld.Cleanup();
 
         for (auto& [id, system] : Systems)
@@ -253,6 +294,7 @@ namespace App
         TextureManager::Cleanup();
         ResourceManager::Cleanup();
         TableManager::Cleanup();
+        BehaviorManager::Cleanup();
         ModelManager::Cleanup();
         CloseWindow();
     }
@@ -303,6 +345,11 @@ namespace App
         }
     }
 
+    void CallEvent(std::string_view name, GameObject* sender, GameObject* target)
+    {
+        CallEvent(StringHasher(name), sender, target);
+    }
+
 }
 
 // simple main app
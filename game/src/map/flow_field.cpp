@@ -0,0 +1,98 @@
+#include "map/flow_field.h"
+
+#include <algorithm>
+#include <functional>
+
+static constexpr float DiagonalCost = 1.41421356f;
+
+// the direction that undoes each direction
+static constexpr uint8_t OppositeDirection[8] = { 1, 0, 3, 2, 7, 6, 5, 4 };
+
+void FlowField::Build(const NavigationGrid& grid, const MapCoordinate& target, int radius)
+{
+    int width = radius * 2 + 1;
+    MapCoordinate origin = { target.X - radius, target.Y - radius };
+
+    // the target usually moved a cell or two, so most of the window is cells the last build already read
+    bool reuseCells = Grid == &grid && GridVersion == grid.GetVersion() && Width == width;
+    int shiftX = origin.X - Origin.X;
+    int shiftY = origin.Y - Origin.Y;
+
+    if (reuseCells)
+        PreviousWalkable.swap(Walkable);
+
+    Target = target;
+    Width = width;
+    Origin = origin;
+    Grid = &grid;
+    GridVersion = grid.GetVersion();
+
+    size_t count = size_t(Width) * size_t(Width);
+    Walkable.resize(count);
+    Distances.assign(count, FLT_MAX);
+    Directions.assign(count, NoDirection);
+    OpenList.clear();
+
+    for (int y = 0; y < Width; y++)
+    {
+        int previousY = y + shiftY;
+        bool previousRow = reuseCells && previousY >= 0 && previousY < Width;
+
+        for (int x = 0; x < Width; x++)
+        {
+            int previousX = x + shiftX;
+            size_t index = size_t(y) * size_t(Width) + size_t(x);
+
+            if (previousRow && previousX >= 0 && previousX < Width)
+                Walkable[index] = PreviousWalkable[size_t(previousY) * size_t(Width) + size_t(previousX)];
+            else
+                Walkable[index] = grid.IsWalkable(Origin.X + x, Origin.Y + y, true);
+        }
+    }
+
+    int start = int(GetIndex(target.X, target.Y));
+    if (!Walkable[start])
+        return;
+
+    // dijkstra out from the target, the step for each cell is back the way the search came to it
+    Distances[start] = 0;
+    OpenList.emplace_back(0.0f, start);
+
+    while (!OpenList.empty())
+    {
+        std::pop_heap(OpenList.begin(), OpenList.end(), std::greater<std::pair<float, int>>());
+        auto [distance, index] = OpenList.back();
+        OpenList.pop_back();
+
+        if (distance > Distances[index])
+            continue;
+
+        int x = index % Width;
+        int y = index / Width;
+
+        for (uint8_t direction = 0; direction < 8; direction++)
+        {
+            int nx = x + DirectionX[direction];
+            int ny = y + DirectionY[direction];
+            if (nx < 0 || ny < 0 || nx >= Width || ny >= Width)
+                continue;
+
+            int next = ny * Width + nx;
+            if (!Walkable[next])
+                continue;
+
+            bool diagonal = direction >= 4;
+            if (diagonal && (!Walkable[y * Width + nx] || !Walkable[ny * Width + x]))
+                continue;
+
+            float nextDistance = distance + (diagonal ? DiagonalCost : 1.0f);
+            if (nextDistance >= Distances[next])
+                continue;
+
+            Distances[next] = nextDistance;
+            Directions[next] = OppositeDirection[direction];
+            OpenList.emplace_back(nextDistance, next);
+            std::push_heap(OpenList.begin(), OpenList.end(), std::greater<std::pair<float, int>>());
+        }
+    }
+}
@@ -0,0 +1,531 @@
+#include "map/hierarchical_graph.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+
+static constexpr float DiagonalCost = 1.41421356f;
+
+// entrances this long or longer get a node at each end instead of one in the middle
+static constexpr int LongEntrance = 6;
+
+static constexpr size_t MaxCachedRoutes = 4096;
+
+// ids of abstract nodes are the cluster slot and the index of the node in the cluster
+static constexpr uint64_t GoalNode = UINT64_MAX;
+static constexpr uint64_t NoNode = UINT64_MAX - 1;
+
+static uint64_t GetNodeID(size_t slot, int index)
+{
+    return (uint64_t(slot) << 8) | uint64_t(index);
+}
+
+static float GetOctileDistance(const MapCoordinate& from, const MapCoordinate& to)
+{
+    int dx = abs(to.X - from.X);
+    int dy = abs(to.Y - from.Y);
+
+    return float(std::max(dx, dy)) + (DiagonalCost - 1.0f) * float(std::min(dx, dy));
+}
+
+static bool IsSameCell(const MapCoordinate& a, const MapCoordinate& b)
+{
+    return a.X == b.X && a.Y == b.Y;
+}
+
+void HierarchicalGraph::SetGrid(const NavigationGrid& grid, bool doorsAlwaysOpen)
+{
+    Clear();
+
+    Grid = &grid;
+    DoorsAlwaysOpen = doorsAlwaysOpen;
+    ClusterSlots.assign(grid.GetChunkSlotCount(), 0);
+}
+
+void HierarchicalGraph::Clear()
+{
+    Grid = nullptr;
+    OpenDoors.clear();
+    ClusterSlots.clear();
+    Clusters.clear();
+    SearchNodes.clear();
+    OpenList.clear();
+    RouteCache.clear();
+    CurrentStats = Stats();
+}
+
+bool HierarchicalGraph::IsWalkable(int x, int y) const
+{
+    NavCell cell = Grid->GetCell(x, y);
+    if (cell == NavCell::Door)
+        return DoorsAlwaysOpen || OpenDoors.contains(MapCoordinate::GetHash(x, y));
+
+    return cell == NavCell::Open;
+}
+
+void HierarchicalGraph::SetDoorOpen(int x, int y, bool open)
+{
+    if (!Grid || Grid->GetCell(x, y) != NavCell::Door)
+        return;
+
+    bool changed = open ? OpenDoors.insert(MapCoordinate::GetHash(x, y)).second : OpenDoors.erase(MapCoordinate::GetHash(x, y)) > 0;
+    if (!changed || DoorsAlwaysOpen)
+        return;
+
+    InvalidateCluster(x, y);
+
+    // a door on the edge of a cluster changes the entrances of the one next to it too
+    int localX = x & MapChunkMask;
+    int localY = y & MapChunkMask;
+    if (localX == 0)
+        InvalidateCluster(x - 1, y);
+    if (localX == MapChunkMask)
+        InvalidateCluster(x + 1, y);
+    if (localY == 0)
+        InvalidateCluster(x, y - 1);
+    if (localY == MapChunkMask)
+        InvalidateCluster(x, y + 1);
+
+    // any cached route could go through the door
+    RouteCache.clear();
+}
+
+void HierarchicalGraph::InvalidateCluster(int x, int y)
+{
+    if (!Grid->IsInGrid(x, y))
+        return;
+
+    uint32_t slot = ClusterSlots[GetClusterSlot(x, y)];
+    if (slot == 0)
+        return;
+
+    Cluster& cluster = *Clusters[slot - 1];
+    cluster.Built = false;
+    cluster.Nodes.clear();
+    cluster.Distances.clear();
+}
+
+HierarchicalGraph::Cluster& HierarchicalGraph::GetCluster(int x, int y)
+{
+    uint32_t& slot = ClusterSlots[GetClusterSlot(x, y)];
+    if (slot == 0)
+    {
+        Clusters.push_back(std::make_unique<Cluster>());
+        slot = uint32_t(Clusters.size());
+    }
+
+    Cluster& cluster = *Clusters[slot - 1];
+    if (!cluster.Built)
+        BuildCluster(cluster, x, y);
+
+    return cluster;
+}
+
+void HierarchicalGraph::AddEntrances(Cluster& cluster, int insideX, int insideY, int stepX, int stepY, int outX, int outY)
+{
+    int runStart = -1;
+    for (int i = 0; i <= MapChunkSize; i++)
+    {
+        int x = insideX + i * stepX;
+        int y = insideY + i * stepY;
+
+        bool open = i < MapChunkSize && IsWalkable(x, y) && IsWalkable(x + outX, y + outY);
+        if (open)
+        {
+            if (runStart < 0)
+                runStart = i;
+            continue;
+        }
+
+        if (runStart < 0)
+            continue;
+
+        // both clusters find the same runs along their shared edge, so the nodes on each side line up
+        int length = i - runStart;
+        int entrances[2] = { runStart + length / 2, -1 };
+        if (length >= LongEntrance)
+        {
+            entrances[0] = runStart;
+            entrances[1] = i - 1;
+        }
+
+        for (int entrance : entrances)
+        {
+            if (entrance < 0)
+                continue;
+
+            MapCoordinate cell = { insideX + entrance * stepX, insideY + entrance * stepY };
+            cluster.Nodes.push_back(ClusterNode{ cell, MapCoordinate{ cell.X + outX, cell.Y + outY } });
+        }
+
+        runStart = -1;
+    }
+}
+
+void HierarchicalGraph::BuildCluster(Cluster& cluster, int x, int y)
+{
+    int originX = x & ~MapChunkMask;
+    int originY = y & ~MapChunkMask;
+
+    cluster.Nodes.clear();
+    AddEntrances(cluster, originX, originY, 1, 0, 0, -1);
+    AddEntrances(cluster, originX, originY + MapChunkMask, 1, 0, 0, 1);
+    AddEntrances(cluster, originX, originY, 0, 1, -1, 0);
+    AddEntrances(cluster, originX + MapChunkMask, originY, 0, 1, 1, 0);
+
+    size_t count = cluster.Nodes.size();
+    cluster.Distances.assign(count * count, FLT_MAX);
+
+    if (count > 0)
+        LoadClusterCells(MapCoordinate{ originX, originY });
+
+    // most of a big map is open, with nothing in the way the distances are straight lines
+    if (std::all_of(LocalWalkable.begin(), LocalWalkable.end(), [](bool walkable) { return walkable; }))
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            for (size_t j = 0; j < count; j++)
+                cluster.Distances[i * count + j] = GetOctileDistance(cluster.Nodes[i].Cell, cluster.Nodes[j].Cell);
+        }
+
+        count = 0;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        SearchCluster(cluster.Nodes[i].Cell, nullptr);
+
+        for (size_t j = 0; j < count; j++)
+            cluster.Distances[i * count + j] = LocalDistances[Map::GetChunkCellIndex(cluster.Nodes[j].Cell.X, cluster.Nodes[j].Cell.Y)];
+    }
+
+    cluster.Built = true;
+    CurrentStats.ClustersBuilt++;
+}
+
+int HierarchicalGraph::FindNode(const Cluster& cluster, const MapCoordinate& cell, const MapCoordinate& exit) const
+{
+    for (size_t i = 0; i < cluster.Nodes.size(); i++)
+    {
+        if (IsSameCell(cluster.Nodes[i].Cell, cell) && IsSameCell(cluster.Nodes[i].Exit, exit))
+            return int(i);
+    }
+
+    return -1;
+}
+
+void HierarchicalGraph::LoadClusterCells(const MapCoordinate& cell)
+{
+    int originX = cell.X & ~MapChunkMask;
+    int originY = cell.Y & ~MapChunkMask;
+
+    for (int y = 0; y < MapChunkSize; y++)
+    {
+        for (int x = 0; x < MapChunkSize; x++)
+            LocalWalkable[(y << MapChunkShift) | x] = IsWalkable(originX + x, originY + y);
+    }
+}
+
+void HierarchicalGraph::SearchCluster(const MapCoordinate& from, const MapCoordinate* target)
+{
+    LocalDistances.fill(FLT_MAX);
+    LocalParents.fill(-1);
+    LocalOpenList.clear();
+
+    int start = int(Map::GetChunkCellIndex(from.X, from.Y));
+    int goal = target ? int(Map::GetChunkCellIndex(target->X, target->Y)) : -1;
+
+    LocalDistances[start] = 0;
+    LocalOpenList.emplace_back(0.0f, start);
+
+    while (!LocalOpenList.empty())
+    {
+        std::pop_heap(LocalOpenList.begin(), LocalOpenList.end(), std::greater<std::pair<float, int>>());
+        auto [distance, index] = LocalOpenList.back();
+        LocalOpenList.pop_back();
+
+        if (distance > LocalDistances[index])
+            continue;
+
+        if (index == goal)
+            return;
+
+        int x = index & MapChunkMask;
+        int y = index >> MapChunkShift;
+
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                int nx = x + dx;
+                int ny = y + dy;
+                if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= MapChunkSize || ny >= MapChunkSize)
+                    continue;
+
+                int next = (ny << MapChunkShift) | nx;
+                if (!LocalWalkable[next])
+                    continue;
+
+                bool diagonal = dx != 0 && dy != 0;
+                if (diagonal && (!LocalWalkable[(y << MapChunkShift) | nx] || !LocalWalkable[(ny << MapChunkShift) | x]))
+                    continue;
+
+                float nextDistance = distance + (diagonal ? DiagonalCost : 1.0f);
+                if (nextDistance >= LocalDistances[next])
+                    continue;
+
+                LocalDistances[next] = nextDistance;
+                LocalParents[next] = int16_t(index);
+                LocalOpenList.emplace_back(nextDistance, next);
+                std::push_heap(LocalOpenList.begin(), LocalOpenList.end(), std::greater<std::pair<float, int>>());
+            }
+        }
+    }
+}
+
+void HierarchicalGraph::AddOpen(uint64_t node, const MapCoordinate& cell, float g, uint64_t parent)
+{
+    auto [itr, added] = SearchNodes.try_emplace(node);
+    SearchNode& searchNode = itr->second;
+    if (!added && (searchNode.Closed || searchNode.G <= g))
+        return;
+
+    searchNode.G = g;
+    searchNode.Parent = parent;
+    searchNode.Cell = cell;
+
+    OpenList.push_back(OpenEntry{ g + GetOctileDistance(cell, SearchGoal), g, node });
+    std::push_heap(OpenList.begin(), OpenList.end(), std::greater<OpenEntry>());
+}
+
+bool HierarchicalGraph::FindAbstractPath(const MapCoordinate& start, const MapCoordinate& goal, HierarchicalPath& path, size_t maxExpansions)
+{
+    path.Waypoints.clear();
+    path.Cost = 0;
+    path.Expanded = 0;
+
+    if (!Grid || !IsWalkable(start.X, start.Y) || !IsWalkable(goal.X, goal.Y))
+        return false;
+
+    size_t startSlot = GetClusterSlot(start.X, start.Y);
+    size_t goalSlot = GetClusterSlot(goal.X, goal.Y);
+
+    const Cluster& startCluster = GetCluster(start.X, start.Y);
+    const Cluster& goalCluster = GetCluster(goal.X, goal.Y);
+
+    LoadClusterCells(start);
+    SearchCluster(start, startSlot == goalSlot ? &goal : nullptr);
+
+    // a goal in the same cluster that can be reached without leaving it doesn't need the graph
+    if (startSlot == goalSlot)
+    {
+        float distance = LocalDistances[Map::GetChunkCellIndex(goal.X, goal.Y)];
+        if (distance < FLT_MAX)
+        {
+            path.Waypoints = { start, goal };
+            path.Cost = distance;
+            return true;
+        }
+
+        // the early out left some of the cluster unsearched
+        SearchCluster(start, nullptr);
+    }
+
+    std::vector<float> startCosts(startCluster.Nodes.size());
+    for (size_t i = 0; i < startCosts.size(); i++)
+        startCosts[i] = LocalDistances[Map::GetChunkCellIndex(startCluster.Nodes[i].Cell.X, startCluster.Nodes[i].Cell.Y)];
+
+    // moves cost the same both ways, so the distances from the goal are the distances to it
+    LoadClusterCells(goal);
+    SearchCluster(goal, nullptr);
+
+    std::vector<float> goalCosts(goalCluster.Nodes.size());
+    for (size_t i = 0; i < goalCosts.size(); i++)
+        goalCosts[i] = LocalDistances[Map::GetChunkCellIndex(goalCluster.Nodes[i].Cell.X, goalCluster.Nodes[i].Cell.Y)];
+
+    uint64_t cacheKey = (uint64_t(startSlot) << 32) | uint64_t(goalSlot);
+    std::vector<uint64_t> route;
+
+    auto cached = RouteCache.find(cacheKey);
+    if (cached != RouteCache.end())
+    {
+        int first = int(cached->second.Nodes.front() & 0xff);
+        int last = int(cached->second.Nodes.back() & 0xff);
+
+        // the route is only good if this start and goal can get to its ends without leaving their clusters
+        if (startCosts[first] < FLT_MAX && goalCosts[last] < FLT_MAX)
+        {
+            CurrentStats.CacheHits++;
+            route = cached->second.Nodes;
+            path.Cost = startCosts[first] + cached->second.Cost + goalCosts[last];
+        }
+    }
+
+    if (route.empty())
+    {
+        CurrentStats.CacheMisses++;
+
+        SearchNodes.clear();
+        OpenList.clear();
+        SearchGoal = goal;
+
+        for (size_t i = 0; i < startCosts.size(); i++)
+        {
+            if (startCosts[i] < FLT_MAX)
+                AddOpen(GetNodeID(startSlot, int(i)), startCluster.Nodes[i].Cell, startCosts[i], NoNode);
+        }
+
+        bool found = false;
+        while (!OpenList.empty())
+        {
+            std::pop_heap(OpenList.begin(), OpenList.end(), std::greater<OpenEntry>());
+            OpenEntry entry = OpenList.back();
+            OpenList.pop_back();
+
+            SearchNode& searchNode = SearchNodes[entry.Node];
+            if (searchNode.Closed || entry.G > searchNode.G)
+                continue;
+
+            searchNode.Closed = true;
+
+            if (entry.Node == GoalNode)
+            {
+                found = true;
+                break;
+            }
+
+            path.Expanded++;
+            if (maxExpansions > 0 && path.Expanded > maxExpansions)
+                return false;
+
+            size_t slot = size_t(entry.Node >> 8);
+            int index = int(entry.Node & 0xff);
+
+            // nodes are only found in clusters that are already built
+            const Cluster& cluster = *Clusters[ClusterSlots[slot] - 1];
+            ClusterNode node = cluster.Nodes[index];
+
+            if (slot == goalSlot && goalCosts[index] < FLT_MAX)
+                AddOpen(GoalNode, goal, entry.G + goalCosts[index], entry.Node);
+
+            size_t count = cluster.Nodes.size();
+            for (size_t i = 0; i < count; i++)
+            {
+                float distance = cluster.Distances[index * count + i];
+                if (int(i) != index && distance < FLT_MAX)
+                    AddOpen(GetNodeID(slot, int(i)), cluster.Nodes[i].Cell, entry.G + distance, entry.Node);
+            }
+
+            const Cluster& next = GetCluster(node.Exit.X, node.Exit.Y);
+            int nextIndex = FindNode(next, node.Exit, node.Cell);
+            if (nextIndex >= 0)
+                AddOpen(GetNodeID(GetClusterSlot(node.Exit.X, node.Exit.Y), nextIndex), node.Exit, entry.G + 1.0f, entry.Node);
+        }
+
+        if (!found)
+            return false;
+
+        path.Cost = SearchNodes[GoalNode].G;
+
+        for (uint64_t node = SearchNodes[GoalNode].Parent; node != NoNode; node = SearchNodes[node].Parent)
+            route.push_back(node);
+
+        std::reverse(route.begin(), route.end());
+
+        if (RouteCache.size() >= MaxCachedRoutes)
+            RouteCache.clear();
+
+        int first = int(route.front() & 0xff);
+        int last = int(route.back() & 0xff);
+        RouteCache[cacheKey] = CachedRoute{ route, path.Cost - startCosts[first] - goalCosts[last] };
+    }
+
+    path.Waypoints.push_back(start);
+    for (uint64_t node : route)
+    {
+        const Cluster& cluster = *Clusters[ClusterSlots[size_t(node >> 8)] - 1];
+        const MapCoordinate& cell = cluster.Nodes[size_t(node & 0xff)].Cell;
+
+        // nodes in a corner belong to two edges
+        if (!IsSameCell(cell, path.Waypoints.back()))
+            path.Waypoints.push_back(cell);
+    }
+
+    if (!IsSameCell(goal, path.Waypoints.back()))
+        path.Waypoints.push_back(goal);
+
+    return true;
+}
+
+bool HierarchicalGraph::RefineSegment(const HierarchicalPath& path, size_t segment, std::vector<MapCoordinate>& cells)
+{
+    if (!Grid || segment + 1 >= path.Waypoints.size())
+        return false;
+
+    const MapCoordinate& from = path.Waypoints[segment];
+    const MapCoordinate& to = path.Waypoints[segment + 1];
+
+    // a step over the edge of a cluster
+    if (GetClusterSlot(from.X, from.Y) != GetClusterSlot(to.X, to.Y))
+    {
+        cells.push_back(to);
+        return true;
+    }
+
+    LoadClusterCells(from);
+    SearchCluster(from, &to);
+
+    int index = int(Map::GetChunkCellIndex(to.X, to.Y));
+    if (LocalDistances[index] == FLT_MAX)
+        return false;
+
+    int originX = from.X & ~MapChunkMask;
+    int originY = from.Y & ~MapChunkMask;
+
+    size_t first = cells.size();
+    for (; LocalParents[index] >= 0; index = LocalParents[index])
+        cells.push_back(MapCoordinate{ originX + (index & MapChunkMask), originY + (index >> MapChunkShift) });
+
+    std::reverse(cells.begin() + first, cells.end());
+    return true;
+}
+
+bool HierarchicalGraph::FindPath(const MapCoordinate& start, const MapCoordinate& goal, PathSearchResult& result, size_t maxExpansions)
+{
+    result.Found = false;
+    result.Points.clear();
+    result.Cost = 0;
+    result.Expanded = 0;
+
+    HierarchicalPath path;
+    bool found = FindAbstractPath(start, goal, path, maxExpansions);
+    result.Expanded = path.Expanded;
+    if (!found)
+        return false;
+
+    std::vector<MapCoordinate> cells = { start };
+    for (size_t i = 0; i + 1 < path.Waypoints.size(); i++)
+    {
+        if (!RefineSegment(path, i, cells))
+            return false;
+    }
+
+    // keep the cells where the route turns
+    for (size_t i = 0; i < cells.size(); i++)
+    {
+        if (i > 0 && i + 1 < cells.size())
+        {
+            int inX = cells[i].X - cells[i - 1].X;
+            int inY = cells[i].Y - cells[i - 1].Y;
+            if (inX == cells[i + 1].X - cells[i].X && inY == cells[i + 1].Y - cells[i].Y)
+                continue;
+        }
+
+        result.Points.push_back(cells[i]);
+    }
+
+    result.Found = true;
+    result.Cost = path.Cost;
+    return true;
+}
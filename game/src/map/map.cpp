@@ -1,10 +1,16 @@
 #include "map/map.h"
 
 #include "services/game_time.h"
+#include "services/texture_manager.h"
+#include "utilities/collision_utils.h"
+#include "utilities/swept_collision.h"
 
 #include "raymath.h"
 
-MapCell InvalidCell = { MapCellState::Invalid };
+#include <algorithm>
+#include <cfloat>
+
+static MapCell OutOfMapCell = { MapCellState::Invalid };
 
 void LightZoneInfo::Advance()
 {
@@ -43,37 +49,15 @@ void LightZoneInfo::Reset()
 }
 
 
-MapCell Map::GetCell(int x, int y) const
-{
-    if (x < 0 || x>= Size.X)
-        return InvalidCell;
-
-    if (y < 0 || y >= Size.Y)
-        return InvalidCell;
-
-    return Cells[y * Size.X + x];
-}
-
 MapCell& Map::GetCellRef(int x, int y)
 {
-    if (x < 0 || x >= Size.X)
-        return InvalidCell;
-
-    if (y < 0 || y >= Size.Y)
-        return InvalidCell;
-
-    return Cells[y * Size.X + x];
-}
-
-const MapCell& Map::GetCellRef(int x, int y) const
-{
-    if (x < 0 || x >= Size.X)
-        return InvalidCell;
-
-    if (y < 0 || y >= Size.Y)
-        return InvalidCell;
+    if (!IsInMap(x, y))
+    {
+        OutOfMapCell = InvalidCell;
+        return OutOfMapCell;
+    }
 
-    return Cells[y * Size.X + x];
+    return AddChunk(x, y).Cells[GetChunkCellIndex(x, y)];
 }
 
 bool Map::IsCellSolid(int x, int y) const
@@ -98,122 +82,70 @@ bool Map::IsCellCapped(int x, int y) const
 
 void Map::Clear()
 {
-    Cells.clear();
-    Size.X = Size.Y = 0;
+    SetSize(0, 0);
+    Regions.clear();
+
+    TextureManager::ReleaseTexture(TilemapName);
+    TilemapName.clear();
+    Tilemap = { 0 };
 }
 
 bool Map::MoveEntity(Vector3& position, Vector3& desiredMotion, float radius)
 {
-    Vector3 newPos = position + desiredMotion;
-    bool collided = false;
-
-    for (int y = int(position.y - 1); y <= int(position.y + 1); y++)
-    {
-        for (int x = int(position.x - 1); x <= int(position.x + 1); x++)
-        {
-            if (!IsCellPassable(x, y))
-            {
-                // check rectangle
+    static const std::vector<Rectangle> noObstacles;
+    return SweptCollision::MoveCircle(*this, noObstacles, position, desiredMotion, radius);
+}
 
-                Vector3 hitPoint = { -10000,-100000, 0 };
-                Vector3 hitNormal = { 0, 0, 0 };
-                PointNearesGridPoint(x, y, newPos, &hitPoint, &hitNormal);
+bool Map::SweepCircle(const Vector2& start, const Vector2& motion, float radius, float* time, Vector2* normal) const
+{
+    // long moves are checked in pieces, so a fast mover only looks at the cells near its path instead of a big box around it
+    static constexpr float MaxPieceLength = 2;
 
-                Vector3 vectorToHit = hitPoint - newPos;
+    int pieces = std::max(1, int(ceilf(Vector2Length(motion) / MaxPieceLength)));
 
-                bool inside = Vector3LengthSqr(vectorToHit) < radius * radius;
+    float bestTime = FLT_MAX;
+    Vector2 bestNormal = { 0, 0 };
 
-                if (inside)
-                {
-                    collided = true;
-                    // normalize the vector along the point to where we are nearest
-                    vectorToHit = Vector3Normalize(vectorToHit);
+    for (int piece = 0; piece < pieces; piece++)
+    {
+        float pieceStart = float(piece) / float(pieces);
+        float pieceEnd = float(piece + 1) / float(pieces);
 
-                    // project that out to the radius to find the point that should be 'deepest' into the rectangle.
-                    Vector3 projectedPoint = newPos + (vectorToHit * radius);
+        Vector2 from = start + motion * pieceStart;
+        Vector2 to = start + motion * pieceEnd;
 
-                    // compute the shift to take the deepest point out to the edge of our nearest hit, based on the vector direction
-                    Vector3 delta = { 0,0 };
+        int minX = int(floorf(std::min(from.x, to.x) - radius));
+        int maxX = int(floorf(std::max(from.x, to.x) + radius));
+        int minY = int(floorf(std::min(from.y, to.y) - radius));
+        int maxY = int(floorf(std::max(from.y, to.y) + radius));
 
-                    if (hitNormal.x != 0)
-                        delta.x = hitPoint.x - projectedPoint.x;
-                    else
-                        delta.y = hitPoint.y - projectedPoint.y;
+        for (int y = minY; y <= maxY; y++)
+        {
+            for (int x = minX; x <= maxX; x++)
+            {
+                if (IsCellPassable(x, y))
+                    continue;
 
-                    // shift the new point by the delta to push us outside of the rectangle
-                    newPos += delta;
+                float hitTime = 0;
+                Vector2 hitNormal = { 0, 0 };
+                Rectangle cell = { float(x), float(y), 1, 1 };
+                if (CollisionUtils::SweepCircleRect(start, motion, radius, cell, &hitTime, &hitNormal) && hitTime < bestTime)
+                {
+                    bestTime = hitTime;
+                    bestNormal = hitNormal;
                 }
             }
         }
-    }
 
-    desiredMotion = newPos - position;
-
-    return collided;
-}
-
-
-void Map::PointNearesGridPoint(int x, int y, const Vector3 point, Vector3* nearest, Vector3* normal)
-{
-    // get the closest point on the vertical sides
-    float hValue = float(x);
-    float hNormal = -1.0f;
-    if (point.x > x + 1)
-    {
-        hValue += 1;
-        hNormal = 1;
+        // a cell in a later piece can't be hit before this piece ends, but one in this piece can be hit after it
+        if (bestTime <= pieceEnd)
+            break;
     }
 
-    Vector3 vecToPoint = Vector3{ hValue, float(y), 0.0f } -  point;
-
-    // get the dot product between the ray and the vector to the point
-    float dotForPoint = Vector3DotProduct(Vector3{ 0, -1, 0 }, vecToPoint);
-    Vector3 nearestPoint = { hValue, 0, 0 };
-
-    if (dotForPoint < 0)
-        nearestPoint.y = float(y);
-    else if (dotForPoint >= 1)
-        nearestPoint.y = float(y + 1);
-    else
-        nearestPoint.y = y + dotForPoint;
-
-    // get the closest point on the horizontal sides
-    float vValue = float(y);
-    float vNormal = -1;
-    if (point.y > y + 1)
-    {
-        vValue = float(y + 1);
-        vNormal = 1;
-    }
+    if (bestTime > 1)
+        return false;
 
-    vecToPoint = Vector3{ float(x), vValue, 0 } - point;
-    // get the dot product between the ray and the vector to the point
-    dotForPoint = Vector3DotProduct(Vector3{ -1, 0, 0 }, vecToPoint);
-    *nearest = Vector3{ 0,vValue, 0};
-
-    if (dotForPoint < 0)
-        nearest->x = float(x);
-    else if (dotForPoint >= 1)
-        nearest->x = float(x + 1);
-    else
-        nearest->x = float(x + dotForPoint);
-
-    if (Vector3LengthSqr(point -nearestPoint) < Vector3LengthSqr(point - *nearest))
-    {
-        *nearest = nearestPoint;
-
-        if (normal)
-        {
-            normal->x = hNormal;
-            normal->y = 0;
-        }
-    }
-    else
-    {
-        if (normal)
-        {
-            normal->y = vNormal;
-            normal->x = 0;
-        }
-    }
-}
\ No newline at end of file
+    *time = bestTime;
+    *normal = bestNormal;
+    return true;
+}
@@ -0,0 +1,552 @@
+#include "map/map_compiler.h"
+#include "map/compiled_map.h"
+
+#include "LDtkLoader/Project.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <unordered_map>
+
+class LDtkMapCompiler
+{
+private:
+    int GridSize = 0;
+
+    CompiledMap::MapHeader Header;
+
+    // only the cells of the map are used, chunks are allocated as tiles are placed
+    Map Cells;
+    std::vector<Rectangle> TileSourceRects;
+    std::vector<CompiledMap::LightZoneRecord> LightZones;
+    std::vector<CompiledMap::EntityRecord> Entities;
+    std::vector<CompiledMap::PathPoint> PathPoints;
+    std::vector<CompiledMap::CellCoordinate> DoorCells;
+    std::vector<CompiledMap::RegionRecord> Regions;
+    std::string Strings;
+
+    // where each level is in the world, in cells from the top left, with y going down like LDtk
+    std::unordered_map<const ldtk::Level*, ldtk::IntPoint> LevelOffsets;
+
+    // the offset of the level whose entities are being compiled
+    ldtk::IntPoint LevelOffset = { 0, 0 };
+
+    ldtk::IntPoint TilesetSize = { 0, 0 };
+
+    CompiledMap::StringRef AddString(std::string_view text)
+    {
+        CompiledMap::StringRef ref;
+        ref.Offset = uint32_t(Strings.size());
+        ref.Length = uint32_t(text.size());
+        Strings.append(text);
+
+        return ref;
+    }
+
+    // converts a pixel position in the current level to a map position
+    Vector2 Convert(const ldtk::IntPoint& point) const
+    {
+        return Vector2{ (float)point.x / GridSize + LevelOffset.x, Header.Height - ((float)point.y / GridSize + LevelOffset.y) };
+    }
+
+    Vector2 ConvertNoFlip(const ldtk::IntPoint& point) const
+    {
+        return Vector2{ (float)point.x / GridSize, ((float)point.y / GridSize) };
+    }
+
+    ldtk::IntPoint ToWorldGrid(const ldtk::IntPoint& gridPosition, const ldtk::Level* level) const
+    {
+        auto offset = LevelOffsets.find(level);
+        if (offset == LevelOffsets.end())
+            return gridPosition;
+
+        return ldtk::IntPoint{ gridPosition.x + offset->second.x, gridPosition.y + offset->second.y };
+    }
+
+    // maps are stored with y going up, LDtk has y going down
+    MapCell& GetCell(const ldtk::IntPoint& gridPosition)
+    {
+        int y = int(Header.Height) - gridPosition.y - 1;
+        return Cells.AddChunk(gridPosition.x, y).Cells[Map::GetChunkCellIndex(gridPosition.x, y)];
+    }
+
+    bool IsInMap(const ldtk::IntPoint& gridPosition) const
+    {
+        return gridPosition.x >= 0 && gridPosition.y >= 0 && gridPosition.x < int(Header.Width) && gridPosition.y < int(Header.Height);
+    }
+
+    Rectangle ObjectBoundsToRect(const ldtk::Entity& object) const
+    {
+        Vector2 pos = Convert(object.getPosition());
+        Vector2 size = ConvertNoFlip(object.getSize());
+        return Rectangle{ pos.x, pos.y - size.y, size.x, size.y };
+    }
+
+    uint16_t GetTileFromRect(int x, int y) const
+    {
+        float scaleX = x / (float)TilesetSize.x;
+        float scaleY = y / (float)TilesetSize.y;
+
+        float epsilonX = 1 / (float)TilesetSize.x;
+        float epsilonY = 1 / (float)TilesetSize.y;
+
+        for (uint16_t index = 0; index < TileSourceRects.size(); index++)
+        {
+            const Rectangle& rect = TileSourceRects[index];
+            if (fabsf(rect.x - scaleX) < epsilonX && fabsf(rect.y - scaleY) < epsilonY)
+                return index;
+        }
+
+        return 0;
+    }
+
+    template<class T, class C>
+    bool SetFromProperty(const std::string& name, const C& container, T& value)
+    {
+        auto field = container.template getField<T>(name);
+        if (field.is_null())
+            return false;
+
+        value = field.value();
+
+        return true;
+    }
+
+    template<class T>
+    bool SetFromProperty(const std::string& name, const ldtk::EntityRef& containerRef, T& value)
+    {
+        auto field = containerRef->getField<T>(name);
+        if (field.is_null())
+            return false;
+
+        value = field.value();
+
+        return true;
+    }
+
+    template<class T>
+    void SetField(const std::string& name, const ldtk::Entity& object, T& value, uint32_t& fields, uint32_t flag)
+    {
+        if (SetFromProperty(name, object, value))
+            fields |= flag;
+    }
+
+    void SetFlagField(const std::string& name, const ldtk::Entity& object, uint8_t& value, uint32_t& fields, uint32_t flag)
+    {
+        bool state = false;
+        if (SetFromProperty(name, object, state))
+        {
+            value = state ? 1 : 0;
+            fields |= flag;
+        }
+    }
+
+    CompiledMap::EntityRecord& AddEntity(const ldtk::Entity& object, CompiledMap::EntityType type)
+    {
+        auto& entity = Entities.emplace_back();
+        entity.Type = type;
+
+        Vector2 convertedPos = Convert(object.getPosition());
+        entity.PositionX = convertedPos.x;
+        entity.PositionY = convertedPos.y;
+
+        return entity;
+    }
+
+    // only entities with a transform have a facing field, the loader throws for fields an entity doesn't have
+    CompiledMap::EntityRecord& AddPlacedEntity(const ldtk::Entity& object, CompiledMap::EntityType type)
+    {
+        auto& entity = AddEntity(object, type);
+        SetField("Facing", object, entity.Facing, entity.Fields, CompiledMap::EntityFields::Facing);
+
+        return entity;
+    }
+
+    void ReadLightInfo(const ldtk::Level& level)
+    {
+        std::string skybox;
+        SetFromProperty("skybox", level, skybox);
+        Header.Skybox = AddString(skybox);
+
+        SetFromProperty("extereor_ambient_level", level, Header.ExteriorAmbientLevel);
+        SetFromProperty("interior_ambient_level", level, Header.InteriorAmbientLevel);
+        SetFromProperty("ambient_direction_angle", level, Header.AmbientAngle);
+    }
+
+    void ReadTileset(const ldtk::Layer& layer)
+    {
+        auto& tileset = layer.getTileset();
+
+        std::string path = tileset.path;
+
+        while (path.substr(0, 3) == "../")
+            path = path.substr(3);
+
+        Header.Tilemap = AddString(path);
+        TilesetSize = tileset.texture_size;
+
+        // the last index is kept for cells without a tile
+        for (int i = 0; i < MapCellInvalidTile; i++)
+        {
+            auto point = tileset.getTileTexturePos(i);
+            if (point.x >= tileset.texture_size.x || point.y >= tileset.texture_size.y)
+                break;
+
+            Rectangle tileRect;
+            tileRect.x = float(point.x) / tileset.texture_size.x;
+            tileRect.y = float(point.y) / tileset.texture_size.y;
+            tileRect.width = (float(point.x + tileset.tile_size) / float(tileset.texture_size.x));
+            tileRect.height = (float(point.y + tileset.tile_size) / float(tileset.texture_size.y));
+
+            TileSourceRects.push_back(tileRect);
+        }
+    }
+
+    void ReadEmptyLayer(const ldtk::Layer& layer, int tileIndex)
+    {
+        for (const auto& tile : layer.allTiles())
+        {
+            auto grid = ToWorldGrid(tile.getGridPosition(), layer.level);
+            if (!IsInMap(grid))
+                continue;
+
+            auto& cell = GetCell(grid);
+            cell.State = MapCellState::Empty;
+            cell.Tiles[tileIndex] = uint16_t(tile.tileId);
+        }
+    }
+
+    void ReadWallsLayer(const ldtk::Layer& layer)
+    {
+        for (const auto& tile : layer.allTiles())
+        {
+            auto grid = ToWorldGrid(tile.getGridPosition(), layer.level);
+            if (!IsInMap(grid))
+                continue;
+
+            auto& cell = GetCell(grid);
+            cell.State = MapCellState::Wall;
+            cell.Tiles[0] = uint16_t(tile.tileId);
+        }
+    }
+
+    void AddModelObject(const ldtk::Entity& object)
+    {
+        auto& entity = AddPlacedEntity(object, CompiledMap::EntityType::Model);
+
+        auto field = object.getField<ldtk::EnumValue>("Model");
+        if (!field.is_null())
+            entity.Name = AddString(field.value().name);
+
+        SetFlagField("Solid", object, entity.Flag, entity.Fields, CompiledMap::EntityFields::Solid);
+    }
+
+    void AddTrigger(const ldtk::Entity& object)
+    {
+        auto& entity = AddEntity(object, CompiledMap::EntityType::Trigger);
+        entity.Bounds = ObjectBoundsToRect(object);
+
+        int triggerId = 0;
+        if (SetFromProperty("trigger_id", object, triggerId))
+        {
+            entity.TriggerId = triggerId;
+            entity.Fields |= CompiledMap::EntityFields::TriggerId;
+        }
+    }
+
+    void AddMobObject(const ldtk::Entity& object)
+    {
+        auto& entity = AddPlacedEntity(object, CompiledMap::EntityType::Mob);
+
+        SetFlagField("FollowPath", object, entity.Flag, entity.Fields, CompiledMap::EntityFields::FollowPath);
+        SetFlagField("ChasePlayer", object, entity.SecondFlag, entity.Fields, CompiledMap::EntityFields::ChasePlayer);
+        SetField("MoveSpeed", object, entity.Speed, entity.Fields, CompiledMap::EntityFields::MoveSpeed);
+        SetField("RotationSpeed", object, entity.SecondSpeed, entity.Fields, CompiledMap::EntityFields::RotationSpeed);
+
+        entity.FirstItem = uint32_t(PathPoints.size());
+        for (auto& point : object.getArrayField<ldtk::IntPoint>("Path"))
+        {
+            if (point.is_null())
+                continue;
+
+            PathPoints.push_back(CompiledMap::PathPoint{ point.value().x + LevelOffset.x + 0.5f, (Header.Height - (point.value().y + LevelOffset.y)) - 0.5f });
+        }
+        entity.ItemCount = uint32_t(PathPoints.size()) - entity.FirstItem;
+    }
+
+    void AddLightZoneObject(const ldtk::Entity& object)
+    {
+        // the last index is kept for cells without a light zone
+        if (LightZones.size() >= MapCellInvalidLightZone)
+            return;
+
+        auto bounds = ObjectBoundsToRect(object);
+
+        CompiledMap::LightZoneRecord zone;
+
+        const auto sequence = object.getField<ldtk::EnumValue>("light_sequence");
+        if (!sequence.is_null())
+            zone.Sequence = AddString(sequence.value().name);
+
+        if (SetFromProperty("max_level", object, zone.MaxLevel))
+            zone.Fields |= CompiledMap::LightZoneFields::MaxLevel;
+
+        if (SetFromProperty("min_level", object, zone.MinLevel))
+            zone.Fields |= CompiledMap::LightZoneFields::MinLevel;
+
+        float len = 0;
+        if (SetFromProperty("sequence_lenght", object, len) && len > 0)
+        {
+            zone.SequenceLength = len;
+            zone.Fields |= CompiledMap::LightZoneFields::SequenceLength;
+        }
+
+        for (int y = int(bounds.y); y < int(bounds.y + bounds.height); y++)
+        {
+            for (int x = int(bounds.x); x < int(bounds.x + bounds.width); x++)
+            {
+                if (Cells.IsInMap(x, y))
+                    Cells.AddChunk(x, y).Cells[Map::GetChunkCellIndex(x, y)].LightZone = uint16_t(LightZones.size());
+            }
+        }
+
+        LightZones.push_back(zone);
+    }
+
+    void AddDoorObject(const ldtk::Entity& object)
+    {
+        auto& entity = AddEntity(object, CompiledMap::EntityType::DoorTrigger);
+        entity.Bounds = ObjectBoundsToRect(object);
+
+        SetFlagField("FullyOpenBeforeClose", object, entity.Flag, entity.Fields, CompiledMap::EntityFields::FullyOpenBeforeClose);
+        SetField("OpenSpeed", object, entity.Speed, entity.Fields, CompiledMap::EntityFields::OpenSpeed);
+        SetField("CloseSpeed", object, entity.SecondSpeed, entity.Fields, CompiledMap::EntityFields::CloseSpeed);
+        SetFlagField("StayOpen", object, entity.SecondFlag, entity.Fields, CompiledMap::EntityFields::StayOpen);
+        SetField("MinimumOpenTime", object, entity.Time, entity.Fields, CompiledMap::EntityFields::MinimumOpenTime);
+
+        // the door cells are part of the cell data, the controller only needs to know which ones it moves
+        entity.FirstItem = uint32_t(DoorCells.size());
+        for (auto doorRef : object.getArrayField<ldtk::EntityRef>("Doors"))
+        {
+            if (doorRef.is_null())
+                continue;
+
+            const auto& door = doorRef.value();
+
+            // doors can be in a neighbouring level
+            auto grid = ToWorldGrid(door->getGridPosition(), door->layer->level);
+            if (!IsInMap(grid))
+                continue;
+
+            auto& doorCell = GetCell(grid);
+            doorCell.State = MapCellState::Door;
+
+            const auto& doorTexture = door->getField<ldtk::TileRef>("Texture");
+            if (!doorTexture.is_null())
+                doorCell.Tiles[2] = GetTileFromRect(doorTexture.value().bounds.x, doorTexture.value().bounds.y);
+
+            if (door->getName() == "Door_X")
+                doorCell.Flags |= MapCellFlags::XAllignment;
+
+            bool backwards = false;
+            bool vertical = false;
+
+            SetFromProperty("Backwards", door, backwards);
+            SetFromProperty("Vertical", door, vertical);
+
+            if (backwards)
+                doorCell.Flags |= MapCellFlags::Reversed;
+
+            if (vertical)
+                doorCell.Flags |= MapCellFlags::HorizontalVertical;
+
+            doorCell.Flags |= MapCellFlags::Impassible;
+
+            DoorCells.push_back(CompiledMap::CellCoordinate{ uint32_t(grid.x), Header.Height - uint32_t(grid.y) - 1 });
+        }
+        entity.ItemCount = uint32_t(DoorCells.size()) - entity.FirstItem;
+    }
+
+    template<class T>
+    static void Append(std::vector<uint8_t>& output, const T* data, size_t count)
+    {
+        size_t start = output.size();
+        output.resize(start + sizeof(T) * count);
+        if (count > 0)
+            memcpy(output.data() + start, data, sizeof(T) * count);
+    }
+
+    void Write(std::vector<uint8_t>& output)
+    {
+        memcpy(Header.Magic, CompiledMap::Magic, sizeof(Header.Magic));
+        Header.Version = CompiledMap::Version;
+        Header.TileRectCount = uint32_t(TileSourceRects.size());
+        Header.LightZoneCount = uint32_t(LightZones.size());
+        Header.EntityCount = uint32_t(Entities.size());
+        Header.PathPointCount = uint32_t(PathPoints.size());
+        Header.DoorCellCount = uint32_t(DoorCells.size());
+        Header.StringsSize = uint32_t(Strings.size());
+        Header.RegionCount = uint32_t(Regions.size());
+        Header.ChunkCount = uint32_t(Cells.Chunks.size());
+
+        output.clear();
+        Append(output, &Header, 1);
+
+        for (const auto& chunk : Cells.Chunks)
+        {
+            CompiledMap::ChunkRecord record = { uint32_t(chunk->Origin.X), uint32_t(chunk->Origin.Y) };
+            Append(output, &record, 1);
+        }
+
+        for (const auto& chunk : Cells.Chunks)
+            Append(output, chunk->Cells, MapChunkCellCount);
+
+        Append(output, TileSourceRects.data(), TileSourceRects.size());
+        Append(output, LightZones.data(), LightZones.size());
+        Append(output, Entities.data(), Entities.size());
+        Append(output, PathPoints.data(), PathPoints.size());
+        Append(output, DoorCells.data(), DoorCells.size());
+        Append(output, Regions.data(), Regions.size());
+        Append(output, Strings.data(), Strings.size());
+    }
+
+    // works out where every level goes and the size of the world that holds them all
+    void PlaceLevels(const ldtk::World& world)
+    {
+        ldtk::IntPoint minimum = { INT_MAX, INT_MAX };
+        ldtk::IntPoint next = { 0, 0 };
+        std::vector<std::pair<const ldtk::Level*, ldtk::IntPoint>> positions;
+
+        for (const auto& level : world.allLevels())
+        {
+            // linear layouts don't give levels a position, they are placed one after the other
+            ldtk::IntPoint position = level.position;
+            if (world.getLayout() == ldtk::WorldLayout::LinearHorizontal)
+            {
+                position = ldtk::IntPoint{ next.x, 0 };
+                next.x += level.size.x;
+            }
+            else if (world.getLayout() == ldtk::WorldLayout::LinearVertical)
+            {
+                position = ldtk::IntPoint{ 0, next.y };
+                next.y += level.size.y;
+            }
+
+            minimum.x = std::min(minimum.x, position.x);
+            minimum.y = std::min(minimum.y, position.y);
+            positions.emplace_back(&level, position);
+        }
+
+        for (const auto& [level, position] : positions)
+        {
+            ldtk::IntPoint offset = { (position.x - minimum.x) / GridSize, (position.y - minimum.y) / GridSize };
+            LevelOffsets.insert_or_assign(level, offset);
+
+            Header.Width = std::max(Header.Width, uint32_t(offset.x + level->size.x / GridSize));
+            Header.Height = std::max(Header.Height, uint32_t(offset.y + level->size.y / GridSize));
+        }
+    }
+
+    void ReadLevelEntities(const ldtk::Level& level)
+    {
+        LevelOffset = LevelOffsets[&level];
+
+        CompiledMap::RegionRecord region;
+        region.Name = AddString(level.name);
+        region.Width = uint32_t(level.size.x / GridSize);
+        region.Height = uint32_t(level.size.y / GridSize);
+        region.X = uint32_t(LevelOffset.x);
+        region.Y = Header.Height - uint32_t(LevelOffset.y) - region.Height;
+        region.FirstEntity = uint32_t(Entities.size());
+
+        const auto& objects = level.getLayer("Objects");
+
+        for (auto& object : objects.allEntities())
+        {
+            if (object.getName() == "PlayerSpawn")
+                AddPlacedEntity(object, CompiledMap::EntityType::PlayerSpawn);
+            else if (object.getName() == "Model")
+                AddModelObject(object);
+            else if (object.getName() == "LightZone")
+                AddLightZoneObject(object);
+            else if (object.getName() == "Trigger")
+                AddTrigger(object);
+            else if (object.getName() == "MOB")
+                AddMobObject(object);
+            else if (object.getName() == "DoorTrigger")
+                AddDoorObject(object);
+        }
+
+        region.EntityCount = uint32_t(Entities.size()) - region.FirstEntity;
+        Regions.push_back(region);
+    }
+
+public:
+    bool Compile(const uint8_t* data, size_t size, std::vector<uint8_t>& output)
+    {
+        ldtk::Project project;
+        project.loadFromMemory(data, size);
+
+        const auto& mapWorld = project.getWorld();
+        const auto& levels = mapWorld.allLevels();
+        if (levels.empty())
+            return false;
+
+        // the layers are defined once for the project, so every level shares the grid size, tileset and world lighting of the first
+        const auto& firstLevel = levels.front();
+        ReadLightInfo(firstLevel);
+
+        const auto& floorLayer = firstLevel.getLayer("Floors");
+        GridSize = floorLayer.getGridSize().x;
+        if (GridSize <= 0)
+            return false;
+
+        ReadTileset(floorLayer);
+
+        PlaceLevels(mapWorld);
+        if (!IsValidMapSize(Header.Width, Header.Height))
+            return false;
+
+        Cells.SetSize(int(Header.Width), int(Header.Height));
+
+        // every level's cells go in before any entities, doors can mark cells in other levels
+        for (const auto& level : levels)
+        {
+            ReadEmptyLayer(level.getLayer("Floors"), 0);
+            ReadEmptyLayer(level.getLayer("Ceilings"), 1);
+            ReadWallsLayer(level.getLayer("Walls"));
+        }
+
+        for (const auto& level : levels)
+            ReadLevelEntities(level);
+
+        Write(output);
+        return true;
+    }
+};
+
+namespace MapCompiler
+{
+    bool CompileLDtk(const uint8_t* data, size_t size, std::vector<uint8_t>& output, std::string& error)
+    {
+        // the LDtk loader reports missing layers, fields and bad json with exceptions
+        try
+        {
+            LDtkMapCompiler compiler;
+            if (!compiler.Compile(data, size, output))
+            {
+                error = "the world has no levels, the Floors layer has no grid size, or the world is too big";
+                return false;
+            }
+        }
+        catch (const std::exception& exception)
+        {
+            error = exception.what();
+            return false;
+        }
+
+        return true;
+    }
+}
@@ -1,7 +1,14 @@
 #include "map/map_reader.h"
 #include "scene.h"
 #include "map/map.h"
-
+#include "map/compiled_map.h"
+#include "map/map_compiler.h"
+
+#include "services/async_loader.h"
+#include "services/character_manager.h"
+#include "services/global_vars.h"
+#include "services/job_pool.h"
+#include "services/pathfinding.h"
 #include "services/texture_manager.h"
 #include "services/resource_manager.h"
 #include "services/table_manager.h"
@@ -17,9 +24,26 @@
 
 #include "utilities/light_utils.h"
 
-#include "LDtkLoader/Project.hpp"
+#include "binary_reader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <unordered_set>
+
+// the models and textures some regions use, they are loaded together before the objects are spawned
+struct MapAssets
+{
+    std::set<std::string> Models;
+    std::set<std::string> AnimatedModels;
+    std::set<std::string> Textures;
+
+    size_t GetCount() const { return Models.size() + AnimatedModels.size() + Textures.size(); }
+};
 
-class MapReader
+class MapReader : public MapRegionLoader
 {
 public:
     MapReader(Scene& world) :TheWorld(world), TheMap(world.GetMap()) {}
@@ -31,385 +55,619 @@ protected:
     Map& TheMap;
 };
 
-class LDTKMapReader : MapReader
+// keeps the entities of the map after reading it, to spawn them a region at a time
+class CompiledMapReader : public MapReader
 {
 private:
-    int GridSize = 0;
+    std::vector<CompiledMap::EntityRecord> Entities;
+    std::vector<CompiledMap::PathPoint> PathPoints;
+    std::vector<CompiledMap::CellCoordinate> DoorCells;
+    std::vector<CompiledMap::RegionRecord> Regions;
+    std::string Strings;
 
-    Vector2 Convert(const ldtk::IntPoint& point) const
+    std::string_view GetString(const CompiledMap::StringRef& ref) const
     {
-        return Vector2{ (float)point.x / GridSize, TheMap.Size.Y - ((float)point.y / GridSize) };
+        return std::string_view(Strings).substr(ref.Offset, ref.Length);
     }
 
-    Vector2 ConvertNoFlip(const ldtk::IntPoint& point) const
+    bool IsValidString(const CompiledMap::StringRef& ref) const
     {
-        return Vector2{ (float)point.x / GridSize, ((float)point.y / GridSize) };
+        return ref.Offset <= Strings.size() && ref.Length <= Strings.size() - ref.Offset;
     }
 
-    size_t PositionToMapID(const ldtk::IntPoint& point)
+    void SetObjectTransform(const CompiledMap::EntityRecord& entity, TransformComponent* transform)
     {
-        auto coord = point;
-        coord.x /= TheMap.Size.X;
-        coord.y = int((TheMap.Size.Y - (coord.y / TheMap.Size.Y)) - 1);
+        if (!transform)
+            return;
 
-        size_t cellIndex = size_t(coord.y * TheMap.Size.X + coord.x);
+        transform->Position.x = entity.PositionX;
+        transform->Position.y = entity.PositionY;
+        transform->Position.z = 0;
 
-        return cellIndex;
+        if (entity.Fields & CompiledMap::EntityFields::Facing)
+            transform->SetFacing(entity.Facing);
     }
 
-    Rectangle ObjectBoundsToRect(const ldtk::Entity& object)
+    void SetupLightInfo(const CompiledMap::MapHeader& header)
     {
-        Vector2 pos = Convert(object.getPosition());
-        Vector2 size = ConvertNoFlip(object.getSize());
-        return Rectangle{ pos.x, pos.y - size.y, size.x, size.y };
-    }
-
+        TheMap.LightInfo = LightingInfo();
 
-    Rectangle ObjectBoundsToRect(const ldtk::EntityRef& objectRef)
-    {
-        Vector2 pos = Convert(objectRef->getPosition());
-        Vector2 size = ConvertNoFlip(objectRef->getSize());
-        return Rectangle{ pos.x, pos.y - size.y, size.x, size.y };
+        TheMap.LightInfo.SkyboxTextureName = GetString(header.Skybox);
+        TheMap.LightInfo.ExteriorAmbientLevel = header.ExteriorAmbientLevel;
+        TheMap.LightInfo.InteriorAmbientLevel = header.InteriorAmbientLevel;
+        TheMap.LightInfo.AmbientAngle = header.AmbientAngle;
     }
 
-    uint8_t GetTileFromRect(int x, int y, int w, int h)
+    void AddLightZone(const CompiledMap::LightZoneRecord& record, const Table* sequenceTable)
     {
-        float scaleX = x / (float)TheMap.Tilemap.width;
-        float scaleY = y / (float)TheMap.Tilemap.height;
+        LightZoneInfo zone;
+        if (sequenceTable && record.Sequence.Length > 0)
+            zone.SequenceValues = LightUtils::ParseLightSequence(sequenceTable->GetField(std::string(GetString(record.Sequence))));
+
+        if (record.Fields & CompiledMap::LightZoneFields::MaxLevel)
+            zone.MaxLevel = record.MaxLevel;
 
-        float epsilonX = 1 / (float)TheMap.Tilemap.width;
-        float epsilonY = 1 / (float)TheMap.Tilemap.height;
+        if (record.Fields & CompiledMap::LightZoneFields::MinLevel)
+            zone.MinLevel = record.MinLevel;
 
-        for (uint8_t index = 0; index < TheMap.TileSourceRects.size(); index++)
+        if (record.Fields & CompiledMap::LightZoneFields::SequenceLength)
         {
-            Rectangle& rect = TheMap.TileSourceRects[index];
-            if (fabsf(rect.x - scaleX) < epsilonX && fabs(rect.y - scaleY) < epsilonY)
-                return index;
+            zone.SequenceLenght = record.SequenceLength;
+
+            zone.SequenceFrameTime = zone.SequenceLenght / zone.SequenceValues.size();
         }
 
-        return 0;
+        zone.Reset();
+
+        TheMap.LightZones.push_back(zone);
     }
 
+    void AddSpawnObject(const CompiledMap::EntityRecord& entity, size_t region)
+    {
+        auto* spawn = TheWorld.AddMapObject(region);
 
-    template<class T>
-    bool SetFromProperty(const std::string& name, const ldtk::FieldsContainer& container, T& value)
+        SetObjectTransform(entity, spawn->AddComponent<TransformComponent>());
+        spawn->AddComponent<SpawnPointComponent>();
+    }
+
+    void AddModelObject(const CompiledMap::EntityRecord& entity, size_t region)
     {
-        auto field = container.getField<T>(name);
-        if (field.is_null())
-            return false;
+        auto* mapObject = TheWorld.AddMapObject(region);
 
-        value = field.value();
+        SetObjectTransform(entity, mapObject->AddComponent<TransformComponent>());
 
-        return true;
+        auto* modelComp = mapObject->AddComponent<MapObjectComponent>(GetString(entity.Name));
+        if (entity.Fields & CompiledMap::EntityFields::Solid)
+            modelComp->Solid = entity.Flag != 0;
     }
 
-    template<class T>
-    bool SetFromProperty(const std::string& name, const ldtk::EntityRef& containerRef, T& value)
+    void AddTrigger(const CompiledMap::EntityRecord& entity, size_t region)
     {
-        auto field = containerRef->getField<T>(name);
-        if (field.is_null())
-            return false;
-
-        value = field.value();
+        auto* trigger = TheWorld.AddMapObject(region);
+        auto* volume = trigger->AddComponent<TriggerComponent>();
+        volume->Bounds = entity.Bounds;
 
-        return true;
+        if (entity.Fields & CompiledMap::EntityFields::TriggerId)
+            volume->TriggerId = entity.TriggerId;
     }
 
-    void SetObjectTransform(const ldtk::Entity& object, TransformComponent* transform)
+    void AddMobObject(const CompiledMap::EntityRecord& entity, size_t region)
     {
-        if (!transform)
-            return;
+        auto* mobObject = TheWorld.AddMapObject(region);
+        SetObjectTransform(entity, mobObject->AddComponent<TransformComponent>());
+        mobObject->AddComponent<MobComponent>();
+        auto* behavior = mobObject->AddComponent<MobBehaviorComponent>();
 
-        Vector2 convertedPos = Convert(object.getPosition());
+        if (entity.Fields & CompiledMap::EntityFields::FollowPath)
+            behavior->FollowPath = entity.Flag != 0;
 
-        transform->Position.x = convertedPos.x;
-        transform->Position.y = convertedPos.y;
-        transform->Position.z = 0;
+        if (entity.Fields & CompiledMap::EntityFields::ChasePlayer)
+            behavior->ChasePlayer = entity.SecondFlag != 0;
 
-        float angle = 0;
-        if (SetFromProperty("Facing", object, angle))
-            transform->SetFacing(angle);
-    }
+        if (entity.Fields & CompiledMap::EntityFields::MoveSpeed)
+            behavior->MoveSpeed = entity.Speed;
 
-    void SetupLightInfo(const ldtk::Level & level)
-    {
-        TheMap.LightInfo = LightingInfo();
+        if (entity.Fields & CompiledMap::EntityFields::RotationSpeed)
+            behavior->RotationSpeed = entity.SecondSpeed;
 
-        SetFromProperty("skybox", level, TheMap.LightInfo.SkyboxTextureName);
-        SetFromProperty("extereor_ambient_level", level, TheMap.LightInfo.ExteriorAmbientLevel);
-        SetFromProperty("interior_ambient_level", level, TheMap.LightInfo.InteriorAmbientLevel);
-        SetFromProperty("ambient_direction_angle", level, TheMap.LightInfo.AmbientAngle);
+        for (uint32_t i = 0; i < entity.ItemCount; i++)
+        {
+            const auto& point = PathPoints[entity.FirstItem + i];
+            behavior->Path.push_back(Vector3{ point.X, point.Y, 0 });
+        }
     }
 
-    void ReadTileset(const ldtk::Layer& layer)
+    void AddDoorObject(const CompiledMap::EntityRecord& entity, size_t region)
     {
-        auto& tileset = layer.getTileset();
+        auto trigger = TheWorld.AddMapObject(region);
+
+        trigger->AddComponent<TriggerComponent>(entity.Bounds);
+        DoorControllerComponent* doorController = trigger->AddComponent<DoorControllerComponent>();
 
-        std::string path = tileset.path;
+        if (entity.Fields & CompiledMap::EntityFields::FullyOpenBeforeClose)
+            doorController->MustOpenBeforClose = entity.Flag != 0;
 
-        while (path.substr(0, 3) == "../")
-            path = path.substr(3);
+        if (entity.Fields & CompiledMap::EntityFields::OpenSpeed)
+            doorController->OpenSpeed = entity.Speed;
 
-        TheMap.Tilemap = TextureManager::GetTexture(path);
-        TheMap.TileSourceRects.clear();
+        if (entity.Fields & CompiledMap::EntityFields::CloseSpeed)
+            doorController->CloseSpeed = entity.SecondSpeed;
 
-        for (int i = 0; i < 255; i++)
-        {
-            auto point = tileset.getTileTexturePos(i);
-            if (point.x >= tileset.texture_size.x || point.y >= tileset.texture_size.y)
-                break;
+        if (entity.Fields & CompiledMap::EntityFields::StayOpen)
+            doorController->StayOpen = entity.SecondFlag != 0;
 
-            Rectangle tileRect;
-            tileRect.x = float(point.x) / tileset.texture_size.x;
-            tileRect.y = float(point.y) / tileset.texture_size.y;
-            tileRect.width = (float(point.x + tileset.tile_size) / float(tileset.texture_size.x));
-            tileRect.height = (float(point.y + tileset.tile_size) / float(tileset.texture_size.y));
+        if (entity.Fields & CompiledMap::EntityFields::MinimumOpenTime)
+            doorController->MiniumOpenTime = entity.Time;
 
-            TheMap.TileSourceRects.push_back(tileRect);
+        // the door cells already have their state, tiles and flags from the cell data
+        for (uint32_t i = 0; i < entity.ItemCount; i++)
+        {
+            const auto& door = DoorCells[entity.FirstItem + i];
+            doorController->Doors.push_back(TheMap.GetCellIndex(int(door.X), int(door.Y)));
         }
     }
 
-    void ReadEmptyLayer(const ldtk::Layer& layer, int tileIndex)
+    // doors start closed when their region is spawned, and go back to closed when it is removed so they aren't left half open
+    void ResetDoors(const CompiledMap::EntityRecord& entity)
     {
-        for (auto cell : layer.allTiles())
+        for (uint32_t i = 0; i < entity.ItemCount; i++)
         {
-            auto coord = Convert(cell.getPosition());
-            auto cellIndex = PositionToMapID(cell.getPosition());
+            const auto& door = DoorCells[entity.FirstItem + i];
+            auto& cell = TheMap.GetCellRef(int(door.X), int(door.Y));
+            cell.ParamState = 0;
+
+            // the pathfinding has to hear about a door that was open, the door system only reports changes it makes itself
+            if (!(cell.Flags & MapCellFlags::Impassible))
+                Pathfinding::SetDoorOpen(MapCoordinate{ int(door.X), int(door.Y) }, false);
 
-            TheMap.Cells[cellIndex].State = MapCellState::Empty;
-            TheMap.Cells[cellIndex].Tiles[tileIndex] = cell.tileId;
+            cell.Flags |= MapCellFlags::Impassible;
         }
     }
 
-    void ReadWallsLayer(const ldtk::Layer& layer)
+    template<class T>
+    static bool ReadArray(Models::BinaryReader& reader, std::vector<T>& values, size_t count)
     {
-        for (auto cell : layer.allTiles())
+        if (!reader.HasRemaining(count * sizeof(T)))
         {
-            auto coord = Convert(cell.getPosition());
-            auto cellIndex = PositionToMapID(cell.getPosition());
-
-            TheMap.Cells[cellIndex].State = MapCellState::Wall;
-            TheMap.Cells[cellIndex].Tiles[0] = cell.tileId;
+            reader.SetError("the file is truncated");
+            return false;
         }
+
+        values.resize(count);
+        return reader.Read(values.data(), count * sizeof(T));
     }
 
-    void AddSpawnObject(const ldtk::Entity& object)
+    static bool IsValidRange(uint32_t first, uint32_t count, size_t size)
     {
-        auto* spawn = TheWorld.AddObject();
-
-        SetObjectTransform(object, spawn->AddComponent<TransformComponent>());
-        spawn->AddComponent<SpawnPointComponent>();
+        return first <= size && count <= size - first;
     }
 
-    void AddMobObject(const ldtk::Entity& object)
+    // copies the cells of a range of chunks out of the file and checks them, this runs on a job pool thread.
+    // the renderer indexes the light zones and tile rects with what the cells hold, so anything past the end fails the read
+    static bool DecodeChunkRange(const std::vector<CompiledMap::ChunkRecord>& records, const uint8_t* cells, size_t lightZoneCount,
+        size_t tileCount, size_t first, size_t last, std::vector<std::unique_ptr<MapChunk>>& chunks)
     {
-        auto* mobObject = TheWorld.AddObject();
-        SetObjectTransform(object, mobObject->AddComponent<TransformComponent>());
-        auto* modelComp = mobObject->AddComponent<MobComponent>();
-        auto* behavior = mobObject->AddComponent<MobBehaviorComponent>();
+        bool valid = true;
+        for (size_t i = first; i < last; i++)
+        {
+            auto chunk = std::make_unique<MapChunk>();
+            chunk->Origin = MapCoordinate{ int32_t(records[i].X), int32_t(records[i].Y) };
+            memcpy(chunk->Cells, cells + i * sizeof(MapChunk::Cells), sizeof(MapChunk::Cells));
 
-        SetFromProperty("FollowPath", object, behavior->FollowPath);
-        SetFromProperty("MoveSpeed", object, behavior->MoveSpeed);
-        SetFromProperty("RotationSpeed", object, behavior->RotationSpeed);
+            for (const auto& cell : chunk->Cells)
+            {
+                valid &= cell.LightZone == MapCellInvalidLightZone || cell.LightZone < lightZoneCount;
 
-        for (auto& point : object.getArrayField<ldtk::IntPoint>("Path"))
-        {
-            Vector3 pointPos = {point.value().x + 0.5f, (TheMap.Size.Y - (point.value().y)) - 0.5f, 0 };
+                for (uint16_t tile : cell.Tiles)
+                    valid &= tile == MapCellInvalidTile || tile < tileCount;
+            }
 
-            behavior->Path.push_back(pointPos);
+            chunks[i] = std::move(chunk);
         }
+
+        return valid;
     }
 
-    void AddTrigger(const ldtk::Entity& object)
+    // large maps have thousands of chunks, they are split into batches that decode on the job pool at the same time
+    static bool DecodeChunks(const std::vector<CompiledMap::ChunkRecord>& records, const uint8_t* cells, size_t lightZoneCount,
+        size_t tileCount, std::vector<std::unique_ptr<MapChunk>>& chunks)
     {
-        auto* trigger = TheWorld.AddObject();
-        auto* volume = trigger->AddComponent<TriggerComponent>();
-        volume->Bounds = ObjectBoundsToRect(object);
-        SetFromProperty("trigger_id", object, volume->TriggerId);
+        static constexpr size_t ChunksPerBatch = 256;
+
+        chunks.resize(records.size());
+        if (records.size() <= ChunksPerBatch)
+            return DecodeChunkRange(records, cells, lightZoneCount, tileCount, 0, records.size(), chunks);
+
+        std::vector<uint8_t> batchValid(JobPool::GetBatchCount(records.size(), ChunksPerBatch), 0);
+
+        // every batch writes its own chunks and result
+        JobPool::ParallelFor(records.size(), ChunksPerBatch, [&records, cells, lightZoneCount, tileCount, &chunks, &batchValid](size_t first, size_t last, size_t batch)
+            {
+                batchValid[batch] = DecodeChunkRange(records, cells, lightZoneCount, tileCount, first, last, chunks) ? 1 : 0;
+            });
+
+        return std::all_of(batchValid.begin(), batchValid.end(), [](uint8_t valid) { return valid != 0; });
     }
 
-    void AddLightZoneObject(const ldtk::Entity& object)
+public:
+    CompiledMapReader(Scene& world) : MapReader(world) {}
+
+    // how long the last read spent decoding chunks
+    double DecodeMS = 0;
+
+    bool Read(std::string_view filename) override
     {
-        auto bounds = ObjectBoundsToRect(object);
+        auto resource = ResourceManager::MapResource(filename);
+        if (!resource)
+            return false;
 
-        auto sequenceTable = TableManager::GetTable(BootstrapTable)->GetFieldAsTable("light_sequences");
+        std::string error;
+        bool read = Read(resource->DataBuffer, resource->DataSize, error);
+        ResourceManager::ReleaseResource(resource);
 
-        LightZoneInfo zone;
-        if (sequenceTable)
+        if (!read)
+            TraceLog(LOG_WARNING, "MAP: Unable to read %s, %s", std::string(filename).c_str(), error.c_str());
+
+        return read;
+    }
+
+    // everything is read and checked before the map is changed, so a bad file leaves the map empty instead of half loaded
+    bool Read(const uint8_t* data, size_t size, std::string& error)
+    {
+        Models::BinaryReader reader(data, size);
+
+        auto header = reader.Read<CompiledMap::MapHeader>();
+        if (!reader.IsValid() || memcmp(header.Magic, CompiledMap::Magic, sizeof(header.Magic)) != 0)
         {
-            const auto sequence = object.getField<ldtk::EnumValue>("light_sequence");
-            if (!sequence.is_null())
-            {
-                zone.SequenceValues = LightUtils::ParseLightSequence(sequenceTable->GetField(sequence.value().name));
-            }  
+            error = "not a compiled map";
+            return false;
         }
 
-        SetFromProperty("max_level", object, zone.MaxLevel);
-        SetFromProperty("min_level", object, zone.MinLevel);
-
-        float len = 0;
-        if (SetFromProperty("sequence_lenght", object, len) && len > 0)
+        if (header.Version != CompiledMap::Version)
         {
-            zone.SequenceLenght = len;
+            error = TextFormat("version %u is not supported, it needs to be compiled again", header.Version);
+            return false;
+        }
 
-            zone.SequenceFrameTime = zone.SequenceLenght / zone.SequenceValues.size();
+        if (!IsValidMapSize(header.Width, header.Height))
+        {
+            error = "the map is too large";
+            return false;
         }
 
-        for (int y = int(bounds.y); y < int(bounds.y + bounds.height); y++)
+        std::vector<CompiledMap::ChunkRecord> chunkRecords;
+        std::vector<Rectangle> tileRects;
+        std::vector<CompiledMap::LightZoneRecord> lightZones;
+        std::vector<char> strings;
+
+        // the chunk cells are decoded once everything else is read, they are skipped over for now
+        ReadArray(reader, chunkRecords, header.ChunkCount);
+        size_t chunkCellBytes = chunkRecords.size() * sizeof(MapChunk::Cells);
+        const uint8_t* chunkCells = reader.GetDataAt(reader.GetPosition(), chunkCellBytes);
+        if (chunkCells)
+            reader.Skip(chunkCellBytes);
+        else if (reader.IsValid())
+            reader.SetError("the file is truncated");
+
+        ReadArray(reader, tileRects, header.TileRectCount);
+        ReadArray(reader, lightZones, header.LightZoneCount);
+        ReadArray(reader, Entities, header.EntityCount);
+        ReadArray(reader, PathPoints, header.PathPointCount);
+        ReadArray(reader, DoorCells, header.DoorCellCount);
+        ReadArray(reader, Regions, header.RegionCount);
+        ReadArray(reader, strings, header.StringsSize);
+
+        if (!reader.IsValid())
         {
-            for (int x = int(bounds.x); x < int(bounds.x + bounds.width); x++)
-            {
-                TheMap.GetCellRef(x, y).LightZone = uint8_t(TheMap.LightZones.size());
-            }
+            error = reader.GetError();
+            return false;
         }
 
-        zone.Reset();
+        Strings.assign(strings.data(), strings.size());
 
-        TheMap.LightZones.push_back(zone);
-    }
+        bool valid = IsValidString(header.Tilemap) && IsValidString(header.Skybox);
 
-    void AddModelObject(const ldtk::Entity& object, ldtk::Project& project)
-    {
-        auto* mapObject = TheWorld.AddObject();
+        uint32_t chunksX = (header.Width + MapChunkMask) >> MapChunkShift;
+        uint32_t chunksY = (header.Height + MapChunkMask) >> MapChunkShift;
+        std::unordered_set<uint64_t> usedChunks;
 
-        SetObjectTransform(object, mapObject->AddComponent<TransformComponent>());
+        for (const auto& record : chunkRecords)
+        {
+            valid &= record.X < chunksX && record.Y < chunksY;
+            valid &= usedChunks.insert(MapCoordinate::GetHash(int32_t(record.X), int32_t(record.Y))).second;
+        }
 
-        auto field = object.getField<ldtk::EnumValue>("Model");
+        // the tilemap loads on a loader thread while the cells are decoded
+        if (valid && header.Tilemap.Length > 0)
+            TextureManager::PrefetchTexture(GetString(header.Tilemap));
 
-        auto* modelComp = mapObject->AddComponent<MapObjectComponent>(field.value().name);
-        SetFromProperty("Solid", object, modelComp->Solid);
-    }
+        auto decodeStart = std::chrono::steady_clock::now();
+        std::vector<std::unique_ptr<MapChunk>> chunks;
+        valid &= DecodeChunks(chunkRecords, chunkCells, lightZones.size(), tileRects.size(), chunks);
+        DecodeMS = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decodeStart).count();
 
-    void AddDoorObject(const ldtk::Entity& object)
-    {
-        auto triggerBounds = ObjectBoundsToRect(object);
+        for (const auto& zone : lightZones)
+            valid &= IsValidString(zone.Sequence);
 
-        auto trigger = TheWorld.AddObject();
+        for (const auto& entity : Entities)
+        {
+            valid &= IsValidString(entity.Name);
 
-        trigger->AddComponent<TriggerComponent>(triggerBounds);
-        DoorControllerComponent* doorController = trigger->AddComponent<DoorControllerComponent>();
+            if (entity.Type == CompiledMap::EntityType::Mob)
+                valid &= IsValidRange(entity.FirstItem, entity.ItemCount, PathPoints.size());
+            else if (entity.Type == CompiledMap::EntityType::DoorTrigger)
+                valid &= IsValidRange(entity.FirstItem, entity.ItemCount, DoorCells.size());
+        }
 
-        SetFromProperty("FullyOpenBeforeClose", object, doorController->MustOpenBeforClose);
-        SetFromProperty("OpenSpeed", object, doorController->OpenSpeed);
-        SetFromProperty("CloseSpeed", object, doorController->CloseSpeed);
-        SetFromProperty("StayOpen", object, doorController->StayOpen);
-        SetFromProperty("MinimumOpenTime", object, doorController->MiniumOpenTime);
+        for (const auto& door : DoorCells)
+            valid &= door.X < header.Width && door.Y < header.Height;
 
-        // get doors
-        for (auto doorRef : object.getArrayField<ldtk::EntityRef>("Doors"))
+        for (const auto& region : Regions)
         {
-            if (doorRef.is_null())
-                continue;
+            valid &= IsValidString(region.Name) && IsValidRange(region.FirstEntity, region.EntityCount, Entities.size());
+            valid &= IsValidRange(region.X, region.Width, header.Width) && IsValidRange(region.Y, region.Height, header.Height);
+        }
 
-            const auto& door = doorRef.value();
+        if (!valid)
+        {
+            error = "the map data is corrupt";
+            return false;
+        }
 
-            auto doorBounds = ObjectBoundsToRect(door);
+        TheMap.SetSize(int(header.Width), int(header.Height));
+        for (auto& chunk : chunks)
+            TheMap.InsertChunk(std::move(chunk));
 
-            Vector2 center = { doorBounds.x, doorBounds.y };
-            
-            int doorX = int(center.x);
-            int doorY = int(center.y);
+        TheMap.TileSourceRects = std::move(tileRects);
 
+        // the tilemap is acquired once everything the map uses has been loaded
+        TheMap.TilemapName = GetString(header.Tilemap);
 
-            auto grid = door->getGridPosition();
-            grid.y = (TheMap.Size.Y - grid.y-1);
+        SetupLightInfo(header);
 
+        auto sequenceTable = TableManager::GetTable(BootstrapTable)->GetFieldAsTable("light_sequences");
+        for (const auto& zone : lightZones)
+            AddLightZone(zone, sequenceTable);
 
-            auto& doorCell = TheMap.GetCellRef(grid.x, grid.y);
-            doorCell.State = MapCellState::Door;
+        for (const auto& region : Regions)
+        {
+            MapRegion& mapRegion = TheMap.Regions.emplace_back();
+            mapRegion.Name = GetString(region.Name);
+            mapRegion.Bounds = Rectangle{ float(region.X), float(region.Y), float(region.Width), float(region.Height) };
+        }
 
-            const auto& doorTexture = door->getField<ldtk::TileRef>("Texture");
+        return true;
+    }
 
-            if (!doorTexture.is_null())
-                doorCell.Tiles[2] = GetTileFromRect(doorTexture.value().bounds.x, doorTexture.value().bounds.y, doorTexture.value().bounds.width, doorTexture.value().bounds.height);
-            
-            if (door->getName() == "Door_X")
-                doorCell.Flags |= MapCellFlags::XAllignment;
+    void LoadRegion(size_t region) override
+    {
+        if (region >= Regions.size())
+            return;
 
-            bool backwards = false;
-            bool vertical = false;
+        const auto& record = Regions[region];
+        for (uint32_t i = record.FirstEntity; i < record.FirstEntity + record.EntityCount; i++)
+        {
+            const auto& entity = Entities[i];
+            switch (entity.Type)
+            {
+            case CompiledMap::EntityType::PlayerSpawn:
+                AddSpawnObject(entity, region);
+                break;
+            case CompiledMap::EntityType::Model:
+                AddModelObject(entity, region);
+                break;
+            case CompiledMap::EntityType::Trigger:
+                AddTrigger(entity, region);
+                break;
+            case CompiledMap::EntityType::Mob:
+                AddMobObject(entity, region);
+                break;
+            case CompiledMap::EntityType::DoorTrigger:
+                ResetDoors(entity);
+                AddDoorObject(entity, region);
+                break;
+            }
+        }
+    }
 
-            SetFromProperty("Backwards", door, backwards);
-            SetFromProperty("Vertical", door, vertical);
+    void UnloadRegion(size_t region) override
+    {
+        if (region >= Regions.size())
+            return;
 
-            if (backwards)
-                doorCell.Flags |= MapCellFlags::Reversed;
+        const auto& record = Regions[region];
+        for (uint32_t i = record.FirstEntity; i < record.FirstEntity + record.EntityCount; i++)
+        {
+            if (Entities[i].Type == CompiledMap::EntityType::DoorTrigger)
+                ResetDoors(Entities[i]);
+        }
+    }
 
-            if (vertical)
-                doorCell.Flags |= MapCellFlags::HorizontalVertical;
+    // adds what the objects of a region will load when they are spawned, returns how many entities the region has
+    size_t CollectAssets(size_t region, MapAssets& assets) const
+    {
+        if (region >= Regions.size())
+            return 0;
 
-            doorCell.Flags |= MapCellFlags::Impassible;
+        const auto& record = Regions[region];
+        for (uint32_t i = record.FirstEntity; i < record.FirstEntity + record.EntityCount; i++)
+        {
+            const auto& entity = Entities[i];
+            if (entity.Type == CompiledMap::EntityType::Model && entity.Name.Length > 0)
+            {
+                assets.Models.emplace(GetString(entity.Name));
+            }
+            else if (entity.Type == CompiledMap::EntityType::Mob)
+            {
+                auto character = CharacterManager::GetCharacter(MobComponent::CharacterName);
+                if (!character)
+                    continue;
 
-            doorController->Doors.push_back(TheMap.GetCellIndex(grid.x, grid.y));
+                assets.AnimatedModels.insert(character->ModelName);
+                if (!character->ShadowTexture.empty())
+                    assets.Textures.insert(character->ShadowTexture);
+            }
         }
 
+        return record.EntityCount;
     }
 
-public:
-    LDTKMapReader(Scene& world) : MapReader(world) {}
+    // where the player starts, the regions around it are spawned before the player is placed
+    Vector3 GetSpawnPosition() const
+    {
+        for (const auto& entity : Entities)
+        {
+            if (entity.Type == CompiledMap::EntityType::PlayerSpawn)
+                return Vector3{ entity.PositionX, entity.PositionY, 0 };
+        }
 
-    bool Read(std::string_view filename) override
+        if (!TheMap.Regions.empty())
+        {
+            const Rectangle& bounds = TheMap.Regions.front().Bounds;
+            return Vector3{ bounds.x + bounds.width * 0.5f, bounds.y + bounds.height * 0.5f, 0 };
+        }
+
+        return Vector3{ 0, 0, 0 };
+    }
+};
+
+// a loose compiled map that is older than its LDtk project is out of date, the project is compiled again instead.
+// compiled maps in packs are always used, the pack tool packs what was compiled
+static bool UseCompiledMap(std::string_view fileName, const std::string& compiledName)
+{
+    if (fileName == compiledName)
+        return true;
+
+    if (!GlobalVars::UseCompiledMaps || !ResourceManager::HasResource(compiledName))
+        return false;
+
+    std::string sourceName(fileName);
+    if (FileExists(sourceName.c_str()) && FileExists(compiledName.c_str()) && GetFileModTime(sourceName.c_str()) > GetFileModTime(compiledName.c_str()))
     {
-        ldtk::Project project;
-        auto resource = ResourceManager::OpenResource(filename.data());
-        if (!resource)
-            return false;
+        TraceLog(LOG_INFO, "MAP: %s is out of date, compiling %s", compiledName.c_str(), sourceName.c_str());
+        return false;
+    }
 
-        project.loadFromMemory(resource->DataBuffer, resource->DataSize);
-        ResourceManager::ReleaseResource(resource);
-        const auto& mapWorld = project.getWorld();
-        const auto& level = *mapWorld.allLevels().begin();
-        SetupLightInfo(level);
+    return true;
+}
+
+static bool CompileAndRead(const char* fileName, CompiledMapReader& reader)
+{
+    auto resource = ResourceManager::OpenResource(fileName);
+    if (!resource)
+    {
+        TraceLog(LOG_WARNING, "MAP: Unable to open %s", fileName);
+        return false;
+    }
 
-        const auto& floorLayer = level.getLayer("Floors");
-        GridSize = floorLayer.getGridSize().x;
+    std::vector<uint8_t> compiled;
+    std::string error;
+    bool read = MapCompiler::CompileLDtk(resource->DataBuffer, resource->DataSize, compiled, error);
+    ResourceManager::ReleaseResource(resource);
 
-        ReadTileset(floorLayer);
+    if (read)
+        read = reader.Read(compiled.data(), compiled.size(), error);
 
-        float mapWidth = float(level.size.x / floorLayer.getGridSize().x);
-        float mapHeight = float(level.size.y / floorLayer.getGridSize().y);
+    if (!read)
+        TraceLog(LOG_WARNING, "MAP: Unable to compile %s, %s", fileName, error.c_str());
 
-        TheMap.Size.X = int(mapWidth);
-        TheMap.Size.Y = int(mapHeight);
-        TheMap.Cells.resize(size_t(mapWidth * mapHeight));
+    return read;
+}
 
-        ReadEmptyLayer(floorLayer, 0);
-        ReadEmptyLayer(level.getLayer("Ceilings"), 1);
-        ReadWallsLayer(level.getLayer("Walls"));
+static MapLoadReport LastLoadReport;
 
-        const auto& objects = level.getLayer("Objects");
+// the time since a phase started, in milliseconds, and starts the next phase
+static double EndPhase(std::chrono::steady_clock::time_point& phaseStart)
+{
+    auto now = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - phaseStart).count();
+    phaseStart = now;
 
-        for (auto& object : objects.allEntities())
-        {
-            if (object.getName() == "PlayerSpawn")
-                AddSpawnObject(object);
-            else if (object.getName() == "Model")
-                AddModelObject(object, project);
-            else if (object.getName() == "LightZone")
-                AddLightZoneObject(object);
-            else if (object.getName() == "Trigger")
-                AddTrigger(object);
-            else if (object.getName() == "MOB")
-                AddMobObject(object);
-            else if (object.getName() == "DoorTrigger")
-                AddDoorObject(object);
-        }
+    return ms;
+}
 
-        return true;
-    }
-};
+// starts every asset loading at once and waits for all of them, so this takes as long as the slowest asset instead of all of them added up.
+// the instances keep the models loaded until the objects that use them are spawned
+static void PrefetchAssets(const MapAssets& assets, std::vector<std::shared_ptr<ModelInstance>>& instances)
+{
+    for (const auto& name : assets.Models)
+        instances.push_back(ModelManager::GetModel(name));
+
+    for (const auto& name : assets.AnimatedModels)
+        instances.push_back(ModelManager::GetAnimatedModel(name));
+
+    for (const auto& name : assets.Textures)
+        TextureManager::PrefetchTexture(name);
+
+    AsyncLoader::CompleteAll();
+}
 
 void ReadWorld(const char* fileName, Scene& world)
 {
+    MapLoadReport report;
+    report.MapName = fileName;
+
+    auto loadStart = std::chrono::steady_clock::now();
+    auto phaseStart = loadStart;
+
     App::GetState() = GameState::Loading;
     auto& map = world.GetMap();
     map.Clear();
     map.LightZones.clear();
 
-    LDTKMapReader reader(world);
+    auto reader = std::make_unique<CompiledMapReader>(world);
+
+    std::string compiledName = CompiledMap::GetCompiledName(fileName);
+
+    bool loaded = false;
+    if (UseCompiledMap(fileName, compiledName))
+        loaded = reader->Read(compiledName);
+
+    // without a usable compiled map the LDtk project is compiled in memory, which is much slower
+    if (!loaded && compiledName != fileName)
+        loaded = CompileAndRead(fileName, *reader);
+
+    report.DecodeMS = reader->DecodeMS;
+    report.ParseMS = EndPhase(phaseStart) - report.DecodeMS;
+    report.ChunkCount = map.Chunks.size();
+
+    if (loaded)
+    {
+        Vector3 spawnPosition = reader->GetSpawnPosition();
 
-    reader.Read(fileName);
+        MapAssets assets;
+        if (!map.TilemapName.empty())
+            assets.Textures.insert(map.TilemapName);
+
+        for (size_t region : world.GetWantedRegions(spawnPosition))
+            report.EntityCount += reader->CollectAssets(region, assets);
+
+        report.AssetCount = assets.GetCount();
+        report.CollectMS = EndPhase(phaseStart);
+
+        std::vector<std::shared_ptr<ModelInstance>> prefetched;
+        PrefetchAssets(assets, prefetched);
+        map.Tilemap = TextureManager::AcquireTexture(map.TilemapName);
+        report.PrefetchMS = EndPhase(phaseStart);
+
+        world.SetRegionLoader(std::move(reader));
+
+        // everything near the start is spawned now, the rest streams in as the player moves
+        world.UpdateRegions(spawnPosition, map.Regions.size());
+        report.SpawnMS = EndPhase(phaseStart);
+    }
+
+    report.TotalMS = EndPhase(loadStart);
+    LastLoadReport = report;
+
+    TraceLog(LOG_INFO, "MAP: Loaded %s in %.1fms, parse %.1fms, decode %.1fms (%d chunks), collect %.1fms, prefetch %.1fms (%d assets), spawn %.1fms (%d entities)",
+        fileName, report.TotalMS, report.ParseMS, report.DecodeMS, int(report.ChunkCount), report.CollectMS, report.PrefetchMS, int(report.AssetCount), report.SpawnMS, int(report.EntityCount));
 
     App::GetState() = GameState::Playing;
 }
 
+const MapLoadReport& GetMapLoadReport()
+{
+    return LastLoadReport;
+}
+
@@ -730,11 +730,18 @@ void MapRenderer::Render()
         }
         else
         {
-            for (int y = 0; y < WorldMap.Size.Y; y++)
+            // only chunks with something in them have cells to draw
+            for (const auto& chunk : WorldMap.Chunks)
             {
-                for (int x = 0; x < WorldMap.Size.X; x++)
+                int originX = chunk->Origin.X << MapChunkShift;
+                int originY = chunk->Origin.Y << MapChunkShift;
+
+                for (int y = originY; y < originY + MapChunkSize; y++)
                 {
-                    RenderCell(x, y);
+                    for (int x = originX; x < originX + MapChunkSize; x++)
+                    {
+                        RenderCell(x, y);
+                    }
                 }
             }
         }
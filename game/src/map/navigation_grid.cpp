@@ -0,0 +1,42 @@
+#include "map/navigation_grid.h"
+
+#include <atomic>
+
+// versions are unique across every grid, a new grid can be made where an old one was freed
+static std::atomic<uint32_t> NextVersion = 0;
+
+void NavigationGrid::Build(const Map& map)
+{
+    Size = map.Size;
+    ChunkCount = map.ChunkCount;
+    ChunkSlots = map.ChunkSlots;
+    Version = ++NextVersion;
+
+    Chunks.resize(map.Chunks.size());
+    for (size_t i = 0; i < map.Chunks.size(); i++)
+    {
+        const MapChunk& chunk = *map.Chunks[i];
+        int originX = chunk.Origin.X << MapChunkShift;
+        int originY = chunk.Origin.Y << MapChunkShift;
+
+        for (int cellIndex = 0; cellIndex < MapChunkCellCount; cellIndex++)
+        {
+            // closed doors are flagged as impassible, but they are still doors
+            if (chunk.Cells[cellIndex].State == MapCellState::Door)
+                Chunks[i][cellIndex] = NavCell::Door;
+            else if (map.IsCellPassable(originX + (cellIndex & MapChunkMask), originY + (cellIndex >> MapChunkShift)))
+                Chunks[i][cellIndex] = NavCell::Open;
+            else
+                Chunks[i][cellIndex] = NavCell::Blocked;
+        }
+    }
+}
+
+void NavigationGrid::Clear()
+{
+    Size = MapCoordinate{};
+    ChunkCount = MapCoordinate{};
+    ChunkSlots.clear();
+    Chunks.clear();
+    Version = ++NextVersion;
+}
@@ -0,0 +1,315 @@
+#include "map/path_finder.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+
+static constexpr float DiagonalCost = 1.41421356f;
+
+// the cost of moving in a straight or diagonal line, or the octile distance when the cells aren't lined up
+static float GetMoveCost(int fromX, int fromY, int toX, int toY)
+{
+    int dx = abs(toX - fromX);
+    int dy = abs(toY - fromY);
+
+    return float(std::max(dx, dy)) + (DiagonalCost - 1.0f) * float(std::min(dx, dy));
+}
+
+static int GetSign(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+void PathFinder::StartSearch(const NavigationGrid& grid, const PathQuery& query)
+{
+    // a different or rebuilt grid can have a different chunk layout, the node blocks don't match it any more
+    if (Grid != &grid || GridVersion != grid.GetVersion() || NodeSlots.size() != grid.GetChunkSlotCount())
+    {
+        NodeSlots.assign(grid.GetChunkSlotCount(), 0);
+        NodeBlocks.clear();
+        Generation = 0;
+    }
+
+    Grid = &grid;
+    GridVersion = grid.GetVersion();
+    OpenDoors = query.OpenDoors;
+    Goal = query.Goal;
+
+    Generation++;
+    if (Generation == 0)
+    {
+        // the stamps wrapped, so old ones could look current
+        for (auto& block : NodeBlocks)
+            block->fill(Node());
+        Generation = 1;
+    }
+
+    OpenList.clear();
+}
+
+PathFinder::Node& PathFinder::GetNode(int x, int y)
+{
+    uint32_t& slot = NodeSlots[Grid->GetChunkSlot(x, y)];
+    if (slot == 0)
+    {
+        NodeBlocks.push_back(std::make_unique<NodeBlock>());
+        slot = uint32_t(NodeBlocks.size());
+    }
+
+    Node& node = (*NodeBlocks[slot - 1])[Map::GetChunkCellIndex(x, y)];
+    if (node.Generation != Generation)
+    {
+        node.Generation = Generation;
+        node.Closed = false;
+        node.G = FLT_MAX;
+    }
+
+    return node;
+}
+
+float PathFinder::GetHeuristic(int x, int y) const
+{
+    return GetMoveCost(x, y, Goal.X, Goal.Y);
+}
+
+void PathFinder::AddOpen(int x, int y, float g, const MapCoordinate& parent)
+{
+    Node& node = GetNode(x, y);
+    if (node.Closed || node.G <= g)
+        return;
+
+    node.G = g;
+    node.Parent = parent;
+
+    OpenList.push_back(OpenEntry{ g + GetHeuristic(x, y), g, MapCoordinate{ x, y } });
+    std::push_heap(OpenList.begin(), OpenList.end(), std::greater<OpenEntry>());
+}
+
+void PathFinder::ExpandAStar(const MapCoordinate& cell, float g)
+{
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            if ((dx == 0 && dy == 0) || !IsWalkable(cell.X + dx, cell.Y + dy))
+                continue;
+
+            bool diagonal = dx != 0 && dy != 0;
+            if (diagonal && (!IsWalkable(cell.X + dx, cell.Y) || !IsWalkable(cell.X, cell.Y + dy)))
+                continue;
+
+            AddOpen(cell.X + dx, cell.Y + dy, g + (diagonal ? DiagonalCost : 1.0f), cell);
+        }
+    }
+}
+
+// walks in a straight line until something makes the cell worth stopping at, a wall ending beside the line or the goal
+bool PathFinder::JumpStraight(int x, int y, int dx, int dy, MapCoordinate& jumpPoint) const
+{
+    while (true)
+    {
+        if (!IsWalkable(x, y))
+            return false;
+
+        bool forced = false;
+        if (x == Goal.X && y == Goal.Y)
+            forced = true;
+        else if (dx != 0)
+            forced = (IsWalkable(x, y - 1) && !IsWalkable(x - dx, y - 1)) || (IsWalkable(x, y + 1) && !IsWalkable(x - dx, y + 1));
+        else
+            forced = (IsWalkable(x - 1, y) && !IsWalkable(x - 1, y - dy)) || (IsWalkable(x + 1, y) && !IsWalkable(x + 1, y - dy));
+
+        if (forced)
+        {
+            jumpPoint = MapCoordinate{ x, y };
+            return true;
+        }
+
+        x += dx;
+        y += dy;
+    }
+}
+
+// diagonal jumps stop where one of the straight lines out of them would stop
+bool PathFinder::Jump(int x, int y, int dx, int dy, MapCoordinate& jumpPoint) const
+{
+    if (dx == 0 || dy == 0)
+        return JumpStraight(x, y, dx, dy, jumpPoint);
+
+    MapCoordinate straightPoint;
+    while (true)
+    {
+        if (!IsWalkable(x, y))
+            return false;
+
+        if ((x == Goal.X && y == Goal.Y) || JumpStraight(x + dx, y, dx, 0, straightPoint) || JumpStraight(x, y + dy, 0, dy, straightPoint))
+        {
+            jumpPoint = MapCoordinate{ x, y };
+            return true;
+        }
+
+        // no cutting corners
+        if (!IsWalkable(x + dx, y) || !IsWalkable(x, y + dy))
+            return false;
+
+        x += dx;
+        y += dy;
+    }
+}
+
+void PathFinder::ExpandJPS(const MapCoordinate& cell, const Node& node, float g)
+{
+    int x = cell.X;
+    int y = cell.Y;
+
+    int directions[8][2];
+    int count = 0;
+    auto addDirection = [&directions, &count](int dx, int dy)
+        {
+            directions[count][0] = dx;
+            directions[count][1] = dy;
+            count++;
+        };
+
+    int dx = GetSign(x - node.Parent.X);
+    int dy = GetSign(y - node.Parent.Y);
+
+    if (dx == 0 && dy == 0)
+    {
+        // the start goes every way it can
+        for (int ny = -1; ny <= 1; ny++)
+        {
+            for (int nx = -1; nx <= 1; nx++)
+            {
+                if ((nx == 0 && ny == 0) || !IsWalkable(x + nx, y + ny))
+                    continue;
+
+                if (nx != 0 && ny != 0 && (!IsWalkable(x + nx, y) || !IsWalkable(x, y + ny)))
+                    continue;
+
+                addDirection(nx, ny);
+            }
+        }
+    }
+    else if (dx != 0 && dy != 0)
+    {
+        bool vertical = IsWalkable(x, y + dy);
+        bool horizontal = IsWalkable(x + dx, y);
+
+        if (vertical)
+            addDirection(0, dy);
+        if (horizontal)
+            addDirection(dx, 0);
+        if (vertical && horizontal)
+            addDirection(dx, dy);
+    }
+    else if (dx != 0)
+    {
+        bool next = IsWalkable(x + dx, y);
+        bool up = IsWalkable(x, y + 1);
+        bool down = IsWalkable(x, y - 1);
+
+        if (next)
+        {
+            addDirection(dx, 0);
+            if (up)
+                addDirection(dx, 1);
+            if (down)
+                addDirection(dx, -1);
+        }
+        if (up)
+            addDirection(0, 1);
+        if (down)
+            addDirection(0, -1);
+    }
+    else
+    {
+        bool next = IsWalkable(x, y + dy);
+        bool right = IsWalkable(x + 1, y);
+        bool left = IsWalkable(x - 1, y);
+
+        if (next)
+        {
+            addDirection(0, dy);
+            if (right)
+                addDirection(1, dy);
+            if (left)
+                addDirection(-1, dy);
+        }
+        if (right)
+            addDirection(1, 0);
+        if (left)
+            addDirection(-1, 0);
+    }
+
+    MapCoordinate jumpPoint;
+    for (int i = 0; i < count; i++)
+    {
+        if (Jump(x + directions[i][0], y + directions[i][1], directions[i][0], directions[i][1], jumpPoint))
+            AddOpen(jumpPoint.X, jumpPoint.Y, g + GetMoveCost(x, y, jumpPoint.X, jumpPoint.Y), cell);
+    }
+}
+
+bool PathFinder::FindPath(const NavigationGrid& grid, const PathQuery& query, PathSearchResult& result)
+{
+    result.Found = false;
+    result.Points.clear();
+    result.Cost = 0;
+    result.Expanded = 0;
+
+    if (!grid.IsWalkable(query.Start.X, query.Start.Y, query.OpenDoors) || !grid.IsWalkable(query.Goal.X, query.Goal.Y, query.OpenDoors))
+        return false;
+
+    StartSearch(grid, query);
+
+    // the start is its own parent
+    AddOpen(query.Start.X, query.Start.Y, 0, query.Start);
+
+    while (!OpenList.empty())
+    {
+        std::pop_heap(OpenList.begin(), OpenList.end(), std::greater<OpenEntry>());
+        OpenEntry entry = OpenList.back();
+        OpenList.pop_back();
+
+        Node& node = GetNode(entry.Cell.X, entry.Cell.Y);
+
+        // a cell can be on the open list more than once, only the cheapest one counts
+        if (node.Closed || entry.G > node.G)
+            continue;
+
+        node.Closed = true;
+        result.Expanded++;
+
+        if (entry.Cell.X == Goal.X && entry.Cell.Y == Goal.Y)
+        {
+            result.Found = true;
+            result.Cost = node.G;
+
+            MapCoordinate cell = entry.Cell;
+            while (true)
+            {
+                result.Points.push_back(cell);
+
+                const Node& pathNode = GetNode(cell.X, cell.Y);
+                if (pathNode.Parent.X == cell.X && pathNode.Parent.Y == cell.Y)
+                    break;
+
+                cell = pathNode.Parent;
+            }
+
+            std::reverse(result.Points.begin(), result.Points.end());
+            return true;
+        }
+
+        if (query.MaxExpansions > 0 && result.Expanded >= query.MaxExpansions)
+            return false;
+
+        if (query.Algorithm == PathAlgorithm::AStar)
+            ExpandAStar(entry.Cell, entry.G);
+        else
+            ExpandJPS(entry.Cell, node, entry.G);
+    }
+
+    return false;
+}
@@ -0,0 +1,318 @@
+#include "map/ray_query.h"
+
+#include "map/grid_traversal.h"
+#include "services/job_pool.h"
+
+#include "raymath.h"
+
+#include <algorithm>
+#include <cfloat>
+
+void RayQueryWorld::ClearBodies()
+{
+    Bodies.clear();
+    Footprints.clear();
+    BodyGrid.Clear();
+}
+
+void RayQueryWorld::AddBox(const BoundingBox& bounds, GameObject* owner)
+{
+    Body& body = Bodies.emplace_back();
+    body.Type = RayHitType::Object;
+    body.Owner = owner;
+    body.Min = bounds.min;
+    body.Max = bounds.max;
+
+    Footprints.push_back(Rectangle{ bounds.min.x, bounds.min.y, bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y });
+}
+
+void RayQueryWorld::AddCapsule(const Vector3& base, float radius, float height, RayHitType type, GameObject* owner)
+{
+    Body& body = Bodies.emplace_back();
+    body.Type = type;
+    body.Owner = owner;
+    body.Radius = radius;
+    body.Bottom = Vector3{ base.x, base.y, base.z + radius };
+    body.Top = Vector3{ base.x, base.y, base.z + std::max(height - radius, radius) };
+
+    Footprints.push_back(Rectangle{ base.x - radius, base.y - radius, radius * 2, radius * 2 });
+}
+
+void RayQueryWorld::BuildIndex()
+{
+    // cells the size of map cells, so the grid walk can look up the bodies in each cell it goes through
+    BodyGrid.BuildBoxes(Footprints.data(), Footprints.size(), 1);
+}
+
+uint8_t RayQueryWorld::GetMask(RayHitType type)
+{
+    switch (type)
+    {
+    case RayHitType::Wall:
+        return RayHitMask::Walls;
+    case RayHitType::Door:
+        return RayHitMask::Doors;
+    case RayHitType::Floor:
+    case RayHitType::Ceiling:
+        return RayHitMask::FloorAndCeiling;
+    case RayHitType::Object:
+        return RayHitMask::Objects;
+    case RayHitType::Mob:
+        return RayHitMask::Mobs;
+    case RayHitType::Player:
+        return RayHitMask::Player;
+    default:
+        return 0;
+    }
+}
+
+bool RayQueryWorld::IntersectBody(const Body& body, const Vector3& origin, const Vector3& direction, float& distance, Vector3& normal)
+{
+    if (body.Type == RayHitType::Object)
+    {
+        // slabs, rays that start inside the box don't hit it
+        float enter = -FLT_MAX;
+        float exit = FLT_MAX;
+        int enterAxis = 0;
+
+        const float origins[3] = { origin.x, origin.y, origin.z };
+        const float directions[3] = { direction.x, direction.y, direction.z };
+        const float mins[3] = { body.Min.x, body.Min.y, body.Min.z };
+        const float maxes[3] = { body.Max.x, body.Max.y, body.Max.z };
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (directions[axis] == 0)
+            {
+                if (origins[axis] < mins[axis] || origins[axis] > maxes[axis])
+                    return false;
+                continue;
+            }
+
+            float first = (mins[axis] - origins[axis]) / directions[axis];
+            float second = (maxes[axis] - origins[axis]) / directions[axis];
+            if (first > second)
+                std::swap(first, second);
+
+            if (first > enter)
+            {
+                enter = first;
+                enterAxis = axis;
+            }
+            exit = std::min(exit, second);
+
+            if (enter > exit)
+                return false;
+        }
+
+        if (enter < 0)
+            return false;
+
+        distance = enter;
+        normal = Vector3Zeros;
+        float outward = directions[enterAxis] > 0 ? -1.0f : 1.0f;
+        if (enterAxis == 0)
+            normal.x = outward;
+        else if (enterAxis == 1)
+            normal.y = outward;
+        else
+            normal.z = outward;
+
+        return true;
+    }
+
+    // capsule, the side of the cylinder between the end centers first and then the end sphere it would have come in by
+    Vector3 axis = body.Top - body.Bottom;
+    Vector3 fromBottom = origin - body.Bottom;
+
+    float axisSq = Vector3DotProduct(axis, axis);
+    float axisDir = Vector3DotProduct(axis, direction);
+    float axisFrom = Vector3DotProduct(axis, fromBottom);
+    float dirFrom = Vector3DotProduct(direction, fromBottom);
+    float fromSq = Vector3DotProduct(fromBottom, fromBottom);
+    float radiusSq = body.Radius * body.Radius;
+
+    float hitDistance = -1;
+
+    float a = axisSq - axisDir * axisDir;
+    float b = axisSq * dirFrom - axisFrom * axisDir;
+    float c = axisSq * fromSq - axisFrom * axisFrom - radiusSq * axisSq;
+    float h = b * b - a * c;
+
+    if (h >= 0 && a > 0.000001f)
+    {
+        float t = (-b - sqrtf(h)) / a;
+        float along = axisFrom + t * axisDir;
+        if (along > 0 && along < axisSq)
+            hitDistance = t;
+    }
+
+    if (hitDistance < 0)
+    {
+        // the end spheres, the near one is hit first when the ray comes in from above or below
+        for (const Vector3* center : { &body.Bottom, &body.Top })
+        {
+            Vector3 fromCenter = origin - *center;
+            float sphereB = Vector3DotProduct(direction, fromCenter);
+            float sphereC = Vector3DotProduct(fromCenter, fromCenter) - radiusSq;
+            float sphereH = sphereB * sphereB - sphereC;
+            if (sphereH < 0)
+                continue;
+
+            float t = -sphereB - sqrtf(sphereH);
+            if (t >= 0 && (hitDistance < 0 || t < hitDistance))
+                hitDistance = t;
+        }
+    }
+
+    if (hitDistance < 0)
+        return false;
+
+    // the normal points away from the nearest point on the line between the end centers
+    Vector3 point = origin + direction * hitDistance;
+    float along = Clamp(Vector3DotProduct(point - body.Bottom, axis) / std::max(axisSq, 0.000001f), 0, 1);
+    normal = Vector3Normalize(point - (body.Bottom + axis * along));
+    distance = hitDistance;
+
+    return true;
+}
+
+bool RayQueryWorld::CastRay(const RayQuery& query, RayHit& hit) const
+{
+    hit = RayHit();
+
+    float length = Vector3Length(query.Direction);
+    if (!WorldMap || length <= 0 || query.MaxDistance <= 0)
+        return false;
+
+    Vector3 direction = query.Direction / length;
+    const Vector3& origin = query.Origin;
+
+    float bestDistance = query.MaxDistance;
+
+    // the direction is a unit vector, so the distances the grid walk gives are how far along the ray it is in 3D too
+    TraceGrid(Vector2{ origin.x, origin.y }, Vector2{ direction.x, direction.y }, query.MaxDistance, [&](const GridStep& step)
+        {
+            MapCell cell = WorldMap->GetCell(step.X, step.Y);
+
+            // the walls of the cell the ray starts in are behind it
+            if (!step.Start)
+            {
+                bool wall = WorldMap->IsCellSolid(step.X, step.Y);
+                bool closedDoor = cell.State == MapCellState::Door && (cell.Flags & MapCellFlags::Impassible);
+
+                uint8_t mask = wall ? RayHitMask::Walls : (closedDoor ? RayHitMask::Doors : 0);
+                if (query.Mask & mask)
+                {
+                    // rays can go over the walls of cells that are open to the sky, and come down on top of them
+                    float height = origin.z + direction.z * step.Distance;
+                    float exitHeight = origin.z + direction.z * step.ExitDistance;
+
+                    float distance = -1;
+                    Vector3 normal = step.SideY ? Vector3{ 0, float(-step.StepY), 0 } : Vector3{ float(-step.StepX), 0, 0 };
+                    if (height >= 0 && height <= WallHeight)
+                    {
+                        distance = step.Distance;
+                    }
+                    else if (height > WallHeight && exitHeight <= WallHeight)
+                    {
+                        distance = (WallHeight - origin.z) / direction.z;
+                        normal = Vector3{ 0, 0, 1 };
+                    }
+
+                    if (distance >= 0)
+                    {
+                        if (distance < bestDistance)
+                        {
+                            bestDistance = distance;
+                            hit.Type = wall ? RayHitType::Wall : RayHitType::Door;
+                            hit.Distance = distance;
+                            hit.Cell = MapCoordinate{ step.X, step.Y };
+                            hit.Object = nullptr;
+                            hit.Normal = normal;
+                        }
+                        return true;
+                    }
+                }
+            }
+
+            if ((query.Mask & RayHitMask::FloorAndCeiling) && !step.Start && cell.Tiles[1] != MapCellInvalidTile && step.Distance < bestDistance
+                && origin.z + direction.z * step.Distance > WallHeight)
+            {
+                // came over the walls from somewhere open to the sky and ran into the edge of a roof
+                bestDistance = step.Distance;
+                hit.Type = RayHitType::Ceiling;
+                hit.Distance = step.Distance;
+                hit.Cell = MapCoordinate{ step.X, step.Y };
+                hit.Object = nullptr;
+                hit.Normal = step.SideY ? Vector3{ 0, float(-step.StepY), 0 } : Vector3{ float(-step.StepX), 0, 0 };
+                return true;
+            }
+
+            if ((query.Mask & RayHitMask::FloorAndCeiling) && direction.z != 0)
+            {
+                // the floor is everywhere, the ceiling only where the cell has one
+                bool down = direction.z < 0;
+                if (down || cell.Tiles[1] != MapCellInvalidTile)
+                {
+                    float planeDistance = ((down ? 0 : WallHeight) - origin.z) / direction.z;
+                    if (planeDistance >= step.Distance && planeDistance <= step.ExitDistance && planeDistance >= 0 && planeDistance < bestDistance)
+                    {
+                        bestDistance = planeDistance;
+                        hit.Type = down ? RayHitType::Floor : RayHitType::Ceiling;
+                        hit.Distance = planeDistance;
+                        hit.Cell = MapCoordinate{ step.X, step.Y };
+                        hit.Object = nullptr;
+                        hit.Normal = Vector3{ 0, 0, down ? 1.0f : -1.0f };
+                    }
+                }
+            }
+
+            BodyGrid.ForEachInCell(step.X, step.Y, [&](size_t index)
+                {
+                    const Body& body = Bodies[index];
+                    if (!(query.Mask & GetMask(body.Type)) || body.Owner == query.Ignore)
+                        return;
+
+                    float distance = 0;
+                    Vector3 normal = { 0, 0, 0 };
+                    if (!IntersectBody(body, origin, direction, distance, normal) || distance >= bestDistance)
+                        return;
+
+                    bestDistance = distance;
+                    hit.Type = body.Type;
+                    hit.Distance = distance;
+                    hit.Normal = normal;
+                    hit.Object = body.Owner;
+                    hit.Cell = MapCoordinate{ step.X, step.Y };
+                });
+
+            // nothing in a later cell can be nearer than something that is hit before this one ends
+            return hit.Type != RayHitType::None && bestDistance <= step.ExitDistance;
+        });
+
+    if (hit.Type == RayHitType::None)
+        return false;
+
+    hit.Point = origin + direction * hit.Distance;
+    return true;
+}
+
+void RayQueryWorld::CastRays(const std::vector<RayQuery>& queries, std::vector<RayHit>& hits) const
+{
+    hits.resize(queries.size());
+
+    if (queries.size() < ParallelRayCount)
+    {
+        for (size_t i = 0; i < queries.size(); i++)
+            CastRay(queries[i], hits[i]);
+        return;
+    }
+
+    // every ray only reads the world and writes its own hit
+    JobPool::ParallelFor(queries.size(), RaysPerBatch, [this, &queries, &hits](size_t first, size_t last, size_t)
+        {
+            for (size_t i = first; i < last; i++)
+                CastRay(queries[i], hits[i]);
+        });
+}
@@ -1,4 +1,7 @@
 #include "map/raycaster.h"
+#include "map/grid_traversal.h"
+
+#include <cfloat>
 
 
 void Raycaster::SetOutputSize(int renderWidth, float renderFOV)
@@ -16,8 +19,9 @@ void Raycaster::SetMap(const Map* map)
     if (map)
     {
         WorldMap = map;
-        CellStatus.resize(WorldMap->Size.X * WorldMap->Size.Y);
-        CellStatus.assign(CellStatus.size(), 0);
+        VisibilitySlots.assign(WorldMap->ChunkSlots.size(), 0);
+        VisibilityChunks.clear();
+        HitCellLocs.clear();
     }
 }
 
@@ -28,10 +32,9 @@ void Raycaster::StartFrame(const Vector3& viewLocation, const Vector3& facingVec
     CameraPlane = Vector2Rotate(NominalCameraPlane, angle);
 
     // clear any previous hit cells
-    for (const auto& i : HitCells)
-        CellStatus[i] = 0;
+    for (const auto& cell : HitCellLocs)
+        VisibilityChunks[VisibilitySlots[WorldMap->GetChunkSlot(cell.X, cell.Y)] - 1][Map::GetChunkCellIndex(cell.X, cell.Y)] = 0;
 
-    HitCells.clear();
     HitCellLocs.clear();
 
     CastCount = 0;
@@ -66,96 +69,41 @@ void Raycaster::CastRay(RayResult& ray, const Vector3& pos)
 
     CastCount++;
 
-    // The current grid point we are in
-    int mapX = int(floor(pos.x));
-    int mapY = int(floor(pos.y));
-
-    ray.HitGridType = WorldMap->GetCell(mapX, mapY).Tiles[0];
-
-    //length of ray from current position to next x or y-side
-    float sideDistX = 0;
-    float sideDistY = 0;
-
-    // length of ray from one x or y-side to next x or y-side
-    // these are derived as:
-    // deltaDistX = sqrt(1 + (rayDirY * rayDirY) / (rayDirX * rayDirX))
-    // deltaDistY = sqrt(1 + (rayDirX * rayDirX) / (rayDirY * rayDirY))
-    // which can be simplified to abs(|rayDir| / rayDirX) and abs(|rayDir| / rayDirY)
-    // where |rayDir| is the length of the vector (rayDirX, rayDirY). Its length,
-    // unlike (dirX, dirY) is not 1, however this does not matter, only the
-    // ratio between deltaDistX and deltaDistY matters, due to the way the DDA
-    // stepping further below works. So the values can be computed as below.
-    // Division through zero is prevented, even though technically that's not
-    // needed in C++ with IEEE 754 floating point values.
-    float deltaDistX = (ray.Directon.x == 0) ? float(1e30) : float(fabs(1.0f / ray.Directon.x));
-    float deltaDistY = (ray.Directon.y == 0) ? float(1e30) : float(fabs(1.0f / ray.Directon.y));
-
-    float perpWallDist = 0;
-
-    // what direction to step in x or y-direction (either +1 or -1)
-    int stepX = 0;
-    int stepY = 0;
-
-    bool hit = false; //was there a wall hit?
-    bool side = false; //was a NS or a EW wall hit?
-
-    // calculate step and initial sideDist
-    if (ray.Directon.x < 0)
-    {
-        stepX = -1;
-        sideDistX = (pos.x - mapX) * deltaDistX;
-    }
-    else
-    {
-        stepX = 1;
-        sideDistX = (mapX + 1.0f - pos.x) * deltaDistX;
-    }
+    bool hit = false;
+    GridStep hitStep;
 
-    if (ray.Directon.y < 0)
-    {
-        stepY = -1;
-        sideDistY = (pos.y - mapY) * deltaDistY;
-    }
-    else
-    {
-        stepY = 1;
-        sideDistY = (mapY + 1.0f - pos.y) * deltaDistY;
-    }
-
-    // perform DDA Digital Differential Analyzer to walk the line
-    while (!hit)
-    {
-        //jump to next map square, either in x-direction, or in y-direction
-        if (sideDistX < sideDistY)
-        {
-            sideDistX += deltaDistX;
-            mapX += stepX;
-            side = false;
-        }
-        else
+    // the direction isn't normalized, so the distances come back already projected on to the camera direction.
+    // using the euclidean distance to the view point would give a fisheye effect
+    TraceGrid(Vector2{ pos.x, pos.y }, ray.Directon, FLT_MAX, [&](const GridStep& step)
         {
-            sideDistY += deltaDistY;
-            mapY += stepY;
-            side = true;
-        }
+            if (step.Start)
+            {
+                ray.HitGridType = WorldMap->GetCell(step.X, step.Y).Tiles[0];
+                return false;
+            }
+
+            if (step.X >= WorldMap->Size.X || step.X < 0 || step.Y >= WorldMap->Size.Y || step.Y < 0)
+                return true;
 
-        if (mapX >= WorldMap->Size.X || mapX < 0 || mapY >= WorldMap->Size.Y || mapY < 0)
-            break;
+            ray.HitGridType = 0;
+            if (WorldMap->IsCellSolid(step.X, step.Y))
+                ray.HitGridType = WorldMap->GetCell(step.X, step.Y).Tiles[0];
 
-        ray.HitGridType = 0;
-        if (WorldMap->IsCellSolid(mapX, mapY))
-            ray.HitGridType = WorldMap->GetCell(mapX, mapY).Tiles[0];
+            ray.HitCellIndex = int64_t(WorldMap->GetCellIndex(step.X, step.Y));
+            ray.TargetCell.X = step.X;
+            ray.TargetCell.Y = step.Y;
 
-        ray.HitCellIndex = int(WorldMap->GetCellIndex(mapX, mapY));
-        ray.TargetCell.X = mapX;
-        ray.TargetCell.Y = mapY;
+            // check if the ray has hit a wall
+            if (ray.HitGridType != 0)
+            {
+                hit = true;
+                hitStep = step;
+            }
 
-        //Check if ray has hit a wall
-        if (ray.HitGridType != 0)
-            hit = true;
+            SetCellVis(step.X, step.Y);
 
-        SetCellVis(mapX, mapY);
-    }
+            return hit;
+        });
 
     if (!hit)
     {
@@ -163,25 +111,12 @@ void Raycaster::CastRay(RayResult& ray, const Vector3& pos)
         return;
     }
 
-
-    // Calculate distance projected on camera direction. This is the shortest distance from the point where the wall is
-    // hit to the camera plane. Euclidean to center camera point would give fisheye effect!
-    // This can be computed as (mapX - posX + (1 - stepX) / 2) / rayDirX for side == 0, or same formula with Y
-    // for size == 1, but can be simplified to the code below thanks to how sideDist and deltaDist are computed:
-    // because they were left scaled to |rayDir|. sideDist is the entire length of the ray above after the multiple
-    // steps, but we subtract deltaDist once because one step more into the wall was taken above.
-    if (!side)
-    {
-        perpWallDist = (sideDistX - deltaDistX);
-        ray.Normal = stepX < 0 ? HitNormals::East : HitNormals::West;
-    }
+    if (!hitStep.SideY)
+        ray.Normal = hitStep.StepX < 0 ? HitNormals::East : HitNormals::West;
     else
-    {
-        perpWallDist = (sideDistY - deltaDistY);
-        ray.Normal = stepY < 0 ? HitNormals::North : HitNormals::South;
-    }
+        ray.Normal = hitStep.StepY < 0 ? HitNormals::North : HitNormals::South;
 
-    ray.Distance = perpWallDist;
+    ray.Distance = hitStep.Distance;
 }
 
 bool Raycaster::CastRayPair(int minPixel, int maxPixel, const Vector3& viewLocation, const Vector3& facingVector)
@@ -222,7 +157,7 @@ void Raycaster::UpdateRayset(const Vector3& viewLocation, const Vector3& facingV
 {
     SetCellVis(int(viewLocation.x), int(viewLocation.y));
 
-    for (uint16_t i = 0; i < RenderWidth; i++)
+    for (int i = 0; i < RenderWidth; i++)
         RaySet[i].HitCellIndex = -1;
 
     size_t index = 0;
@@ -259,20 +194,26 @@ bool Raycaster::IsCellVis(int x, int y) const
     if (!WorldMap || x < 0 || x >= WorldMap->Size.X || y < 0 || y >= WorldMap->Size.Y)
         return false;
 
-    int index = y * (int)WorldMap->Size.X + x;
-    return CellStatus[index] == 1;
+    uint32_t slot = VisibilitySlots[WorldMap->GetChunkSlot(x, y)];
+    return slot != 0 && VisibilityChunks[slot - 1][Map::GetChunkCellIndex(x, y)] == 1;
 }
 
 void Raycaster::AddCellVis(int x, int y)
 {
-    int index = y * (int)WorldMap->Size.X + x;
-    uint8_t& id = CellStatus[index];
+    // the first cell seen in a chunk gets that chunk some visibility storage, it is reused every frame after that
+    uint32_t& slot = VisibilitySlots[WorldMap->GetChunkSlot(x, y)];
+    if (slot == 0)
+    {
+        VisibilityChunks.emplace_back().fill(0);
+        slot = uint32_t(VisibilityChunks.size());
+    }
+
+    uint8_t& id = VisibilityChunks[slot - 1][Map::GetChunkCellIndex(x, y)];
     if (id == 1)
         return;
 
     id = 1;
-    HitCells.push_back(index);
-    HitCellLocs.emplace_back(MapCoordinate{ uint16_t(x), uint16_t(y) });
+    HitCellLocs.emplace_back(MapCoordinate{ x, y });
 }
 
 void Raycaster::SetCellVis(int x, int y)
@@ -4,6 +4,10 @@
 #include "game_object.h"
 
 #include "map/map_reader.h"
+#include "services/global_vars.h"
+#include "services/pathfinding.h"
+
+#include <algorithm>
 
 Scene::Scene()
 {
@@ -18,25 +22,41 @@ void Scene::Init()
 void Scene::Load(std::string_view map)
 {
     CurrentWorldMap = map;
-    WorldMap.Clear();
+    ClearMap();
 
     if (!map.empty())
         ReadWorld(map.data(), *this);
 
     WorldRaycaster.SetMap(&WorldMap);
+    Pathfinding::SetMap(WorldMap);
 }
 
 void Scene::ReloadMap()
 {
-    WorldMap.Clear();
+    ClearMap();
+
     if (!CurrentWorldMap.empty())
         ReadWorld(CurrentWorldMap.data(), *this);
 
     WorldRaycaster.SetMap(&WorldMap);
+    Pathfinding::SetMap(WorldMap);
+
+    App::CallEvent(MapReloaded, nullptr, nullptr);
+}
+
+void Scene::ClearMap()
+{
+    // the objects remove themselves from their systems as they are destroyed
+    RegionRootObjects.clear();
+    RegionLoader = nullptr;
+
+    WorldMap.Clear();
 }
 
 void Scene::Cleanup()
 {
+    RegionRootObjects.clear();
+    RegionLoader = nullptr;
     RootObject = nullptr;
 }
 
@@ -45,4 +65,111 @@ GameObject* Scene::AddObject()
     auto* object = RootObject->AddChild();
 
     return object;
-}
\ No newline at end of file
+}
+
+GameObject* Scene::AddMapObject(size_t region)
+{
+    if (region >= RegionRootObjects.size() || !RegionRootObjects[region])
+        return nullptr;
+
+    return RegionRootObjects[region]->AddChild();
+}
+
+void Scene::LoadRegion(size_t region)
+{
+    auto& regions = WorldMap.Regions;
+    if (!RegionLoader || region >= regions.size() || regions[region].Loaded)
+        return;
+
+    if (RegionRootObjects.size() < regions.size())
+        RegionRootObjects.resize(regions.size());
+
+    RegionRootObjects[region] = std::make_unique<GameObject>();
+    regions[region].Loaded = true;
+
+    RegionLoader->LoadRegion(region);
+}
+
+void Scene::UnloadRegion(size_t region)
+{
+    auto& regions = WorldMap.Regions;
+    if (region >= regions.size() || !regions[region].Loaded)
+        return;
+
+    RegionRootObjects[region] = nullptr;
+    regions[region].Loaded = false;
+
+    if (RegionLoader)
+        RegionLoader->UnloadRegion(region);
+}
+
+static float GetDistanceToRegion(const MapRegion& region, const Vector3& position)
+{
+    float dx = std::max({ region.Bounds.x - position.x, 0.0f, position.x - (region.Bounds.x + region.Bounds.width) });
+    float dy = std::max({ region.Bounds.y - position.y, 0.0f, position.y - (region.Bounds.y + region.Bounds.height) });
+
+    return sqrtf(dx * dx + dy * dy);
+}
+
+std::vector<size_t> Scene::GetWantedRegions(const Vector3& position) const
+{
+    const auto& regions = WorldMap.Regions;
+
+    std::vector<std::pair<float, size_t>> nearest;
+    nearest.reserve(regions.size());
+    for (size_t i = 0; i < regions.size(); i++)
+        nearest.emplace_back(GetDistanceToRegion(regions[i], position), i);
+
+    std::sort(nearest.begin(), nearest.end());
+
+    std::vector<size_t> wanted;
+    for (auto [distance, region] : nearest)
+    {
+        // loaded regions stay until they are further away than they load at, so walking along an edge doesn't load and unload them every frame
+        float range = regions[region].Loaded ? GlobalVars::RegionUnloadDistance : GlobalVars::RegionLoadDistance;
+
+        // the region the player is in is always wanted
+        if (distance <= 0 || (distance <= range && wanted.size() < size_t(std::max(GlobalVars::MaxLoadedRegions, 1))))
+            wanted.push_back(region);
+    }
+
+    return wanted;
+}
+
+void Scene::UpdateRegions(const Vector3& position, size_t maxLoads)
+{
+    auto& regions = WorldMap.Regions;
+    std::vector<size_t> wanted = GetWantedRegions(position);
+
+    // unloading first keeps the loaded count inside the budget
+    std::vector<bool> keep(regions.size(), false);
+    for (size_t region : wanted)
+        keep[region] = true;
+
+    for (size_t region = 0; region < regions.size(); region++)
+    {
+        if (!keep[region])
+            UnloadRegion(region);
+    }
+
+    for (size_t region : wanted)
+    {
+        if (!regions[region].Loaded && maxLoads > 0)
+        {
+            LoadRegion(region);
+            maxLoads--;
+        }
+    }
+}
+
+size_t Scene::GetLoadedRegionCount() const
+{
+    size_t count = 0;
+    for (const auto& region : WorldMap.Regions)
+    {
+        if (region.Loaded)
+            count++;
+    }
+
+    return count;
+}
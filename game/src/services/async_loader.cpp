@@ -0,0 +1,250 @@
+#include "services/async_loader.h"
+#include "services/global_vars.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace AsyncLoader
+{
+    enum class JobState
+    {
+        Queued,
+        Working,
+        WaitingForUpload,
+        Uploading,
+        Done,
+    };
+
+    class LoadJob
+    {
+    public:
+        std::function<void()> Work;
+        std::function<void()> Upload;
+        JobState State = JobState::Queued;
+    };
+
+    // the queues and every job state are guarded by the one mutex
+    static std::mutex QueueMutex;
+    static std::condition_variable WorkAvailable;
+    static std::condition_variable WorkFinished;
+
+    static std::deque<JobPtr> WorkQueue;
+    static std::deque<JobPtr> UploadQueue;
+
+    static std::vector<std::thread> Workers;
+    static bool Stopping = false;
+
+    // jobs that have been queued and not uploaded, and the ones a thread is doing the work step for right now
+    static size_t PendingJobs = 0;
+    static size_t WorkingJobs = 0;
+
+    static void WorkerThread()
+    {
+        std::unique_lock<std::mutex> lock(QueueMutex);
+
+        while (true)
+        {
+            WorkAvailable.wait(lock, []() { return Stopping || !WorkQueue.empty(); });
+            if (Stopping)
+                return;
+
+            JobPtr job = WorkQueue.front();
+            WorkQueue.pop_front();
+            job->State = JobState::Working;
+            WorkingJobs++;
+
+            lock.unlock();
+            if (job->Work)
+                job->Work();
+            lock.lock();
+
+            job->State = JobState::WaitingForUpload;
+            WorkingJobs--;
+            UploadQueue.push_back(job);
+            WorkFinished.notify_all();
+        }
+    }
+
+    static void RunUpload(JobPtr job)
+    {
+        if (job->Upload)
+            job->Upload();
+
+        // the steps can hold the last reference to what they loaded
+        std::lock_guard<std::mutex> lock(QueueMutex);
+        job->Work = nullptr;
+        job->Upload = nullptr;
+        job->State = JobState::Done;
+        PendingJobs--;
+    }
+
+    void Init()
+    {
+        if (!Workers.empty())
+            return;
+
+        // leave a core for the main thread, and don't fight the game for the rest of them
+        unsigned int threadCount = std::thread::hardware_concurrency();
+        threadCount = std::clamp(threadCount > 1 ? threadCount - 1 : 1, 1u, 4u);
+
+        Stopping = false;
+        for (unsigned int i = 0; i < threadCount; i++)
+            Workers.emplace_back(WorkerThread);
+    }
+
+    void Cleanup()
+    {
+        {
+            std::lock_guard<std::mutex> lock(QueueMutex);
+            Stopping = true;
+        }
+        WorkAvailable.notify_all();
+
+        for (auto& worker : Workers)
+            worker.join();
+
+        Workers.clear();
+
+        WorkQueue.clear();
+        UploadQueue.clear();
+        PendingJobs = 0;
+    }
+
+    JobPtr QueueLoad(std::function<void()> work, std::function<void()> upload)
+    {
+        JobPtr job = std::make_shared<LoadJob>();
+        job->Work = std::move(work);
+        job->Upload = std::move(upload);
+
+        {
+            std::lock_guard<std::mutex> lock(QueueMutex);
+            PendingJobs++;
+        }
+
+        if (!GlobalVars::UseAsyncLoading || Workers.empty())
+        {
+            Complete(job);
+            return job;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(QueueMutex);
+            WorkQueue.push_back(job);
+        }
+        WorkAvailable.notify_one();
+
+        return job;
+    }
+
+    void ProcessUploads(float budgetSeconds)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        while (true)
+        {
+            JobPtr job;
+            {
+                std::lock_guard<std::mutex> lock(QueueMutex);
+                if (UploadQueue.empty())
+                    return;
+
+                job = UploadQueue.front();
+                UploadQueue.pop_front();
+                job->State = JobState::Uploading;
+            }
+
+            RunUpload(job);
+
+            std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed.count() >= budgetSeconds)
+                return;
+        }
+    }
+
+    void Complete(JobPtr job)
+    {
+        if (!job)
+            return;
+
+        std::unique_lock<std::mutex> lock(QueueMutex);
+
+        if (job->State == JobState::Queued)
+        {
+            // take it away from the workers and do it here
+            auto itr = std::find(WorkQueue.begin(), WorkQueue.end(), job);
+            if (itr != WorkQueue.end())
+                WorkQueue.erase(itr);
+
+            job->State = JobState::Working;
+            WorkingJobs++;
+
+            lock.unlock();
+            if (job->Work)
+                job->Work();
+            lock.lock();
+
+            job->State = JobState::WaitingForUpload;
+            WorkingJobs--;
+        }
+        else if (job->State == JobState::Working)
+        {
+            WorkFinished.wait(lock, [&job]() { return job->State != JobState::Working; });
+        }
+
+        // done already, or being uploaded further up the stack
+        if (job->State != JobState::WaitingForUpload)
+            return;
+
+        auto itr = std::find(UploadQueue.begin(), UploadQueue.end(), job);
+        if (itr != UploadQueue.end())
+            UploadQueue.erase(itr);
+
+        job->State = JobState::Uploading;
+        lock.unlock();
+
+        RunUpload(job);
+    }
+
+    void CompleteAll()
+    {
+        while (true)
+        {
+            JobPtr job;
+            {
+                std::unique_lock<std::mutex> lock(QueueMutex);
+
+                // jobs a worker is busy with are in neither queue, wait for them to show up as uploads
+                WorkFinished.wait(lock, []() { return !WorkQueue.empty() || !UploadQueue.empty() || WorkingJobs == 0; });
+
+                if (!UploadQueue.empty())
+                    job = UploadQueue.front();
+                else if (!WorkQueue.empty())
+                    job = WorkQueue.front();
+                else
+                    return;
+            }
+
+            Complete(job);
+        }
+    }
+
+    bool IsDone(const JobPtr& job)
+    {
+        if (!job)
+            return true;
+
+        std::lock_guard<std::mutex> lock(QueueMutex);
+        return job->State == JobState::Done;
+    }
+
+    size_t GetPendingCount()
+    {
+        std::lock_guard<std::mutex> lock(QueueMutex);
+        return PendingJobs;
+    }
+};
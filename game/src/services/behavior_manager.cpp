@@ -0,0 +1,88 @@
+#include "services/behavior_manager.h"
+#include "services/table_manager.h"
+
+#include "raylib.h"
+
+#include <string>
+#include <unordered_map>
+
+static constexpr char BehaviorManifest[] = "behavior_manifest";
+
+namespace BehaviorManager
+{
+    static const Table* BehaviorManifestTable = nullptr;
+    static std::unordered_map<std::string, std::shared_ptr<const BehaviorTree>> BehaviorCache;
+    static std::shared_ptr<const BehaviorTree> FallbackBehavior;
+
+    // what mobs did before behaviors came from tables, chase the player when they have seen them, then patrol or wander
+    static std::shared_ptr<const BehaviorTree> GetFallbackBehavior()
+    {
+        if (FallbackBehavior)
+            return FallbackBehavior;
+
+        Table table;
+        table.insert_or_assign("root", "selector:chase,patrol,wander");
+        table.insert_or_assign("chase", "sequence:chase_enabled,saw_player,player_in_range,chase_player");
+        table.insert_or_assign("patrol", "sequence:has_path,follow_path");
+        table.insert_or_assign("tick_lod", "8:0,24:0.1,48:0.25");
+
+        auto tree = std::make_shared<BehaviorTree>();
+        std::string error;
+        // it is built in, so this only fails if the node names change. the mobs then stand still instead of crashing
+        if (!tree->Compile(DefaultBehavior, table, error))
+            TraceLog(LOG_ERROR, "BEHAVIOR: The default behavior does not compile, %s", error.c_str());
+
+        FallbackBehavior = tree;
+        return FallbackBehavior;
+    }
+
+    static std::shared_ptr<const BehaviorTree> LoadBehavior(const std::string& name)
+    {
+        const Table* behaviorTable = BehaviorManifestTable ? BehaviorManifestTable->GetFieldAsTable(name) : nullptr;
+        if (!behaviorTable)
+        {
+            TraceLog(LOG_WARNING, "BEHAVIOR: No behavior table for %s, using the default", name.c_str());
+            return GetFallbackBehavior();
+        }
+
+        auto tree = std::make_shared<BehaviorTree>();
+        std::string error;
+        if (!tree->Compile(name, *behaviorTable, error))
+        {
+            TraceLog(LOG_WARNING, "BEHAVIOR: %s does not compile, %s. Using the default", name.c_str(), error.c_str());
+            return GetFallbackBehavior();
+        }
+
+        TraceLog(LOG_INFO, "BEHAVIOR: Compiled %s, %d nodes", name.c_str(), int(tree->GetNodeCount()));
+        return tree;
+    }
+
+    void Init()
+    {
+        BehaviorManifestTable = TableManager::GetTable(BootstrapTable)->GetFieldAsTable(BehaviorManifest);
+    }
+
+    void Cleanup()
+    {
+        BehaviorCache.clear();
+        FallbackBehavior = nullptr;
+    }
+
+    std::shared_ptr<const BehaviorTree> GetBehavior(std::string_view name)
+    {
+        std::string key(name.empty() ? DefaultBehavior : name);
+
+        auto itr = BehaviorCache.find(key);
+        if (itr != BehaviorCache.end())
+            return itr->second;
+
+        auto tree = LoadBehavior(key);
+        BehaviorCache.insert_or_assign(key, tree);
+        return tree;
+    }
+
+    void Reload()
+    {
+        BehaviorCache.clear();
+    }
+};
@@ -49,6 +49,9 @@ namespace CharacterManager
         if (characterTable->HasField("shadow"))
             character->ShadowTexture = characterTable->GetField("shadow");
 
+        if (characterTable->HasField("behavior"))
+            character->BehaviorName = characterTable->GetField("behavior");
+
         CharacterCache.insert_or_assign(key, character);
 
         return character;
@@ -24,6 +24,36 @@ namespace GlobalVars
 
     bool UseMouseDrag = DebugTrue;
 
+    bool UseAnimationLOD = true;
+    float AnimationLODScale = 1.0f;
+
+    bool UseAsyncLoading = true;
+    float UploadBudgetMS = 4.0f;
+
+    // loose files in the resource folder replace the same file in a pack, so assets can be edited without repacking
+    bool UseLooseFileOverlay = DebugTrue;
+    bool ShowCacheStats = false;
+
+    // load the .dds made by the texture tool instead of the source image when there is one
+    bool UseCompressedTextures = true;
+
+    // watch the resource folder and reload files as they are saved
+    bool UseHotReload = DebugTrue;
+
+    // load the .cmap next to a map instead of parsing its LDtk project
+    bool UseCompiledMaps = true;
+
+    // the most regions of a world that have their objects spawned, and how close in cells the player has to get to spawn them
+    int MaxLoadedRegions = 9;
+    float RegionLoadDistance = 16;
+    float RegionUnloadDistance = 24;
+
+    // push mobs that overlap each other or the player apart
+    bool UseCrowdSeparation = true;
+
+    // how many line of sight rays mobs can cast in a frame, the rest use what they saw last until it is their turn
+    int PerceptionRaysPerFrame = 32;
+
     float MasterVolume = 0.5f;
 
     bool Paused = false;
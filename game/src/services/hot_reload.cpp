@@ -0,0 +1,133 @@
+#include "services/hot_reload.h"
+#include "services/behavior_manager.h"
+#include "services/global_vars.h"
+#include "services/model_manager.h"
+#include "services/resource_cache.h"
+#include "services/resource_manager.h"
+#include "services/table_manager.h"
+#include "services/texture_manager.h"
+#include "utilities/file_watcher.h"
+#include "utilities/pack_format.h"
+
+#include "map/compiled_map.h"
+
+#include "game.h"
+#include "scene.h"
+
+#include "raylib.h"
+
+#include <string>
+
+namespace HotReload
+{
+    static FileWatcher Watcher;
+
+    void Init()
+    {
+        SetEnabled(GlobalVars::UseHotReload);
+    }
+
+    void Cleanup()
+    {
+        Watcher.Stop();
+    }
+
+    void SetEnabled(bool enabled)
+    {
+        if (enabled == Watcher.IsWatching())
+            return;
+
+        if (!enabled)
+        {
+            Watcher.Stop();
+            return;
+        }
+
+        // the resource manager made the resource folder the working directory
+        if (!Watcher.Start(GetWorkingDirectory()))
+            TraceLog(LOG_WARNING, "RESOURCE: Unable to watch %s for changes", GetWorkingDirectory());
+    }
+
+    bool UsesNotifications()
+    {
+        return Watcher.UsesNotifications();
+    }
+
+    void Update()
+    {
+        if (!Watcher.IsWatching())
+            return;
+
+        auto changedFiles = Watcher.GetChangedFiles();
+        if (changedFiles.empty())
+            return;
+
+        Scene& scene = App::GetScene();
+        std::string mapName = PackFormat::NormalizePath(scene.GetMapName());
+        std::string compiledMapName = mapName.empty() ? std::string() : CompiledMap::GetCompiledName(mapName);
+
+        bool reloadMap = false;
+        bool tablesReloaded = false;
+        bool shadersReloaded = false;
+        bool texturesReplaced = false;
+
+        for (const auto& file : changedFiles)
+        {
+            // the next open has to read the file from disk again
+            ResourceManager::InvalidateResource(file);
+
+            if (IsFileExtension(file.c_str(), ".pack"))
+            {
+                TraceLog(LOG_INFO, "RESOURCE: %s changed, packs are only mounted at startup", file.c_str());
+                continue;
+            }
+
+            if (TableManager::ReloadTable(file))
+            {
+                TraceLog(LOG_INFO, "RESOURCE: Reloaded table %s", file.c_str());
+                tablesReloaded = true;
+            }
+
+            shadersReloaded |= TextureManager::ReloadShaders(file);
+            texturesReplaced |= TextureManager::ReloadTexture(file);
+            ModelManager::ReloadModels(file);
+
+            if (file == mapName || file == compiledMapName)
+                reloadMap = true;
+        }
+
+        if (tablesReloaded)
+        {
+            ResourceCache::LoadBudgets(TableManager::GetTable(BootstrapTable)->GetFieldAsTable("cache_budgets"));
+            BehaviorManager::Reload();
+
+            // the map reads tables as it loads, so it is read again to pick up the changes
+            if (!mapName.empty())
+                reloadMap = true;
+        }
+
+        if (texturesReplaced)
+        {
+            ModelManager::RefreshTextures();
+
+            // the map holds a copy of its tilemap, getting it again doesn't change the references it holds
+            Map& map = scene.GetMap();
+            if (!reloadMap && !map.TilemapName.empty())
+            {
+                map.Tilemap = TextureManager::AcquireTexture(map.TilemapName);
+                TextureManager::ReleaseTexture(map.TilemapName);
+            }
+        }
+
+        // the map reload sets up the rendering again, which gets the new shaders too
+        if (reloadMap)
+        {
+            scene.ReloadMap();
+            TraceLog(LOG_INFO, "RESOURCE: Reloaded map %s", mapName.c_str());
+        }
+        else if (shadersReloaded)
+        {
+            App::CallEvent(ShadersReloaded, nullptr, nullptr);
+        }
+    }
+};
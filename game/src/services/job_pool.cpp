@@ -0,0 +1,146 @@
+#include "services/job_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace JobPool
+{
+    struct Batches
+    {
+        const std::function<void(size_t, size_t, size_t)>* Work = nullptr;
+        size_t Count = 0;
+        size_t BatchSize = 0;
+        size_t BatchCount = 0;
+
+        // the threads take batches in order until they run out
+        std::atomic<size_t> NextBatch = 0;
+    };
+
+    static std::mutex PoolMutex;
+    static std::condition_variable WorkAvailable;
+    static std::condition_variable WorkFinished;
+
+    static std::vector<std::thread> Workers;
+    static bool Stopping = false;
+
+    // the batches being run, and how many workers are still looking at them
+    static Batches* Current = nullptr;
+    static size_t Generation = 0;
+    static size_t ActiveWorkers = 0;
+
+    // one ParallelFor at a time gets the workers
+    static std::mutex CallMutex;
+
+    static thread_local bool InBatch = false;
+
+    static void RunBatches(Batches& batches)
+    {
+        InBatch = true;
+
+        while (true)
+        {
+            size_t batch = batches.NextBatch.fetch_add(1);
+            if (batch >= batches.BatchCount)
+                break;
+
+            size_t first = batch * batches.BatchSize;
+            size_t last = std::min(first + batches.BatchSize, batches.Count);
+            (*batches.Work)(first, last, batch);
+        }
+
+        InBatch = false;
+    }
+
+    static void WorkerThread()
+    {
+        size_t seenGeneration = 0;
+        std::unique_lock<std::mutex> lock(PoolMutex);
+
+        while (true)
+        {
+            WorkAvailable.wait(lock, [&seenGeneration]() { return Stopping || (Current && Generation != seenGeneration); });
+            if (Stopping)
+                return;
+
+            seenGeneration = Generation;
+            Batches* batches = Current;
+            ActiveWorkers++;
+
+            lock.unlock();
+            RunBatches(*batches);
+            lock.lock();
+
+            ActiveWorkers--;
+            WorkFinished.notify_all();
+        }
+    }
+
+    void Init()
+    {
+        if (!Workers.empty())
+            return;
+
+        // the main thread runs batches too, so one less than the cores
+        unsigned int threadCount = std::thread::hardware_concurrency();
+        threadCount = std::clamp(threadCount > 1 ? threadCount - 1 : 1, 1u, 8u);
+
+        Stopping = false;
+        for (unsigned int i = 0; i < threadCount; i++)
+            Workers.emplace_back(WorkerThread);
+    }
+
+    void Cleanup()
+    {
+        {
+            std::lock_guard<std::mutex> callLock(CallMutex);
+            std::lock_guard<std::mutex> lock(PoolMutex);
+            Stopping = true;
+        }
+        WorkAvailable.notify_all();
+
+        for (auto& worker : Workers)
+            worker.join();
+
+        Workers.clear();
+    }
+
+    void ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t first, size_t last, size_t batch)>& work)
+    {
+        Batches batches;
+        batches.Work = &work;
+        batches.Count = count;
+        batches.BatchSize = batchSize;
+        batches.BatchCount = GetBatchCount(count, batchSize);
+
+        if (batches.BatchCount == 0)
+            return;
+
+        // nothing to share, or the workers are busy with someone else's batches
+        std::unique_lock<std::mutex> callLock(CallMutex, std::defer_lock);
+        if (batches.BatchCount == 1 || Workers.empty() || InBatch || !callLock.try_lock())
+        {
+            bool wasInBatch = InBatch;
+            RunBatches(batches);
+            InBatch = wasInBatch;
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(PoolMutex);
+            Current = &batches;
+            Generation++;
+        }
+        WorkAvailable.notify_all();
+
+        RunBatches(batches);
+
+        // every batch has been taken, once the workers that took one are finished nothing points at the batches any more
+        std::unique_lock<std::mutex> lock(PoolMutex);
+        Current = nullptr;
+        WorkFinished.wait(lock, []() { return ActiveWorkers == 0; });
+    }
+};
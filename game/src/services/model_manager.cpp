@@ -1,9 +1,14 @@
 #include "services/model_manager.h"
+#include "services/async_loader.h"
+#include "services/resource_cache.h"
 #include "services/table_manager.h"
 #include "services/resource_manager.h"
+#include "services/texture_manager.h"
+#include "services/global_vars.h"
 #include "components/transform_component.h"
 
 #include "utilities/mesh_utils.h"
+#include "utilities/pack_format.h"
 #include "utilities/string_utils.h"
 
 #include "model.h"
@@ -11,6 +16,7 @@
 #include "rlgl.h"
 #include "raymath.h"
 
+#include <algorithm>
 #include <unordered_map>
 #include <string>
 
@@ -22,54 +28,59 @@ BoundingBox ModelRecord::GetBounds()
     return Bounds;
 }
 
-std::shared_ptr<ModelInstance> ModelRecord::GetModelInstance()
+ModelRecord::~ModelRecord()
 {
-    ReferenceCount++;
-    return std::make_shared<ModelInstance>(this);
+    // the upload referenced the textures of the groups
+    if (!Ready)
+        return;
+
+    for (const auto& group : ModelGeometry.Groups)
+        TextureManager::ReleaseTexture(group.TextureName);
 }
 
-void ModelRecord::ReleaseInstance()
+void ModelRecord::GeometryChanged()
 {
-    ReferenceCount--;
+    Generation++;
+    BoundsValid = false;
+}
 
-    if (ReferenceCount == 0)
-    {
-        // we could destroy this mesh
-    }
+void ModelRecord::AddInstance()
+{
+    if (Cache)
+        Cache->AddReference(CacheKey);
+}
+
+void ModelRecord::ReleaseInstance()
+{
+    if (Cache)
+        Cache->ReleaseReference(CacheKey);
 }
 
 void ModelRecord::CheckBounds()
 {
-    if (BoundsValid)
+    if (BoundsValid || !Ready)
         return;
 
     if (!ModelGeometry.Groups.empty())
     {
-        Vector3 temp = { 0 };
-        for (auto& group : ModelGeometry.Groups)
-        {
-            for (auto& mesh : group.Meshes)
-            {
-                if (!BoundsValid)
-                {
-                    Bounds = GetMeshBoundingBox(mesh.Geometry);
-                    BoundsValid = true;
-                    break;
-                }
-                BoundingBox tempBounds = GetMeshBoundingBox(mesh.Geometry);
+        Bounds = ModelGeometry.GetBounds();
+        BoundsValid = true;
+    }
+}
 
-                temp.x = (Bounds.min.x < tempBounds.min.x) ? Bounds.min.x : tempBounds.min.x;
-                temp.y = (Bounds.min.y < tempBounds.min.y) ? Bounds.min.y : tempBounds.min.y;
-                temp.z = (Bounds.min.z < tempBounds.min.z) ? Bounds.min.z : tempBounds.min.z;
-                Bounds.min = temp;
+const Models::AnimatableBoneLOD& AnimatedModelRecord::GetBoneLOD(int maxDepth)
+{
+    auto itr = BoneLODs.find(maxDepth);
+    if (itr != BoneLODs.end())
+        return itr->second;
 
-                temp.x = (Bounds.max.x > tempBounds.max.x) ? Bounds.max.x : tempBounds.max.x;
-                temp.y = (Bounds.max.y > tempBounds.max.y) ? Bounds.max.y : tempBounds.max.y;
-                temp.z = (Bounds.max.z > tempBounds.max.z) ? Bounds.max.z : tempBounds.max.z;
-                Bounds.max = temp;
-            }
-        }
-    }
+    return BoneLODs.insert_or_assign(maxDepth, Models::BuildBoneLOD(ModelGeometry, maxDepth)).first->second;
+}
+
+void AnimatedModelRecord::GeometryChanged()
+{
+    ModelRecord::GeometryChanged();
+    BoneLODs.clear();
 }
 
 ModelInstance::~ModelInstance()
@@ -82,6 +93,9 @@ static Matrix ModelIdentity = MatrixScale(1,1,1);
 
 void ModelInstance::Draw(TransformComponent& transform)
 {
+    if (!CheckGeometry())
+        return;
+
     rlPushMatrix();
     rlTranslatef(transform.Position.x, transform.Position.y, transform.Position.z);
     rlRotatef(transform.GetFacing(), 0, 0, 1);
@@ -93,39 +107,115 @@ void ModelInstance::Draw(TransformComponent& transform)
 
 void ModelInstance::SetShader(Shader shader)
 {
+    OverrideShader = shader;
+
     for (auto& mat : MaterialOverrides)
         mat.shader = shader;
 }
 
-ModelInstance::ModelInstance(ModelRecord* geometry)
-    :Geometry(geometry)
+bool ModelInstance::CheckGeometry()
 {
-    if (geometry)
+    if (GeometryReady && GeometryGeneration == Geometry->Generation)
+        return true;
+
+    if (!Geometry || !Geometry->Ready)
+        return false;
+
+    // the geometry was reloaded, the materials were copied from the old one
+    if (GeometryReady)
     {
-        for (auto& group : geometry->ModelGeometry.Groups)
-        {
-            MaterialOverrides.push_back(LoadMaterialDefault());
-            MaterialOverrides.back().shader = group.GroupMaterial.shader;
+        for (auto& material : MaterialOverrides)
+            MemFree(material.maps);
+        MaterialOverrides.clear();
+    }
 
-            for (int i = 0; i < 12; i++)
-            {
-                MaterialOverrides.back().maps[i].texture = group.GroupMaterial.maps[i].texture;
-                MaterialOverrides.back().maps[i].color = group.GroupMaterial.maps[i].color;
-            }
+    // set first, the setup can call back into things that check it
+    GeometryReady = true;
+    GeometryGeneration = Geometry->Generation;
+    OnGeometryReady();
+    return true;
+}
+
+void ModelInstance::OnGeometryReady()
+{
+    for (auto& group : Geometry->ModelGeometry.Groups)
+    {
+        MaterialOverrides.push_back(LoadMaterialDefault());
+        MaterialOverrides.back().shader = group.GroupMaterial.shader;
+
+        for (int i = 0; i < 12; i++)
+        {
+            MaterialOverrides.back().maps[i].texture = group.GroupMaterial.maps[i].texture;
+            MaterialOverrides.back().maps[i].color = group.GroupMaterial.maps[i].color;
         }
     }
+
+    if (OverrideShader.id != 0)
+        SetShader(OverrideShader);
+}
+
+ModelInstance::ModelInstance(ModelRecord* geometry)
+    :Geometry(geometry)
+{
+    if (Geometry)
+        Geometry->AddInstance();
+
+    // only sets up the base part, derived instances finish their own setup in their constructor
+    CheckGeometry();
 }
 
 AnimatedModelInstance::AnimatedModelInstance(AnimatedModelRecord* geometry)
     : ModelInstance(geometry)
     , AnimatedModel(geometry)
 {
+    if (GeometryReady)
+        CurrentPose = Models::GetDefaultPose(Geometry->ModelGeometry);
+}
+
+void AnimatedModelInstance::OnGeometryReady()
+{
+    ModelInstance::OnGeometryReady();
+
+    // after a reload the sequence is in the old animations, so start the same one again from the same frame
+    if (CurrentAnimaton != nullptr)
+    {
+        PendingSequence = CurrentSequenceName;
+        PendingStartFrame = CurrentFrame;
+
+        CurrentAnimaton = nullptr;
+        SharedPose = nullptr;
+        PoseValid = false;
+    }
+
     CurrentPose = Models::GetDefaultPose(Geometry->ModelGeometry);
+
+    if (!PendingSequence.empty())
+    {
+        std::string sequence = std::move(PendingSequence);
+        PendingSequence.clear();
+        SetSequence(sequence, PendingStartFrame);
+    }
 }
 
 void AnimatedModelInstance::Advance(float dt)
 {
-    if (CurrentAnimaton == nullptr)
+    AdvanceTime(dt);
+    UpdatePose(-1);
+}
+
+void AnimatedModelInstance::Advance(float dt, const AnimationLOD& lod)
+{
+    AdvanceTime(dt);
+
+    if (PoseValid && PoseAge < lod.UpdateInterval)
+        return;
+
+    UpdatePose(lod.MaxBoneDepth);
+}
+
+void AnimatedModelInstance::AdvanceTime(float dt)
+{
+    if (!CheckGeometry() || CurrentAnimaton == nullptr)
         return;
 
     float animFrameTime = 1.0f / AnimationFPS;
@@ -144,16 +234,43 @@ void AnimatedModelInstance::Advance(float dt)
 
     CurrentParam = AnimationAccumulator / animFrameTime;
 
+    PoseAge += dt;
+}
+
+void AnimatedModelInstance::UpdatePose(int maxBoneDepth)
+{
+    if (CurrentAnimaton == nullptr)
+        return;
+
+    PoseAge = 0;
+    PoseValid = true;
+
     int lastFrame = CurrentFrame - 1;
     if (lastFrame < 0)
         lastFrame = int(CurrentAnimaton->Frames.size()) - 1;
 
-    Models::InterpolatePose(Geometry->ModelGeometry, CurrentPose, CurrentAnimaton->Frames[lastFrame], CurrentAnimaton->Frames[CurrentFrame], CurrentParam);
+    const Models::AnimatableBoneLOD* lod = maxBoneDepth >= 0 ? &AnimatedModel->GetBoneLOD(maxBoneDepth) : nullptr;
+
+    // a shared baked pose is cheaper than even a reduced skeleton, the cache keeps the reduced poses apart from the full ones
+    auto& poseCache = ModelManager::GetPoseCache();
+    if (poseCache.IsEnabled())
+    {
+        SharedPose = poseCache.GetPose(Geometry->ModelGeometry, *CurrentAnimaton, lastFrame, CurrentParam, lod);
+        if (SharedPose)
+            return;
+    }
+
+    SharedPose = nullptr;
+
+    if (lod)
+        Models::InterpolateReducedPose(Geometry->ModelGeometry, CurrentPose, *CurrentAnimaton, lastFrame, CurrentFrame, CurrentParam, *lod);
+    else
+        Models::InterpolatePackedPose(Geometry->ModelGeometry, CurrentPose, *CurrentAnimaton, lastFrame, CurrentFrame, CurrentParam);
 }
 
 void AnimatedModelInstance::Draw(class TransformComponent& transform)
 {
-    if (CurrentAnimaton == nullptr)
+    if (!CheckGeometry() || CurrentAnimaton == nullptr)
         return;
 
     rlPushMatrix();
@@ -161,21 +278,30 @@ void AnimatedModelInstance::Draw(class TransformComponent& transform)
     rlRotatef(transform.GetFacing(), 0, 0, 1);
     rlMultMatrixf(MatrixToFloatV(Geometry->OrientationTransform).v);
 
-    Models::DrawAnimatableModel(Geometry->ModelGeometry, ModelIdentity, &CurrentPose, &MaterialOverrides);
+    Models::DrawAnimatableModel(Geometry->ModelGeometry, ModelIdentity, SharedPose ? SharedPose.get() : &CurrentPose, &MaterialOverrides);
 
     rlPopMatrix();
 }
 
 void AnimatedModelInstance::SetSequence(const std::string& name, int startFrame)
 {
+    if (!CheckGeometry())
+    {
+        PendingSequence = name;
+        PendingStartFrame = startFrame;
+        return;
+    }
+
     auto itr = AnimatedModel->Animations.Sequences.find(name);
     if (itr == AnimatedModel->Animations.Sequences.end())
         return;
 
 
     CurrentAnimaton = &(itr->second);
+    CurrentSequenceName = name;
     CurrentFrame = startFrame % CurrentAnimaton->Frames.size();
     AnimationAccumulator = 0;
+    PoseValid = false;
 }
 
 namespace ModelManager
@@ -184,37 +310,323 @@ namespace ModelManager
 
     std::shared_ptr<AnimatedModelRecord> DefaultModel;
 
-    std::unordered_map<std::string, std::shared_ptr<ModelRecord>> ModelCache;
-    std::unordered_map<std::string, std::shared_ptr<AnimatedModelRecord>> AnimatedModelCache;
+    static std::hash<std::string_view> StringHasher;
+
+    std::unordered_map<size_t, std::shared_ptr<ModelRecord>> ModelCache;
+    std::unordered_map<size_t, std::shared_ptr<AnimatedModelRecord>> AnimatedModelCache;
+
+    Models::AnimationPoseCache PoseCache;
+
+    // models no instance uses are kept until the budgets need the room
+    static ResourceCache ModelRecordCache("models", [](size_t key) { ModelCache.erase(key); }, 64 * 1024 * 1024, 128 * 1024 * 1024);
+
+    static ResourceCache AnimatedModelRecordCache("animated_models", [](size_t key)
+        {
+            // the pose cache is keyed by the sequences in the records
+            PoseCache.Clear();
+            AnimatedModelCache.erase(key);
+        }, 64 * 1024 * 1024, 128 * 1024 * 1024);
+
+    // the bytes of vertex data a mesh has on the CPU side
+    static size_t GetMeshDataSize(const Mesh& mesh)
+    {
+        size_t vertexSize = 0;
+        if (mesh.vertices)
+            vertexSize += sizeof(float) * 3;
+        if (mesh.texcoords)
+            vertexSize += sizeof(float) * 2;
+        if (mesh.normals)
+            vertexSize += sizeof(float) * 3;
+        if (mesh.colors)
+            vertexSize += sizeof(unsigned char) * 4;
+        if (mesh.boneWeights)
+            vertexSize += sizeof(float) * 4;
+        if (mesh.boneIds)
+            vertexSize += sizeof(unsigned char) * 4;
+
+        size_t size = vertexSize * mesh.vertexCount;
+        if (mesh.indices)
+            size += sizeof(unsigned short) * 3 * mesh.triangleCount;
+
+        return size;
+    }
+
+    static size_t GetModelDataSize(const Models::AnimateableModel& model)
+    {
+        size_t size = 0;
+        for (const auto& group : model.Groups)
+        {
+            for (const auto& mesh : group.Meshes)
+                size += GetMeshDataSize(mesh.Geometry);
+        }
+
+        return size;
+    }
+
+    static size_t GetAnimationDataSize(const Models::AnimationSet& animations)
+    {
+        size_t size = 0;
+        for (const auto& [name, sequence] : animations.Sequences)
+        {
+            for (const auto& frame : sequence.Frames)
+                size += frame.GlobalTransforms.size() * sizeof(Transform);
+
+            size += sequence.PackedFrames.Data.size() * sizeof(float);
+        }
+
+        return size;
+    }
+
+    // sorted by distance, the last level has no distance limit
+    std::vector<AnimationLOD> AnimationLODs = { AnimationLOD() };
+
+    void LoadAnimationLODs(const Table* lodTable)
+    {
+        if (!lodTable)
+            return;
+
+        // each level is distance:updates per second:max bone depth
+        std::vector<AnimationLOD> levels;
+        for (const auto& [key, value] : *lodTable)
+        {
+            auto parts = lodTable->SplitField(key, ":");
+            if (parts.empty())
+                continue;
+
+            AnimationLOD& level = levels.emplace_back();
+            level.MaxDistance = float(atof(parts[0].c_str()));
+
+            if (parts.size() > 1)
+            {
+                float rate = float(atof(parts[1].c_str()));
+                level.UpdateInterval = rate > 0 ? 1.0f / rate : 0;
+            }
+
+            if (parts.size() > 2)
+                level.MaxBoneDepth = atoi(parts[2].c_str());
+        }
+
+        if (levels.empty())
+            return;
+
+        std::sort(levels.begin(), levels.end(), [](const AnimationLOD& a, const AnimationLOD& b)
+            {
+                if (a.MaxDistance <= 0 || b.MaxDistance <= 0)
+                    return b.MaxDistance <= 0 && a.MaxDistance > 0;
+                return a.MaxDistance < b.MaxDistance;
+            });
+
+        levels.back().MaxDistance = 0;
+        AnimationLODs = levels;
+    }
+
+    const AnimationLOD& GetAnimationLOD(float distance)
+    {
+        for (const auto& level : AnimationLODs)
+        {
+            if (level.MaxDistance <= 0 || distance <= level.MaxDistance * GlobalVars::AnimationLODScale)
+                return level;
+        }
+
+        return AnimationLODs.back();
+    }
+
+    Models::AnimationPoseCache& GetPoseCache()
+    {
+        return PoseCache;
+    }
+
+    float GetPoseKernelError(int samplesPerFrame)
+    {
+        float maxError = 0;
+        for (auto& [name, record] : AnimatedModelCache)
+        {
+            if (!record->Ready)
+                continue;
+
+            // every sequence wraps back to its first frame when it plays, so that pair is checked too
+            for (auto& [sequenceName, sequence] : record->Animations.Sequences)
+                maxError = std::max(maxError, Models::GetPackedPoseError(record->ModelGeometry, sequence, samplesPerFrame, true));
+        }
+
+        return maxError;
+    }
+
+    int RunReaderChecks(std::vector<std::string>& failures)
+    {
+        int failed = Models::RunBinaryReaderChecks(failures);
+
+        // a model and its animations can be shared by several records, each file is checked once
+        std::vector<std::pair<std::string, bool>> files;
+        auto addFile = [&files](const std::string& file, bool animationFile)
+            {
+                if (!file.empty() && std::find(files.begin(), files.end(), std::make_pair(file, animationFile)) == files.end())
+                    files.emplace_back(file, animationFile);
+            };
+
+        for (auto& [hash, record] : ModelCache)
+        {
+            if (record->Ready)
+                addFile(record->SourceFile, false);
+        }
+
+        for (auto& [hash, record] : AnimatedModelCache)
+        {
+            if (!record->Ready)
+                continue;
+
+            addFile(record->SourceFile, false);
+            addFile(record->AnimationFile, true);
+        }
+
+        for (const auto& [file, animationFile] : files)
+        {
+            auto resource = ResourceManager::MapResource(file);
+            if (!resource)
+                continue;
+
+            failed += Models::RunFileReaderChecks(resource->DataBuffer, resource->DataSize, animationFile, file, failures);
+            ResourceManager::ReleaseResource(resource);
+        }
+
+        return failed;
+    }
+
+    // the part of a model load done on a loader thread, handed to the upload step
+    struct ModelLoadState
+    {
+        // the vertex data is uploaded straight out of the mapped file, so it stays open until the upload is done
+        std::shared_ptr<ResoureInfo> Resource;
+
+        // the textures the materials use, decoded along with the model so it is ready in one upload
+        std::vector<std::pair<std::string, Image>> Textures;
+
+        bool Valid = false;
+        std::string Error;
+        std::string AnimationError;
+
+        // every stream is sent to the GPU, so this is measured before the upload drops any of them
+        size_t GPUBytes = 0;
+    };
+
+    // an animation file made for another skeleton would index past its frames, so those sequences are dropped
+    static void DropMismatchedSequences(const Models::AnimateableModel& model, Models::AnimationSet& animations, const std::string& animFile)
+    {
+        for (const auto& name : Models::RemoveMismatchedSequences(model, animations))
+            TraceLog(LOG_WARNING, "MODEL: Skipping animation %s in %s, its bone count doesn't match the model", name.c_str(), animFile.c_str());
+    }
+
+    static void QueueModelLoad(std::shared_ptr<ModelRecord> record, const std::string& file, const std::string& animFile, Models::AnimationSet* animations)
+    {
+        auto state = std::make_shared<ModelLoadState>();
+
+        AsyncLoader::QueueLoad([record, state, file, animFile, animations]()
+            {
+                state->Resource = ResourceManager::MapResource(file);
+                if (!state->Resource)
+                {
+                    state->Error = "unable to open file";
+                    return;
+                }
+
+                Models::BinaryReader reader(state->Resource->DataBuffer, state->Resource->DataSize);
+                state->Valid = record->ModelGeometry.Read(reader, true);
+                if (!state->Valid)
+                {
+                    state->Error = reader.GetError();
+                    return;
+                }
+
+                state->GPUBytes = GetModelDataSize(record->ModelGeometry);
+
+                for (const auto& group : record->ModelGeometry.Groups)
+                {
+                    if (group.TextureName.empty())
+                        continue;
+
+                    auto itr = std::find_if(state->Textures.begin(), state->Textures.end(), [&group](const auto& texture) { return texture.first == group.TextureName; });
+                    if (itr == state->Textures.end())
+                        state->Textures.emplace_back(group.TextureName, TextureManager::DecodeTexture(group.TextureName));
+                }
+
+                if (!animations || animFile.empty())
+                    return;
+
+                // the sequences are decoded into their own memory, so the file only needs to be mapped while reading
+                auto animResource = ResourceManager::MapResource(animFile);
+                if (!animResource)
+                    return;
+
+                Models::BinaryReader animReader(animResource->DataBuffer, animResource->DataSize);
+                if (!animations->Read(animReader))
+                    state->AnimationError = animReader.GetError();
+
+                ResourceManager::ReleaseResource(animResource);
+            },
+            [record, state, file, animFile, animations]()
+            {
+                if (state->Valid)
+                {
+                    for (auto& [name, image] : state->Textures)
+                        TextureManager::AddTexture(name, image);
+
+                    record->ModelGeometry.Upload();
+
+                    if (animations)
+                        DropMismatchedSequences(record->ModelGeometry, *animations, animFile);
+
+                    record->Ready = true;
+
+                    size_t cpuBytes = GetModelDataSize(record->ModelGeometry);
+                    if (animations)
+                        cpuBytes += GetAnimationDataSize(*animations);
+
+                    // an unused record can be evicted while it loads, then it is no longer in the cache and this does nothing
+                    if (record->Cache)
+                        record->Cache->SetSize(record->CacheKey, cpuBytes, state->GPUBytes);
+                }
+                else
+                {
+                    TraceLog(LOG_WARNING, "MODEL: Unable to read %s, %s", file.c_str(), state->Error.c_str());
+                }
+
+                if (!state->AnimationError.empty())
+                    TraceLog(LOG_WARNING, "MODEL: Unable to read animations %s, %s", animFile.c_str(), state->AnimationError.c_str());
+
+                ResourceManager::ReleaseResource(state->Resource);
+            });
+    }
 
     ModelRecord* FindModel(std::string_view name, std::string_view file)
     {
-        std::string nameRecord(name);
+        size_t hash = StringHasher(name);
 
-        auto itr = ModelCache.find(nameRecord);
+        auto itr = ModelCache.find(hash);
         if (itr != ModelCache.end())
             return itr->second.get();
 
-        auto resource = ResourceManager::OpenResource(file);
-        if (!resource)
+        if (!ResourceManager::HasResource(file))
             return DefaultModel.get();
 
+        // the record is handed out right away and fills in when the load is done
         auto modelRecord = std::make_shared<ModelRecord>();
+        modelRecord->Cache = &ModelRecordCache;
+        modelRecord->CacheKey = hash;
+        modelRecord->SourceFile = file;
 
-        modelRecord->ModelGeometry.Read(resource->DataBuffer, resource->DataSize);
-        ResourceManager::ReleaseResource(resource);
+        ModelCache.insert_or_assign(hash, modelRecord);
+        ModelRecordCache.Add(hash, 0);
 
-        modelRecord->ModelGeometry.Upload();
+        QueueModelLoad(modelRecord, std::string(file), std::string(), nullptr);
 
-        ModelCache.insert_or_assign(nameRecord, modelRecord);
         return modelRecord.get();
     }
 
     AnimatedModelRecord* FindAnimModel(std::string_view name, std::string_view record)
     {
-        std::string nameRecord(name);
+        size_t hash = StringHasher(name);
 
-        auto itr = AnimatedModelCache.find(nameRecord);
+        auto itr = AnimatedModelCache.find(hash);
         if (itr != AnimatedModelCache.end())
             return itr->second.get();
 
@@ -225,28 +637,20 @@ namespace ModelManager
         if (parts.size() > 1)
             anim = parts[1];
 
-        auto resource = ResourceManager::OpenResource(file);
-        if (!resource)
+        if (!ResourceManager::HasResource(file))
             return DefaultModel.get();
 
         auto modelRecord = std::make_shared<AnimatedModelRecord>();
+        modelRecord->Cache = &AnimatedModelRecordCache;
+        modelRecord->CacheKey = hash;
+        modelRecord->SourceFile = file;
+        modelRecord->AnimationFile = anim;
 
-        modelRecord->ModelGeometry.Read(resource->DataBuffer, resource->DataSize);
-        ResourceManager::ReleaseResource(resource);
+        AnimatedModelCache.insert_or_assign(hash, modelRecord);
+        AnimatedModelRecordCache.Add(hash, 0);
 
-        if (!anim.empty())
-        {
-            resource = ResourceManager::OpenResource(anim);
-            if (resource)
-            {
-                modelRecord->Animations.Read(resource->DataBuffer, resource->DataSize);
-                ResourceManager::ReleaseResource(resource);
-            }
-        }
-
-        modelRecord->ModelGeometry.Upload();
+        QueueModelLoad(modelRecord, file, anim, &modelRecord->Animations);
 
-        AnimatedModelCache.insert_or_assign(nameRecord, modelRecord);
         return modelRecord.get();
     }
 
@@ -258,8 +662,19 @@ namespace ModelManager
         Model tempModel = LoadModelFromMesh(GenMeshCube(0.5f, 0.5f, 0.5f));
         Models::LoadFromModel(DefaultModel->ModelGeometry, tempModel);
         DefaultModel->ModelGeometry.Groups[0].GroupMaterial.maps[MATERIAL_MAP_ALBEDO].color = MAGENTA;
+        DefaultModel->Ready = true;
+
+        auto* bootstrap = TableManager::GetTable(BootstrapTable);
+        ModelManifestTable = bootstrap->GetFieldAsTable("model_manifest");
+
+        if (bootstrap->HasField("animation_cache_samples"))
+            PoseCache.SetSamplesPerFrame(atoi(bootstrap->GetField("animation_cache_samples").data()));
 
-        ModelManifestTable = TableManager::GetTable(BootstrapTable)->GetFieldAsTable("model_manifest");
+        if (bootstrap->HasField("animation_cache_budget_kb"))
+            PoseCache.SetMemoryBudget(size_t(atoi(bootstrap->GetField("animation_cache_budget_kb").data())) * 1024);
+
+        if (bootstrap->HasField("animation_lod"))
+            LoadAnimationLODs(bootstrap->GetFieldAsTable("animation_lod"));
 
         if (ModelManifestTable && PreloadModels)
         {
@@ -281,7 +696,7 @@ namespace ModelManager
 
         std::string nameRecord(name);
 
-        auto itr = ModelCache.find(nameRecord);
+        auto itr = ModelCache.find(StringHasher(name));
         if (itr != ModelCache.end())
         {
             model = itr->second.get();
@@ -304,7 +719,7 @@ namespace ModelManager
 
         std::string nameRecord(name);
 
-        auto itr = AnimatedModelCache.find(nameRecord);
+        auto itr = AnimatedModelCache.find(StringHasher(name));
         if (itr != AnimatedModelCache.end())
         {
             model = itr->second.get();
@@ -323,7 +738,153 @@ namespace ModelManager
 
     void UnloadAll()
     {
+        // nothing can still be loading into the records
+        AsyncLoader::CompleteAll();
+
+        // the cache holds pointers to the sequences in the records
+        PoseCache.Clear();
+
         ModelCache.clear();
         AnimatedModelCache.clear();
+
+        ModelRecordCache.Clear();
+        AnimatedModelRecordCache.Clear();
+    }
+
+    // reads a loaded model again on this thread, the new file is checked before the old geometry is dropped
+    static bool ReloadModelRecord(ModelRecord& record, Models::AnimationSet* animations, bool reloadGeometry)
+    {
+        size_t gpuBytes = record.Cache ? record.Cache->GetGPUBytes(record.CacheKey) : 0;
+
+        if (reloadGeometry)
+        {
+            auto resource = ResourceManager::MapResource(record.SourceFile);
+            if (!resource)
+            {
+                TraceLog(LOG_WARNING, "MODEL: Unable to reload %s, unable to open file", record.SourceFile.c_str());
+                return false;
+            }
+
+            {
+                Models::AnimateableModel check;
+                Models::BinaryReader checkReader(resource->DataBuffer, resource->DataSize);
+                if (!check.Read(checkReader, true))
+                {
+                    TraceLog(LOG_WARNING, "MODEL: Unable to reload %s, %s", record.SourceFile.c_str(), checkReader.GetError().c_str());
+                    ResourceManager::ReleaseResource(resource);
+                    return false;
+                }
+            }
+
+            // the old textures are released after the new ones are acquired, so a texture both use is never evicted in between
+            std::vector<std::string> oldTextures;
+            for (const auto& group : record.ModelGeometry.Groups)
+                oldTextures.push_back(group.TextureName);
+
+            record.ModelGeometry.Unload();
+
+            Models::BinaryReader reader(resource->DataBuffer, resource->DataSize);
+            record.ModelGeometry.Read(reader, true);
+
+            gpuBytes = GetModelDataSize(record.ModelGeometry);
+            record.ModelGeometry.Upload();
+
+            for (const auto& texture : oldTextures)
+                TextureManager::ReleaseTexture(texture);
+
+            ResourceManager::ReleaseResource(resource);
+        }
+
+        if (animations && !record.AnimationFile.empty())
+        {
+            auto animResource = ResourceManager::MapResource(record.AnimationFile);
+            if (animResource)
+            {
+                Models::AnimationSet newAnimations;
+                Models::BinaryReader animReader(animResource->DataBuffer, animResource->DataSize);
+                if (newAnimations.Read(animReader))
+                    animations->Sequences = std::move(newAnimations.Sequences);
+                else
+                    TraceLog(LOG_WARNING, "MODEL: Unable to reload animations %s, %s", record.AnimationFile.c_str(), animReader.GetError().c_str());
+
+                ResourceManager::ReleaseResource(animResource);
+            }
+        }
+
+        if (record.Cache)
+        {
+            size_t cpuBytes = GetModelDataSize(record.ModelGeometry);
+            if (animations)
+                cpuBytes += GetAnimationDataSize(*animations);
+
+            record.Cache->SetSize(record.CacheKey, cpuBytes, gpuBytes);
+        }
+
+        record.GeometryChanged();
+
+        TraceLog(LOG_INFO, "MODEL: Reloaded %s", record.SourceFile.c_str());
+        return true;
+    }
+
+    bool ReloadModels(std::string_view fileName)
+    {
+        std::string file = PackFormat::NormalizePath(fileName);
+
+        bool reloaded = false;
+
+        // records still loading read the new file anyway
+        for (auto& [hash, record] : ModelCache)
+        {
+            if (record->Ready && PackFormat::NormalizePath(record->SourceFile) == file)
+                reloaded |= ReloadModelRecord(*record, nullptr, true);
+        }
+
+        for (auto& [hash, record] : AnimatedModelCache)
+        {
+            if (!record->Ready)
+                continue;
+
+            bool geometry = PackFormat::NormalizePath(record->SourceFile) == file;
+            bool animations = !record->AnimationFile.empty() && PackFormat::NormalizePath(record->AnimationFile) == file;
+
+            if (!geometry && !animations)
+                continue;
+
+            if (ReloadModelRecord(*record, animations ? &record->Animations : nullptr, geometry))
+            {
+                // new geometry can change the skeleton under the sequences that were already loaded
+                DropMismatchedSequences(record->ModelGeometry, record->Animations, record->AnimationFile);
+                reloaded = true;
+            }
+        }
+
+        // the baked poses are keyed by the old geometry and sequences
+        if (reloaded)
+            PoseCache.Clear();
+
+        return reloaded;
+    }
+
+    static void RefreshRecordTextures(ModelRecord& record)
+    {
+        if (!record.Ready)
+            return;
+
+        // resolving acquires every texture again, so the references from the first time are given back
+        record.ModelGeometry.ResolveTextures();
+
+        for (const auto& group : record.ModelGeometry.Groups)
+            TextureManager::ReleaseTexture(group.TextureName);
+
+        record.GeometryChanged();
+    }
+
+    void RefreshTextures()
+    {
+        for (auto& [hash, record] : ModelCache)
+            RefreshRecordTextures(*record);
+
+        for (auto& [hash, record] : AnimatedModelCache)
+            RefreshRecordTextures(*record);
     }
-};
+};
\ No newline at end of file
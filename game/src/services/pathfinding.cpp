@@ -0,0 +1,509 @@
+#include "services/pathfinding.h"
+
+#include "raylib.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+namespace Pathfinding
+{
+    // a mob on a big open map asking for a cell it can't reach would search the whole map without this
+    static constexpr size_t MaxRequestExpansions = 250000;
+
+    struct PathRequest
+    {
+        PathQuery Query;
+        PathStatus Status = PathStatus::Pending;
+        std::vector<MapCoordinate> Points;
+    };
+
+    // the requests, the queue and the grid pointer are guarded by the one mutex
+    static std::mutex RequestMutex;
+    static std::condition_variable RequestAvailable;
+
+    static std::unordered_map<RequestID, PathRequest> Requests;
+    static std::deque<RequestID> RequestQueue;
+    static RequestID NextRequestID = 1;
+
+    // searches that are running hold a reference, so setting a new map doesn't pull the grid out from under them
+    static std::shared_ptr<const NavigationGrid> CurrentGrid;
+
+    static std::thread Worker;
+    static bool Stopping = false;
+
+    // the flow field gets its own thread, so a new field never waits behind a long search
+    static std::thread FlowWorker;
+    static std::condition_variable FlowTargetAvailable;
+
+    // the worker and the main thread each keep their own node memory
+    static PathFinder WorkerFinder;
+    static PathFinder MainFinder;
+
+    struct DoorChange
+    {
+        MapCoordinate Cell;
+        bool Open = false;
+    };
+
+    // door changes wait here for the next search to apply them, guarded by the mutex
+    static std::vector<DoorChange> DoorChanges;
+
+    // only the thread doing the searches uses the graphs, the grid they were made for is held until the next one replaces it
+    static std::shared_ptr<const NavigationGrid> GraphGrid;
+    static HierarchicalGraph WalkingGraph;
+    static HierarchicalGraph DoorStateGraph;
+
+    // mobs further than this from the player don't get a flow field to follow
+    static constexpr int FlowFieldRadius = 32;
+
+    // the flow target and the published field are guarded by the mutex
+    static MapCoordinate FlowTarget;
+    static bool HasFlowTarget = false;
+    static bool FlowTargetChanged = false;
+    static std::shared_ptr<FlowField> CurrentFlowField;
+
+    // the field before the current one, its buffers are built into again once nothing holds it
+    static std::shared_ptr<FlowField> SpareFlowField;
+
+    // builds the field for the current target and publishes it, call with the mutex unlocked
+    static void UpdateFlowField()
+    {
+        MapCoordinate target;
+        std::shared_ptr<const NavigationGrid> grid;
+        std::shared_ptr<FlowField> field;
+        {
+            std::lock_guard<std::mutex> lock(RequestMutex);
+            FlowTargetChanged = false;
+            target = FlowTarget;
+            grid = CurrentGrid;
+
+            if (SpareFlowField && SpareFlowField.use_count() == 1)
+                field = std::move(SpareFlowField);
+        }
+
+        if (!grid)
+            return;
+
+        if (!field)
+            field = std::make_shared<FlowField>();
+
+        field->Build(*grid, target, FlowFieldRadius);
+
+        std::lock_guard<std::mutex> lock(RequestMutex);
+        SpareFlowField = std::move(CurrentFlowField);
+        CurrentFlowField = std::move(field);
+    }
+
+    static bool Search(const PathQuery& query, PathFinder& finder, PathSearchResult& result)
+    {
+        std::shared_ptr<const NavigationGrid> grid;
+        std::vector<DoorChange> doorChanges;
+        {
+            std::lock_guard<std::mutex> lock(RequestMutex);
+            grid = CurrentGrid;
+            doorChanges.swap(DoorChanges);
+        }
+
+        if (!grid)
+        {
+            result = PathSearchResult();
+            return false;
+        }
+
+        if (GraphGrid != grid)
+        {
+            GraphGrid = grid;
+            WalkingGraph.SetGrid(*grid, true);
+            DoorStateGraph.SetGrid(*grid, false);
+        }
+
+        for (const auto& change : doorChanges)
+            DoorStateGraph.SetDoorOpen(change.Cell.X, change.Cell.Y, change.Open);
+
+        if (query.Algorithm != PathAlgorithm::Hierarchical)
+            return finder.FindPath(*grid, query, result);
+
+        HierarchicalGraph& graph = query.OpenDoors ? WalkingGraph : DoorStateGraph;
+        return graph.FindPath(query.Start, query.Goal, result, query.MaxExpansions);
+    }
+
+    static void SetResult(RequestID request, bool found, std::vector<MapCoordinate>& points)
+    {
+        auto itr = Requests.find(request);
+
+        // canceled while it was searching
+        if (itr == Requests.end())
+            return;
+
+        itr->second.Status = found ? PathStatus::Found : PathStatus::NotFound;
+        itr->second.Points = std::move(points);
+    }
+
+    static void WorkerThread()
+    {
+        std::unique_lock<std::mutex> lock(RequestMutex);
+        PathSearchResult result;
+
+        while (true)
+        {
+            RequestAvailable.wait(lock, []() { return Stopping || !RequestQueue.empty(); });
+            if (Stopping)
+                return;
+
+            RequestID request = RequestQueue.front();
+            RequestQueue.pop_front();
+
+            auto itr = Requests.find(request);
+            if (itr == Requests.end())
+                continue;
+
+            PathQuery query = itr->second.Query;
+
+            lock.unlock();
+            bool found = Search(query, WorkerFinder, result);
+            lock.lock();
+
+            SetResult(request, found, result.Points);
+        }
+    }
+
+    static void FlowWorkerThread()
+    {
+        std::unique_lock<std::mutex> lock(RequestMutex);
+
+        while (true)
+        {
+            FlowTargetAvailable.wait(lock, []() { return Stopping || FlowTargetChanged; });
+            if (Stopping)
+                return;
+
+            // a target that moves again while this builds is picked up on the next pass
+            lock.unlock();
+            UpdateFlowField();
+            lock.lock();
+        }
+    }
+
+    void Init()
+    {
+        if (Worker.joinable())
+            return;
+
+        Stopping = false;
+        Worker = std::thread(WorkerThread);
+        FlowWorker = std::thread(FlowWorkerThread);
+    }
+
+    void Cleanup()
+    {
+        {
+            std::lock_guard<std::mutex> lock(RequestMutex);
+            Stopping = true;
+        }
+        RequestAvailable.notify_all();
+        FlowTargetAvailable.notify_all();
+
+        if (Worker.joinable())
+            Worker.join();
+
+        if (FlowWorker.joinable())
+            FlowWorker.join();
+
+        Requests.clear();
+        RequestQueue.clear();
+        DoorChanges.clear();
+        CurrentGrid.reset();
+
+        HasFlowTarget = false;
+        FlowTargetChanged = false;
+        CurrentFlowField.reset();
+        SpareFlowField.reset();
+
+        WalkingGraph.Clear();
+        DoorStateGraph.Clear();
+        GraphGrid.reset();
+    }
+
+    void SetMap(const Map& map)
+    {
+        auto grid = std::make_shared<NavigationGrid>();
+        grid->Build(map);
+
+        bool rebuildFlowField = false;
+        {
+            std::lock_guard<std::mutex> lock(RequestMutex);
+            CurrentGrid = grid;
+
+            // anything still waiting was asked about the old map
+            for (RequestID request : RequestQueue)
+            {
+                auto itr = Requests.find(request);
+                if (itr != Requests.end())
+                    itr->second.Status = PathStatus::NotFound;
+            }
+            RequestQueue.clear();
+
+            // the graphs start with the doors that are open as the map loads
+            DoorChanges.clear();
+            for (size_t door : map.DoorCells)
+            {
+                int x = int(door % size_t(map.Size.X));
+                int y = int(door / size_t(map.Size.X));
+                if (map.IsCellPassable(x, y))
+                    DoorChanges.push_back(DoorChange{ MapCoordinate{ x, y }, true });
+            }
+
+            CurrentFlowField.reset();
+            rebuildFlowField = HasFlowTarget;
+            FlowTargetChanged = HasFlowTarget;
+        }
+
+        if (rebuildFlowField && !FlowWorker.joinable())
+            UpdateFlowField();
+        else if (rebuildFlowField)
+            FlowTargetAvailable.notify_one();
+    }
+
+    void SetFlowTarget(const MapCoordinate& cell)
+    {
+        {
+            std::lock_guard<std::mutex> lock(RequestMutex);
+            if (HasFlowTarget && FlowTarget.X == cell.X && FlowTarget.Y == cell.Y)
+                return;
+
+            FlowTarget = cell;
+            HasFlowTarget = true;
+            FlowTargetChanged = true;
+        }
+
+        if (FlowWorker.joinable())
+            FlowTargetAvailable.notify_one();
+        else
+            UpdateFlowField();
+    }
+
+    std::shared_ptr<const FlowField> GetFlowField()
+    {
+        std::lock_guard<std::mutex> lock(RequestMutex);
+        return CurrentFlowField;
+    }
+
+    RequestID RequestPath(const MapCoordinate& start, const MapCoordinate& goal, bool openDoors, PathAlgorithm algorithm)
+    {
+        PathQuery query;
+        query.Start = start;
+        query.Goal = goal;
+        query.OpenDoors = openDoors;
+        query.Algorithm = algorithm;
+        query.MaxExpansions = MaxRequestExpansions;
+
+        // without a worker the search happens right away, the result is still picked up with GetPath
+        if (!Worker.joinable())
+        {
+            PathSearchResult result;
+            bool found = Search(query, MainFinder, result);
+
+            RequestID request = NextRequestID++;
+            PathRequest& pathRequest = Requests[request];
+            pathRequest.Query = query;
+            pathRequest.Status = found ? PathStatus::Found : PathStatus::NotFound;
+            pathRequest.Points = std::move(result.Points);
+            return request;
+        }
+
+        std::lock_guard<std::mutex> lock(RequestMutex);
+
+        RequestID request = NextRequestID++;
+        Requests[request].Query = query;
+        RequestQueue.push_back(request);
+        RequestAvailable.notify_one();
+
+        return request;
+    }
+
+    PathStatus GetPath(RequestID request, std::vector<MapCoordinate>& points)
+    {
+        std::lock_guard<std::mutex> lock(RequestMutex);
+
+        auto itr = Requests.find(request);
+        if (itr == Requests.end())
+            return PathStatus::Unknown;
+
+        PathStatus status = itr->second.Status;
+        if (status == PathStatus::Pending)
+            return status;
+
+        points = std::move(itr->second.Points);
+        Requests.erase(itr);
+
+        return status;
+    }
+
+    void CancelPath(RequestID request)
+    {
+        if (request == InvalidRequest)
+            return;
+
+        // the worker skips queued ids that are no longer in the table
+        std::lock_guard<std::mutex> lock(RequestMutex);
+        Requests.erase(request);
+    }
+
+    void SetDoorOpen(const MapCoordinate& cell, bool open)
+    {
+        std::lock_guard<std::mutex> lock(RequestMutex);
+        DoorChanges.push_back(DoorChange{ cell, open });
+    }
+
+    bool FindPathNow(const PathQuery& query, PathSearchResult& result)
+    {
+        std::shared_ptr<const NavigationGrid> grid;
+        {
+            std::lock_guard<std::mutex> lock(RequestMutex);
+            grid = CurrentGrid;
+        }
+
+        if (!grid)
+        {
+            result = PathSearchResult();
+            return false;
+        }
+
+        return MainFinder.FindPath(*grid, query, result);
+    }
+
+    static constexpr int BenchmarkRoomSize = 12;
+
+    // rooms on a grid, each wall between two rooms has one gap that is either a door or open, and the rooms are scattered with rubble
+    static void GenerateBenchmarkMap(Map& map, int size, std::mt19937& random)
+    {
+        map.SetSize(size, size);
+
+        std::uniform_int_distribution<int> gapPosition(1, BenchmarkRoomSize - 1);
+        std::uniform_int_distribution<int> percent(0, 99);
+
+        for (int y = 0; y < size; y++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                bool wall = (x % BenchmarkRoomSize) == 0 || (y % BenchmarkRoomSize) == 0;
+                if (wall || percent(random) < 3)
+                    map.GetCellRef(x, y).State = MapCellState::Wall;
+            }
+        }
+
+        for (int roomY = 0; roomY < size; roomY += BenchmarkRoomSize)
+        {
+            for (int roomX = 0; roomX < size; roomX += BenchmarkRoomSize)
+            {
+                MapCellState gapState = percent(random) < 30 ? MapCellState::Door : MapCellState::Empty;
+                map.GetCellRef(roomX + gapPosition(random), roomY).State = gapState;
+
+                gapState = percent(random) < 30 ? MapCellState::Door : MapCellState::Empty;
+                map.GetCellRef(roomX, roomY + gapPosition(random)).State = gapState;
+            }
+        }
+    }
+
+    static MapCoordinate GetRandomWalkableCell(const NavigationGrid& grid, std::mt19937& random)
+    {
+        std::uniform_int_distribution<int> coordinate(0, grid.GetSize().X - 1);
+
+        while (true)
+        {
+            MapCoordinate cell = { coordinate(random), coordinate(random) };
+            if (grid.IsWalkable(cell.X, cell.Y, true))
+                return cell;
+        }
+    }
+
+    BenchmarkReport RunBenchmark(int mapSize, int queries, uint32_t seed)
+    {
+        BenchmarkReport report;
+        report.MapSize = std::clamp(mapSize, BenchmarkRoomSize * 2, 8192);
+        report.Queries = std::max(queries, 1);
+
+        std::mt19937 random(seed);
+
+        NavigationGrid grid;
+        {
+            Map map;
+            GenerateBenchmarkMap(map, report.MapSize, random);
+            grid.Build(map);
+        }
+
+        std::vector<PathQuery> pathQueries(report.Queries);
+        for (auto& query : pathQueries)
+        {
+            query.Start = GetRandomWalkableCell(grid, random);
+            query.Goal = GetRandomWalkableCell(grid, random);
+        }
+
+        PathFinder jpsFinder;
+        PathFinder aStarFinder;
+        PathSearchResult jpsResult;
+        PathSearchResult aStarResult;
+        PathSearchResult hierarchicalResult;
+
+        HierarchicalGraph graph;
+        graph.SetGrid(grid, true);
+
+        double overhead = 0;
+
+        for (auto& query : pathQueries)
+        {
+            query.Algorithm = PathAlgorithm::JPS;
+            auto start = std::chrono::steady_clock::now();
+            bool jpsFound = jpsFinder.FindPath(grid, query, jpsResult);
+            report.JPSMS += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            query.Algorithm = PathAlgorithm::AStar;
+            start = std::chrono::steady_clock::now();
+            bool aStarFound = aStarFinder.FindPath(grid, query, aStarResult);
+            report.AStarMS += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            start = std::chrono::steady_clock::now();
+            bool hierarchicalFound = graph.FindPath(query.Start, query.Goal, hierarchicalResult);
+            report.HierarchicalMS += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            report.JPSExpanded += jpsResult.Expanded;
+            report.AStarExpanded += aStarResult.Expanded;
+            report.HierarchicalExpanded += hierarchicalResult.Expanded;
+
+            if (jpsFound)
+                report.Found++;
+
+            if (aStarFound && hierarchicalFound && aStarResult.Cost > 0)
+                overhead += (hierarchicalResult.Cost - aStarResult.Cost) / aStarResult.Cost;
+
+            // the two sum the same steps in a different order, so the costs can be a little apart
+            if (jpsFound != aStarFound || hierarchicalFound != aStarFound || fabsf(jpsResult.Cost - aStarResult.Cost) > 0.001f * std::max(1.0f, aStarResult.Cost))
+                report.Mismatches++;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& query : pathQueries)
+            graph.FindPath(query.Start, query.Goal, hierarchicalResult);
+        report.HierarchicalCachedMS = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        report.ClustersBuilt = graph.GetStats().ClustersBuilt;
+        report.CacheHits = graph.GetStats().CacheHits;
+        report.HierarchicalOverhead = report.Found > 0 ? float(overhead * 100.0 / report.Found) : 0.0f;
+
+        TraceLog(LOG_INFO, "PATH: Benchmark %dx%d, %d queries, %d found, JPS %.2fms %zu expanded, A* %.2fms %zu expanded, %d mismatches",
+            report.MapSize, report.MapSize, report.Queries, report.Found,
+            report.JPSMS, report.JPSExpanded, report.AStarMS, report.AStarExpanded, report.Mismatches);
+        TraceLog(LOG_INFO, "PATH: Hierarchical %.2fms %zu expanded, %zu clusters, again with cached routes %.2fms %zu hits, %.1f%% longer",
+            report.HierarchicalMS, report.HierarchicalExpanded, report.ClustersBuilt, report.HierarchicalCachedMS, report.CacheHits, report.HierarchicalOverhead);
+
+        return report;
+    }
+};
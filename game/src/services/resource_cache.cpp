@@ -0,0 +1,249 @@
+#include "services/resource_cache.h"
+#include "services/table_manager.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+static std::vector<ResourceCache*>& GetCacheList()
+{
+    // the caches are globals in the services, so the list has to exist before any of them are constructed
+    static std::vector<ResourceCache*> caches;
+    return caches;
+}
+
+ResourceCache::ResourceCache(std::string_view name, EvictCallback onEvict, size_t cpuBudget, size_t gpuBudget, std::mutex* ownerMutex)
+    : Name(name)
+    , OnEvict(onEvict)
+    , OwnerMutex(ownerMutex)
+    , CPUBudget(cpuBudget)
+    , GPUBudget(gpuBudget)
+{
+    GetCacheList().push_back(this);
+}
+
+ResourceCache::~ResourceCache()
+{
+    auto& caches = GetCacheList();
+    caches.erase(std::remove(caches.begin(), caches.end(), this), caches.end());
+}
+
+void ResourceCache::Add(size_t key, size_t cpuBytes, size_t gpuBytes, size_t references)
+{
+    auto [itr, added] = Entries.try_emplace(key);
+    CacheEntry& entry = itr->second;
+
+    if (added)
+    {
+        entry.UnusedItr = UnusedEntries.end();
+        if (references == 0)
+            entry.UnusedItr = UnusedEntries.insert(UnusedEntries.begin(), key);
+    }
+    else if (entry.References == 0 && references > 0)
+    {
+        UnusedEntries.erase(entry.UnusedItr);
+        entry.UnusedItr = UnusedEntries.end();
+    }
+
+    entry.References += references;
+
+    SetSize(key, cpuBytes, gpuBytes);
+}
+
+void ResourceCache::SetSize(size_t key, size_t cpuBytes, size_t gpuBytes)
+{
+    auto itr = Entries.find(key);
+    if (itr == Entries.end())
+        return;
+
+    bool grew = cpuBytes > itr->second.CPUBytes || gpuBytes > itr->second.GPUBytes;
+
+    CPUBytes = CPUBytes - itr->second.CPUBytes + cpuBytes;
+    GPUBytes = GPUBytes - itr->second.GPUBytes + gpuBytes;
+
+    itr->second.CPUBytes = cpuBytes;
+    itr->second.GPUBytes = gpuBytes;
+
+    // an unused entry that finishes loading would otherwise sit over budget until something else is released
+    if (grew)
+        EvictUnused(&key);
+}
+
+bool ResourceCache::Contains(size_t key) const
+{
+    return Entries.find(key) != Entries.end();
+}
+
+bool ResourceCache::AddReference(size_t key)
+{
+    auto itr = Entries.find(key);
+    if (itr == Entries.end())
+    {
+        Misses++;
+        return false;
+    }
+
+    Hits++;
+
+    CacheEntry& entry = itr->second;
+    if (entry.References == 0)
+    {
+        UnusedEntries.erase(entry.UnusedItr);
+        entry.UnusedItr = UnusedEntries.end();
+    }
+
+    entry.References++;
+    return true;
+}
+
+void ResourceCache::ReleaseReference(size_t key)
+{
+    auto itr = Entries.find(key);
+    if (itr == Entries.end() || itr->second.References == 0)
+        return;
+
+    CacheEntry& entry = itr->second;
+    entry.References--;
+
+    if (entry.References == 0)
+    {
+        entry.UnusedItr = UnusedEntries.insert(UnusedEntries.begin(), key);
+        Trim();
+    }
+}
+
+size_t ResourceCache::GetReferenceCount(size_t key) const
+{
+    auto itr = Entries.find(key);
+    if (itr == Entries.end())
+        return 0;
+
+    return itr->second.References;
+}
+
+size_t ResourceCache::GetGPUBytes(size_t key) const
+{
+    auto itr = Entries.find(key);
+    if (itr == Entries.end())
+        return 0;
+
+    return itr->second.GPUBytes;
+}
+
+void ResourceCache::Remove(size_t key)
+{
+    auto itr = Entries.find(key);
+    if (itr == Entries.end())
+        return;
+
+    if (itr->second.References == 0)
+        UnusedEntries.erase(itr->second.UnusedItr);
+
+    CPUBytes -= itr->second.CPUBytes;
+    GPUBytes -= itr->second.GPUBytes;
+
+    Entries.erase(itr);
+}
+
+void ResourceCache::Clear()
+{
+    Entries.clear();
+    UnusedEntries.clear();
+    CPUBytes = 0;
+    GPUBytes = 0;
+}
+
+void ResourceCache::SetBudget(size_t cpuBytes, size_t gpuBytes)
+{
+    std::unique_lock<std::mutex> lock;
+    if (OwnerMutex)
+        lock = std::unique_lock<std::mutex>(*OwnerMutex);
+
+    CPUBudget = cpuBytes;
+    GPUBudget = gpuBytes;
+    Trim();
+}
+
+bool ResourceCache::IsOverBudget() const
+{
+    return (CPUBudget > 0 && CPUBytes > CPUBudget) || (GPUBudget > 0 && GPUBytes > GPUBudget);
+}
+
+void ResourceCache::Trim()
+{
+    EvictUnused(nullptr);
+}
+
+void ResourceCache::EvictUnused(const size_t* keep)
+{
+    while (IsOverBudget())
+    {
+        auto itr = std::find_if(UnusedEntries.rbegin(), UnusedEntries.rend(), [keep](size_t key) { return !keep || key != *keep; });
+        if (itr == UnusedEntries.rend())
+            return;
+
+        size_t key = *itr;
+
+        // the entry is gone before the owner hears about it, so the callback can't see it half removed
+        Remove(key);
+        Evictions++;
+
+        if (OnEvict)
+            OnEvict(key);
+    }
+}
+
+ResourceCache::Stats ResourceCache::GetStats() const
+{
+    std::unique_lock<std::mutex> lock;
+    if (OwnerMutex)
+        lock = std::unique_lock<std::mutex>(*OwnerMutex);
+
+    Stats stats;
+    stats.Entries = Entries.size();
+    stats.ReferencedEntries = Entries.size() - UnusedEntries.size();
+    stats.CPUBytes = CPUBytes;
+    stats.GPUBytes = GPUBytes;
+    stats.Hits = Hits;
+    stats.Misses = Misses;
+    stats.Evictions = Evictions;
+
+    return stats;
+}
+
+const std::vector<ResourceCache*>& ResourceCache::GetCaches()
+{
+    return GetCacheList();
+}
+
+ResourceCache* ResourceCache::FindCache(std::string_view name)
+{
+    for (auto* cache : GetCacheList())
+    {
+        if (cache->GetName() == name)
+            return cache;
+    }
+
+    return nullptr;
+}
+
+void ResourceCache::LoadBudgets(const Table* budgetTable)
+{
+    if (!budgetTable)
+        return;
+
+    for (const auto& [name, value] : *budgetTable)
+    {
+        ResourceCache* cache = FindCache(name);
+        if (!cache)
+            continue;
+
+        auto parts = budgetTable->SplitField(name, ":");
+        if (parts.empty())
+            continue;
+
+        size_t cpuBudget = size_t(atoll(parts[0].c_str())) * 1024;
+        size_t gpuBudget = parts.size() > 1 ? size_t(atoll(parts[1].c_str())) * 1024 : 0;
+
+        cache->SetBudget(cpuBudget, gpuBudget);
+    }
+}
@@ -1,23 +1,98 @@
 #include "services/resource_manager.h"
+#include "services/global_vars.h"
+#include "services/resource_cache.h"
+#include "utilities/mapped_file.h"
+#include "utilities/pack_format.h"
 
+#include <algorithm>
+#include <climits>
+#include <mutex>
 #include <unordered_map>
 #include <string>
+#include <vector>
 #include <string.h>
 
 #include "raylib.h"
 
 ResoureInfo::~ResoureInfo()
 {
-    UnloadFileData(DataBuffer);
+    // mapped data goes away with the last resource that uses the mapping
+    if (!Mapping)
+        UnloadFileData(DataBuffer);
 }
 
 namespace ResourceManager
 {
-    static std::hash<std::string_view> StringHasher;
-
     using ResourceMap = std::unordered_map<size_t, std::shared_ptr<ResoureInfo>>;
     ResourceMap OpenResources;
 
+    // the data of each open resource to its hash, so a resource can be released by its data without a search
+    std::unordered_map<const void*, size_t> OpenResourceData;
+
+    struct MountedPack
+    {
+        std::string Path;
+        std::shared_ptr<MappedFile> Mapping;
+
+        // both point into the mapping
+        const PackFormat::PackEntry* Entries = nullptr;
+        size_t EntryCount = 0;
+        const char* Names = nullptr;
+    };
+
+    // in mount order, so later packs are searched first
+    std::vector<MountedPack> MountedPacks;
+
+    // resources are opened from the loader threads too, the lock only covers the maps, cache and pack list so files are still read in parallel
+    static std::mutex ResourceMutex;
+
+    static void EvictResource(size_t pathHash)
+    {
+        auto itr = OpenResources.find(pathHash);
+        if (itr == OpenResources.end())
+            return;
+
+        OpenResourceData.erase(itr->second->DataBuffer);
+        OpenResources.erase(itr);
+    }
+
+    // released resources stay open while they fit in the budget, so opening the same file again is free
+    static ResourceCache RawCache("resources", EvictResource, 32 * 1024 * 1024, 0, &ResourceMutex);
+
+    // the same hash is used for the open resources and the pack index, so a lookup only hashes the path once
+    static size_t HashPath(std::string_view filePath)
+    {
+        return size_t(PackFormat::HashPath(filePath));
+    }
+
+    static std::shared_ptr<ResoureInfo> FindOpenResource(size_t pathHash)
+    {
+        std::lock_guard<std::mutex> lock(ResourceMutex);
+
+        if (!RawCache.AddReference(pathHash))
+            return nullptr;
+
+        auto itr = OpenResources.find(pathHash);
+        if (itr != OpenResources.end())
+            return itr->second;
+
+        return nullptr;
+    }
+
+    static void AddOpenResource(std::shared_ptr<ResoureInfo> resource)
+    {
+        std::lock_guard<std::mutex> lock(ResourceMutex);
+
+        // two threads can open the same file at once, the last one replaces the first but both hold a reference
+        auto itr = OpenResources.find(resource->NameHash);
+        if (itr != OpenResources.end())
+            OpenResourceData.erase(itr->second->DataBuffer);
+
+        RawCache.Add(resource->NameHash, resource->DataSize, 0, 1);
+        OpenResources.insert_or_assign(resource->NameHash, resource);
+        OpenResourceData.insert_or_assign(resource->DataBuffer, resource->NameHash);
+    }
+
     bool SearchAndSetResourceDir(const char* folderName)
     {
         // check the working dir
@@ -68,12 +143,228 @@ namespace ResourceManager
     {
         SearchAndSetResourceDir(rootFolder.data());
 
-        // TODO, handle reading from packages here, like reading an archive
+        // mount every pack in the resource folder, in name order so patch packs can sort after the base pack
+        FilePathList packFiles = LoadDirectoryFilesEx(".", ".pack", false);
+
+        std::vector<std::string> packPaths;
+        for (unsigned int i = 0; i < packFiles.count; i++)
+            packPaths.emplace_back(packFiles.paths[i]);
+
+        UnloadDirectoryFiles(packFiles);
+
+        std::sort(packPaths.begin(), packPaths.end());
+        for (const auto& packPath : packPaths)
+            MountPack(packPath);
     }
 
     void Cleanup()
     {
+        std::lock_guard<std::mutex> lock(ResourceMutex);
         OpenResources.clear();
+        OpenResourceData.clear();
+        RawCache.Clear();
+
+        // resources that are still held keep their pack mapped
+        MountedPacks.clear();
+    }
+
+    static bool ValidatePack(MountedPack& pack)
+    {
+        const uint8_t* data = pack.Mapping->GetData();
+        size_t size = pack.Mapping->GetSize();
+
+        if (size < sizeof(PackFormat::PackHeader))
+            return false;
+
+        PackFormat::PackHeader header;
+        memcpy(&header, data, sizeof(header));
+
+        if (memcmp(header.Magic, PackFormat::Magic, sizeof(header.Magic)) != 0 || header.Version != PackFormat::Version)
+            return false;
+
+        // the entry table is used in place, so it must fit and be aligned
+        if (header.EntriesOffset % alignof(PackFormat::PackEntry) != 0 || header.EntriesOffset > size
+            || header.EntryCount > (size - header.EntriesOffset) / sizeof(PackFormat::PackEntry))
+            return false;
+
+        if (header.NamesOffset > size || header.NamesSize > size - header.NamesOffset)
+            return false;
+
+        pack.Entries = reinterpret_cast<const PackFormat::PackEntry*>(data + header.EntriesOffset);
+        pack.EntryCount = header.EntryCount;
+        pack.Names = reinterpret_cast<const char*>(data + header.NamesOffset);
+
+        for (size_t i = 0; i < pack.EntryCount; i++)
+        {
+            const PackFormat::PackEntry& entry = pack.Entries[i];
+
+            // the lookup is a binary search, so the hashes must be sorted and unique
+            if (i > 0 && entry.PathHash <= pack.Entries[i - 1].PathHash)
+                return false;
+
+            if (entry.DataOffset > size || entry.StoredSize > size - entry.DataOffset)
+                return false;
+
+            if (entry.NameOffset > header.NamesSize || entry.NameLength > header.NamesSize - entry.NameOffset)
+                return false;
+
+            if (entry.Flags & PackFormat::Compressed)
+            {
+                // compressed entries go through raylib, which uses int sizes
+                if (entry.StoredSize > INT_MAX || entry.Size > INT_MAX)
+                    return false;
+            }
+            else if (entry.Size != entry.StoredSize)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool MountPack(std::string_view packPath)
+    {
+        MountedPack pack;
+        pack.Path = std::string(packPath);
+        pack.Mapping = std::make_shared<MappedFile>();
+
+        if (!pack.Mapping->Open(packPath))
+        {
+            TraceLog(LOG_WARNING, "RESOURCE: Unable to open pack %s", pack.Path.c_str());
+            return false;
+        }
+
+        if (!ValidatePack(pack))
+        {
+            TraceLog(LOG_WARNING, "RESOURCE: %s is not a valid pack", pack.Path.c_str());
+            return false;
+        }
+
+        TraceLog(LOG_INFO, "RESOURCE: Mounted pack %s with %d entries", pack.Path.c_str(), int(pack.EntryCount));
+
+        std::lock_guard<std::mutex> lock(ResourceMutex);
+        MountedPacks.push_back(std::move(pack));
+        return true;
+    }
+
+    size_t GetMountedPackCount()
+    {
+        std::lock_guard<std::mutex> lock(ResourceMutex);
+        return MountedPacks.size();
+    }
+
+    size_t GetPackEntryCount()
+    {
+        std::lock_guard<std::mutex> lock(ResourceMutex);
+
+        size_t count = 0;
+        for (const auto& pack : MountedPacks)
+            count += pack.EntryCount;
+
+        return count;
+    }
+
+    // finds the newest pack entry for a path, the entry is copied so it can be used after the lock is released
+    static bool FindPackEntry(std::string_view filePath, size_t pathHash, PackFormat::PackEntry& entry, std::shared_ptr<MappedFile>& mapping)
+    {
+        std::lock_guard<std::mutex> lock(ResourceMutex);
+
+        if (MountedPacks.empty())
+            return false;
+
+        std::string normalizedPath = PackFormat::NormalizePath(filePath);
+
+        for (auto pack = MountedPacks.rbegin(); pack != MountedPacks.rend(); ++pack)
+        {
+            const PackFormat::PackEntry* end = pack->Entries + pack->EntryCount;
+            const PackFormat::PackEntry* itr = std::lower_bound(pack->Entries, end, uint64_t(pathHash),
+                [](const PackFormat::PackEntry& entry, uint64_t hash) { return entry.PathHash < hash; });
+
+            if (itr == end || itr->PathHash != pathHash)
+                continue;
+
+            if (std::string_view(pack->Names + itr->NameOffset, itr->NameLength) != normalizedPath)
+                continue;
+
+            entry = *itr;
+            mapping = pack->Mapping;
+            return true;
+        }
+
+        return false;
+    }
+
+    // loose files only need to be checked when they can replace pack entries
+    static bool UseLooseFile(std::string_view filePath)
+    {
+        return GlobalVars::UseLooseFileOverlay && FileExists(std::string(filePath).c_str());
+    }
+
+    // uncompressed entries are views of the pack mapping, compressed entries are expanded into a new buffer
+    static std::shared_ptr<ResoureInfo> OpenPackResource(std::string_view filePath, size_t pathHash, bool asText)
+    {
+        PackFormat::PackEntry entry;
+        std::shared_ptr<MappedFile> mapping;
+
+        if (!FindPackEntry(filePath, pathHash, entry, mapping))
+            return nullptr;
+
+        if (UseLooseFile(filePath))
+            return nullptr;
+
+        const uint8_t* storedData = mapping->GetData() + entry.DataOffset;
+
+        std::shared_ptr<ResoureInfo> file = std::make_shared<ResoureInfo>();
+        file->NameHash = pathHash;
+
+        if (!(entry.Flags & PackFormat::Compressed))
+        {
+            // the pack has a zero after every entry, so text can be used in place too
+            file->DataBuffer = const_cast<uint8_t*>(storedData);
+            file->DataSize = size_t(entry.Size);
+            file->Mapping = mapping;
+            return file;
+        }
+
+        int size = 0;
+        uint8_t* buffer = DecompressData(storedData, int(entry.StoredSize), &size);
+        if (!buffer || size_t(size) != entry.Size)
+        {
+            TraceLog(LOG_WARNING, "RESOURCE: Unable to decompress %s", std::string(filePath).c_str());
+            MemFree(buffer);
+            return nullptr;
+        }
+
+        if (asText)
+        {
+            uint8_t* textBuffer = (uint8_t*)MemRealloc(buffer, size + 1);
+            if (!textBuffer)
+            {
+                MemFree(buffer);
+                return nullptr;
+            }
+
+            buffer = textBuffer;
+            buffer[size] = 0;
+        }
+
+        file->DataBuffer = buffer;
+        file->DataSize = size;
+        return file;
+    }
+
+    bool HasResource(std::string_view filePath)
+    {
+        if (filePath.empty())
+            return false;
+
+        PackFormat::PackEntry entry;
+        std::shared_ptr<MappedFile> mapping;
+        if (FindPackEntry(filePath, HashPath(filePath), entry, mapping))
+            return true;
+
+        return FileExists(std::string(filePath).c_str());
     }
 
     std::shared_ptr<ResoureInfo> OpenResource(std::string_view filePath, bool asText)
@@ -81,11 +372,18 @@ namespace ResourceManager
         if (filePath.empty())
             return nullptr;
 
-        size_t pathHash = StringHasher(filePath);
+        size_t pathHash = HashPath(filePath);
 
-        auto itr = OpenResources.find(pathHash);
-        if (itr != OpenResources.end())
-            return itr->second;
+        auto openResource = FindOpenResource(pathHash);
+        if (openResource)
+            return openResource;
+
+        auto packResource = OpenPackResource(filePath, pathHash, asText);
+        if (packResource)
+        {
+            AddOpenResource(packResource);
+            return packResource;
+        }
 
         int size = 0;
         uint8_t* buffer = nullptr;
@@ -110,7 +408,43 @@ namespace ResourceManager
         file->DataBuffer = buffer;
         file->DataSize = size;
 
-        OpenResources.insert_or_assign(pathHash, file);
+        AddOpenResource(file);
+        return file;
+    }
+
+    std::shared_ptr<ResoureInfo> MapResource(std::string_view filePath)
+    {
+        if (filePath.empty())
+            return nullptr;
+
+        size_t pathHash = HashPath(filePath);
+
+        auto openResource = FindOpenResource(pathHash);
+        if (openResource)
+            return openResource;
+
+        // pack entries are already mapped
+        auto packResource = OpenPackResource(filePath, pathHash, false);
+        if (packResource)
+        {
+            AddOpenResource(packResource);
+            return packResource;
+        }
+
+        auto mapping = std::make_shared<MappedFile>();
+        if (!mapping->Open(filePath))
+            return OpenResource(filePath);
+
+        std::shared_ptr<ResoureInfo> file = std::make_shared<ResoureInfo>();
+
+        file->NameHash = pathHash;
+
+        // the readers take mutable buffers but never write to them
+        file->DataBuffer = const_cast<uint8_t*>(mapping->GetData());
+        file->DataSize = mapping->GetSize();
+        file->Mapping = std::move(mapping);
+
+        AddOpenResource(file);
         return file;
     }
 
@@ -119,27 +453,37 @@ namespace ResourceManager
         if (!resource)
             return;
 
-        auto itr = OpenResources.find(resource->NameHash);
-        if (itr != OpenResources.end())
-            OpenResources.erase(itr);
+        std::lock_guard<std::mutex> lock(ResourceMutex);
+        RawCache.ReleaseReference(resource->NameHash);
     }
 
     void ReleaseResource(const char* resourceName)
     {
-        auto itr = OpenResources.find(StringHasher(resourceName));
-        if (itr != OpenResources.end())
-            OpenResources.erase(itr);
+        std::lock_guard<std::mutex> lock(ResourceMutex);
+        RawCache.ReleaseReference(HashPath(resourceName));
     }
 
     void ReleaseResourceByData(void* resourceData)
     {
-        for (ResourceMap::iterator itr = OpenResources.begin(); itr != OpenResources.end(); ++itr)
-        {
-            if (itr->second->DataBuffer == resourceData)
-            {
-                OpenResources.erase(itr);
-                return;
-            }
-        }
+        std::lock_guard<std::mutex> lock(ResourceMutex);
+
+        auto itr = OpenResourceData.find(resourceData);
+        if (itr != OpenResourceData.end())
+            RawCache.ReleaseReference(itr->second);
+    }
+
+    void InvalidateResource(std::string_view filePath)
+    {
+        std::lock_guard<std::mutex> lock(ResourceMutex);
+
+        size_t pathHash = HashPath(filePath);
+
+        auto itr = OpenResources.find(pathHash);
+        if (itr == OpenResources.end())
+            return;
+
+        OpenResourceData.erase(itr->second->DataBuffer);
+        OpenResources.erase(itr);
+        RawCache.Remove(pathHash);
     }
 };
\ No newline at end of file
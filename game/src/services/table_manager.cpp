@@ -50,23 +50,15 @@ namespace TableManager
     }
 
 
-    const Table* GetTable(std::string_view name)
+    static bool ReadTable(std::string_view name, Table& table)
     {
-        size_t hash = StringHasher(name);
-        
-        auto itr = LoadedTables.find(hash);
-        if (itr != LoadedTables.end())
-            return &itr->second;
-
         auto resource = ResourceManager::OpenResource(name, true);
 
         if (resource == nullptr)
-            return nullptr;
+            return false;
 
         auto lines = StringUtils::SplitString(std::string_view((char*)resource->DataBuffer, resource->DataSize), "\n");
 
-        Table& table = LoadedTables.try_emplace(hash).first->second;
-
         for (auto& line : lines)
         {
             auto parts = StringUtils::SplitString(line, ";");
@@ -78,7 +70,37 @@ namespace TableManager
 
         ResourceManager::ReleaseResource(resource);
 
-        return &table;
+        return true;
+    }
+
+    const Table* GetTable(std::string_view name)
+    {
+        size_t hash = StringHasher(name);
+        
+        auto itr = LoadedTables.find(hash);
+        if (itr != LoadedTables.end())
+            return &itr->second;
+
+        Table table;
+        if (!ReadTable(name, table))
+            return nullptr;
+
+        return &LoadedTables.insert_or_assign(hash, std::move(table)).first->second;
+    }
+
+    bool ReloadTable(std::string_view name)
+    {
+        auto itr = LoadedTables.find(StringHasher(name));
+        if (itr == LoadedTables.end())
+            return false;
+
+        // a table that can't be read right now keeps what it had
+        Table table;
+        if (!ReadTable(name, table))
+            return false;
+
+        itr->second.swap(table);
+        return true;
     }
 
     void UnloadAll()
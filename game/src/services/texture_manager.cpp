@@ -1,8 +1,17 @@
 #include "services/texture_manager.h"
+#include "services/async_loader.h"
+#include "services/global_vars.h"
+#include "services/resource_cache.h"
 #include "services/resource_manager.h"
 #include "services/table_manager.h"
 #include "model.h"
+#include "utilities/pack_format.h"
+#include "utilities/texture_compression.h"
 
+#include "rlgl.h"
+
+#include <memory>
+#include <string>
 #include <unordered_map>
 
 namespace TextureManager
@@ -12,36 +21,141 @@ namespace TextureManager
     struct TextureRecord
     {
         size_t Hash = 0;
+        std::string Name;
         ::Texture2D Texture = { 0 };
         size_t ImageSize = 0;
+
+        // false while the texture is loading and if it failed, the texture is then empty or the default texture and must not be unloaded
+        bool Loaded = false;
+
+        // set while the texture is being loaded in the background
+        AsyncLoader::JobPtr LoadJob;
+
+        // textures handed out by value or pointer can't be tracked, so they hold a reference that is never released
+        bool Pinned = false;
+
+        bool Cubemap = false;
     };
 
+    // textures replaced by a reload, copies of them may still be drawn so they stay loaded until everything is unloaded
+    static std::vector<TextureRecord> RetiredTextures;
+
     static std::unordered_map<size_t, TextureRecord> LoadedTextures;
 
+    static void EvictTexture(size_t hash)
+    {
+        auto itr = LoadedTextures.find(hash);
+        if (itr == LoadedTextures.end())
+            return;
+
+        // a texture that is still loading just drops its image when the load finds the record gone
+        if (itr->second.Loaded)
+        {
+            UsedVRam -= itr->second.ImageSize;
+            UnloadTexture(itr->second.Texture);
+        }
+
+        LoadedTextures.erase(itr);
+    }
+
+    static ResourceCache TextureCache("textures", EvictTexture, 0, 256 * 1024 * 1024);
+
     static bool PreloadShaders = true;
     static std::unordered_map<size_t, Shader> LoadedShaders;
 
+    // the files each loaded shader came from, so it can be built again when one changes
+    struct ShaderSource
+    {
+        std::string Vertex;
+        std::string Fragment;
+    };
+    static std::unordered_map<size_t, ShaderSource> ShaderSources;
+
     static std::hash<std::string_view> StringHasher;
 
     static TextureRecord DefaultTexture;
 
     static const Table* ShaderTable = nullptr;
 
+    // set in Init if the GPU can sample DXT textures
+    static bool CompressedTexturesSupported = false;
+
     void LoadTextureRecord(TextureRecord& record, Image& image)
     {
         record.Texture = LoadTextureFromImage(image);
-        GenTextureMipmaps(&record.Texture);
+
+        // precompressed textures bring their own mips, the GPU can't build them for a compressed format
+        if (image.mipmaps <= 1 && !TextureCompression::IsCompressedFormat(image.format))
+            GenTextureMipmaps(&record.Texture);
+
         SetTextureFilter(record.Texture, TEXTURE_FILTER_ANISOTROPIC_16X);
 
-        record.ImageSize = image.width * image.height;
-        if (image.format == PIXELFORMAT_UNCOMPRESSED_R8G8B8)
-            record.ImageSize *= 3;
-        if (image.format == PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
-            record.ImageSize *= 4;
+        record.ImageSize = TextureCompression::GetTextureSize(record.Texture.width, record.Texture.height, record.Texture.mipmaps, record.Texture.format);
 
-        record.ImageSize += record.ImageSize / 3;
-  
         UsedVRam += record.ImageSize;
+        record.Loaded = true;
+
+        TextureCache.SetSize(record.Hash, 0, record.ImageSize);
+    }
+
+    static TextureRecord& AddTextureRecord(size_t hash, std::string_view name)
+    {
+        auto [itr, added] = LoadedTextures.try_emplace(hash);
+        itr->second.Hash = hash;
+        itr->second.Name = name;
+
+        if (added)
+            TextureCache.Add(hash, 0, 0);
+
+        return itr->second;
+    }
+
+    static void PinTexture(TextureRecord& record)
+    {
+        if (record.Pinned)
+            return;
+
+        record.Pinned = true;
+        TextureCache.AddReference(record.Hash);
+    }
+
+    static TextureRecord& QueueTextureLoad(size_t hash, std::string_view name)
+    {
+        TextureRecord& record = AddTextureRecord(hash, name);
+
+        auto image = std::make_shared<Image>();
+        std::string fileName(name);
+
+        auto job = AsyncLoader::QueueLoad([image, fileName]()
+            {
+                *image = DecodeTexture(fileName);
+            },
+            [image, hash]()
+            {
+                auto itr = LoadedTextures.find(hash);
+                if (itr != LoadedTextures.end())
+                {
+                    TextureRecord& record = itr->second;
+                    record.LoadJob = nullptr;
+
+                    // a model load may have brought in the same texture first
+                    if (!record.Loaded)
+                    {
+                        if (IsImageValid(*image))
+                            LoadTextureRecord(record, *image);
+                        else
+                            record.Texture = DefaultTexture.Texture;
+                    }
+                }
+
+                UnloadImage(*image);
+            });
+
+        // the upload runs on this thread, so if it isn't done yet it can't finish before this is set
+        if (!AsyncLoader::IsDone(job))
+            record.LoadJob = job;
+
+        return record;
     }
 
     Shader FindShader(std::string_view key, std::string_view vertex, std::string_view fragment)
@@ -69,11 +183,34 @@ namespace TextureManager
         ResourceManager::ReleaseResource(fragmentResource);
 
         LoadedShaders.insert_or_assign(hash, shader);
+        ShaderSources.insert_or_assign(hash, ShaderSource{ std::string(vertex), std::string(fragment) });
         return shader;
     }
 
+    static void CheckCompressedTextureSupport()
+    {
+        // upload one DXT1 block, raylib refuses it if the extension is missing
+        uint8_t block[8] = { 0 };
+
+        Image image = { 0 };
+        image.data = block;
+        image.width = 4;
+        image.height = 4;
+        image.mipmaps = 1;
+        image.format = PIXELFORMAT_COMPRESSED_DXT1_RGB;
+
+        Texture2D texture = LoadTextureFromImage(image);
+        CompressedTexturesSupported = IsTextureValid(texture);
+        UnloadTexture(texture);
+
+        if (!CompressedTexturesSupported)
+            TraceLog(LOG_WARNING, "TEXTURE: DXT textures are not supported, loading the source images");
+    }
+
     void Init()
     {
+        CheckCompressedTextureSupport();
+
         auto defaultImage = GenImageChecked(128, 128, 8, 8, DARKGRAY, GRAY);
         ImageDrawRectangle(&defaultImage, 32, 8, 64, 10, ColorAlpha(RED, 0.5f));
         ImageDrawRectangle(&defaultImage, 64-8, 32, 16, 64, ColorAlpha(GREEN, 0.5f));
@@ -83,7 +220,8 @@ namespace TextureManager
         LoadTextureRecord(DefaultTexture, defaultImage);
         UnloadImage(defaultImage);
 
-        SetModelTextureResolver(GetTexture);
+        // models reference their textures, so they can be evicted once no model uses them
+        SetModelTextureResolver(AcquireTexture);
 
         auto* bootstrapTable = TableManager::GetTable(BootstrapTable);
         
@@ -149,27 +287,125 @@ namespace TextureManager
         DefaultTexture.ImageSize = 0;
     }
 
-    Texture2D GetTexture(std::string_view name)
+    // finds or starts loading a texture, null if there is no such texture
+    static TextureRecord* FindTextureRecord(std::string_view name, bool waitForLoad)
     {
         size_t hash = StringHasher(name);
+
+        TextureRecord* record = nullptr;
+
         auto itr = LoadedTextures.find(hash);
         if (itr != LoadedTextures.end())
-            return itr->second.Texture;
+            record = &itr->second;
+        else if (ResourceManager::HasResource(name))
+            record = &QueueTextureLoad(hash, name);
+        else
+            return nullptr;
 
-        auto resource = ResourceManager::OpenResource(name);
-        if (!resource)
-        {
+        // it's needed right now, so finish any background load here
+        if (waitForLoad && record->LoadJob)
+            AsyncLoader::Complete(record->LoadJob);
+
+        return record;
+    }
+
+    Texture2D GetTexture(std::string_view name)
+    {
+        TextureRecord* record = FindTextureRecord(name, true);
+        if (!record)
             return DefaultTexture.Texture;
+
+        PinTexture(*record);
+        return record->Texture;
+    }
+
+    Texture2D AcquireTexture(std::string_view name)
+    {
+        TextureRecord* record = FindTextureRecord(name, true);
+        if (!record)
+            return DefaultTexture.Texture;
+
+        TextureCache.AddReference(record->Hash);
+        return record->Texture;
+    }
+
+    void ReleaseTexture(std::string_view name)
+    {
+        if (name.empty())
+            return;
+
+        TextureCache.ReleaseReference(StringHasher(name));
+    }
+
+    const Texture2D* RequestTexture(std::string_view name)
+    {
+        TextureRecord* record = FindTextureRecord(name, false);
+        if (!record)
+            return &DefaultTexture.Texture;
+
+        PinTexture(*record);
+        return &record->Texture;
+    }
+
+    void PrefetchTexture(std::string_view name)
+    {
+        FindTextureRecord(name, false);
+    }
+
+    // the name of a precompressed version of a texture, the same path with a .dds extension
+    static std::string GetCompressedTextureName(std::string_view name)
+    {
+        size_t extension = name.find_last_of('.');
+        if (extension == std::string_view::npos || name.substr(extension) == ".dds")
+            return std::string();
+
+        std::string compressedName(name.substr(0, extension));
+        compressedName += ".dds";
+        return compressedName;
+    }
+
+    Image DecodeTexture(std::string_view name)
+    {
+        Image image = { 0 };
+
+        std::string fileName(name);
+
+        if (GlobalVars::UseCompressedTextures && CompressedTexturesSupported)
+        {
+            std::string compressedName = GetCompressedTextureName(name);
+            if (!compressedName.empty() && ResourceManager::HasResource(compressedName))
+                fileName = compressedName;
         }
 
-        itr = LoadedTextures.try_emplace(hash).first;
+        auto resource = ResourceManager::OpenResource(fileName);
+        if (!resource)
+            return image;
 
-        Image img = LoadImageFromMemory(GetFileExtension(name.data()), resource->DataBuffer, int(resource->DataSize));
-        LoadTextureRecord(itr->second, img);
-        UnloadImage(img);
+        image = LoadImageFromMemory(GetFileExtension(fileName.c_str()), resource->DataBuffer, int(resource->DataSize));
         ResourceManager::ReleaseResource(resource);
 
-        return itr->second.Texture;
+        return image;
+    }
+
+    Texture2D AddTexture(std::string_view name, Image& image)
+    {
+        TextureRecord& record = AddTextureRecord(StringHasher(name), name);
+
+        if (!record.Loaded)
+        {
+            if (IsImageValid(image))
+                LoadTextureRecord(record, image);
+            else
+                record.Texture = DefaultTexture.Texture;
+
+            // a background load of the same texture will see it's done and drop its own copy
+            record.LoadJob = nullptr;
+        }
+
+        UnloadImage(image);
+        image = Image{ 0 };
+
+        return record.Texture;
     }
 
     static bool GenerateCubeMapMipMaps = false;
@@ -189,26 +425,24 @@ namespace TextureManager
         ResourceManager::ReleaseResource(resource);
         if (IsImageValid(image))
         {
-            itr = LoadedTextures.try_emplace(hash).first;
-
-            TextureRecord& record = itr->second;
-
-            record.ImageSize = image.width * image.height;
-            if (image.format == PIXELFORMAT_UNCOMPRESSED_R8G8B8)
-                record.ImageSize *= 3;
-            if (image.format == PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
-                record.ImageSize *= 4;
+            TextureRecord& record = AddTextureRecord(hash, name);
+            record.Cubemap = true;
+            PinTexture(record);
 
             record.Texture = LoadTextureCubemap(image, CUBEMAP_LAYOUT_AUTO_DETECT);    // CUBEMAP_LAYOUT_PANORAMA
+            record.Loaded = true;
 
             if (GenerateCubeMapMipMaps)
             {
                 GenTextureMipmaps(&record.Texture);
                 SetTextureFilter(record.Texture, TEXTURE_FILTER_ANISOTROPIC_16X);
-                record.ImageSize += record.ImageSize / 3;
             }
 
+            // six faces of the texture size
+            record.ImageSize = 6 * TextureCompression::GetTextureSize(record.Texture.width, record.Texture.height, record.Texture.mipmaps, record.Texture.format);
+
             UsedVRam += record.ImageSize;
+            TextureCache.SetSize(hash, 0, record.ImageSize);
             UnloadImage(image);
 
             return record.Texture;
@@ -221,23 +455,136 @@ namespace TextureManager
 
     void UnloadAll()
     {
+        // nothing can still be loading into the records
+        AsyncLoader::CompleteAll();
+
         for (auto& [hash, textureRecord] : LoadedTextures)
         {
+            if (!textureRecord.Loaded)
+                continue;
+
             UsedVRam -= textureRecord.ImageSize;
             UnloadTexture(textureRecord.Texture);
         }
 
         LoadedTextures.clear();
+        TextureCache.Clear();
+
+        for (auto& record : RetiredTextures)
+        {
+            UsedVRam -= record.ImageSize;
+            UnloadTexture(record.Texture);
+        }
+        RetiredTextures.clear();
 
         for (auto& [hash, shader] : LoadedShaders)
         {
             UnloadShader(shader);
         }
         LoadedShaders.clear();
+        ShaderSources.clear();
     }
 
     size_t GetUsedVRAM()
     {
         return UsedVRam;
     }
+
+    // true if a texture is loaded from a file, either the file it was asked for or the precompressed version of it
+    static bool IsTextureSource(const TextureRecord& record, const std::string& fileName)
+    {
+        std::string name = PackFormat::NormalizePath(record.Name);
+        return name == fileName || GetCompressedTextureName(name) == fileName;
+    }
+
+    bool ReloadTexture(std::string_view fileName)
+    {
+        std::string file = PackFormat::NormalizePath(fileName);
+
+        bool replaced = false;
+
+        for (auto& [hash, record] : LoadedTextures)
+        {
+            // a texture still loading reads the new file anyway, cubemaps are only built when the scene is set up
+            if (!record.Loaded || record.LoadJob || record.Cubemap || !IsTextureSource(record, file))
+                continue;
+
+            Image image = DecodeTexture(record.Name);
+            if (!IsImageValid(image))
+            {
+                TraceLog(LOG_WARNING, "TEXTURE: Unable to reload %s, keeping the old texture", record.Name.c_str());
+                continue;
+            }
+
+            Texture2D& texture = record.Texture;
+
+            // the same layout is written into the existing texture, so every copy of it sees the change
+            if (image.width == texture.width && image.height == texture.height && image.format == texture.format
+                && image.mipmaps <= 1 && !TextureCompression::IsCompressedFormat(image.format))
+            {
+                UpdateTexture(texture, image.data);
+                if (texture.mipmaps > 1)
+                    GenTextureMipmaps(&texture);
+            }
+            else
+            {
+                TextureRecord& retired = RetiredTextures.emplace_back();
+                retired.Texture = record.Texture;
+                retired.ImageSize = record.ImageSize;
+
+                UsedVRam -= record.ImageSize;
+                LoadTextureRecord(record, image);
+                UsedVRam += retired.ImageSize;
+
+                replaced = true;
+            }
+
+            UnloadImage(image);
+            TraceLog(LOG_INFO, "TEXTURE: Reloaded %s", record.Name.c_str());
+        }
+
+        return replaced;
+    }
+
+    bool ReloadShaders(std::string_view fileName)
+    {
+        std::string file = PackFormat::NormalizePath(fileName);
+
+        bool reloaded = false;
+
+        for (auto& [hash, source] : ShaderSources)
+        {
+            if (PackFormat::NormalizePath(source.Vertex) != file && PackFormat::NormalizePath(source.Fragment) != file)
+                continue;
+
+            auto vertexResource = ResourceManager::OpenResource(source.Vertex, true);
+            auto fragmentResource = ResourceManager::OpenResource(source.Fragment, true);
+
+            const char* vertexText = vertexResource ? (char*)(vertexResource->DataBuffer) : nullptr;
+            const char* fragmentText = fragmentResource ? (char*)(fragmentResource->DataBuffer) : nullptr;
+
+            Shader shader = LoadShaderFromMemory(vertexText, fragmentText);
+
+            ResourceManager::ReleaseResource(vertexResource);
+            ResourceManager::ReleaseResource(fragmentResource);
+
+            // a shader that doesn't compile leaves the old one running, the compile errors are in the log
+            if (shader.id == rlGetShaderIdDefault())
+            {
+                TraceLog(LOG_WARNING, "SHADER: Unable to reload %s, keeping the old shader", file.c_str());
+                continue;
+            }
+
+            auto itr = LoadedShaders.find(hash);
+            if (itr != LoadedShaders.end())
+            {
+                UnloadShader(itr->second);
+                itr->second = shader;
+            }
+
+            reloaded = true;
+        }
+
+        return reloaded;
+    }
 };
\ No newline at end of file
@@ -29,5 +29,6 @@ void System::AddObject(GameObject* object)
 
 void System::RemoveObject(GameObject* object)
 {
+    OnRemoveObject(object);
     Objects.erase(object);
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "systems/audio_system.h"
 
+#include "services/async_loader.h"
 #include "services/table_manager.h"
 #include "services/resource_manager.h"
 #include "services/global_vars.h"
@@ -43,9 +44,33 @@ void AudioSystem::OnUpdate()
     if (!AudioReady)
         return;
 
+    UpdateSoundReferences();
+
     // TODO handle music updates
 }
 
+void AudioSystem::UpdateSoundReferences()
+{
+    std::vector<size_t> released;
+
+    for (auto& [key, sound] : LoadedSounds)
+    {
+        bool inUse = sound.Instance.use_count() > 1 || sound.Instance->IsAnyPlaying();
+        if (inUse == sound.InUse)
+            continue;
+
+        sound.InUse = inUse;
+        if (inUse)
+            SoundCache.AddReference(key);
+        else
+            released.push_back(key);
+    }
+
+    // releasing can evict, which changes the map
+    for (size_t key : released)
+        SoundCache.ReleaseReference(key);
+}
+
 void AudioSystem::OnCleaup()
 {
     if (!AudioReady)
@@ -57,29 +82,50 @@ void AudioSystem::OnCleaup()
 
 SoundInstance::Ptr AudioSystem::GetSound(const std::string& name)
 {
-    auto itr = LoadedSounds.find(name);
+    size_t key = StringHasher(name);
+
+    auto itr = LoadedSounds.find(key);
     if (itr != LoadedSounds.end())
-        return itr->second;
+        return itr->second.Instance;
 
     if (!AudioManifestTable || !AudioManifestTable->contains(name))
         return nullptr;
 
-    std::string_view file = AudioManifestTable->GetField(name);
-    auto resource = ResourceManager::OpenResource(file);
-    if (!resource)
+    std::string fileName(AudioManifestTable->GetField(name));
+    if (!ResourceManager::HasResource(fileName))
         return nullptr;
 
-    Wave wave = LoadWaveFromMemory(GetFileExtension(file.data()), resource->DataBuffer, int(resource->DataSize));
-    ResourceManager::ReleaseResource(resource);
+    // the instance is silent until the sound is loaded
+    SoundInstance::Ptr instance = std::make_shared<SoundInstance>(Sound{ 0 });
+    LoadedSounds.insert_or_assign(key, LoadedSound{ instance });
+    SoundCache.Add(key, 0);
 
-    Sound sound = LoadSoundFromWave(wave);
-    UnloadWave(wave);
+    auto wave = std::make_shared<Wave>();
 
-    if (!IsSoundValid(sound))
-        return nullptr;
+    AsyncLoader::QueueLoad([wave, fileName]()
+        {
+            auto resource = ResourceManager::OpenResource(fileName);
+            if (!resource)
+                return;
+
+            *wave = LoadWaveFromMemory(GetFileExtension(fileName.c_str()), resource->DataBuffer, int(resource->DataSize));
+            ResourceManager::ReleaseResource(resource);
+        },
+        [this, key, wave, instance]()
+        {
+            if (IsWaveValid(*wave))
+            {
+                Sound sound = LoadSoundFromWave(*wave);
+                if (IsSoundValid(sound))
+                {
+                    instance->SetSource(sound);
+                    SoundCache.SetSize(key, size_t(sound.frameCount) * sound.stream.channels * sound.stream.sampleSize / 8);
+                }
+            }
+
+            UnloadWave(*wave);
+        });
 
-    SoundInstance::Ptr instance = std::make_shared<SoundInstance>(sound);
-    LoadedSounds.insert_or_assign(name, instance);
     return instance;
 }
 
@@ -116,6 +162,20 @@ void SoundInstance::StopAll()
         StopSound(SourceSound);
 }
 
+bool SoundInstance::IsAnyPlaying() const
+{
+    if (IsSoundPlaying(SourceSound))
+        return true;
+
+    for (const auto& alias : Aliases)
+    {
+        if (IsSoundPlaying(alias))
+            return true;
+    }
+
+    return false;
+}
+
 const Sound& SoundInstance::GetSound(int instanceID) const
 {
     if (instanceID == 0)
@@ -145,6 +205,18 @@ SoundInstance::SoundInstance(Sound sound) : SourceSound(sound)
 {
 }
 
+void SoundInstance::SetSource(Sound sound)
+{
+    StopAll();
+
+    for (auto& alias : Aliases)
+        UnloadSoundAlias(alias);
+    Aliases.clear();
+
+    UnloadSound(SourceSound);
+    SourceSound = sound;
+}
+
 SoundInstance::~SoundInstance()
 {
     for (auto& alias : Aliases)
@@ -1,16 +1,33 @@
 #include "systems/console_render_system.h"
 #include "services/game_time.h"
+#include "services/async_loader.h"
 #include "services/global_vars.h"
+#include "services/hot_reload.h"
+#include "services/model_manager.h"
+#include "services/pathfinding.h"
+#include "services/resource_cache.h"
+#include "services/resource_manager.h"
+#include "services/texture_manager.h"
 #include "components/trigger_component.h"
+#include "systems/map_object_system.h"
+#include "systems/mobile_object_system.h"
+#include "systems/player_management_system.h"
+#include "systems/perception_system.h"
+#include "systems/ray_query_system.h"
+#include "map/map_reader.h"
 #include "utilities/string_utils.h"
+#include "utilities/swept_collision.h"
+#include "utilities/texture_compression.h"
 #include "utilities/debug_draw_utility.h"
 
+#include "game.h"
 #include "scene.h"
 #include "raylib.h"
 
 #include <string>
 #include <stdarg.h>
 #include <algorithm>
+#include <chrono>
 
 static constexpr float AnimationTime = 0.5f;
 static constexpr float ConsoleSizeParam = 0.5f;
@@ -41,14 +58,15 @@ ConsoleRenderSystem::ConsoleRenderSystem() : System()
 			if (!LastConsole)
 				return;
 
-			static char logText[2048] = { 0 };
+			char logText[2048] = { 0 };
 
 			std::string log = GetLogLevelName(logLevel);
-			vsprintf(logText, text, args);
+			vsnprintf(logText, sizeof(logText), text, args);
 			log += " ";
 			log += logText;
 
-			LastConsole->ConsoleOutput.push_front(log);
+			std::lock_guard<std::mutex> lock(LastConsole->PendingLogMutex);
+			LastConsole->PendingLog.push_front(log);
 
 #if defined(_DEBUG)
 			printf("%s : %s\n", log.c_str(), logText);
@@ -152,10 +170,352 @@ void ConsoleRenderSystem::OnSetup()
 
             OutputMessage(TextFormat("FPS Cap = %d", GlobalVars::FPSCap));
         });
+
+    RegisterCommand(ConsoleCommands::ToggleAnimationLOD,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            GlobalVars::UseAnimationLOD = !GlobalVars::UseAnimationLOD;
+            OutputVarState("UseAnimationLOD", GlobalVars::UseAnimationLOD);
+        });
+
+    RegisterCommand(ConsoleCommands::ToggleAsyncLoading,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            GlobalVars::UseAsyncLoading = !GlobalVars::UseAsyncLoading;
+            OutputVarState("UseAsyncLoading", GlobalVars::UseAsyncLoading);
+            OutputMessage(TextFormat("Pending loads = %d", int(AsyncLoader::GetPendingCount())));
+        });
+
+    RegisterCommand(ConsoleCommands::ToggleLooseFiles,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            GlobalVars::UseLooseFileOverlay = !GlobalVars::UseLooseFileOverlay;
+            OutputVarState("UseLooseFileOverlay", GlobalVars::UseLooseFileOverlay);
+            OutputMessage(TextFormat("Mounted packs = %d, entries = %d", int(ResourceManager::GetMountedPackCount()), int(ResourceManager::GetPackEntryCount())));
+        });
+
+    RegisterCommand(ConsoleCommands::ToggleCacheStats,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            GlobalVars::ShowCacheStats = !GlobalVars::ShowCacheStats;
+            OutputVarState("ShowCacheStats", GlobalVars::ShowCacheStats);
+        });
+
+    RegisterCommand(ConsoleCommands::ToggleCompressedTextures,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            // only changes textures loaded from now on
+            GlobalVars::UseCompressedTextures = !GlobalVars::UseCompressedTextures;
+            OutputVarState("UseCompressedTextures", GlobalVars::UseCompressedTextures);
+            OutputMessage(TextFormat("Texture VRAM = %dkb", int(TextureManager::GetUsedVRAM() / 1024)));
+        });
+
+    RegisterCommand(ConsoleCommands::ToggleHotReload,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            GlobalVars::UseHotReload = !GlobalVars::UseHotReload;
+            HotReload::SetEnabled(GlobalVars::UseHotReload);
+            OutputVarState("UseHotReload", GlobalVars::UseHotReload);
+
+            if (GlobalVars::UseHotReload)
+                OutputMessage(HotReload::UsesNotifications() ? "Watching for changes with inotify" : "Polling for changes");
+        });
+
+    RegisterCommand(ConsoleCommands::ToggleCrowdSeparation,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            GlobalVars::UseCrowdSeparation = !GlobalVars::UseCrowdSeparation;
+            OutputVarState("UseCrowdSeparation", GlobalVars::UseCrowdSeparation);
+        });
+
+    RegisterCommand(ConsoleCommands::SetCacheBudget,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            ResourceCache* cache = args.size() > 2 ? ResourceCache::FindCache(args[1]) : nullptr;
+            if (!cache)
+            {
+                OutputMessage("set_cache_budget <cache> <cpu kb> [gpu kb], 0 is no limit");
+                for (const auto* cache : ResourceCache::GetCaches())
+                    OutputMessage(TextFormat("%s cpu %dkb gpu %dkb", cache->GetName().c_str(), int(cache->GetCPUBudget() / 1024), int(cache->GetGPUBudget() / 1024)));
+                return;
+            }
+
+            size_t cpuBudget = size_t(atoll(args[2].c_str())) * 1024;
+            size_t gpuBudget = args.size() > 3 ? size_t(atoll(args[3].c_str())) * 1024 : cache->GetGPUBudget();
+            cache->SetBudget(cpuBudget, gpuBudget);
+
+            OutputMessage(TextFormat("%s budget cpu %dkb gpu %dkb", cache->GetName().c_str(), int(cpuBudget / 1024), int(gpuBudget / 1024)));
+        });
+
+    RegisterCommand(ConsoleCommands::SetRegionBudget,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            if (args.size() > 1)
+                GlobalVars::MaxLoadedRegions = std::max(atoi(args[1].c_str()), 1);
+
+            // the change is applied by the streaming system on the next frame
+            const Map& map = App::GetScene().GetMap();
+            for (const auto& region : map.Regions)
+                OutputMessage(TextFormat("%s %s", region.Name.c_str(), region.Loaded ? "loaded" : "unloaded"));
+
+            OutputMessage(TextFormat("Region budget = %d, %d of %d loaded", GlobalVars::MaxLoadedRegions, int(App::GetScene().GetLoadedRegionCount()), int(map.Regions.size())));
+        });
+
+    RegisterCommand(ConsoleCommands::ShowMapLoadReport,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            const MapLoadReport& report = GetMapLoadReport();
+            if (report.MapName.empty())
+            {
+                OutputMessage("No map has been loaded");
+                return;
+            }
+
+            OutputMessage(TextFormat("%s loaded in %.1fms", report.MapName.c_str(), report.TotalMS));
+            OutputMessage(TextFormat("parse %.1fms", report.ParseMS));
+            OutputMessage(TextFormat("decode %.1fms, %d chunks", report.DecodeMS, int(report.ChunkCount)));
+            OutputMessage(TextFormat("collect %.1fms, %d assets", report.CollectMS, int(report.AssetCount)));
+            OutputMessage(TextFormat("prefetch %.1fms", report.PrefetchMS));
+            OutputMessage(TextFormat("spawn %.1fms, %d entities", report.SpawnMS, int(report.EntityCount)));
+        });
+
+    RegisterCommand(ConsoleCommands::BenchmarkPaths,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            int size = 1024;
+            int queries = 200;
+            if (args.size() > 1)
+                size = atoi(args[1].c_str());
+            if (args.size() > 2)
+                queries = atoi(args[2].c_str());
+
+            auto report = Pathfinding::RunBenchmark(size, queries, uint32_t(GetRandomValue(0, 0x7fffffff)));
+
+            OutputMessage(TextFormat("%d paths on a %dx%d map, %d found", report.Queries, report.MapSize, report.MapSize, report.Found));
+            OutputMessage(TextFormat("JPS %.2fms, %.3fms per path, %d nodes", report.JPSMS, report.JPSMS / report.Queries, int(report.JPSExpanded)));
+            OutputMessage(TextFormat("A* %.2fms, %.3fms per path, %d nodes", report.AStarMS, report.AStarMS / report.Queries, int(report.AStarExpanded)));
+            OutputMessage(TextFormat("HPA* %.2fms, %.3fms per path, %d nodes, %d clusters, %.1f%% longer",
+                report.HierarchicalMS, report.HierarchicalMS / report.Queries, int(report.HierarchicalExpanded), int(report.ClustersBuilt), report.HierarchicalOverhead));
+            OutputMessage(TextFormat("HPA* again %.2fms, %.3fms per path, %d cached routes used", report.HierarchicalCachedMS, report.HierarchicalCachedMS / report.Queries, int(report.CacheHits)));
+            if (report.Mismatches > 0)
+                OutputMessage(TextFormat("%d paths did not match", report.Mismatches));
+        });
+
+    RegisterCommand(ConsoleCommands::BenchmarkRays,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            int count = 4096;
+            if (args.size() > 1)
+                count = std::max(atoi(args[1].c_str()), 1);
+
+            // rays from the player's eye in every direction, a little up or down, like a spray of shotgun pellets
+            Vector3 eye = App::GetSystem<PlayerManagementSystem>()->GetPlayerPos();
+            eye.z += 0.5f;
+
+            std::vector<RayQuery> queries(count);
+            for (auto& query : queries)
+            {
+                float angle = GetRandomValue(0, 3600) * 0.1f * DEG2RAD;
+                query.Origin = eye;
+                query.Direction = Vector3{ cosf(angle), sinf(angle), GetRandomValue(-100, 100) * 0.002f };
+                query.MaxDistance = 64;
+                query.Ignore = App::GetSystem<PlayerManagementSystem>()->GetPlayerObject();
+            }
+
+            auto* rays = App::GetSystem<RayQuerySystem>();
+            std::vector<RayHit> hits;
+
+            auto start = std::chrono::steady_clock::now();
+            for (const auto& query : queries)
+            {
+                RayHit hit;
+                rays->CastRay(query, hit);
+            }
+            auto batchStart = std::chrono::steady_clock::now();
+            rays->CastRays(queries, hits);
+            auto end = std::chrono::steady_clock::now();
+
+            double singleMS = std::chrono::duration<double, std::milli>(batchStart - start).count();
+            double batchMS = std::chrono::duration<double, std::milli>(end - batchStart).count();
+
+            int counts[8] = { 0 };
+            for (const auto& hit : hits)
+                counts[size_t(hit.Type)]++;
+
+            OutputMessage(TextFormat("%d rays, one at a time %.3fms, batched %.3fms, %d bodies", count, singleMS, batchMS, int(rays->GetWorld().GetBodyCount())));
+            OutputMessage(TextFormat("Walls %d, doors %d, floor %d, ceiling %d, objects %d, mobs %d, missed %d",
+                counts[size_t(RayHitType::Wall)], counts[size_t(RayHitType::Door)], counts[size_t(RayHitType::Floor)], counts[size_t(RayHitType::Ceiling)],
+                counts[size_t(RayHitType::Object)], counts[size_t(RayHitType::Mob)], counts[size_t(RayHitType::None)]));
+        });
+
+    RegisterCommand(ConsoleCommands::SpawnCrowd,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            int count = 1000;
+            if (args.size() > 1)
+                count = atoi(args[1].c_str());
+
+            size_t spawned = App::GetSystem<MobSystem>()->SpawnCrowd(size_t(std::max(count, 0)), 16);
+            OutputMessage(TextFormat("Spawned %d mobs around the player", int(spawned)));
+        });
+
+    RegisterCommand(ConsoleCommands::ShowCrowdReport,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            auto report = App::GetSystem<MobSystem>()->TakeCrowdReport();
+            if (report.Frames == 0)
+            {
+                OutputMessage("No crowd frames since the last report");
+                return;
+            }
+
+            OutputMessage(TextFormat("%d frames, %d agents, %d overlaps, %d batches", int(report.Frames), int(report.Agents), int(report.Overlaps), int(report.Batches)));
+            OutputMessage(TextFormat("Gather %.3fms, grid %.3fms, solve %.3fms, apply %.3fms",
+                report.GatherMS, report.GridMS, report.SolveMS, report.ApplyMS));
+            OutputMessage(TextFormat("Total %.3fms per frame", report.GatherMS + report.GridMS + report.SolveMS + report.ApplyMS));
+        });
+
+    RegisterCommand(ConsoleCommands::ShowPerceptionReport,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            auto report = App::GetSystem<PerceptionSystem>()->TakePerceptionReport();
+            if (report.Frames == 0)
+            {
+                OutputMessage("No perception frames since the last report");
+                return;
+            }
+
+            OutputMessage(TextFormat("%d frames, %d mobs, %d can see the player", int(report.Frames), int(report.Mobs), int(report.CanSee)));
+            OutputMessage(TextFormat("Per frame %.1f out of sight, %.1f in visible cells, %.1f cached, %.1f waiting, %.1f rays",
+                report.OutOfSight, report.VisibleCells, report.Cached, report.Waiting, report.Rays));
+            OutputMessage(TextFormat("%.3fms per frame", report.MS));
+        });
+
+    RegisterCommand(ConsoleCommands::ShowBehaviorReport,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            auto report = App::GetSystem<MobSystem>()->TakeBehaviorReport();
+            if (report.Frames == 0)
+            {
+                OutputMessage("No behavior frames since the last report");
+                return;
+            }
+
+            OutputMessage(TextFormat("%d frames, %d behaviors, %d mobs", int(report.Frames), int(report.Behaviors), int(report.Agents)));
+            OutputMessage(TextFormat("%.1f trees evaluated, %.3fms per frame", report.Evaluations, report.MS));
+        });
+
+    RegisterCommand(ConsoleCommands::ShowDoorReport,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            auto* mapObjects = App::GetSystem<MapObjectSystem>();
+            OutputMessage(TextFormat("%d doors, %d active, %d cells changed last frame, %d started or stopped blocking",
+                int(mapObjects->GetDoorCount()), int(mapObjects->GetActiveDoorCount()), int(mapObjects->GetChangedDoorCells().size()),
+                int(mapObjects->GetBlockingChangedDoorCells().size())));
+        });
+
+    RegisterCommand(ConsoleCommands::SetPerceptionBudget,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            if (args.size() < 2)
+                GlobalVars::PerceptionRaysPerFrame = 32;
+            else
+                GlobalVars::PerceptionRaysPerFrame = std::max(atoi(args[1].c_str()), 0);
+
+            OutputMessage(TextFormat("Perception budget = %d rays per frame", GlobalVars::PerceptionRaysPerFrame));
+        });
+
+    RegisterCommand(ConsoleCommands::SetUploadBudget,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            if (args.size() < 2)
+                GlobalVars::UploadBudgetMS = 4;
+            else
+                GlobalVars::UploadBudgetMS = float(atof(args[1].c_str()));
+
+            OutputMessage(TextFormat("Upload Budget = %fms", GlobalVars::UploadBudgetMS));
+        });
+
+    RegisterCommand(ConsoleCommands::SetAnimationLODScale,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            if (args.size() < 2)
+                GlobalVars::AnimationLODScale = 1;
+            else
+                GlobalVars::AnimationLODScale = float(atof(args[1].c_str()));
+
+            OutputMessage(TextFormat("Animation LOD Distance Scale = %f", GlobalVars::AnimationLODScale));
+        });
+
+    RegisterCommand(ConsoleCommands::CheckAnimationKernel,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            int samples = 8;
+            if (args.size() >= 2)
+                samples = atoi(args[1].c_str());
+
+            samples = std::max(samples, 1);
+
+            // on a keyframe the kernel and InterpolatePose do the same math, so anything past rounding is a bug in the kernel
+            float keyframeError = ModelManager::GetPoseKernelError(1);
+            bool keyframesPassed = keyframeError <= Models::PackedPoseKeyframeTolerance;
+            OutputMessage(TextFormat("Animation kernel keyframes %s, error = %g, tolerance = %g",
+                keyframesPassed ? "passed" : "FAILED", keyframeError, Models::PackedPoseKeyframeTolerance));
+
+            float blendError = ModelManager::GetPoseKernelError(samples);
+            bool blendsPassed = blendError <= Models::PackedPoseBlendTolerance;
+            OutputMessage(TextFormat("Animation kernel blends %s at %d samples per frame, error = %g, tolerance = %g",
+                blendsPassed ? "passed" : "FAILED", samples, blendError, Models::PackedPoseBlendTolerance));
+        });
+
+    RegisterCommand(ConsoleCommands::CheckCollision,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            std::vector<std::string> failures;
+            int failed = SweptCollision::RunRegressionChecks(failures);
+
+            for (const auto& failure : failures)
+                OutputMessage(failure);
+
+            OutputMessage(failed == 0 ? "Collision checks passed" : TextFormat("%d collision checks failed", failed));
+        });
+
+    RegisterCommand(ConsoleCommands::CheckModelReader,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            std::vector<std::string> failures;
+            int failed = ModelManager::RunReaderChecks(failures);
+
+            for (const auto& failure : failures)
+                OutputMessage(failure);
+
+            OutputMessage(failed == 0 ? "Model reader checks passed" : TextFormat("%d model reader checks failed", failed));
+        });
+
+    RegisterCommand(ConsoleCommands::CheckTextureCompression,
+        [this](std::string_view command, const std::vector<std::string>& args)
+        {
+            std::vector<std::string> failures;
+            int failed = TextureCompression::RunRegressionChecks(failures);
+
+            for (const auto& failure : failures)
+                OutputMessage(failure);
+
+            OutputMessage(failed == 0 ? "Texture compression checks passed" : TextFormat("%d texture compression checks failed", failed));
+        });
 }
 
 void ConsoleRenderSystem::OnUpdate()
 {
+	{
+		std::lock_guard<std::mutex> lock(PendingLogMutex);
+		while (!PendingLog.empty())
+		{
+			ConsoleOutput.push_front(std::move(PendingLog.back()));
+			PendingLog.pop_back();
+		}
+	}
+
 	float animationTime = 0.125f;
 
 	// animation and state changes
@@ -6,13 +6,17 @@
 #include "components/transform_component.h"
 #include "components/trigger_component.h"
 #include "components/door_controller_component.h"
-#include "services/model_manager.h"
+#include "services/game_time.h"
 #include "services/global_vars.h"
+#include "services/model_manager.h"
+#include "services/pathfinding.h"
 
-#include "utilities/collision_utils.h"
+#include "utilities/swept_collision.h"
 
 #include "raymath.h"
 
+#include <algorithm>
+
 
 void MapObjectSystem::OnSetup()
 {
@@ -39,13 +43,22 @@ void MapObjectSystem::OnSetup()
 
 void MapObjectSystem::OnUpdate()
 {
-    for (auto* door : Doors.Components)
-        door->Update();
+    // models can be reloaded with different bounds, so the boxes are gathered again each frame
+    SolidBoundsDirty = true;
+
+    // before the triggers, so a door that was just spawned can be walked into
+    AddPendingDoors();
+
+    // before the doors, so they see who walked into them last frame
+    UpdateTriggers();
+
+    UpdateDoors();
 }
 
 void MapObjectSystem::OnAddObject(GameObject* object)
 {
     auto* mapObject = MapObjects.Add(object);
+    SolidBoundsDirty = true;
 
     if (mapObject)
     {
@@ -55,8 +68,13 @@ void MapObjectSystem::OnAddObject(GameObject* object)
             SceneRenderer->MapObjectAdded(mapObject);
     }
 
-    Triggers.Add(object);
-    Doors.Add(object);
+    if (Triggers.Add(object))
+        TriggersDirty = true;
+
+    auto* door = Doors.Add(object);
+    if (door && door->DoorIndex == DoorControllerComponent::NoDoorIndex
+        && std::find(PendingDoors.begin(), PendingDoors.end(), door) == PendingDoors.end())
+        PendingDoors.push_back(door);
 }
 
 template<class T>
@@ -79,6 +97,24 @@ bool FindAndErase(GameObject* object, std::vector<T*>& container)
 void MapObjectSystem::OnRemoveObject(GameObject* object)
 {
     MapObjects.Remove(object);
+    SolidBoundsDirty = true;
+
+    auto* trigger = object->GetComponent<TriggerComponent>();
+    if (trigger)
+    {
+        // nothing is in a trigger that is gone, and no events are sent for it
+        for (auto& [entity, occupant] : TriggerOccupants)
+            std::erase(occupant.Inside, trigger);
+
+        std::erase_if(TriggerEvents, [trigger](const TriggerEvent& event) { return event.Trigger == trigger; });
+
+        TriggersDirty = true;
+    }
+
+    auto* door = object->GetComponent<DoorControllerComponent>();
+    if (door)
+        RemoveDoor(door);
+
     Triggers.Remove(object);
     Doors.Remove(object);
 }
@@ -92,130 +128,432 @@ void MapObjectSystem::CheckTriggers(GameObject* entity, float radius, bool hitSo
     if (!transform)
         return;
 
-    Vector2 pos = { transform->Position.x, transform->Position.y };
+    TriggerMovers.emplace_back(TriggerMover{ entity->GetToken(), Vector2{ transform->Position.x, transform->Position.y }, radius });
+}
+
+void MapObjectSystem::BuildTriggerGrid()
+{
+    TriggerList.assign(Triggers.Components.begin(), Triggers.Components.end());
+
+    TriggerBounds.clear();
+    for (auto* trigger : TriggerList)
+        TriggerBounds.push_back(trigger->Bounds);
+
+    TriggerGrid.BuildBoxes(TriggerBounds.data(), TriggerBounds.size(), TriggerGridCellSize);
 
-    for (auto& trigger : Triggers.Components)
+    TriggerStamps.assign(TriggerList.size(), 0);
+    TriggerStamp = 0;
+
+    TriggersDirty = false;
+}
+
+void MapObjectSystem::UpdateTriggers()
+{
+    // the bounds are set after the component is added, so the grid is built when it is first needed
+    if (TriggersDirty)
+        BuildTriggerGrid();
+
+    std::erase_if(TriggerOccupants, [](const auto& entry) { return !entry.second.Token->IsValid(); });
+
+    for (const auto& mover : TriggerMovers)
     {
-        if (CheckCollisionCircleRec(pos, radius, trigger->Bounds))
-        {
-            if (!entity->HasFlag(trigger))
+        if (!mover.Token->IsValid())
+            continue;
+
+        // only the triggers in the grid cells around the entity are tested
+        TriggersTouched.clear();
+        TriggerStamp++;
+
+        TriggerGrid.ForEachInRange(mover.Position.x - mover.Radius, mover.Position.y - mover.Radius, mover.Position.x + mover.Radius, mover.Position.y + mover.Radius,
+            [&](size_t index)
             {
-                entity->AddFlag(trigger);
-                trigger->AddObject(entity->GetToken());
-                trigger->GetOwner()->CallEvent(TriggerComponent::TriggerEnter, entity);
-            }
+                if (TriggerStamps[index] == TriggerStamp)
+                    return;
+
+                TriggerStamps[index] = TriggerStamp;
+                if (CheckCollisionCircleRec(mover.Position, mover.Radius, TriggerBounds[index]))
+                    TriggersTouched.push_back(TriggerList[index]);
+            });
+
+        GameObject* entity = mover.Token->GetOwner<GameObject>();
+        auto& occupant = TriggerOccupants[entity];
+        if (occupant.Token != mover.Token)
+        {
+            // a new entity, or a new one where a destroyed one used to be
+            occupant.Token = mover.Token;
+            occupant.Inside.clear();
+        }
+
+        // only the differences from last time make events, an entity is only ever in a few triggers
+        for (auto* trigger : occupant.Inside)
+        {
+            if (std::find(TriggersTouched.begin(), TriggersTouched.end(), trigger) == TriggersTouched.end())
+                TriggerEvents.emplace_back(TriggerEvent{ trigger, mover.Token, false });
         }
-        else if (entity->HasFlag(trigger))
+
+        for (auto* trigger : TriggersTouched)
         {
-            trigger->RemovObject(entity->GetToken());
-            entity->ClearFlag(trigger);
-            trigger->GetOwner()->CallEvent(TriggerComponent::TriggerExit, entity);
+            if (std::find(occupant.Inside.begin(), occupant.Inside.end(), trigger) == occupant.Inside.end())
+                TriggerEvents.emplace_back(TriggerEvent{ trigger, mover.Token, true });
         }
+
+        occupant.Inside.swap(TriggersTouched);
     }
+
+    TriggerMovers.clear();
+
+    // every trigger knows who is in it before any events go out, so a door doesn't close on one mob as another walks in
+    for (const auto& event : TriggerEvents)
+    {
+        if (event.Enter)
+            event.Trigger->AddObject(event.Entity);
+        else
+            event.Trigger->RemovObject(event.Entity);
+    }
+
+    // by index and a copy of each, a handler that removes a trigger takes its events out of the list
+    for (size_t i = 0; i < TriggerEvents.size(); i++)
+    {
+        TriggerEvent event = TriggerEvents[i];
+        if (!event.Entity->IsValid())
+            continue;
+
+        event.Trigger->GetOwner()->CallEvent(event.Enter ? TriggerComponent::TriggerEnter : TriggerComponent::TriggerExit, event.Entity->GetOwner<GameObject>());
+    }
+
+    TriggerEvents.clear();
 }
 
 bool MapObjectSystem::MoveEntity(Vector3& position, Vector3& desiredMotion, float radius, GameObject* entity)
 {
-    bool hitSomething = false;
-
     if (Vector3Equals(desiredMotion, Vector3Zeros))
         return false;
 
-    Vector3 newPos = position + desiredMotion;
+    return SweptCollision::MoveCircle(App::GetScene().GetMap(), GetSolidBounds(), position, desiredMotion, radius);
+}
+
+const std::vector<Rectangle>& MapObjectSystem::GetSolidBounds()
+{
+    if (!SolidBoundsDirty)
+        return SolidBounds;
 
+    SolidBounds.clear();
     for (auto* object : MapObjects.Components)
     {
-        if (!object->Solid)
+        if (!object->Solid || !object->Instance || !object->Instance->Geometry)
             continue;
 
-        float motionVecLen = Vector3Length(desiredMotion);
-        if (motionVecLen < FLT_MIN)
-            break;
-
         BoundingBox bbox = object->Instance->Geometry->GetBounds();
+        TransformComponent& transform = object->GetOwner()->MustGetComponent<TransformComponent>();
 
-        Vector3 targetVec = desiredMotion / motionVecLen;
+        SolidBounds.push_back(Rectangle{ transform.Position.x + bbox.min.x, transform.Position.y + bbox.min.y, bbox.max.x - bbox.min.x, bbox.max.y - bbox.min.y });
+    }
 
-        TransformComponent& transform = object->GetOwner()->MustGetComponent<TransformComponent>();
+    SolidBoundsDirty = false;
+    return SolidBounds;
+}
 
-        // check bounds
+void MapObjectSystem::AddPendingDoors()
+{
+    for (auto* door : PendingDoors)
+    {
+        door->DoorIndex = DoorTable.Controllers.size();
+
+        DoorTable.Controllers.push_back(door);
+        DoorTable.States.push_back(DoorState::Closed);
+        DoorTable.Params.push_back(0);
+        DoorTable.OpenSpeeds.push_back(door->OpenSpeed);
+        DoorTable.CloseSpeeds.push_back(door->CloseSpeed);
+        DoorTable.MinimumOpenTimes.push_back(door->MiniumOpenTime);
+        DoorTable.WaitTimes.push_back(0);
+
+        uint8_t flags = 0;
+        if (door->MustOpenBeforClose)
+            flags |= DoorFlags::MustOpenBeforeClose;
+        if (door->StayOpen)
+            flags |= DoorFlags::StayOpen;
+        DoorTable.Flags.push_back(flags);
+
+        DoorTable.FirstCells.push_back(uint32_t(DoorTable.Cells.size()));
+        DoorTable.CellCounts.push_back(uint32_t(door->Doors.size()));
+        DoorTable.Cells.insert(DoorTable.Cells.end(), door->Doors.begin(), door->Doors.end());
+    }
 
-        if (false)
-        {
-            Rectangle rect = { 0,0,0,0 };
-            rect.x = transform.Position.x + bbox.min.x;
-            rect.y = transform.Position.y + bbox.min.y;
-            rect.width = bbox.max.x - bbox.min.x;
-            rect.height = bbox.max.y - bbox.min.y;
+    PendingDoors.clear();
+}
 
-            Vector2 hitPoint2D = { -10000,-100000 };
-            Vector2 hitNormal2D = { 0, 0 };
+void MapObjectSystem::RemoveDoor(DoorControllerComponent* door)
+{
+    if (door->DoorIndex == DoorControllerComponent::NoDoorIndex)
+    {
+        std::erase(PendingDoors, door);
+        return;
+    }
 
-            Vector2 newPos2D = { newPos.x, newPos.y };
+    uint32_t index = uint32_t(door->DoorIndex);
+    uint32_t last = uint32_t(DoorTable.Controllers.size() - 1);
 
-            CollisionUtils::PointNearestRect(rect, newPos2D, &hitPoint2D, &hitNormal2D);
+    // close the gap its cells leave, the doors after it move down
+    uint32_t firstCell = DoorTable.FirstCells[index];
+    uint32_t cellCount = DoorTable.CellCounts[index];
+    DoorTable.Cells.erase(DoorTable.Cells.begin() + firstCell, DoorTable.Cells.begin() + firstCell + cellCount);
+    for (auto& first : DoorTable.FirstCells)
+    {
+        if (first > firstCell)
+            first -= cellCount;
+    }
 
-            Vector2 vectorToHit = hitPoint2D - newPos2D;
+    std::erase(ActiveDoors, index);
+    std::erase_if(DoorEvents, [door](const DoorEvent& event) { return event.Door == door; });
 
-            bool inside = Vector2LengthSqr(vectorToHit) < radius * radius;
+    // the last door takes its row
+    if (index != last)
+    {
+        DoorTable.Controllers[index] = DoorTable.Controllers[last];
+        DoorTable.States[index] = DoorTable.States[last];
+        DoorTable.Params[index] = DoorTable.Params[last];
+        DoorTable.OpenSpeeds[index] = DoorTable.OpenSpeeds[last];
+        DoorTable.CloseSpeeds[index] = DoorTable.CloseSpeeds[last];
+        DoorTable.MinimumOpenTimes[index] = DoorTable.MinimumOpenTimes[last];
+        DoorTable.WaitTimes[index] = DoorTable.WaitTimes[last];
+        DoorTable.Flags[index] = DoorTable.Flags[last];
+        DoorTable.FirstCells[index] = DoorTable.FirstCells[last];
+        DoorTable.CellCounts[index] = DoorTable.CellCounts[last];
+
+        DoorTable.Controllers[index]->DoorIndex = index;
+        std::replace(ActiveDoors.begin(), ActiveDoors.end(), last, index);
+    }
 
-            if (inside)
-            {
-                hitSomething = true;
-                // normalize the vector along the point to where we are nearest
-                vectorToHit = Vector2Normalize(vectorToHit);
+    DoorTable.Controllers.pop_back();
+    DoorTable.States.pop_back();
+    DoorTable.Params.pop_back();
+    DoorTable.OpenSpeeds.pop_back();
+    DoorTable.CloseSpeeds.pop_back();
+    DoorTable.MinimumOpenTimes.pop_back();
+    DoorTable.WaitTimes.pop_back();
+    DoorTable.Flags.pop_back();
+    DoorTable.FirstCells.pop_back();
+    DoorTable.CellCounts.pop_back();
+
+    door->DoorIndex = DoorControllerComponent::NoDoorIndex;
+}
 
-                // project that out to the radius to find the point that should be 'deepest' into the rectangle.
-                Vector2 projectedPoint = newPos2D + (vectorToHit * radius);
+void MapObjectSystem::ActivateDoor(uint32_t door)
+{
+    if (DoorTable.Flags[door] & DoorFlags::Active)
+        return;
 
-                // compute the shift to take the deepest point out to the edge of our nearest hit, based on the vector direction
-                Vector3 delta = { 0, 0, 0 };
+    DoorTable.Flags[door] |= DoorFlags::Active;
+    ActiveDoors.push_back(door);
+}
 
-                if (hitNormal2D.x != 0)
-                    delta.x = hitPoint2D.x - projectedPoint.x;
-                else
-                    delta.y = hitPoint2D.y - projectedPoint.y;
+void MapObjectSystem::SetDoorParam(uint32_t door, float param)
+{
+    Map& map = App::GetScene().GetMap();
 
-                // shift the new point by the delta to push us outside of the rectangle
-                newPos += delta;
-            }
-        }
+    uint8_t paramState = uint8_t(Clamp(param, 0, 1) * 255);
+
+    uint32_t end = DoorTable.FirstCells[door] + DoorTable.CellCounts[door];
+    for (uint32_t i = DoorTable.FirstCells[door]; i < end; i++)
+    {
+        auto& cell = map.GetCellRef(DoorTable.Cells[i]);
+        if (cell.ParamState == paramState)
+            continue;
+
+        cell.ParamState = paramState;
+        ChangedDoorCells.push_back(DoorTable.Cells[i]);
+    }
+}
+
+void MapObjectSystem::SetDoorBlocked(uint32_t door, bool blocked)
+{
+    Map& map = App::GetScene().GetMap();
+
+    uint32_t end = DoorTable.FirstCells[door] + DoorTable.CellCounts[door];
+    for (uint32_t i = DoorTable.FirstCells[door]; i < end; i++)
+    {
+        size_t cellIndex = DoorTable.Cells[i];
+        auto& cell = map.GetCellRef(cellIndex);
+
+        // this runs every frame the door moves, only tell the pathfinding about real changes
+        if (bool(cell.Flags & MapCellFlags::Impassible) == blocked)
+            continue;
+
+        Pathfinding::SetDoorOpen(MapCoordinate{ int(cellIndex % size_t(map.Size.X)), int(cellIndex / size_t(map.Size.X)) }, !blocked);
+
+        if (blocked)
+            cell.Flags |= MapCellFlags::Impassible;
         else
-        {
-            Vector3 hitPoint = { -10000,-100000, 0 };
-            Vector3 hitNormal = { 0, 0, 0 };
+            cell.Flags &= ~(MapCellFlags::Impassible);
+
+        ChangedDoorCells.push_back(cellIndex);
+        BlockingChangedDoorCells.push_back(cellIndex);
+    }
+}
+
+void MapObjectSystem::DoorTriggerEnter(DoorControllerComponent* door, GameObject* subject)
+{
+    if (door->DoorIndex == DoorControllerComponent::NoDoorIndex)
+        return;
+
+    uint32_t index = uint32_t(door->DoorIndex);
+    if (DoorTable.CellCounts[index] == 0)
+        return;
+
+    DoorState state = DoorTable.States[index];
+    if (state == DoorState::Open || state == DoorState::Opening)
+        return; // we are already in the right state, and update will handle it
+
+    // TODO, check security
+
+    // Start the open process
+    DoorTable.States[index] = DoorState::Opening;
+    DoorTable.Flags[index] &= ~DoorFlags::NeedCloseASAP;
+    ActivateDoor(index);
+
+    door->GetOwner()->CallEvent(DoorControllerComponent::DoorOpening, subject);
+}
+
+void MapObjectSystem::DoorTriggerExit(DoorControllerComponent* door, GameObject* sender, GameObject* subject)
+{
+    if (door->DoorIndex == DoorControllerComponent::NoDoorIndex)
+        return;
+
+    uint32_t index = uint32_t(door->DoorIndex);
+    if (DoorTable.CellCounts[index] == 0)
+        return;
+
+    DoorState state = DoorTable.States[index];
+    uint8_t flags = DoorTable.Flags[index];
+
+    if (state == DoorState::Closed || state == DoorState::Closing)
+        return; // we are already in the right state, and update will handle it
+
+    // do we have a valid trigger, and is anyone else still in it? if so, we can't close on them (TODO, what about security flags? have an 'allow murder' option?)
+    TriggerComponent* trigger = sender->GetComponent<TriggerComponent>();
+    if (trigger && trigger->HasAnyObjects())
+        return;
+
+    if (state == DoorState::Open && (flags & DoorFlags::StayOpen))
+        return;
+
+    // if the door must fully open before closing, then flag it as asap close
+    if ((flags & DoorFlags::MustOpenBeforeClose) && state == DoorState::Opening)
+    {
+        if (!(flags & DoorFlags::StayOpen))
+            DoorTable.Flags[index] |= DoorFlags::NeedCloseASAP;
+        return;
+    }
+
+    // start closing the door
+    DoorTable.States[index] = DoorState::Closing;
+    ActivateDoor(index);
+
+    door->GetOwner()->CallEvent(DoorControllerComponent::DoorClosing, subject);
+}
+
+void MapObjectSystem::UpdateDoors()
+{
+    ChangedDoorCells.clear();
+    BlockingChangedDoorCells.clear();
+
+    float deltaTime = GameTime::GetDeltaTime();
+
+    for (size_t i = 0; i < ActiveDoors.size();)
+    {
+        uint32_t door = ActiveDoors[i];
 
-            CollisionUtils::PointNearestBoundsXY(bbox, transform.Position, newPos, &hitPoint, &hitNormal);
+        DoorState& state = DoorTable.States[door];
+        float& param = DoorTable.Params[door];
+        uint8_t& flags = DoorTable.Flags[door];
 
-            Vector3 vectorToHit = hitPoint - newPos;
- 
-            bool inside = Vector3LengthSqr(vectorToHit) < radius * radius;
- 
-            if (inside)
+        switch (state)
+        {
+        case DoorState::Open:
+            // force close
+            if (flags & DoorFlags::NeedCloseASAP)
             {
-                hitSomething = true;
-                // normalize the vector along the point to where we are nearest
-                vectorToHit = Vector3Normalize(vectorToHit);
- 
-                // project that out to the radius to find the point that should be 'deepest' into the rectangle.
-                Vector3 projectedPoint = newPos + (vectorToHit * radius);
- 
-                // compute the shift to take the deepest point out to the edge of our nearest hit, based on the vector direction
-                Vector3 delta = { 0,0 };
- 
-                if (hitNormal.x != 0)
-                    delta.x = hitPoint.x - projectedPoint.x;
+                if (DoorTable.MinimumOpenTimes[door] > 0)
+                {
+                    DoorTable.WaitTimes[door] = DoorTable.MinimumOpenTimes[door];
+                    state = DoorState::WaitingForClose;
+                }
                 else
-                    delta.y = hitPoint.y - projectedPoint.y;
- 
-                // shift the new point by the delta to push us outside of the rectangle
-                newPos += delta;
+                {
+                    flags &= ~DoorFlags::NeedCloseASAP;
+                    state = DoorState::Closing;
+                    DoorEvents.emplace_back(DoorEvent{ DoorTable.Controllers[door], DoorControllerComponent::DoorClosing });
+                }
+            }
+            break;
+
+        case DoorState::Opening:
+            param += deltaTime / DoorTable.OpenSpeeds[door];
+            if (param >= 1)
+            {
+                param = 1;
+                state = DoorState::Open;
+            }
+
+            SetDoorParam(door, param);
+
+            if (param >= 0.5f)
+                SetDoorBlocked(door, false);
+            break;
+
+        case DoorState::WaitingForClose:
+            DoorTable.WaitTimes[door] -= deltaTime;
+            if (DoorTable.WaitTimes[door] <= 0)
+            {
+                flags &= ~DoorFlags::NeedCloseASAP;
+                state = DoorState::Closing;
+                DoorEvents.emplace_back(DoorEvent{ DoorTable.Controllers[door], DoorControllerComponent::DoorClosing });
+            }
+            break;
+
+        case DoorState::Closing:
+            param -= deltaTime / DoorTable.CloseSpeeds[door];
+            if (param <= 0)
+            {
+                param = 0;
+                state = DoorState::Closed;
             }
+
+            SetDoorParam(door, param);
+
+            if (param <= 0.5f)
+                SetDoorBlocked(door, true);
+            break;
+
+        case DoorState::Closed:
+        default:
+            break; // do nothing, we are just chillin closed
+        }
+
+        // a closed door, or an open one with nothing to wait for, stays out of the loop until its trigger wakes it
+        bool idle = state == DoorState::Closed || (state == DoorState::Open && !(flags & DoorFlags::NeedCloseASAP));
+        if (idle)
+        {
+            flags &= ~DoorFlags::Active;
+            ActiveDoors[i] = ActiveDoors.back();
+            ActiveDoors.pop_back();
+        }
+        else
+        {
+            i++;
         }
     }
 
-    desiredMotion = newPos - position;
+    // a cell that moved and stopped blocking in the same frame is only listed once
+    std::sort(ChangedDoorCells.begin(), ChangedDoorCells.end());
+    ChangedDoorCells.erase(std::unique(ChangedDoorCells.begin(), ChangedDoorCells.end()), ChangedDoorCells.end());
 
-    return hitSomething;
-}
+    // by index, a handler can remove a door and take its events with it
+    for (size_t i = 0; i < DoorEvents.size(); i++)
+    {
+        DoorEvent event = DoorEvents[i];
+        event.Door->GetOwner()->CallEvent(event.Name, nullptr);
+    }
 
+    DoorEvents.clear();
+}
@@ -2,26 +2,275 @@
 
 #include "components/mob_behavior_component.h"
 #include "components/transform_component.h"
+#include "services/behavior_manager.h"
+#include "services/character_manager.h"
+#include "services/game_time.h"
+#include "services/global_vars.h"
+#include "services/pathfinding.h"
+#include "systems/map_object_system.h"
+#include "systems/player_management_system.h"
 #include "utilities/collision_utils.h"
+#include "utilities/swept_collision.h"
+
+#include "game.h"
+#include "scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
 
 void MobSystem::OnUpdate()
 {
-    // do AI updates
+    AssignBehaviors();
+
+    auto behaviorStart = std::chrono::steady_clock::now();
+
+    Vector3 playerPos = App::GetSystem<PlayerManagementSystem>()->GetPlayerPos();
+
+    // the flow field is only kept up to date while something is chasing the player
+    std::shared_ptr<const FlowField> playerField;
+    for (auto& behavior : MobBehaviors.Components)
+    {
+        if (!behavior->ChasePlayer)
+            continue;
+
+        Pathfinding::SetFlowTarget(MapCoordinate{ int(floorf(playerPos.x)), int(floorf(playerPos.y)) });
+        playerField = Pathfinding::GetFlowField();
+        break;
+    }
+
+    // do AI updates, a behavior at a time so its tree stays in the cache
+
+    size_t agents = 0;
+    size_t evaluations = 0;
+    for (auto& group : BehaviorGroups)
+    {
+        const BehaviorTree& tree = *group.Tree;
+        for (size_t i = 0; i < group.Agents.size(); i++)
+        {
+            if (group.Agents[i]->Process(tree, group.Blackboards[i], playerField.get(), playerPos))
+                evaluations++;
+        }
+        agents += group.Agents.size();
+    }
+
+    BehaviorTotals.Frames++;
+    BehaviorTotals.Behaviors = BehaviorGroups.size();
+    BehaviorTotals.Agents = agents;
+    BehaviorTotals.Evaluations += double(evaluations);
+    BehaviorTotals.MS += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - behaviorStart).count();
+
+    if (GlobalVars::UseCrowdSeparation)
+        SeparateCrowd();
+}
+
+void MobSystem::AssignBehaviors()
+{
+    for (auto* behavior : PendingBehaviors)
+    {
+        // the character says what its mobs do, unless the mob was given a behavior of its own
+        std::string_view name = behavior->Behavior;
+        std::shared_ptr<CharacterInfo> character;
+        if (name.empty())
+        {
+            character = CharacterManager::GetCharacter(MobComponent::CharacterName);
+            if (character)
+                name = character->BehaviorName;
+        }
+
+        auto tree = BehaviorManager::GetBehavior(name);
+
+        size_t groupIndex = 0;
+        while (groupIndex < BehaviorGroups.size() && BehaviorGroups[groupIndex].Tree != tree)
+            groupIndex++;
+
+        if (groupIndex == BehaviorGroups.size())
+            BehaviorGroups.emplace_back().Tree = tree;
+
+        auto& group = BehaviorGroups[groupIndex];
+
+        behavior->BehaviorGroup = groupIndex;
+        behavior->BehaviorSlot = group.Agents.size();
+        group.Agents.push_back(behavior);
+
+        // the first evaluation is on the next update, after that mobs added together think on different frames
+        auto& blackboard = group.Blackboards.emplace_back();
+        blackboard.TickTimer = tree->GetLongestTickInterval() * float(behavior->BehaviorSlot % 8) / 8.0f;
+    }
+
+    PendingBehaviors.clear();
+}
+
+MobSystem::BehaviorReport MobSystem::TakeBehaviorReport()
+{
+    BehaviorReport report = BehaviorTotals;
+    BehaviorTotals = BehaviorReport();
+
+    if (report.Frames > 0)
+    {
+        double frames = double(report.Frames);
+        report.Evaluations /= frames;
+        report.MS /= frames;
+    }
+
+    return report;
+}
+
+void MobSystem::SeparateCrowd()
+{
+    auto gatherStart = std::chrono::steady_clock::now();
+
+    Crowd.Clear();
+    CrowdMembers.clear();
 
     for (auto& behavior : MobBehaviors.Components)
     {
-        behavior->Process();
+        auto* transform = behavior->GetOwner()->GetComponent<TransformComponent>();
+        if (!transform)
+            continue;
+
+        Crowd.AddAgent(transform->Position.x, transform->Position.y, behavior->Radius);
+        CrowdMembers.push_back(behavior);
+    }
+
+    if (CrowdMembers.empty())
+        return;
+
+    // the player shoves mobs out of the way, but mobs can't shove the player
+    if (!GlobalVars::UseGhostMovement)
+    {
+        Vector3 playerPos = App::GetSystem<PlayerManagementSystem>()->GetPlayerPos();
+        Crowd.AddAgent(playerPos.x, playerPos.y, PlayerManagementSystem::PlayerRadius, true);
+    }
+
+    auto solveStart = std::chrono::steady_clock::now();
+
+    Crowd.Solve(CrowdPushSpeed * GameTime::GetDeltaTime());
+
+    auto applyStart = std::chrono::steady_clock::now();
+
+    // the pushes still go through the walls and props, so a crowd can't shove a mob into them
+    CrowdMovers.resize(CrowdMembers.size());
+    for (size_t i = 0; i < CrowdMembers.size(); i++)
+    {
+        auto& mover = CrowdMovers[i];
+        mover.Position = CrowdMembers[i]->GetOwner()->GetComponent<TransformComponent>()->Position;
+        mover.Motion = Vector3{ Crowd.GetPushX(i), Crowd.GetPushY(i), 0 };
+        mover.Radius = CrowdMembers[i]->Radius;
+    }
+
+    SweptCollision::MoveCircles(App::GetScene().GetMap(), App::GetSystem<MapObjectSystem>()->GetSolidBounds(), CrowdMovers);
+
+    for (size_t i = 0; i < CrowdMembers.size(); i++)
+        CrowdMembers[i]->GetOwner()->GetComponent<TransformComponent>()->Position = CrowdMovers[i].Position;
+
+    auto applyEnd = std::chrono::steady_clock::now();
+
+    const auto& stats = Crowd.GetStats();
+
+    CrowdTotals.Frames++;
+    CrowdTotals.Agents = stats.Agents;
+    CrowdTotals.Overlaps = stats.Overlaps;
+    CrowdTotals.Batches = stats.Batches;
+    CrowdTotals.GatherMS += std::chrono::duration<double, std::milli>(solveStart - gatherStart).count();
+    CrowdTotals.GridMS += stats.GridMS;
+    CrowdTotals.SolveMS += stats.SolveMS;
+    CrowdTotals.ApplyMS += std::chrono::duration<double, std::milli>(applyEnd - applyStart).count();
+}
+
+MobSystem::CrowdReport MobSystem::TakeCrowdReport()
+{
+    CrowdReport report = CrowdTotals;
+    CrowdTotals = CrowdReport();
+
+    if (report.Frames > 0)
+    {
+        double frames = double(report.Frames);
+        report.GatherMS /= frames;
+        report.GridMS /= frames;
+        report.SolveMS /= frames;
+        report.ApplyMS /= frames;
+    }
+
+    return report;
+}
+
+size_t MobSystem::SpawnCrowd(size_t count, float range)
+{
+    auto& scene = App::GetScene();
+    const auto& map = scene.GetMap();
+
+    Vector3 center = App::GetSystem<PlayerManagementSystem>()->GetPlayerPos();
+
+    // the mobs belong to the region the player is in, so they go away with it like the ones the map places
+    auto regions = scene.GetWantedRegions(center);
+    size_t region = regions.empty() ? 0 : regions.front();
+
+    std::mt19937 rng{ uint32_t(count) };
+    std::uniform_real_distribution<float> offset(-range, range);
+    std::uniform_real_distribution<float> jitter(0.25f, 0.75f);
+    std::uniform_real_distribution<float> facing(0, 360);
+
+    size_t spawned = 0;
+    for (size_t attempt = 0; attempt < count * 8 && spawned < count; attempt++)
+    {
+        int x = int(floorf(center.x + offset(rng)));
+        int y = int(floorf(center.y + offset(rng)));
+        if (!map.IsCellPassable(x, y))
+            continue;
+
+        GameObject* mobObject = scene.AddMapObject(region);
+        if (!mobObject)
+            mobObject = scene.AddObject();
+
+        auto* transform = mobObject->AddComponent<TransformComponent>();
+        transform->Position = Vector3{ x + jitter(rng), y + jitter(rng), 0 };
+        transform->SetFacing(facing(rng));
+
+        mobObject->AddComponent<MobComponent>();
+        auto* behavior = mobObject->AddComponent<MobBehaviorComponent>();
+        behavior->ChasePlayer = true;
+
+        spawned++;
     }
+
+    return spawned;
 }
 
 void MobSystem::OnAddObject(GameObject* object)
 {
     Mobs.Add(object);
-    MobBehaviors.Add(object);
+
+    // the behavior is picked on the next update, whatever sets up the mob may not have said which one yet
+    auto* behavior = MobBehaviors.Add(object);
+    if (behavior && behavior->BehaviorGroup == MobBehaviorComponent::NoBehaviorGroup
+        && std::find(PendingBehaviors.begin(), PendingBehaviors.end(), behavior) == PendingBehaviors.end())
+        PendingBehaviors.push_back(behavior);
 }
 
 void MobSystem::OnRemoveObject(GameObject* object)
 {
+    auto* behavior = object->GetComponent<MobBehaviorComponent>();
+    if (behavior && behavior->BehaviorGroup != MobBehaviorComponent::NoBehaviorGroup)
+    {
+        // the last mob in the group takes over the slot
+        auto& group = BehaviorGroups[behavior->BehaviorGroup];
+        size_t slot = behavior->BehaviorSlot;
+
+        group.Agents[slot] = group.Agents.back();
+        group.Blackboards[slot] = group.Blackboards.back();
+        group.Agents[slot]->BehaviorSlot = slot;
+
+        group.Agents.pop_back();
+        group.Blackboards.pop_back();
+
+        behavior->BehaviorGroup = MobBehaviorComponent::NoBehaviorGroup;
+    }
+    else if (behavior)
+    {
+        std::erase(PendingBehaviors, behavior);
+    }
+
     MobBehaviors.Remove(object);
     Mobs.Remove(object);
 }
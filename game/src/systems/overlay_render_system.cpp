@@ -2,34 +2,71 @@
 #include "systems/player_management_system.h"
 #include "services/texture_manager.h"
 #include "services/global_vars.h"
+#include "services/resource_cache.h"
 #include "scene.h"
 
 #include "raylib.h"
 
+#include <string>
+
+static const char* FormatMemory(size_t bytes)
+{
+    float value = bytes / 1024.0f;
+    const char* suffix = "kb";
+    if (value > 1024)
+    {
+        value /= 1024.0f;
+        suffix = "mb";
+    }
+    if (value > 1024)
+    {
+        value /= 1024.0f;
+        suffix = "gb";
+    }
+
+    return TextFormat("%0.2f%s", value, suffix);
+}
+
+static void DrawCacheStats(int y)
+{
+    for (const auto* cache : ResourceCache::GetCaches())
+    {
+        auto stats = cache->GetStats();
+
+        size_t lookups = stats.Hits + stats.Misses;
+        int hitRate = lookups > 0 ? int(stats.Hits * 100 / lookups) : 0;
+
+        // the formatted text is in raylib's shared buffers, so each part is copied before the line is formatted
+        std::string cpu = FormatMemory(stats.CPUBytes);
+        std::string cpuBudget = cache->GetCPUBudget() > 0 ? FormatMemory(cache->GetCPUBudget()) : "any";
+        std::string gpu = FormatMemory(stats.GPUBytes);
+        std::string gpuBudget = cache->GetGPUBudget() > 0 ? FormatMemory(cache->GetGPUBudget()) : "any";
+
+        DrawText(TextFormat("%s %d/%d in use, cpu %s of %s, gpu %s of %s, %d%% hits, %d evicted", cache->GetName().c_str(),
+            int(stats.ReferencedEntries), int(stats.Entries), cpu.c_str(), cpuBudget.c_str(), gpu.c_str(), gpuBudget.c_str(),
+            hitRate, int(stats.Evictions)), 10, y, 20, LIGHTGRAY);
+
+        y -= 20;
+    }
+}
+
 void OverlayRenderSystem::OnUpdate()
 {
     if (App::GetState() != GameState::Playing)
         return;
 
     DrawText(TextFormat("Rays Cast %d", App::GetScene().GetRaycaster().GetCastCount()), 10, GetScreenHeight() - 50, 20, SKYBLUE);
-    DrawText(TextFormat("Cells Drawn %d of %d total cells", GlobalVars::UseVisCulling ? App::GetScene().GetRaycaster().GetHitCelList().size() : App::GetScene().GetMap().Cells.size(), App::GetScene().GetMap().Cells.size()), 10, GetScreenHeight() - 70, 20, YELLOW);
+    const Map& map = App::GetScene().GetMap();
+    int chunkCells = int(map.Chunks.size()) * MapChunkCellCount;
+    int cellsDrawn = GlobalVars::UseVisCulling ? int(App::GetScene().GetRaycaster().GetHitCelList().size()) : chunkCells;
+    DrawText(TextFormat("Cells Drawn %d of %d cells in %d chunks", cellsDrawn, chunkCells, int(map.Chunks.size())), 10, GetScreenHeight() - 70, 20, YELLOW);
 
-    float vram = TextureManager::GetUsedVRAM() / 1024.0f;
-    const char* vramSuffix = "kb";
-    if (vram > 1024)
-    {
-        vram /= 1024.0f;
-        vramSuffix = "mb";
-    }
-    if (vram > 1024)
-    {
-        vram /= 1024.0f;
-        vramSuffix = "gb";
-    }
-
-    DrawText(TextFormat("Used Texture Memory %0.2f%s", vram, vramSuffix), 10, GetScreenHeight()-30, 20, WHITE);
+    DrawText(TextFormat("Used Texture Memory %s", FormatMemory(TextureManager::GetUsedVRAM())), 10, GetScreenHeight()-30, 20, WHITE);
     DrawFPS(10, GetScreenHeight() - 90);
 
+    if (GlobalVars::ShowCacheStats)
+        DrawCacheStats(GetScreenHeight() - 115);
+
     if (GlobalVars::ShowCoordinates)
     {
         auto playerPos = App::GetSystem<PlayerManagementSystem>()->GetPlayerPos();
@@ -0,0 +1,219 @@
+#include "systems/perception_system.h"
+
+#include "components/mob_behavior_component.h"
+#include "components/transform_component.h"
+#include "services/game_time.h"
+#include "services/global_vars.h"
+#include "systems/map_object_system.h"
+#include "systems/mobile_object_system.h"
+#include "systems/player_management_system.h"
+#include "systems/ray_query_system.h"
+
+#include "game.h"
+#include "scene.h"
+
+#include <algorithm>
+#include <chrono>
+
+void PerceptionSystem::OnSetup()
+{
+    MapObjects = App::GetSystem<MapObjectSystem>();
+    Mobs = App::GetSystem<MobSystem>();
+    PlayerManager = App::GetSystem<PlayerManagementSystem>();
+    RayQueries = App::GetSystem<RayQuerySystem>();
+}
+
+PerceptionSystem::PerceptionReport PerceptionSystem::TakePerceptionReport()
+{
+    PerceptionReport report = Totals;
+    Totals = PerceptionReport();
+
+    if (report.Frames > 0)
+    {
+        double frames = double(report.Frames);
+        report.OutOfSight /= frames;
+        report.VisibleCells /= frames;
+        report.Cached /= frames;
+        report.Waiting /= frames;
+        report.Rays /= frames;
+        report.MS /= frames;
+    }
+
+    return report;
+}
+
+void PerceptionSystem::SetCanSeePlayer(MobBehaviorComponent* mob, bool canSee, const Vector3& playerPos, GameObject* player)
+{
+    if (canSee)
+    {
+        mob->TimeSinceSeenPlayer = 0;
+        mob->LastSeenPlayerPosition = playerPos;
+    }
+
+    if (canSee == mob->CanSeePlayer)
+        return;
+
+    mob->CanSeePlayer = canSee;
+    mob->GetOwner()->CallEvent(canSee ? PlayerSpotted : PlayerLost, player);
+}
+
+bool PerceptionSystem::DoorChangedBetween(const Vector3& from, const Vector3& to) const
+{
+    if (!MapObjects || MapObjects->GetBlockingChangedDoorCells().empty())
+        return false;
+
+    // the ray stays inside the box its ends make, a door anywhere else can't have changed what it hits
+    int minX = int(floorf(std::min(from.x, to.x)));
+    int minY = int(floorf(std::min(from.y, to.y)));
+    int maxX = int(floorf(std::max(from.x, to.x)));
+    int maxY = int(floorf(std::max(from.y, to.y)));
+
+    size_t mapWidth = size_t(std::max(App::GetScene().GetMap().Size.X, 1));
+
+    for (size_t cell : MapObjects->GetBlockingChangedDoorCells())
+    {
+        int x = int(cell % mapWidth);
+        int y = int(cell / mapWidth);
+
+        if (x >= minX && x <= maxX && y >= minY && y <= maxY)
+            return true;
+    }
+
+    return false;
+}
+
+void PerceptionSystem::OnUpdate()
+{
+    if (!Mobs || !PlayerManager)
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+
+    float deltaTime = GameTime::GetDeltaTime();
+
+    GameObject* player = PlayerManager->GetPlayerObject();
+    Vector3 playerPos = PlayerManager->GetPlayerPos();
+    const Raycaster& raycaster = App::GetScene().GetRaycaster();
+
+    size_t outOfSight = 0;
+    size_t visibleCells = 0;
+    size_t cached = 0;
+
+    Candidates.clear();
+
+    for (auto* mob : Mobs->MobBehaviors.Components)
+    {
+        mob->TimeSinceSeenPlayer += deltaTime;
+        mob->TimeSinceSightCheck += deltaTime;
+        mob->SightCheckTimeLeft -= deltaTime;
+
+        auto* transform = mob->GetOwner()->GetComponent<TransformComponent>();
+        if (!player || !transform)
+        {
+            SetCanSeePlayer(mob, false, playerPos, player);
+            continue;
+        }
+
+        Vector2 toPlayer = { playerPos.x - transform->Position.x, playerPos.y - transform->Position.y };
+        float distance = Vector2Length(toPlayer);
+
+        // too far away or looking the other way, no ray needed. the next check is due as soon as this changes
+        bool inFieldOfView = distance <= 0.001f
+            || Vector2DotProduct(Vector2{ transform->Forward.x, transform->Forward.y }, toPlayer / distance) >= cosf(mob->FieldOfView * 0.5f * DEG2RAD);
+
+        if (distance > mob->SightRange || !inFieldOfView)
+        {
+            mob->SightCheckTimeLeft = 0;
+            SetCanSeePlayer(mob, false, playerPos, player);
+            outOfSight++;
+            continue;
+        }
+
+        float checkInterval = Lerp(NearCheckInterval, FarCheckInterval, distance / mob->SightRange);
+
+        // if the player's view got to the mob's cell last frame, there is a clear line from the mob back to the player
+        if (raycaster.IsCellVis(int(floorf(transform->Position.x)), int(floorf(transform->Position.y))))
+        {
+            mob->TimeSinceSightCheck = 0;
+            mob->SightCheckTimeLeft = checkInterval;
+            SetCanSeePlayer(mob, true, playerPos, player);
+            visibleCells++;
+            continue;
+        }
+
+        // a door opening or closing in the way makes the last ray out of date
+        if (mob->SightCheckTimeLeft > 0 && DoorChangedBetween(transform->Position, playerPos))
+            mob->SightCheckTimeLeft = 0;
+
+        // the last ray still holds, a mob that sees the player keeps up with where they went
+        if (mob->SightCheckTimeLeft > 0)
+        {
+            if (mob->CanSeePlayer)
+                SetCanSeePlayer(mob, true, playerPos, player);
+            cached++;
+            continue;
+        }
+
+        Candidates.push_back(Candidate{ mob, mob->TimeSinceSightCheck / (distance + 1), distance });
+    }
+
+    // only the budget's worth of rays, the ones waiting longest for how close they are go first and the rest wait for a later frame
+    size_t rayCount = RayQueries ? std::min(Candidates.size(), size_t(std::max(GlobalVars::PerceptionRaysPerFrame, 0))) : 0;
+    if (rayCount < Candidates.size())
+    {
+        std::nth_element(Candidates.begin(), Candidates.begin() + rayCount, Candidates.end(),
+            [](const Candidate& a, const Candidate& b) { return a.Priority > b.Priority; });
+    }
+
+    Queries.resize(rayCount);
+    for (size_t i = 0; i < rayCount; i++)
+    {
+        const auto& candidate = Candidates[i];
+        const Vector3& mobPos = candidate.Mob->GetOwner()->MustGetComponent<TransformComponent>().Position;
+
+        Vector3 origin = { mobPos.x, mobPos.y, mobPos.z + MobEyeHeight };
+        Vector3 target = { playerPos.x, playerPos.y, playerPos.z + PlayerTargetHeight };
+
+        RayQuery& query = Queries[i];
+        query.Origin = origin;
+        query.Direction = target - origin;
+        query.MaxDistance = Vector3Length(query.Direction);
+        query.Mask = RayHitMask::Sight;
+        query.Ignore = candidate.Mob->GetOwner();
+    }
+
+    if (rayCount > 0)
+        RayQueries->CastRays(Queries, Hits);
+
+    for (size_t i = 0; i < rayCount; i++)
+    {
+        const auto& candidate = Candidates[i];
+
+        candidate.Mob->TimeSinceSightCheck = 0;
+        candidate.Mob->SightCheckTimeLeft = Lerp(NearCheckInterval, FarCheckInterval, candidate.Distance / candidate.Mob->SightRange);
+        SetCanSeePlayer(candidate.Mob, Hits[i].Type == RayHitType::None, playerPos, player);
+    }
+
+    // the ones still waiting keep what they saw last
+    for (size_t i = rayCount; i < Candidates.size(); i++)
+    {
+        if (Candidates[i].Mob->CanSeePlayer)
+            SetCanSeePlayer(Candidates[i].Mob, true, playerPos, player);
+    }
+
+    Totals.Frames++;
+    Totals.Mobs = Mobs->MobBehaviors.Components.size();
+    Totals.CanSee = 0;
+    for (auto* mob : Mobs->MobBehaviors.Components)
+    {
+        if (mob->CanSeePlayer)
+            Totals.CanSee++;
+    }
+
+    Totals.OutOfSight += double(outOfSight);
+    Totals.VisibleCells += double(visibleCells);
+    Totals.Cached += double(cached);
+    Totals.Waiting += double(Candidates.size() - rayCount);
+    Totals.Rays += double(rayCount);
+    Totals.MS += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
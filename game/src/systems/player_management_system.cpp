@@ -34,6 +34,25 @@ void PlayerManagementSystem::OnSetup()
     }
 
     App::GetSystem<AudioSystem>()->GetSound("spawn")->Play();
+
+    App::AddEventHandler(Scene::MapReloaded, [this](size_t, GameObject*, GameObject*)
+        {
+            OnMapReloaded();
+        }, Token);
+}
+
+void PlayerManagementSystem::OnMapReloaded()
+{
+    if (!PlayerTransform || !Spawn)
+        return;
+
+    const Map& map = App::GetScene().GetMap();
+    if (!map.IsCellSolid(int(floorf(PlayerTransform->Position.x)), int(floorf(PlayerTransform->Position.y))))
+        return;
+
+    TransformComponent& transform = Spawn->GetOwner()->MustGetComponent<TransformComponent>();
+    PlayerTransform->Position = transform.Position;
+    PlayerTransform->Forward = transform.Forward;
 }
 
 Vector3 PlayerManagementSystem::GetPlayerPos() const
@@ -63,6 +82,12 @@ void PlayerManagementSystem::OnAddObject(GameObject* object)
         Spawn = object->GetComponent<SpawnPointComponent>();
 }
 
+void PlayerManagementSystem::OnRemoveObject(GameObject* object)
+{
+    if (Spawn && Spawn->GetOwner() == object)
+        Spawn = nullptr;
+}
+
 void PlayerManagementSystem::OnUpdate()
 {
     if (!Input || !PlayerObject)
@@ -91,16 +116,12 @@ void PlayerManagementSystem::OnUpdate()
 
     Vector3 motion = forward + sideways;
 
-    static constexpr float playerRadius = 0.25f;
-
-    bool hitWall = false;
-    bool hitObstacle = false;
+    bool hitSomething = false;
     if (!GlobalVars::UseGhostMovement)
     {
-        hitWall = App::GetScene().GetMap().MoveEntity(PlayerTransform->Position, motion, playerRadius);
-        hitObstacle = MapObjects->MoveEntity(PlayerTransform->Position, motion, playerRadius);
+        hitSomething = MapObjects->MoveEntity(PlayerTransform->Position, motion, PlayerRadius);
 
-        if (hitWall || hitObstacle)
+        if (hitSomething)
         {
             // trigger event ?
         }
@@ -108,5 +129,5 @@ void PlayerManagementSystem::OnUpdate()
 
     PlayerTransform->Position += motion;
 
-    MapObjects->CheckTriggers(PlayerObject, playerRadius, hitWall || hitObstacle);
+    MapObjects->CheckTriggers(PlayerObject, PlayerRadius, hitSomething);
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "systems/ray_query_system.h"
+
+#include "components/map_object_component.h"
+#include "components/mob_behavior_component.h"
+#include "components/transform_component.h"
+#include "systems/map_object_system.h"
+#include "systems/mobile_object_system.h"
+#include "systems/player_management_system.h"
+#include "services/model_manager.h"
+
+#include "scene.h"
+
+void RayQuerySystem::OnSetup()
+{
+    MapObjects = App::GetSystem<MapObjectSystem>();
+    Mobs = App::GetSystem<MobSystem>();
+    PlayerManager = App::GetSystem<PlayerManagementSystem>();
+}
+
+void RayQuerySystem::OnUpdate()
+{
+    World.SetMap(&App::GetScene().GetMap());
+    World.ClearBodies();
+
+    if (MapObjects)
+    {
+        for (auto* object : MapObjects->MapObjects.Components)
+        {
+            if (!object->Solid || !object->Instance || !object->Instance->Geometry)
+                continue;
+
+            BoundingBox bounds = object->Instance->Geometry->GetBounds();
+            const auto& transform = object->GetOwner()->MustGetComponent<TransformComponent>();
+
+            World.AddBox(BoundingBox{ transform.Position + bounds.min, transform.Position + bounds.max }, object->GetOwner());
+        }
+    }
+
+    if (Mobs)
+    {
+        for (auto* mob : Mobs->Mobs.Components)
+        {
+            auto* transform = mob->GetOwner()->GetComponent<TransformComponent>();
+            if (!transform)
+                continue;
+
+            auto* behavior = mob->GetOwner()->GetComponent<MobBehaviorComponent>();
+            World.AddCapsule(transform->Position, behavior ? behavior->Radius : 0.25f, MobHeight, RayHitType::Mob, mob->GetOwner());
+        }
+    }
+
+    if (PlayerManager && PlayerManager->GetPlayerObject())
+        World.AddCapsule(PlayerManager->GetPlayerPos(), PlayerManagementSystem::PlayerRadius, PlayerHeight, RayHitType::Player, PlayerManager->GetPlayerObject());
+
+    World.BuildIndex();
+}
@@ -0,0 +1,17 @@
+#include "systems/region_streaming_system.h"
+#include "systems/player_management_system.h"
+
+#include "scene.h"
+
+void RegionStreamingSystem::OnSetup()
+{
+    PlayerManager = App::GetSystem<PlayerManagementSystem>();
+}
+
+void RegionStreamingSystem::OnUpdate()
+{
+    if (!PlayerManager)
+        return;
+
+    App::GetScene().UpdateRegions(PlayerManager->GetPlayerPos(), MaxRegionLoadsPerFrame);
+}
@@ -11,6 +11,7 @@
 #include "services/texture_manager.h"
 #include "services/table_manager.h"
 #include "services/global_vars.h"
+#include "services/hot_reload.h"
 
 #include "components/transform_component.h"
 #include "components/map_object_component.h"
@@ -41,12 +42,21 @@ void SceneRenderSystem::MapObjectAdded(class MapObjectComponent* object)
 
 void SceneRenderSystem::OnSetup()
 {
-    Render.Reset();
-
     PlayerManager = App::GetSystem<PlayerManagementSystem>();
     MapObjects = App::GetSystem<MapObjectSystem>();
     Mobs = App::GetSystem<MobSystem>();
 
+    SetupRendering();
+
+    // the lighting comes from the map and the shaders can be rebuilt, so both get everything set up again
+    App::AddEventHandler(Scene::MapReloaded, [this](size_t, GameObject*, GameObject*) { SetupRendering(); }, Token);
+    App::AddEventHandler(HotReload::ShadersReloaded, [this](size_t, GameObject*, GameObject*) { SetupRendering(); }, Token);
+}
+
+void SceneRenderSystem::SetupRendering()
+{
+    Render.Reset();
+
     std::string skyboxName = App::GetScene().GetMap().LightInfo.SkyboxTextureName;
     if (skyboxName.empty())
         skyboxName = TableManager::GetTable(BootstrapTable)->GetField("default_skybox").data();
@@ -65,6 +75,11 @@ void SceneRenderSystem::OnSetup()
     value = MATERIAL_MAP_CUBEMAP;
     SetShaderValue(SkyboxShader, GetShaderLocation(SkyboxShader, "environmentMap"), &value, SHADER_UNIFORM_INT);
 
+    // the material shares its shader and texture, so only its maps are freed
+    if (Skybox.vertexCount > 0)
+        UnloadMesh(Skybox);
+    MemFree(SkyboxMaterial.maps);
+
     Skybox = GenMeshCube(-10,-10,-10);
     SkyboxMaterial = LoadMaterialDefault();
     SkyboxMaterial.maps[MATERIAL_MAP_CUBEMAP].texture = SkyboxTexture;
@@ -99,6 +114,22 @@ float GetFOVX(float fovY)
     return 2.0f * atanf(tanf(fovY * DEG2RAD * 0.5f) * aspectRatio) * RAD2DEG;
 }
 
+// a mob can be seen if any cell under its footprint is visible
+static bool IsMobVisible(const Raycaster& raycaster, const Vector3& position)
+{
+    constexpr float radius = 0.5f;
+
+    for (int y = int(floorf(position.y - radius)); y <= int(floorf(position.y + radius)); y++)
+    {
+        for (int x = int(floorf(position.x - radius)); x <= int(floorf(position.x + radius)); x++)
+        {
+            if (raycaster.IsCellVis(x, y))
+                return true;
+        }
+    }
+    return false;
+}
+
 void SceneRenderSystem::OnUpdate()
 {
     if (App::GetState() != GameState::Playing)
@@ -158,8 +189,11 @@ void SceneRenderSystem::OnUpdate()
     }
     val = 1;
     SetShaderValue(ObjectLights.GetShader(), AnimationShaderLocation, &val, SHADER_UNIFORM_INT);
+    const auto& raycaster = App::GetScene().GetRaycaster();
     for (auto mob : Mobs->Mobs.Components)
     {
+        auto& transform = mob->GetOwner()->MustGetComponent<TransformComponent>();
+        mob->Animate(Vector3Distance(transform.Position, Render.Viepoint.position), IsMobVisible(raycaster, transform.Position));
         mob->Draw();
     }
 
@@ -0,0 +1,207 @@
+#include "utilities/behavior_tree.h"
+
+#include "services/table_manager.h"
+#include "utilities/string_utils.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+static constexpr char RootNode[] = "root";
+static constexpr char TickLODField[] = "tick_lod";
+
+// deep enough for anything sensible, and stops a table where nodes name each other in a loop
+static constexpr int MaxDepth = 32;
+
+struct ConditionName
+{
+    std::string_view Name;
+    BehaviorCondition Condition;
+};
+
+static constexpr ConditionName ConditionNames[] =
+{
+    { "chase_enabled", BehaviorCondition::ChaseEnabled },
+    { "saw_player", BehaviorCondition::SawPlayer },
+    { "can_see_player", BehaviorCondition::CanSeePlayer },
+    { "player_in_range", BehaviorCondition::PlayerInRange },
+    { "player_within", BehaviorCondition::PlayerWithin },
+    { "has_path", BehaviorCondition::HasPath },
+};
+
+struct ActionName
+{
+    std::string_view Name;
+    BehaviorAction Action;
+};
+
+static constexpr ActionName ActionNames[] =
+{
+    { "idle", BehaviorAction::Idle },
+    { "chase_player", BehaviorAction::ChasePlayer },
+    { "follow_path", BehaviorAction::FollowPath },
+    { "wander", BehaviorAction::Wander },
+};
+
+static std::string_view Trim(std::string_view text)
+{
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+        text.remove_prefix(1);
+
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r'))
+        text.remove_suffix(1);
+
+    return text;
+}
+
+bool BehaviorTree::Compile(std::string_view name, const Table& table, std::string& error)
+{
+    Name = name;
+    Nodes.clear();
+    TickLOD.clear();
+
+    if (!table.HasField(RootNode))
+    {
+        error = "no root node";
+        return false;
+    }
+
+    if (!CompileNode(table, RootNode, 0, error))
+    {
+        Nodes.clear();
+        return false;
+    }
+
+    for (const auto& level : table.SplitField(TickLODField, ","))
+    {
+        auto parts = StringUtils::SplitString(Trim(level), ":");
+        if (parts.size() != 2)
+        {
+            error = "tick_lod levels are distance:seconds";
+            Nodes.clear();
+            return false;
+        }
+
+        TickLOD.emplace_back(float(atof(parts[0].c_str())), std::max(float(atof(parts[1].c_str())), 0.0f));
+    }
+
+    std::sort(TickLOD.begin(), TickLOD.end());
+
+    return true;
+}
+
+bool BehaviorTree::CompileNode(const Table& table, std::string_view name, int depth, std::string& error)
+{
+    if (depth > MaxDepth)
+    {
+        error = "nodes nest too deep, does one contain itself?";
+        return false;
+    }
+
+    if (Nodes.size() >= NoBehaviorNode)
+    {
+        error = "too many nodes";
+        return false;
+    }
+
+    std::string key(name);
+    if (!table.HasField(key))
+        return CompileLeaf(name, error);
+
+    std::string_view value = Trim(table.GetField(key));
+    size_t split = value.find(':');
+    std::string_view kind = Trim(value.substr(0, split));
+    std::string_view arguments = split == std::string_view::npos ? std::string_view() : value.substr(split + 1);
+
+    if (kind == "condition" || kind == "action")
+        return CompileLeaf(Trim(arguments), error);
+
+    BehaviorNodeType type = BehaviorNodeType::Selector;
+    if (kind == "selector")
+        type = BehaviorNodeType::Selector;
+    else if (kind == "sequence")
+        type = BehaviorNodeType::Sequence;
+    else if (kind == "invert")
+        type = BehaviorNodeType::Invert;
+    else
+        return CompileLeaf(value, error);
+
+    size_t index = Nodes.size();
+    Nodes.emplace_back().Type = type;
+
+    auto children = StringUtils::SplitString(arguments, ",");
+    if (type == BehaviorNodeType::Invert && children.size() != 1)
+    {
+        error = "invert node " + key + " needs one child";
+        return false;
+    }
+
+    for (const auto& child : children)
+    {
+        std::string_view childName = Trim(child);
+        if (childName.empty())
+        {
+            error = "node " + key + " has an empty child";
+            return false;
+        }
+
+        if (!CompileNode(table, childName, depth + 1, error))
+            return false;
+    }
+
+    // the vector may have grown, so the node is looked up again
+    Nodes[index].End = uint16_t(Nodes.size());
+    return true;
+}
+
+bool BehaviorTree::CompileLeaf(std::string_view expression, std::string& error)
+{
+    size_t split = expression.find(':');
+    std::string_view name = Trim(expression.substr(0, split));
+
+    BehaviorNode node;
+    if (split != std::string_view::npos)
+        node.Param = float(atof(std::string(Trim(expression.substr(split + 1))).c_str()));
+
+    auto condition = std::find_if(std::begin(ConditionNames), std::end(ConditionNames), [name](const ConditionName& entry) { return entry.Name == name; });
+    auto action = std::find_if(std::begin(ActionNames), std::end(ActionNames), [name](const ActionName& entry) { return entry.Name == name; });
+
+    if (condition != std::end(ConditionNames))
+    {
+        node.Type = BehaviorNodeType::Condition;
+        node.Leaf = uint8_t(condition->Condition);
+    }
+    else if (action != std::end(ActionNames))
+    {
+        node.Type = BehaviorNodeType::Action;
+        node.Leaf = uint8_t(action->Action);
+    }
+    else
+    {
+        error = "unknown node, condition or action " + std::string(name);
+        return false;
+    }
+
+    node.End = uint16_t(Nodes.size() + 1);
+    Nodes.push_back(node);
+    return true;
+}
+
+float BehaviorTree::GetTickInterval(float distance) const
+{
+    for (const auto& [levelDistance, interval] : TickLOD)
+    {
+        if (distance <= levelDistance)
+            return interval;
+    }
+
+    return TickLOD.empty() ? 0 : TickLOD.back().second;
+}
+
+float BehaviorTree::GetLongestTickInterval() const
+{
+    float longest = 0;
+    for (const auto& level : TickLOD)
+        longest = std::max(longest, level.second);
+
+    return longest;
+}
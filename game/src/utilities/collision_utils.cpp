@@ -3,6 +3,9 @@
 #include "raylib.h"
 #include "raymath.h"
 
+#include <algorithm>
+#include <cfloat>
+
 namespace CollisionUtils
 {
     void SetUnitAngleDeg(float& angle)
@@ -145,4 +148,118 @@ namespace CollisionUtils
             }
         }
     }
-}
\ No newline at end of file
+
+    bool SweepCircleRect(const Vector2& start, const Vector2& motion, float radius, const Rectangle& rect, float* time, Vector2* normal)
+    {
+        float right = rect.x + rect.width;
+        float bottom = rect.y + rect.height;
+
+        // already touching, only motion into the rectangle is blocked so things can always back out
+        Vector2 closest = { Clamp(start.x, rect.x, right), Clamp(start.y, rect.y, bottom) };
+        Vector2 away = start - closest;
+        float distanceSq = Vector2LengthSqr(away);
+        if (distanceSq < radius * radius)
+        {
+            Vector2 outward = { 0, 0 };
+            if (distanceSq > 0.000001f)
+            {
+                outward = away / sqrtf(distanceSq);
+            }
+            else
+            {
+                // the center is inside, go out the nearest side
+                float left = start.x - rect.x;
+                float toRight = right - start.x;
+                float top = start.y - rect.y;
+                float toBottom = bottom - start.y;
+                float nearest = std::min(std::min(left, toRight), std::min(top, toBottom));
+
+                if (nearest == left)
+                    outward.x = -1;
+                else if (nearest == toRight)
+                    outward.x = 1;
+                else if (nearest == top)
+                    outward.y = -1;
+                else
+                    outward.y = 1;
+            }
+
+            if (Vector2DotProduct(motion, outward) >= 0)
+                return false;
+
+            *time = 0;
+            *normal = outward;
+            return true;
+        }
+
+        // the circle hits the rectangle when its center hits the rectangle grown by the radius with rounded corners,
+        // so trace the center against the grown rectangle then check the corners as circles
+        float enter = -FLT_MAX;
+        float exit = FLT_MAX;
+        Vector2 enterNormal = { 0, 0 };
+
+        const float starts[2] = { start.x, start.y };
+        const float motions[2] = { motion.x, motion.y };
+        const float mins[2] = { rect.x - radius, rect.y - radius };
+        const float maxes[2] = { right + radius, bottom + radius };
+
+        for (int axis = 0; axis < 2; axis++)
+        {
+            if (motions[axis] == 0)
+            {
+                if (starts[axis] < mins[axis] || starts[axis] > maxes[axis])
+                    return false;
+                continue;
+            }
+
+            float entryTime = ((motions[axis] > 0 ? mins[axis] : maxes[axis]) - starts[axis]) / motions[axis];
+            float exitTime = ((motions[axis] > 0 ? maxes[axis] : mins[axis]) - starts[axis]) / motions[axis];
+
+            if (entryTime > enter)
+            {
+                enter = entryTime;
+                enterNormal = axis == 0 ? Vector2{ motions[axis] > 0 ? -1.0f : 1.0f, 0 } : Vector2{ 0, motions[axis] > 0 ? -1.0f : 1.0f };
+            }
+            exit = std::min(exit, exitTime);
+
+            if (enter > exit)
+                return false;
+        }
+
+        if (enter > 1 || exit < 0)
+            return false;
+
+        Vector2 point = start + motion * std::max(enter, 0.0f);
+        bool outsideX = point.x < rect.x || point.x > right;
+        bool outsideY = point.y < rect.y || point.y > bottom;
+
+        if (!outsideX || !outsideY)
+        {
+            if (enter < 0)
+                return false;
+
+            *time = enter;
+            *normal = enterNormal;
+            return true;
+        }
+
+        // the center comes in past a corner, it can only touch the rounded corner there
+        Vector2 corner = { point.x < rect.x ? rect.x : right, point.y < rect.y ? rect.y : bottom };
+        Vector2 fromCorner = start - corner;
+
+        float a = Vector2LengthSqr(motion);
+        float b = 2 * Vector2DotProduct(motion, fromCorner);
+        float c = Vector2LengthSqr(fromCorner) - radius * radius;
+        float discriminant = b * b - 4 * a * c;
+        if (discriminant < 0 || a <= 0)
+            return false;
+
+        float hitTime = (-b - sqrtf(discriminant)) / (2 * a);
+        if (hitTime < 0 || hitTime > 1)
+            return false;
+
+        *time = hitTime;
+        *normal = Vector2Normalize(start + motion * hitTime - corner);
+        return true;
+    }
+}
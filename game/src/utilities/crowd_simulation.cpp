@@ -0,0 +1,140 @@
+#include "utilities/crowd_simulation.h"
+
+#include "services/job_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+void CrowdSimulation::Clear()
+{
+    PositionX.clear();
+    PositionY.clear();
+    Radius.clear();
+    Fixed.clear();
+    PushX.clear();
+    PushY.clear();
+    MaxRadius = 0;
+}
+
+size_t CrowdSimulation::AddAgent(float x, float y, float radius, bool fixed)
+{
+    PositionX.push_back(x);
+    PositionY.push_back(y);
+    Radius.push_back(radius);
+    Fixed.push_back(fixed ? 1 : 0);
+    MaxRadius = std::max(MaxRadius, radius);
+
+    return PositionX.size() - 1;
+}
+
+size_t CrowdSimulation::SolveRange(size_t first, size_t last, float maxPush)
+{
+    size_t overlaps = 0;
+    float range = MaxRadius * 2;
+
+    for (size_t agent = first; agent < last; agent++)
+    {
+        float pushX = 0;
+        float pushY = 0;
+
+        if (!Fixed[agent])
+        {
+            float x = PositionX[agent];
+            float y = PositionY[agent];
+            float radius = Radius[agent];
+
+            Grid.ForEachInRange(x - range, y - range, x + range, y + range, [&](size_t other)
+                {
+                    if (other == agent)
+                        return;
+
+                    float minDistance = radius + Radius[other];
+                    float deltaX = x - PositionX[other];
+                    float deltaY = y - PositionY[other];
+                    float distanceSq = deltaX * deltaX + deltaY * deltaY;
+                    if (distanceSq >= minDistance * minDistance)
+                        return;
+
+                    // agents that are only just touching are left alone, so a packed crowd settles instead of jittering
+                    float distance = sqrtf(distanceSq);
+                    float overlap = minDistance - distance;
+                    if (overlap < minDistance * OverlapSlop)
+                        return;
+
+                    overlaps++;
+
+                    if (distance < 0.0001f)
+                    {
+                        // right on top of each other, the lower index goes one way and the higher the other
+                        deltaX = other > agent ? -1.0f : 1.0f;
+                        deltaY = 0;
+                        distance = 1;
+                    }
+
+                    // each side moves half of the overlap, unless the other one can't move
+                    float share = Fixed[other] ? 1.0f : 0.5f;
+                    float scale = overlap * share / distance;
+                    pushX += deltaX * scale;
+                    pushY += deltaY * scale;
+                });
+
+            float pushSq = pushX * pushX + pushY * pushY;
+            if (pushSq > maxPush * maxPush)
+            {
+                float scale = maxPush / sqrtf(pushSq);
+                pushX *= scale;
+                pushY *= scale;
+            }
+        }
+
+        PushX[agent] = pushX;
+        PushY[agent] = pushY;
+    }
+
+    return overlaps;
+}
+
+void CrowdSimulation::Solve(float maxPush)
+{
+    size_t count = PositionX.size();
+
+    LastStats = Stats();
+    LastStats.Agents = count;
+
+    PushX.resize(count);
+    PushY.resize(count);
+
+    auto gridStart = std::chrono::steady_clock::now();
+
+    // cells as big as the widest agent, so everything an agent can touch is in the cells around it
+    Grid.Build(PositionX.data(), PositionY.data(), count, MaxRadius * 2);
+
+    auto solveStart = std::chrono::steady_clock::now();
+
+    if (count < ParallelAgentCount)
+    {
+        LastStats.Batches = count > 0 ? 1 : 0;
+        LastStats.Overlaps = SolveRange(0, count, maxPush);
+    }
+    else
+    {
+        // the batches only read the positions and write the pushes of their own agents, so they don't need to lock anything
+        size_t batchCount = JobPool::GetBatchCount(count, AgentsPerBatch);
+        std::vector<size_t> batchOverlaps(batchCount, 0);
+
+        JobPool::ParallelFor(count, AgentsPerBatch, [this, maxPush, &batchOverlaps](size_t first, size_t last, size_t batch)
+            {
+                batchOverlaps[batch] = SolveRange(first, last, maxPush);
+            });
+
+        LastStats.Batches = batchCount;
+        for (size_t overlaps : batchOverlaps)
+            LastStats.Overlaps += overlaps;
+    }
+
+    auto solveEnd = std::chrono::steady_clock::now();
+
+    LastStats.GridMS = std::chrono::duration<double, std::milli>(solveStart - gridStart).count();
+    LastStats.SolveMS = std::chrono::duration<double, std::milli>(solveEnd - solveStart).count();
+}
@@ -0,0 +1,238 @@
+#include "utilities/file_watcher.h"
+#include "utilities/pack_format.h"
+
+#include "raylib.h"
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// how long a file has to stop changing before it is reported
+static constexpr double SettleTime = 0.25;
+
+// seconds between scans of the folder when there are no notifications
+static constexpr double PollInterval = 1.0;
+
+FileWatcher::~FileWatcher()
+{
+    Stop();
+}
+
+bool FileWatcher::Start(std::string_view rootFolder)
+{
+    Stop();
+
+    RootFolder = rootFolder;
+    while (!RootFolder.empty() && (RootFolder.back() == '/' || RootFolder.back() == '\\'))
+        RootFolder.pop_back();
+
+    if (!DirectoryExists(RootFolder.c_str()))
+        return false;
+
+    Watching = true;
+
+    if (!StartNotifications())
+    {
+        // remember how every file is now, so only later changes are reported
+        PollFiles(false);
+        LastPollTime = GetTime();
+    }
+
+    return true;
+}
+
+void FileWatcher::Stop()
+{
+#if defined(__linux__)
+    if (NotifyHandle >= 0)
+        close(NotifyHandle);
+#endif
+
+    NotifyHandle = -1;
+    WatchedFolders.clear();
+    FileTimes.clear();
+    PendingChanges.clear();
+    Watching = false;
+}
+
+std::vector<std::string> FileWatcher::GetChangedFiles()
+{
+    std::vector<std::string> changedFiles;
+    if (!Watching)
+        return changedFiles;
+
+    double now = GetTime();
+
+    if (NotifyHandle >= 0)
+    {
+        ReadNotifications();
+    }
+    else if (now - LastPollTime >= PollInterval)
+    {
+        PollFiles(true);
+        LastPollTime = now;
+    }
+
+    for (auto itr = PendingChanges.begin(); itr != PendingChanges.end();)
+    {
+        if (now - itr->second >= SettleTime)
+        {
+            changedFiles.push_back(itr->first);
+            itr = PendingChanges.erase(itr);
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+
+    return changedFiles;
+}
+
+void FileWatcher::AddChange(const std::string& path)
+{
+    // editors write backups and swap files next to the real ones
+    size_t nameStart = path.find_last_of('/');
+    std::string_view name = std::string_view(path).substr(nameStart == std::string::npos ? 0 : nameStart + 1);
+    if (name.empty() || name.front() == '.' || name.back() == '~')
+        return;
+
+    PendingChanges.insert_or_assign(path, GetTime());
+}
+
+#if defined(__linux__)
+
+bool FileWatcher::StartNotifications()
+{
+    NotifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (NotifyHandle < 0)
+    {
+        TraceLog(LOG_WARNING, "RESOURCE: inotify is not available, polling %s for changes", RootFolder.c_str());
+        return false;
+    }
+
+    AddWatches(std::string());
+    return true;
+}
+
+void FileWatcher::AddWatches(const std::string& folder)
+{
+    std::string path = folder.empty() ? RootFolder : RootFolder + "/" + folder;
+
+    // a file is reported once it is closed after writing, or moved in, which is how most editors save
+    int watch = inotify_add_watch(NotifyHandle, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (watch < 0)
+    {
+        TraceLog(LOG_WARNING, "RESOURCE: Unable to watch %s for changes", path.c_str());
+        return;
+    }
+
+    WatchedFolders.insert_or_assign(watch, folder);
+
+    // inotify is not recursive, every folder needs its own watch
+    FilePathList files = LoadDirectoryFiles(path.c_str());
+    for (unsigned int i = 0; i < files.count; i++)
+    {
+        if (IsPathFile(files.paths[i]))
+            continue;
+
+        std::string subFolder = GetFileName(files.paths[i]);
+        if (subFolder.empty() || subFolder.front() == '.')
+            continue;
+
+        AddWatches(folder.empty() ? subFolder : folder + "/" + subFolder);
+    }
+    UnloadDirectoryFiles(files);
+}
+
+void FileWatcher::ReadNotifications()
+{
+    alignas(inotify_event) char buffer[4096];
+
+    while (true)
+    {
+        ssize_t size = read(NotifyHandle, buffer, sizeof(buffer));
+        if (size <= 0)
+            break;
+
+        for (ssize_t offset = 0; offset < size;)
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                TraceLog(LOG_WARNING, "RESOURCE: Too many file changes at once, some were missed");
+                continue;
+            }
+
+            auto folder = WatchedFolders.find(event->wd);
+            if (folder == WatchedFolders.end())
+                continue;
+
+            if (event->mask & IN_IGNORED)
+            {
+                WatchedFolders.erase(folder);
+                continue;
+            }
+
+            if (event->len == 0)
+                continue;
+
+            std::string path = folder->second.empty() ? std::string(event->name) : folder->second + "/" + event->name;
+
+            if (event->mask & IN_ISDIR)
+            {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                    AddWatches(path);
+            }
+            else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+            {
+                AddChange(path);
+            }
+        }
+    }
+}
+
+#else
+
+bool FileWatcher::StartNotifications()
+{
+    return false;
+}
+
+void FileWatcher::AddWatches(const std::string& folder)
+{
+}
+
+void FileWatcher::ReadNotifications()
+{
+}
+
+#endif
+
+void FileWatcher::PollFiles(bool reportChanges)
+{
+    FilePathList files = LoadDirectoryFilesEx(RootFolder.c_str(), nullptr, true);
+    for (unsigned int i = 0; i < files.count; i++)
+    {
+        std::string_view fullPath = files.paths[i];
+        if (fullPath.size() <= RootFolder.size())
+            continue;
+
+        std::string path = PackFormat::NormalizePath(fullPath.substr(RootFolder.size() + 1));
+
+        long modTime = GetFileModTime(files.paths[i]);
+
+        auto [itr, added] = FileTimes.try_emplace(path, modTime);
+        if (!added && itr->second == modTime)
+            continue;
+
+        itr->second = modTime;
+
+        if (reportChanges)
+            AddChange(path);
+    }
+    UnloadDirectoryFiles(files);
+}
@@ -0,0 +1,121 @@
+#include "utilities/mapped_file.h"
+
+#include <string>
+
+// this file can't include raylib, the windows headers collide with it
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(std::string_view filePath)
+{
+    Close();
+
+    std::string path(filePath);
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize = { 0 };
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    FileHandle = file;
+    MappingHandle = mapping;
+    Data = (uint8_t*)view;
+    Size = size_t(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (Data)
+        UnmapViewOfFile(Data);
+
+    if (MappingHandle)
+        CloseHandle(MappingHandle);
+
+    if (FileHandle)
+        CloseHandle(FileHandle);
+
+    Data = nullptr;
+    Size = 0;
+    MappingHandle = nullptr;
+    FileHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(std::string_view filePath)
+{
+    Close();
+
+    std::string path(filePath);
+
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size == 0)
+    {
+        close(file);
+        return false;
+    }
+
+    void* view = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+    // the mapping keeps its own reference to the file
+    close(file);
+
+    if (view == MAP_FAILED)
+        return false;
+
+    Data = (uint8_t*)view;
+    Size = size_t(info.st_size);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (Data)
+        munmap(Data, Size);
+
+    Data = nullptr;
+    Size = 0;
+}
+
+#endif
@@ -0,0 +1,95 @@
+#include "utilities/spatial_grid.h"
+
+#include <algorithm>
+
+void SpatialGrid::SetCellSize(float cellSize)
+{
+    CellSize = std::max(cellSize, 0.001f);
+    InverseCellSize = 1.0f / CellSize;
+}
+
+void SpatialGrid::Build(const float* x, const float* y, size_t count, float cellSize)
+{
+    SetCellSize(cellSize);
+
+    PendingCellX.resize(count);
+    PendingCellY.resize(count);
+    PendingItems.resize(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        PendingCellX[i] = GetCell(x[i]);
+        PendingCellY[i] = GetCell(y[i]);
+        PendingItems[i] = uint32_t(i);
+    }
+
+    SortEntries();
+}
+
+void SpatialGrid::BuildBoxes(const Rectangle* boxes, size_t count, float cellSize)
+{
+    SetCellSize(cellSize);
+
+    PendingCellX.clear();
+    PendingCellY.clear();
+    PendingItems.clear();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const Rectangle& box = boxes[i];
+        int32_t lastX = GetCell(box.x + box.width);
+        int32_t lastY = GetCell(box.y + box.height);
+
+        for (int32_t cellY = GetCell(box.y); cellY <= lastY; cellY++)
+        {
+            for (int32_t cellX = GetCell(box.x); cellX <= lastX; cellX++)
+            {
+                PendingCellX.push_back(cellX);
+                PendingCellY.push_back(cellY);
+                PendingItems.push_back(uint32_t(i));
+            }
+        }
+    }
+
+    SortEntries();
+}
+
+void SpatialGrid::SortEntries()
+{
+    size_t count = PendingItems.size();
+
+    uint32_t bucketCount = 16;
+    while (bucketCount < count * 2)
+        bucketCount <<= 1;
+    BucketMask = bucketCount - 1;
+
+    EntryCellX.resize(count);
+    EntryCellY.resize(count);
+    EntryItems.resize(count);
+    BucketStarts.assign(size_t(bucketCount) + 1, 0);
+
+    // counting sort, count what goes in each bucket, turn the counts into where each bucket starts, then drop the entries in
+    for (size_t i = 0; i < count; i++)
+        BucketStarts[GetBucket(PendingCellX[i], PendingCellY[i]) + 1]++;
+
+    for (uint32_t bucket = 0; bucket < bucketCount; bucket++)
+        BucketStarts[bucket + 1] += BucketStarts[bucket];
+
+    FillCursors.assign(BucketStarts.begin(), BucketStarts.end() - 1);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t entry = FillCursors[GetBucket(PendingCellX[i], PendingCellY[i])]++;
+        EntryCellX[entry] = PendingCellX[i];
+        EntryCellY[entry] = PendingCellY[i];
+        EntryItems[entry] = PendingItems[i];
+    }
+}
+
+void SpatialGrid::Clear()
+{
+    BucketStarts.clear();
+    EntryCellX.clear();
+    EntryCellY.clear();
+    EntryItems.clear();
+}
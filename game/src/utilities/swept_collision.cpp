@@ -0,0 +1,327 @@
+#include "utilities/swept_collision.h"
+
+#include "map/map.h"
+#include "services/job_pool.h"
+#include "utilities/collision_utils.h"
+
+#include "raymath.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <random>
+
+namespace SweptCollision
+{
+    static constexpr size_t MoversPerBatch = 256;
+
+    // below this the movers are all done on the calling thread
+    static constexpr size_t ParallelMoverCount = 512;
+
+    static bool FindFirstHit(const Map& map, const std::vector<Rectangle>& obstacles, const Vector2& start, const Vector2& motion, float radius,
+        float& time, Vector2& normal)
+    {
+        bool hit = map.SweepCircle(start, motion, radius, &time, &normal);
+
+        for (const auto& obstacle : obstacles)
+        {
+            float obstacleTime = 0;
+            Vector2 obstacleNormal = { 0, 0 };
+            if (!CollisionUtils::SweepCircleRect(start, motion, radius, obstacle, &obstacleTime, &obstacleNormal))
+                continue;
+
+            if (!hit || obstacleTime < time)
+            {
+                time = obstacleTime;
+                normal = obstacleNormal;
+                hit = true;
+            }
+        }
+
+        return hit;
+    }
+
+    bool MoveCircle(const Map& map, const std::vector<Rectangle>& obstacles, const Vector3& position, Vector3& motion, float radius)
+    {
+        Vector2 start = { position.x, position.y };
+        Vector2 current = start;
+        Vector2 remaining = { motion.x, motion.y };
+
+        bool hitSomething = false;
+
+        // the first trace and then the slides
+        for (int pass = 0; pass <= MaxSlides; pass++)
+        {
+            if (Vector2LengthSqr(remaining) < FLT_EPSILON * FLT_EPSILON)
+                break;
+
+            float time = 0;
+            Vector2 normal = { 0, 0 };
+            if (!FindFirstHit(map, obstacles, current, remaining, radius, time, normal))
+            {
+                current += remaining;
+                remaining = Vector2{ 0, 0 };
+                break;
+            }
+
+            hitSomething = true;
+
+            // go up to the surface and step back off it, then take what is left of the move along the surface
+            current += remaining * time + normal * SkinWidth;
+            remaining = remaining * (1 - time);
+            remaining -= normal * Vector2DotProduct(remaining, normal);
+        }
+
+        motion.x = current.x - start.x;
+        motion.y = current.y - start.y;
+
+        return hitSomething;
+    }
+
+    static void MoveRange(const Map& map, const std::vector<Rectangle>& obstacles, std::vector<Mover>& movers, size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; i++)
+        {
+            Mover& mover = movers[i];
+            mover.Hit = MoveCircle(map, obstacles, mover.Position, mover.Motion, mover.Radius);
+            mover.Position += mover.Motion;
+        }
+    }
+
+    void MoveCircles(const Map& map, const std::vector<Rectangle>& obstacles, std::vector<Mover>& movers)
+    {
+        if (movers.size() < ParallelMoverCount)
+        {
+            MoveRange(map, obstacles, movers, 0, movers.size());
+            return;
+        }
+
+        // every mover only depends on the map and the obstacles, so the batches don't share anything they write
+        JobPool::ParallelFor(movers.size(), MoversPerBatch, [&map, &obstacles, &movers](size_t first, size_t last, size_t)
+            {
+                MoveRange(map, obstacles, movers, first, last);
+            });
+    }
+
+    // how far a circle reaches into a rectangle, 0 or less when they don't overlap
+    static float GetOverlap(const Vector2& center, float radius, const Rectangle& rect)
+    {
+        Vector2 closest = { Clamp(center.x, rect.x, rect.x + rect.width), Clamp(center.y, rect.y, rect.y + rect.height) };
+        return radius - Vector2Distance(center, closest);
+    }
+
+    static float GetMapOverlap(const Map& map, const Vector2& center, float radius)
+    {
+        float worst = 0;
+        for (int y = int(floorf(center.y - radius)); y <= int(floorf(center.y + radius)); y++)
+        {
+            for (int x = int(floorf(center.x - radius)); x <= int(floorf(center.x + radius)); x++)
+            {
+                if (!map.IsCellPassable(x, y))
+                    worst = std::max(worst, GetOverlap(center, radius, Rectangle{ float(x), float(y), 1, 1 }));
+            }
+        }
+        return worst;
+    }
+
+    static void SetWall(Map& map, int x, int y)
+    {
+        map.GetCellRef(x, y).State = MapCellState::Wall;
+    }
+
+    // walls around the edge, each cell blocked with the odds given
+    static void BuildCheckMap(Map& map, int size, float wallOdds, uint32_t seed)
+    {
+        map.SetSize(size, size);
+
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> roll(0, 1);
+
+        for (int y = 0; y < size; y++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                bool edge = x == 0 || y == 0 || x == size - 1 || y == size - 1;
+                if (edge || (wallOdds > 0 && roll(rng) < wallOdds))
+                    SetWall(map, x, y);
+                else
+                    map.GetCellRef(x, y).State = MapCellState::Empty;
+            }
+        }
+    }
+
+    // which cells can be walked between, a circle smaller than a cell can't squeeze between two diagonal walls
+    static std::vector<int> FindAreas(const Map& map)
+    {
+        std::vector<int> areas(size_t(map.Size.X) * size_t(map.Size.Y), -1);
+        std::vector<MapCoordinate> open;
+
+        int areaCount = 0;
+        for (int y = 0; y < map.Size.Y; y++)
+        {
+            for (int x = 0; x < map.Size.X; x++)
+            {
+                if (!map.IsCellPassable(x, y) || areas[map.GetCellIndex(x, y)] >= 0)
+                    continue;
+
+                areas[map.GetCellIndex(x, y)] = areaCount;
+                open.push_back(MapCoordinate{ x, y });
+
+                while (!open.empty())
+                {
+                    MapCoordinate cell = open.back();
+                    open.pop_back();
+
+                    static constexpr int StepX[4] = { 1, -1, 0, 0 };
+                    static constexpr int StepY[4] = { 0, 0, 1, -1 };
+                    for (int step = 0; step < 4; step++)
+                    {
+                        int nextX = cell.X + StepX[step];
+                        int nextY = cell.Y + StepY[step];
+                        if (!map.IsCellPassable(nextX, nextY) || areas[map.GetCellIndex(nextX, nextY)] >= 0)
+                            continue;
+
+                        areas[map.GetCellIndex(nextX, nextY)] = areaCount;
+                        open.push_back(MapCoordinate{ nextX, nextY });
+                    }
+                }
+
+                areaCount++;
+            }
+        }
+
+        return areas;
+    }
+
+    int RunRegressionChecks(std::vector<std::string>& failures)
+    {
+        int failed = 0;
+        auto check = [&](bool passed, const char* name, const Vector3& end)
+            {
+                if (passed)
+                    return;
+
+                failed++;
+                failures.push_back(TextFormat("%s: ended at %.4f, %.4f", name, end.x, end.y));
+            };
+
+        // fixed moves, an open room with a wall down it at x 10, a block at 20,20, two walls touching at a corner
+        // and a solid object from 24,10 to 26,12
+        {
+            Map map;
+            BuildCheckMap(map, 32, 0, 0);
+            for (int y = 1; y < 31; y++)
+                SetWall(map, 10, y);
+            SetWall(map, 20, 20);
+            SetWall(map, 14, 14);
+            SetWall(map, 15, 15);
+
+            std::vector<Rectangle> obstacles = { Rectangle{ 24, 10, 2, 2 } };
+            constexpr float radius = 0.25f;
+
+            auto move = [&](float x, float y, float motionX, float motionY, bool& hit)
+                {
+                    Vector3 position = { x, y, 0 };
+                    Vector3 motion = { motionX, motionY, 0 };
+                    hit = MoveCircle(map, obstacles, position, motion, radius);
+                    return position + motion;
+                };
+
+            bool hit = false;
+            Vector3 end = move(5.5f, 5.5f, 20, 0, hit);
+            check(hit && end.x <= 10 - radius && end.x > 10 - radius - 0.01f && end.y == 5.5f, "Fast move into a wall", end);
+
+            end = move(2.5f, 16.5f, 1000, 0, hit);
+            check(hit && end.x <= 10 - radius && end.x > 10 - radius - 0.01f, "Frame spike into a wall", end);
+
+            end = move(9.5f, 5.5f, 1, 1, hit);
+            check(hit && end.x <= 10 - radius && fabsf(end.y - 6.5f) < 0.01f, "Slide along a wall", end);
+
+            end = move(18.5f, 18.5f, 3, 3, hit);
+            check(hit && GetMapOverlap(map, Vector2{ end.x, end.y }, radius) <= 0, "Into the corner of a block", end);
+
+            end = move(22, 11, 5, 0, hit);
+            check(hit && end.x <= 24 - radius && end.x > 24 - radius - 0.01f, "Into an object", end);
+
+            end = move(9.9f, 5.5f, -1, 0, hit);
+            check(!hit && fabsf(end.x - 8.9f) < 0.0001f, "Back out of a wall", end);
+
+            end = move(14.5f, 15.5f, 1, -1, hit);
+            check(hit && int(floorf(end.x)) == 14 && int(floorf(end.y)) == 15, "Squeeze between diagonal walls", end);
+
+            end = move(12.5f, 5.5f, 0, 0, hit);
+            check(!hit && end.x == 12.5f && end.y == 5.5f, "Standing still", end);
+        }
+
+        // random moves on a random map, nothing may end up inside a wall or in an area it can't walk to from where it started,
+        // and moving them all at once has to give exactly the same results
+        {
+            Map map;
+            BuildCheckMap(map, 48, 0.25f, 12345);
+            std::vector<int> areas = FindAreas(map);
+
+            std::mt19937 rng(54321);
+            std::uniform_int_distribution<int> cell(1, 46);
+            std::uniform_real_distribution<float> angle(0, 2 * PI);
+            std::uniform_real_distribution<float> distance(0, 10);
+
+            std::vector<Mover> movers;
+            while (movers.size() < 2000)
+            {
+                int x = cell(rng);
+                int y = cell(rng);
+                if (!map.IsCellPassable(x, y))
+                    continue;
+
+                float direction = angle(rng);
+                float length = distance(rng);
+
+                Mover mover;
+                mover.Position = Vector3{ x + 0.5f, y + 0.5f, 0 };
+                mover.Motion = Vector3{ cosf(direction) * length, sinf(direction) * length, 0 };
+                movers.push_back(mover);
+            }
+
+            std::vector<Mover> batch = movers;
+            MoveCircles(map, std::vector<Rectangle>(), batch);
+
+            int inWalls = 0;
+            int escaped = 0;
+            int mismatched = 0;
+            for (size_t i = 0; i < movers.size(); i++)
+            {
+                Mover single = movers[i];
+                single.Hit = MoveCircle(map, std::vector<Rectangle>(), single.Position, single.Motion, single.Radius);
+                single.Position += single.Motion;
+
+                if (!Vector3Equals(single.Position, batch[i].Position) || single.Hit != batch[i].Hit)
+                    mismatched++;
+
+                Vector2 end = { single.Position.x, single.Position.y };
+                if (GetMapOverlap(map, end, single.Radius) > 0.0001f)
+                    inWalls++;
+
+                int startArea = areas[map.GetCellIndex(int(movers[i].Position.x), int(movers[i].Position.y))];
+                if (areas[map.GetCellIndex(int(floorf(end.x)), int(floorf(end.y)))] != startArea)
+                    escaped++;
+            }
+
+            if (inWalls > 0)
+            {
+                failed++;
+                failures.push_back(TextFormat("Random moves: %d ended inside a wall", inWalls));
+            }
+            if (escaped > 0)
+            {
+                failed++;
+                failures.push_back(TextFormat("Random moves: %d went through a wall", escaped));
+            }
+            if (mismatched > 0)
+            {
+                failed++;
+                failures.push_back(TextFormat("Random moves: %d batched moves differ from single ones", mismatched));
+            }
+        }
+
+        return failed;
+    }
+}
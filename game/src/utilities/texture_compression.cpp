@@ -0,0 +1,867 @@
+#include "utilities/texture_compression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+
+namespace TextureCompression
+{
+    static size_t GetBlockLevelSize(int width, int height, int blockWidth, int blockHeight, size_t blockBytes)
+    {
+        return size_t((width + blockWidth - 1) / blockWidth) * size_t((height + blockHeight - 1) / blockHeight) * blockBytes;
+    }
+
+    size_t GetLevelSize(int width, int height, int format)
+    {
+        width = std::max(width, 1);
+        height = std::max(height, 1);
+
+        size_t pixels = size_t(width) * size_t(height);
+
+        switch (format)
+        {
+        case PIXELFORMAT_UNCOMPRESSED_GRAYSCALE:
+            return pixels;
+
+        case PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA:
+        case PIXELFORMAT_UNCOMPRESSED_R5G6B5:
+        case PIXELFORMAT_UNCOMPRESSED_R5G5B5A1:
+        case PIXELFORMAT_UNCOMPRESSED_R4G4B4A4:
+        case PIXELFORMAT_UNCOMPRESSED_R16:
+            return pixels * 2;
+
+        case PIXELFORMAT_UNCOMPRESSED_R8G8B8:
+            return pixels * 3;
+
+        case PIXELFORMAT_UNCOMPRESSED_R8G8B8A8:
+        case PIXELFORMAT_UNCOMPRESSED_R32:
+            return pixels * 4;
+
+        case PIXELFORMAT_UNCOMPRESSED_R16G16B16:
+            return pixels * 6;
+
+        case PIXELFORMAT_UNCOMPRESSED_R16G16B16A16:
+            return pixels * 8;
+
+        case PIXELFORMAT_UNCOMPRESSED_R32G32B32:
+            return pixels * 12;
+
+        case PIXELFORMAT_UNCOMPRESSED_R32G32B32A32:
+            return pixels * 16;
+
+        case PIXELFORMAT_COMPRESSED_DXT1_RGB:
+        case PIXELFORMAT_COMPRESSED_DXT1_RGBA:
+        case PIXELFORMAT_COMPRESSED_ETC1_RGB:
+        case PIXELFORMAT_COMPRESSED_ETC2_RGB:
+            return GetBlockLevelSize(width, height, 4, 4, 8);
+
+        case PIXELFORMAT_COMPRESSED_DXT3_RGBA:
+        case PIXELFORMAT_COMPRESSED_DXT5_RGBA:
+        case PIXELFORMAT_COMPRESSED_ETC2_EAC_RGBA:
+        case PIXELFORMAT_COMPRESSED_ASTC_4x4_RGBA:
+            return GetBlockLevelSize(width, height, 4, 4, 16);
+
+        case PIXELFORMAT_COMPRESSED_ASTC_8x8_RGBA:
+            return GetBlockLevelSize(width, height, 8, 8, 16);
+
+        case PIXELFORMAT_COMPRESSED_PVRT_RGB:
+        case PIXELFORMAT_COMPRESSED_PVRT_RGBA:
+            // 4 bits per pixel, but never smaller than 8x8
+            return size_t(std::max(width, 8)) * size_t(std::max(height, 8)) / 2;
+
+        default:
+            return pixels * 4;
+        }
+    }
+
+    size_t GetTextureSize(int width, int height, int mipmaps, int format)
+    {
+        size_t size = 0;
+        for (int level = 0; level < std::max(mipmaps, 1); level++)
+            size += GetLevelSize(width >> level, height >> level, format);
+
+        return size;
+    }
+
+    bool IsCompressedFormat(int format)
+    {
+        return format >= PIXELFORMAT_COMPRESSED_DXT1_RGB;
+    }
+
+    bool HasAlpha(const Image& image)
+    {
+        if (!image.data || image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
+            return false;
+
+        const uint8_t* pixels = (const uint8_t*)image.data;
+        size_t count = size_t(image.width) * size_t(image.height);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (pixels[i * 4 + 3] != 255)
+                return true;
+        }
+
+        return false;
+    }
+
+    int GetCompressedMipCount(int width, int height)
+    {
+        int count = 0;
+        while (width >= 4 && height >= 4 && width % 4 == 0 && height % 4 == 0)
+        {
+            count++;
+            width /= 2;
+            height /= 2;
+        }
+
+        return count;
+    }
+
+    Image BuildMipChain(const Image& image, int mipmaps)
+    {
+        Image result = { 0 };
+        if (!image.data || image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 || mipmaps < 1)
+            return result;
+
+        result.width = image.width;
+        result.height = image.height;
+        result.mipmaps = mipmaps;
+        result.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+        result.data = MemAlloc((unsigned int)GetTextureSize(image.width, image.height, mipmaps, result.format));
+
+        uint8_t* level = (uint8_t*)result.data;
+        memcpy(level, image.data, GetLevelSize(image.width, image.height, result.format));
+
+        int width = image.width;
+        int height = image.height;
+
+        for (int mip = 1; mip < mipmaps; mip++)
+        {
+            int nextWidth = std::max(width / 2, 1);
+            int nextHeight = std::max(height / 2, 1);
+            uint8_t* nextLevel = level + GetLevelSize(width, height, result.format);
+
+            // box filter, odd edges reuse the last row or column
+            for (int y = 0; y < nextHeight; y++)
+            {
+                int y0 = std::min(y * 2, height - 1);
+                int y1 = std::min(y * 2 + 1, height - 1);
+
+                for (int x = 0; x < nextWidth; x++)
+                {
+                    int x0 = std::min(x * 2, width - 1);
+                    int x1 = std::min(x * 2 + 1, width - 1);
+
+                    for (int c = 0; c < 4; c++)
+                    {
+                        int sum = level[(y0 * width + x0) * 4 + c] + level[(y0 * width + x1) * 4 + c]
+                            + level[(y1 * width + x0) * 4 + c] + level[(y1 * width + x1) * 4 + c];
+
+                        nextLevel[(y * nextWidth + x) * 4 + c] = uint8_t((sum + 2) / 4);
+                    }
+                }
+            }
+
+            level = nextLevel;
+            width = nextWidth;
+            height = nextHeight;
+        }
+
+        return result;
+    }
+
+    static uint16_t PackColor565(const float color[3])
+    {
+        int r = std::clamp(int(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+        int g = std::clamp(int(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+        int b = std::clamp(int(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+
+        return uint16_t((r << 11) | (g << 5) | b);
+    }
+
+    static void UnpackColor565(uint16_t packed, int color[3])
+    {
+        int r = (packed >> 11) & 31;
+        int g = (packed >> 5) & 63;
+        int b = packed & 31;
+
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    // the four colors of a block in four color mode
+    static void BuildPalette(uint16_t color0, uint16_t color1, int palette[4][3])
+    {
+        UnpackColor565(color0, palette[0]);
+        UnpackColor565(color1, palette[1]);
+
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+    }
+
+    // picks the closest palette color for each pixel, returns the total squared error
+    static int FindColorIndices(const uint8_t pixels[64], const int palette[4][3], uint8_t indices[16])
+    {
+        int totalError = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            int bestError = INT32_MAX;
+            for (int p = 0; p < 4; p++)
+            {
+                int error = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int delta = int(pixels[i * 4 + c]) - palette[p][c];
+                    error += delta * delta;
+                }
+
+                if (error < bestError)
+                {
+                    bestError = error;
+                    indices[i] = uint8_t(p);
+                }
+            }
+            totalError += bestError;
+        }
+
+        return totalError;
+    }
+
+    // encodes a color block for a pair of endpoints, keeping the first endpoint larger so the block is in four color mode
+    static int EncodeColorBlock(const uint8_t pixels[64], uint16_t color0, uint16_t color1, uint8_t block[8])
+    {
+        if (color0 < color1)
+            std::swap(color0, color1);
+
+        uint8_t indices[16] = { 0 };
+        int error = 0;
+
+        int palette[4][3];
+        BuildPalette(color0, color1, palette);
+
+        if (color0 == color1)
+        {
+            // equal endpoints are three color mode, where only the first index is safe to use
+            for (int i = 0; i < 16; i++)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    int delta = int(pixels[i * 4 + c]) - palette[0][c];
+                    error += delta * delta;
+                }
+            }
+        }
+        else
+        {
+            error = FindColorIndices(pixels, palette, indices);
+        }
+
+        block[0] = uint8_t(color0 & 0xFF);
+        block[1] = uint8_t(color0 >> 8);
+        block[2] = uint8_t(color1 & 0xFF);
+        block[3] = uint8_t(color1 >> 8);
+
+        uint32_t bits = 0;
+        for (int i = 0; i < 16; i++)
+            bits |= uint32_t(indices[i]) << (i * 2);
+
+        block[4] = uint8_t(bits);
+        block[5] = uint8_t(bits >> 8);
+        block[6] = uint8_t(bits >> 16);
+        block[7] = uint8_t(bits >> 24);
+
+        return error;
+    }
+
+    void CompressBlockDXT1(const uint8_t pixels[64], uint8_t block[8])
+    {
+        // fit a line through the colors, the endpoints are the extremes along its main axis
+        float mean[3] = { 0 };
+        for (int i = 0; i < 16; i++)
+        {
+            for (int c = 0; c < 3; c++)
+                mean[c] += pixels[i * 4 + c] / 16.0f;
+        }
+
+        float covariance[6] = { 0 };
+        for (int i = 0; i < 16; i++)
+        {
+            float r = pixels[i * 4 + 0] - mean[0];
+            float g = pixels[i * 4 + 1] - mean[1];
+            float b = pixels[i * 4 + 2] - mean[2];
+
+            covariance[0] += r * r;
+            covariance[1] += r * g;
+            covariance[2] += r * b;
+            covariance[3] += g * g;
+            covariance[4] += g * b;
+            covariance[5] += b * b;
+        }
+
+        float axis[3] = { 1, 1, 1 };
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[3] =
+            {
+                axis[0] * covariance[0] + axis[1] * covariance[1] + axis[2] * covariance[2],
+                axis[0] * covariance[1] + axis[1] * covariance[3] + axis[2] * covariance[4],
+                axis[0] * covariance[2] + axis[1] * covariance[4] + axis[2] * covariance[5],
+            };
+
+            float length = std::max({ fabsf(next[0]), fabsf(next[1]), fabsf(next[2]) });
+            if (length <= 0)
+                break;
+
+            for (int c = 0; c < 3; c++)
+                axis[c] = next[c] / length;
+        }
+
+        int minIndex = 0;
+        int maxIndex = 0;
+        float minDot = INFINITY;
+        float maxDot = -INFINITY;
+
+        for (int i = 0; i < 16; i++)
+        {
+            float dot = pixels[i * 4 + 0] * axis[0] + pixels[i * 4 + 1] * axis[1] + pixels[i * 4 + 2] * axis[2];
+            if (dot < minDot)
+            {
+                minDot = dot;
+                minIndex = i;
+            }
+            if (dot > maxDot)
+            {
+                maxDot = dot;
+                maxIndex = i;
+            }
+        }
+
+        float maxColor[3] = { float(pixels[maxIndex * 4 + 0]), float(pixels[maxIndex * 4 + 1]), float(pixels[maxIndex * 4 + 2]) };
+        float minColor[3] = { float(pixels[minIndex * 4 + 0]), float(pixels[minIndex * 4 + 1]), float(pixels[minIndex * 4 + 2]) };
+
+        int bestError = EncodeColorBlock(pixels, PackColor565(maxColor), PackColor565(minColor), block);
+        if (bestError == 0)
+            return;
+
+        // refine the endpoints with a least squares fit to the chosen indices
+        static constexpr float IndexWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+        uint32_t bits = block[4] | (block[5] << 8) | (block[6] << 16) | (uint32_t(block[7]) << 24);
+
+        float aa = 0, bb = 0, ab = 0;
+        float ax[3] = { 0 };
+        float bx[3] = { 0 };
+
+        for (int i = 0; i < 16; i++)
+        {
+            float weight = IndexWeights[(bits >> (i * 2)) & 3];
+            float inverse = 1.0f - weight;
+
+            aa += weight * weight;
+            bb += inverse * inverse;
+            ab += weight * inverse;
+
+            for (int c = 0; c < 3; c++)
+            {
+                ax[c] += weight * pixels[i * 4 + c];
+                bx[c] += inverse * pixels[i * 4 + c];
+            }
+        }
+
+        float determinant = aa * bb - ab * ab;
+        if (fabsf(determinant) < 0.0001f)
+            return;
+
+        float refinedMax[3];
+        float refinedMin[3];
+        for (int c = 0; c < 3; c++)
+        {
+            refinedMax[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+            refinedMin[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+        }
+
+        uint8_t refinedBlock[8];
+        int refinedError = EncodeColorBlock(pixels, PackColor565(refinedMax), PackColor565(refinedMin), refinedBlock);
+        if (refinedError < bestError)
+            memcpy(block, refinedBlock, sizeof(refinedBlock));
+    }
+
+    void CompressBlockDXT5(const uint8_t pixels[64], uint8_t block[16])
+    {
+        uint8_t maxAlpha = 0;
+        uint8_t minAlpha = 255;
+        for (int i = 0; i < 16; i++)
+        {
+            maxAlpha = std::max(maxAlpha, pixels[i * 4 + 3]);
+            minAlpha = std::min(minAlpha, pixels[i * 4 + 3]);
+        }
+
+        block[0] = maxAlpha;
+        block[1] = minAlpha;
+
+        // with the larger alpha first the block uses eight interpolated values
+        int palette[8] = { maxAlpha, minAlpha };
+        for (int i = 1; i < 7; i++)
+            palette[i + 1] = ((7 - i) * maxAlpha + i * minAlpha) / 7;
+
+        uint64_t bits = 0;
+        if (maxAlpha != minAlpha)
+        {
+            for (int i = 0; i < 16; i++)
+            {
+                int bestIndex = 0;
+                int bestError = INT32_MAX;
+                for (int p = 0; p < 8; p++)
+                {
+                    int error = abs(int(pixels[i * 4 + 3]) - palette[p]);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        bestIndex = p;
+                    }
+                }
+
+                bits |= uint64_t(bestIndex) << (i * 3);
+            }
+        }
+
+        for (int i = 0; i < 6; i++)
+            block[2 + i] = uint8_t(bits >> (i * 8));
+
+        CompressBlockDXT1(pixels, block + 8);
+    }
+
+    void DecompressBlockDXT1(const uint8_t block[8], uint8_t pixels[64])
+    {
+        uint16_t color0 = uint16_t(block[0] | (block[1] << 8));
+        uint16_t color1 = uint16_t(block[2] | (block[3] << 8));
+
+        int palette[4][3];
+        int alpha[4] = { 255, 255, 255, 255 };
+
+        BuildPalette(color0, color1, palette);
+        if (color0 <= color1)
+        {
+            // three color mode, the last color is transparent black
+            for (int c = 0; c < 3; c++)
+            {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+            alpha[3] = 0;
+        }
+
+        uint32_t bits = block[4] | (block[5] << 8) | (block[6] << 16) | (uint32_t(block[7]) << 24);
+        for (int i = 0; i < 16; i++)
+        {
+            int index = (bits >> (i * 2)) & 3;
+            pixels[i * 4 + 0] = uint8_t(palette[index][0]);
+            pixels[i * 4 + 1] = uint8_t(palette[index][1]);
+            pixels[i * 4 + 2] = uint8_t(palette[index][2]);
+            pixels[i * 4 + 3] = uint8_t(alpha[index]);
+        }
+    }
+
+    void DecompressBlockDXT5(const uint8_t block[16], uint8_t pixels[64])
+    {
+        int palette[8] = { block[0], block[1] };
+        if (block[0] > block[1])
+        {
+            for (int i = 1; i < 7; i++)
+                palette[i + 1] = ((7 - i) * block[0] + i * block[1]) / 7;
+        }
+        else
+        {
+            for (int i = 1; i < 5; i++)
+                palette[i + 1] = ((5 - i) * block[0] + i * block[1]) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        uint64_t bits = 0;
+        for (int i = 0; i < 6; i++)
+            bits |= uint64_t(block[2 + i]) << (i * 8);
+
+        DecompressBlockDXT1(block + 8, pixels);
+
+        // the color block of a DXT5 block is always four color mode
+        uint16_t color0 = uint16_t(block[8] | (block[9] << 8));
+        uint16_t color1 = uint16_t(block[10] | (block[11] << 8));
+        if (color0 <= color1)
+        {
+            int colorPalette[4][3];
+            BuildPalette(color0, color1, colorPalette);
+
+            uint32_t colorBits = block[12] | (block[13] << 8) | (block[14] << 16) | (uint32_t(block[15]) << 24);
+            for (int i = 0; i < 16; i++)
+            {
+                int index = (colorBits >> (i * 2)) & 3;
+                for (int c = 0; c < 3; c++)
+                    pixels[i * 4 + c] = uint8_t(colorPalette[index][c]);
+            }
+        }
+
+        for (int i = 0; i < 16; i++)
+            pixels[i * 4 + 3] = uint8_t(palette[(bits >> (i * 3)) & 7]);
+    }
+
+    Image CompressImage(const Image& image, int format)
+    {
+        Image result = { 0 };
+
+        if (format != PIXELFORMAT_COMPRESSED_DXT1_RGB && format != PIXELFORMAT_COMPRESSED_DXT5_RGBA)
+            return result;
+
+        if (!image.data || image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 || image.width % 4 != 0 || image.height % 4 != 0)
+            return result;
+
+        // every level has to be whole blocks
+        int mipmaps = std::min(std::max(image.mipmaps, 1), GetCompressedMipCount(image.width, image.height));
+
+        size_t blockBytes = format == PIXELFORMAT_COMPRESSED_DXT1_RGB ? 8 : 16;
+
+        result.width = image.width;
+        result.height = image.height;
+        result.mipmaps = mipmaps;
+        result.format = format;
+        result.data = MemAlloc((unsigned int)GetTextureSize(image.width, image.height, mipmaps, format));
+
+        const uint8_t* source = (const uint8_t*)image.data;
+        uint8_t* destination = (uint8_t*)result.data;
+
+        for (int level = 0; level < mipmaps; level++)
+        {
+            int width = image.width >> level;
+            int height = image.height >> level;
+
+            for (int blockY = 0; blockY < height / 4; blockY++)
+            {
+                for (int blockX = 0; blockX < width / 4; blockX++)
+                {
+                    uint8_t pixels[64];
+                    for (int row = 0; row < 4; row++)
+                        memcpy(pixels + row * 16, source + ((blockY * 4 + row) * width + blockX * 4) * 4, 16);
+
+                    if (format == PIXELFORMAT_COMPRESSED_DXT1_RGB)
+                        CompressBlockDXT1(pixels, destination);
+                    else
+                        CompressBlockDXT5(pixels, destination);
+
+                    destination += blockBytes;
+                }
+            }
+
+            source += GetLevelSize(width, height, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+        }
+
+        return result;
+    }
+
+    Image DecompressImage(const Image& image)
+    {
+        Image result = { 0 };
+
+        if (!image.data || (image.format != PIXELFORMAT_COMPRESSED_DXT1_RGB && image.format != PIXELFORMAT_COMPRESSED_DXT5_RGBA))
+            return result;
+
+        int mipmaps = std::max(image.mipmaps, 1);
+        size_t blockBytes = image.format == PIXELFORMAT_COMPRESSED_DXT1_RGB ? 8 : 16;
+
+        result.width = image.width;
+        result.height = image.height;
+        result.mipmaps = mipmaps;
+        result.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+        result.data = MemAlloc((unsigned int)GetTextureSize(image.width, image.height, mipmaps, result.format));
+
+        const uint8_t* source = (const uint8_t*)image.data;
+        uint8_t* destination = (uint8_t*)result.data;
+
+        for (int level = 0; level < mipmaps; level++)
+        {
+            int width = std::max(image.width >> level, 1);
+            int height = std::max(image.height >> level, 1);
+
+            for (int blockY = 0; blockY < (height + 3) / 4; blockY++)
+            {
+                for (int blockX = 0; blockX < (width + 3) / 4; blockX++)
+                {
+                    uint8_t pixels[64];
+                    if (image.format == PIXELFORMAT_COMPRESSED_DXT1_RGB)
+                        DecompressBlockDXT1(source, pixels);
+                    else
+                        DecompressBlockDXT5(source, pixels);
+
+                    source += blockBytes;
+
+                    // levels smaller than a block only keep the pixels they have
+                    for (int row = 0; row < 4 && blockY * 4 + row < height; row++)
+                    {
+                        int columns = std::min(4, width - blockX * 4);
+                        memcpy(destination + ((blockY * 4 + row) * width + blockX * 4) * 4, pixels + row * 16, columns * 4);
+                    }
+                }
+            }
+
+            destination += GetLevelSize(width, height, result.format);
+        }
+
+        return result;
+    }
+
+    float GetImageError(const Image& a, const Image& b)
+    {
+        if (!a.data || !b.data || a.width != b.width || a.height != b.height
+            || a.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 || b.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
+            return -1;
+
+        const uint8_t* pixelsA = (const uint8_t*)a.data;
+        const uint8_t* pixelsB = (const uint8_t*)b.data;
+        size_t count = size_t(a.width) * size_t(a.height) * 4;
+
+        double sum = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            double delta = double(pixelsA[i]) - double(pixelsB[i]);
+            sum += delta * delta;
+        }
+
+        return float(sqrt(sum / double(count)));
+    }
+
+    // the parts of the DDS header raylib reads
+    struct DDSPixelFormat
+    {
+        uint32_t Size = 32;
+        uint32_t Flags = 0x04;    // DDPF_FOURCC
+        uint32_t FourCC = 0;
+        uint32_t RGBBitCount = 0;
+        uint32_t Masks[4] = { 0 };
+    };
+
+    struct DDSHeader
+    {
+        uint32_t Size = 124;
+        uint32_t Flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;    // caps, height, width, pixel format, mip count, linear size
+        uint32_t Height = 0;
+        uint32_t Width = 0;
+        uint32_t PitchOrLinearSize = 0;
+        uint32_t Depth = 0;
+        uint32_t MipMapCount = 0;
+        uint32_t Reserved1[11] = { 0 };
+        DDSPixelFormat PixelFormat;
+        uint32_t Caps = 0x1000;    // DDSCAPS_TEXTURE
+        uint32_t Caps2 = 0;
+        uint32_t Caps3 = 0;
+        uint32_t Caps4 = 0;
+        uint32_t Reserved2 = 0;
+    };
+
+    static_assert(sizeof(DDSHeader) == 124, "DDS header must not have padding");
+
+    bool ExportDDS(const Image& image, const char* fileName)
+    {
+        if (!image.data || (image.format != PIXELFORMAT_COMPRESSED_DXT1_RGB && image.format != PIXELFORMAT_COMPRESSED_DXT5_RGBA))
+            return false;
+
+        int mipmaps = std::max(image.mipmaps, 1);
+
+        DDSHeader header;
+        header.Width = uint32_t(image.width);
+        header.Height = uint32_t(image.height);
+        header.PitchOrLinearSize = uint32_t(GetLevelSize(image.width, image.height, image.format));
+        header.MipMapCount = uint32_t(mipmaps);
+        header.PixelFormat.FourCC = image.format == PIXELFORMAT_COMPRESSED_DXT1_RGB ? 0x31545844 : 0x35545844;   // "DXT1" or "DXT5"
+
+        if (mipmaps > 1)
+            header.Caps |= 0x400000 | 0x8;    // DDSCAPS_MIPMAP, DDSCAPS_COMPLEX
+
+        size_t dataSize = GetTextureSize(image.width, image.height, mipmaps, image.format);
+
+        // raylib reads the first level plus a third for the mips, which can be a little more than a block aligned chain, so pad up to it
+        size_t readSize = header.PitchOrLinearSize;
+        if (mipmaps > 1)
+            readSize += header.PitchOrLinearSize / 3;
+
+        FILE* file = fopen(fileName, "wb");
+        if (!file)
+            return false;
+
+        bool written = fwrite("DDS ", 1, 4, file) == 4
+            && fwrite(&header, sizeof(header), 1, file) == 1
+            && fwrite(image.data, 1, dataSize, file) == dataSize;
+
+        for (size_t i = dataSize; written && i < readSize; i++)
+            written = fputc(0, file) != EOF;
+
+        fclose(file);
+        return written;
+    }
+
+    // an 8 bit RGBA image filled by a function of the pixel position
+    template<class Fill>
+    static Image MakeCheckImage(int width, int height, Fill fill)
+    {
+        Image image = { 0 };
+        image.width = width;
+        image.height = height;
+        image.mipmaps = 1;
+        image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+        image.data = MemAlloc((unsigned int)GetLevelSize(width, height, image.format));
+
+        uint8_t* pixels = (uint8_t*)image.data;
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+                fill(x, y, pixels + (y * width + x) * 4);
+        }
+
+        return image;
+    }
+
+    // compresses and expands the image, returns the error of the first level or -1 if either step failed
+    static float GetRoundTripError(const Image& image, int format)
+    {
+        Image compressed = CompressImage(image, format);
+        if (!compressed.data)
+            return -1;
+
+        Image expanded = DecompressImage(compressed);
+        float error = GetImageError(image, expanded);
+
+        UnloadImage(expanded);
+        UnloadImage(compressed);
+        return error;
+    }
+
+    int RunRegressionChecks(std::vector<std::string>& failures)
+    {
+        int failed = 0;
+
+        // sizes of formats with known layouts, block formats round partial blocks up to whole ones
+        struct SizeCheck
+        {
+            int Width;
+            int Height;
+            int Mipmaps;
+            int Format;
+            size_t Expected;
+        };
+
+        static constexpr SizeCheck sizeChecks[] =
+        {
+            { 16, 16, 1, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE, 256 },
+            { 16, 16, 1, PIXELFORMAT_UNCOMPRESSED_R5G6B5, 512 },
+            { 16, 16, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8, 768 },
+            { 16, 16, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 1024 },
+            { 16, 16, 1, PIXELFORMAT_UNCOMPRESSED_R16G16B16A16, 2048 },
+            { 16, 16, 1, PIXELFORMAT_UNCOMPRESSED_R32G32B32A32, 4096 },
+            { 16, 16, 1, PIXELFORMAT_COMPRESSED_DXT1_RGB, 128 },
+            { 16, 16, 1, PIXELFORMAT_COMPRESSED_ETC2_RGB, 128 },
+            { 16, 16, 1, PIXELFORMAT_COMPRESSED_DXT5_RGBA, 256 },
+            { 16, 16, 1, PIXELFORMAT_COMPRESSED_ASTC_4x4_RGBA, 256 },
+            { 16, 16, 1, PIXELFORMAT_COMPRESSED_ASTC_8x8_RGBA, 64 },
+            { 4, 4, 1, PIXELFORMAT_COMPRESSED_PVRT_RGB, 32 },
+            { 1, 1, 1, PIXELFORMAT_COMPRESSED_DXT1_RGB, 8 },
+            { 6, 6, 1, PIXELFORMAT_COMPRESSED_DXT1_RGB, 32 },
+            { 6, 6, 1, PIXELFORMAT_COMPRESSED_DXT5_RGBA, 64 },
+            { 16, 16, 0, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 1024 },
+            { 256, 256, 9, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 349524 },
+            { 256, 256, 9, PIXELFORMAT_COMPRESSED_DXT1_RGB, 43704 },
+            { 256, 256, 9, PIXELFORMAT_COMPRESSED_DXT5_RGBA, 87408 },
+            { 64, 32, 7, PIXELFORMAT_COMPRESSED_DXT1_RGB, 1384 },
+        };
+
+        for (const auto& check : sizeChecks)
+        {
+            size_t size = GetTextureSize(check.Width, check.Height, check.Mipmaps, check.Format);
+            if (size == check.Expected)
+                continue;
+
+            failed++;
+            failures.push_back(TextFormat("size of %dx%d format %d with %d mips: %zu, expected %zu", check.Width, check.Height, check.Format, check.Mipmaps, size, check.Expected));
+        }
+
+        if (GetCompressedMipCount(256, 256) != 7 || GetCompressedMipCount(12, 8) != 1 || GetCompressedMipCount(2, 2) != 0)
+        {
+            failed++;
+            failures.push_back("compressed mip counts are wrong");
+        }
+
+        // round trips, each bound is a little over the error the encoders get now. smooth images come back within about 2.7,
+        // noise within about 46 where flat blocks of the average color would be near 74
+        std::mt19937 random(35);
+
+        struct RoundTrip
+        {
+            const char* Name;
+            Image Source;
+            int Format;
+            float MaxError;
+        };
+
+        RoundTrip roundTrips[] =
+        {
+            // colors 565 can hold exactly come back unchanged
+            { "solid", MakeCheckImage(32, 32, [](int x, int y, uint8_t* pixel) { pixel[0] = 255; pixel[1] = 0; pixel[2] = 255; pixel[3] = 255; }), PIXELFORMAT_COMPRESSED_DXT1_RGB, 0.5f },
+            { "gradient", MakeCheckImage(64, 64, [](int x, int y, uint8_t* pixel) { pixel[0] = uint8_t(x * 4); pixel[1] = uint8_t(y * 4); pixel[2] = uint8_t((x + y) * 2); pixel[3] = 255; }), PIXELFORMAT_COMPRESSED_DXT1_RGB, 3.5f },
+            { "noise", MakeCheckImage(64, 64, [&random](int x, int y, uint8_t* pixel) { for (int c = 0; c < 3; c++) pixel[c] = uint8_t(random()); pixel[3] = 255; }), PIXELFORMAT_COMPRESSED_DXT1_RGB, 55.0f },
+            { "alpha gradient", MakeCheckImage(64, 64, [](int x, int y, uint8_t* pixel) { pixel[0] = uint8_t(x * 4); pixel[1] = 128; pixel[2] = uint8_t(255 - y * 4); pixel[3] = uint8_t(y * 4); }), PIXELFORMAT_COMPRESSED_DXT5_RGBA, 3.5f },
+            { "alpha noise", MakeCheckImage(64, 64, [&random](int x, int y, uint8_t* pixel) { for (int c = 0; c < 4; c++) pixel[c] = uint8_t(random()); }), PIXELFORMAT_COMPRESSED_DXT5_RGBA, 55.0f },
+        };
+
+        for (auto& check : roundTrips)
+        {
+            float error = GetRoundTripError(check.Source, check.Format);
+            if (error < 0 || error > check.MaxError)
+            {
+                failed++;
+                failures.push_back(TextFormat("%s round trip error %g, limit %g", check.Name, error, check.MaxError));
+            }
+
+            UnloadImage(check.Source);
+        }
+
+        // sizes the encoder can't take come back empty instead of half written
+        Image uneven = MakeCheckImage(6, 6, [](int x, int y, uint8_t* pixel) { memset(pixel, 255, 4); });
+        Image rejected = CompressImage(uneven, PIXELFORMAT_COMPRESSED_DXT1_RGB);
+        if (rejected.data)
+        {
+            failed++;
+            failures.push_back("a 6x6 image was compressed");
+            UnloadImage(rejected);
+        }
+        UnloadImage(uneven);
+
+        // a mip chain keeps the levels that are whole blocks and expands back, the steep two color gradient comes back within about 4.7
+        Image source = MakeCheckImage(32, 32, [](int x, int y, uint8_t* pixel) { pixel[0] = uint8_t(x * 8); pixel[1] = uint8_t(y * 8); pixel[2] = 0; pixel[3] = 255; });
+        Image chain = BuildMipChain(source, 6);
+        Image compressed = CompressImage(chain, PIXELFORMAT_COMPRESSED_DXT5_RGBA);
+        if (compressed.mipmaps != GetCompressedMipCount(32, 32))
+        {
+            failed++;
+            failures.push_back(TextFormat("a 32x32 chain compressed to %d levels, expected %d", compressed.mipmaps, GetCompressedMipCount(32, 32)));
+        }
+        else
+        {
+            Image expanded = DecompressImage(compressed);
+            if (!expanded.data || GetImageError(chain, expanded) > 6.0f)
+            {
+                failed++;
+                failures.push_back("a compressed mip chain did not expand back");
+            }
+            UnloadImage(expanded);
+        }
+        UnloadImage(compressed);
+        UnloadImage(chain);
+        UnloadImage(source);
+
+        return failed;
+    }
+}
@@ -0,0 +1,113 @@
+#include "raylib.h"
+
+#include "map/compiled_map.h"
+#include "map/map_compiler.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// compiles LDtk projects into compiled maps, written next to the project.
+// the game loads the .cmap instead of the project with the same name
+// usage: map_tool <ldtk file or folder> [-force]
+
+struct ToolTotals
+{
+    int Compiled = 0;
+    int Skipped = 0;
+    int Failed = 0;
+    size_t SourceBytes = 0;
+    size_t CompiledBytes = 0;
+};
+
+static void CompileMap(const std::string& sourcePath, bool force, ToolTotals& totals)
+{
+    std::string outputPath = CompiledMap::GetCompiledName(sourcePath);
+
+    if (!force && FileExists(outputPath.c_str()) && GetFileModTime(outputPath.c_str()) >= GetFileModTime(sourcePath.c_str()))
+    {
+        totals.Skipped++;
+        return;
+    }
+
+    int sourceSize = 0;
+    unsigned char* sourceData = LoadFileData(sourcePath.c_str(), &sourceSize);
+    if (!sourceData)
+    {
+        printf("unable to load %s\n", sourcePath.c_str());
+        totals.Failed++;
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<uint8_t> compiled;
+    std::string error;
+    bool compiledMap = MapCompiler::CompileLDtk(sourceData, size_t(sourceSize), compiled, error);
+
+    double compileMS = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    UnloadFileData(sourceData);
+
+    if (!compiledMap)
+    {
+        printf("unable to compile %s, %s\n", sourcePath.c_str(), error.c_str());
+        totals.Failed++;
+        return;
+    }
+
+    if (!SaveFileData(outputPath.c_str(), compiled.data(), int(compiled.size())))
+    {
+        printf("unable to write %s\n", outputPath.c_str());
+        totals.Failed++;
+        return;
+    }
+
+    totals.Compiled++;
+    totals.SourceBytes += size_t(sourceSize);
+    totals.CompiledBytes += compiled.size();
+
+    printf("%s %d to %d bytes, the project took %.1fms to parse and convert\n", outputPath.c_str(), sourceSize, int(compiled.size()), compileMS);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf("usage: map_tool <ldtk file or folder> [-force]\n");
+        return 1;
+    }
+
+    bool force = false;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-force") == 0)
+            force = true;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    std::vector<std::string> sourcePaths;
+    if (DirectoryExists(argv[1]))
+    {
+        FilePathList files = LoadDirectoryFilesEx(argv[1], ".ldtk", true);
+        for (unsigned int i = 0; i < files.count; i++)
+            sourcePaths.push_back(files.paths[i]);
+        UnloadDirectoryFiles(files);
+    }
+    else
+    {
+        sourcePaths.push_back(argv[1]);
+    }
+
+    ToolTotals totals;
+    for (const auto& sourcePath : sourcePaths)
+        CompileMap(sourcePath, force, totals);
+
+    printf("compiled %d maps, %d up to date, failed %d, %d bytes of LDtk to %d bytes\n",
+        totals.Compiled, totals.Skipped, totals.Failed, int(totals.SourceBytes), int(totals.CompiledBytes));
+
+    return totals.Failed > 0 ? 1 : 0;
+}
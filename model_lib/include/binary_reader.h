@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <string_view>
+
+namespace Models
+{
+    // reads the data written by the model and animation writers from a memory buffer.
+    // every read is bounds checked, the first failed read puts the reader in an error state and after that every read
+    // fails and returns zeroed data, so a loader can read a whole block and check IsValid once
+    class BinaryReader
+    {
+    public:
+        BinaryReader() = default;
+
+        // reads from a buffer that must outlive the reader
+        BinaryReader(const uint8_t* buffer, size_t size);
+
+        bool Read(void* destination, size_t bytes);
+
+        template<class T>
+        T Read()
+        {
+            T value = {};
+            Read(&value, sizeof(T));
+            return value;
+        }
+
+        // reads a fixed size, null padded, string
+        std::string ReadFixedString(size_t bytes);
+
+        // reads an int length followed by that many characters
+        std::string ReadString();
+
+        bool Skip(size_t bytes);
+
+        // moves to an absolute position from the start of the data
+        bool Seek(size_t position);
+
+        size_t GetPosition() const { return Position; }
+        size_t GetSize() const { return Size; }
+        size_t GetRemaining() const { return Position < Size ? Size - Position : 0; }
+
+        // true if there are at least this many bytes left, a cheap guard before allocating for counts read from the data
+        bool HasRemaining(size_t bytes) const { return !Failed && bytes <= GetRemaining(); }
+
+        // a pointer to the data at an absolute position, or nullptr if the range is outside the data
+        const uint8_t* GetDataAt(size_t position, size_t bytes) const;
+
+        bool IsValid() const { return !Failed; }
+
+        // puts the reader in the error state, for loaders that find bad values in data that was read correctly
+        void SetError(std::string_view error);
+        const std::string& GetError() const { return Error; }
+
+    protected:
+        const uint8_t* Buffer = nullptr;
+        size_t Size = 0;
+        size_t Position = 0;
+
+        bool Failed = false;
+        std::string Error;
+    };
+}
@@ -3,18 +3,27 @@
 #include "raylib.h"
 #include "raymath.h"
 
+#include "binary_reader.h"
+
 #include <vector>
 #include <unordered_map>
 #include <string>
 #include <string_view>
 #include <stdint.h>
 #include <functional>
+#include <list>
+#include <memory>
 
 void WriteModel(Model& model, std::string_view file);
-void ReadModel(Model& model, uint8_t* buffer, size_t size, bool supportCPUAnimation = false);
 
-void WriteModelAnimations(ModelAnimation* animations, size_t count, std::string_view file);
+// the readers return false and leave the model unchanged if the data is truncated or corrupt, the reader overloads keep the error
+bool ReadModel(Model& model, uint8_t* buffer, size_t size, bool supportCPUAnimation = false);
+bool ReadModel(Model& model, Models::BinaryReader& reader, bool supportCPUAnimation = false);
+
+// writes animations in the compressed format, keyframes that can be rebuilt by blending their neighbors to within the error are dropped, 0 keeps every keyframe
+void WriteModelAnimations(ModelAnimation* animations, size_t count, std::string_view file, float keyframeError = 0);
 ModelAnimation* ReadModelAnimations(const Model& model, size_t& count, uint8_t* buffer, size_t size);
+ModelAnimation* ReadModelAnimations(const Model& model, size_t& count, Models::BinaryReader& reader);
 
 using ResolveModelTextureCallback = std::function<Texture(std::string_view)>;
 void SetModelTextureResolver(ResolveModelTextureCallback callback);
@@ -25,6 +34,9 @@ namespace Models
     struct AnimateableMesh
     {
         Mesh Geometry;
+
+        // the bounds of the mesh when it was loaded, used once the CPU side vertex data is gone
+        BoundingBox Bounds = { 0 };
     };
 
     // A bone with it's binding transform, and pointers to it's children
@@ -34,6 +46,9 @@ namespace Models
         size_t ParentBoneId = size_t(-1);
         Transform DefaultGlobalTransform;
 
+        // the inverse of the binding transform, cached so that posing does not need to invert it every frame
+        Transform InverseBindTransform = { Vector3{0,0,0}, Quaternion{0,0,0,1}, Vector3{1,1,1} };
+
         std::vector<AnimatableBoneInfo*> Children;
     };
 
@@ -49,11 +64,51 @@ namespace Models
         std::vector<Transform> GlobalTransforms;
     };
 
+    // transforms for a set of frames stored as a structure of arrays, so that several bones can be evaluated at once.
+    // each frame holds one run of BoneStride floats per channel, bones past BoneCount are padded with the identity transform
+    struct AnimatablePackedTransforms
+    {
+        enum Channel
+        {
+            TranslationX = 0,
+            TranslationY,
+            TranslationZ,
+            RotationX,
+            RotationY,
+            RotationZ,
+            RotationW,
+            ScaleX,
+            ScaleY,
+            ScaleZ,
+            ChannelCount
+        };
+
+        // the number of bones evaluated together by the pose kernel
+        static constexpr size_t LaneWidth = 4;
+
+        size_t FrameCount = 0;
+        size_t BoneCount = 0;
+        size_t BoneStride = 0;
+
+        std::vector<float> Data;
+
+        bool IsValid() const { return FrameCount > 0 && BoneStride > 0; }
+
+        // sizes the storage and fills every bone with the identity transform
+        void Resize(size_t frameCount, size_t boneCount);
+        void SetTransform(size_t frame, size_t bone, const Transform& transform);
+
+        const float* GetChannel(size_t frame, Channel channel) const { return Data.data() + (frame * ChannelCount + channel) * BoneStride; }
+    };
+
     // a sequence of animation keyframes
     struct AnimatableSequence
     {
         std::vector<AnimateableKeyFrame> Frames;
         float FPS = 30;
+
+        // the keyframes packed for the pose kernel, must be rebuilt with PackSequence when the frames change
+        AnimatablePackedTransforms PackedFrames;
     };
 
 
@@ -61,6 +116,9 @@ namespace Models
     {
         Material GroupMaterial;
         std::vector<AnimateableMesh> Meshes;
+
+        // the albedo texture from the file, resolved into the material by ResolveTextures
+        std::string TextureName;
     };
 
     // a model that can be animated
@@ -83,11 +141,35 @@ namespace Models
 
         Matrix RootTransform = MatrixIdentity();
 
-        void Read(uint8_t* buffer, size_t size);
+        // the inverse binding transforms packed for the pose kernel, built by UpdateInverseBindPose
+        AnimatablePackedTransforms PackedInverseBind;
+
+        // reads a model, when borrowMeshData is set the vertex streams of version 4 files point into the buffer instead of being copied,
+        // the buffer must then stay valid until Upload is called.
+        // returns false and leaves the model unchanged if the data is bad
+        bool Read(uint8_t* buffer, size_t size, bool borrowMeshData = false);
+        bool Read(BinaryReader& reader, bool borrowMeshData = false);
         void Write( std::string_view file);
 
+        // resolves the texture names of the groups with the model texture resolver, then sends the meshes to the GPU,
+        // borrowed vertex data is dropped afterwards. Read does not touch the GPU so it can run on any thread, Upload must be on the main thread
         void Upload();
 
+        // sets the group material textures from their names with the model texture resolver
+        void ResolveTextures();
+
+        // frees the meshes and materials and empties the model, so it can be read again
+        void Unload();
+
+        // true while the mesh vertex streams point into the buffer given to Read
+        bool BorrowsMeshData = false;
+
+        // drops all references to the buffer given to Read, so it can be released
+        void ReleaseBorrowedMeshData();
+
+        // recomputes the inverse binding transforms, must be called after any bone binding transform is changed
+        void UpdateInverseBindPose();
+
         BoundingBox GetBounds();
 
         bool AutoUnload = true;
@@ -98,8 +180,12 @@ namespace Models
     {
         std::unordered_map<std::string, AnimatableSequence> Sequences;
 
-        void Read(uint8_t* buffer, size_t size);
-        void Write(std::string_view file);
+        // returns false if the data is bad, any sequences before the bad one are kept
+        bool Read(uint8_t* buffer, size_t size);
+        bool Read(BinaryReader& reader);
+
+        // writes the set in the compressed format, keyframes that can be rebuilt by blending their neighbors to within the error are dropped, 0 keeps every keyframe
+        void Write(std::string_view file, float keyframeError = 0);
     };
 
     // loads an animated model from a raylib model, all the meshes and materials are transfered to the animateable model, and removed from the raylib model
@@ -119,6 +205,125 @@ namespace Models
     // updates a pose to be an interpolation value between two keyframes
     void InterpolatePose(const AnimateableModel& model, AnimateablePose& pose, const AnimateableKeyFrame& frame1, const AnimateableKeyFrame& frame2, float param);
 
+    // blends two keyframe transforms the same way dropped keyframes are rebuilt, a lerp for translation and scale and a shortest path nlerp for rotation
+    Transform BlendKeyframeTransform(const Transform& t1, const Transform& t2, float param);
+
+    // a reduced skeleton for distant models, only bones up to a depth in the bone tree are evaluated,
+    // every deeper bone uses the matrix of its closest evaluated ancestor
+    struct AnimatableBoneLOD
+    {
+        int MaxDepth = -1;
+
+        std::vector<size_t> EvaluatedBones;
+
+        // for each bone, the evaluated bone it takes its matrix from
+        std::vector<size_t> SourceBones;
+    };
+
+    // builds a reduced skeleton that evaluates bones up to a depth, a negative depth evaluates every bone
+    AnimatableBoneLOD BuildBoneLOD(const AnimateableModel& model, int maxDepth);
+
+    // updates a pose to be an interpolation between two keyframes of a sequence, only evaluating the bones in a reduced skeleton
+    void InterpolateReducedPose(const AnimateableModel& model, AnimateablePose& pose, const AnimatableSequence& sequence, size_t frame1, size_t frame2, float param, const AnimatableBoneLOD& lod);
+
+    // rebuilds the packed copy of a sequence's keyframes, a sequence whose frames have different bone counts is left unpacked
+    void PackSequence(AnimatableSequence& sequence);
+
+    // true when the sequence is packed and has a transform for every bone of the model, the pose functions do nothing for one that doesn't
+    bool SequenceMatchesModel(const AnimateableModel& model, const AnimatableSequence& sequence);
+
+    // drops the sequences that don't match the model's skeleton, like an animation file made for another model, and returns their names
+    std::vector<std::string> RemoveMismatchedSequences(const AnimateableModel& model, AnimationSet& animations);
+
+    // updates a pose to be an interpolation between two keyframes of a sequence, using the packed keyframes to evaluate several bones at once.
+    // rotations are blended with a normalized lerp whose parameter is corrected to follow a slerp, falls back to InterpolatePose if the sequence is not packed for this model
+    void InterpolatePackedPose(const AnimateableModel& model, AnimateablePose& pose, const AnimatableSequence& sequence, size_t frame1, size_t frame2, float param);
+
+    // how far the packed pose kernel may be from InterpolatePose on a keyframe, float rounding in the packed math is around 2e-6
+    static constexpr float PackedPoseKeyframeTolerance = 1e-4f;
+
+    // how far it may be between keyframes. the kernel's corrected nlerp stays within about 2e-4 of a slerp, the rest is raymath's
+    // slerp snapping to the first rotation when two keys are so close their dot product rounds to 1, about 2e-3 on nearly still bones
+    static constexpr float PackedPoseBlendTolerance = 5e-3f;
+
+    // compares the packed pose kernel to InterpolatePose across a sequence, and returns the largest difference of any bone matrix element.
+    // the pair from the last frame back to the first is only compared when the sequence loops
+    float GetPackedPoseError(const AnimateableModel& model, const AnimatableSequence& sequence, int samplesPerFrame, bool looping);
+
+    // checks that the binary reader fails cleanly on reads past the end, bad string lengths and random reads over random data.
+    // returns how many checks failed, with a line for each in failures
+    int RunBinaryReaderChecks(std::vector<std::string>& failures);
+
+    // feeds cut off and randomly damaged copies of a model or animation file through its reader. the whole file must read,
+    // every cut off copy must be rejected, and a damaged copy must either read or be rejected with an error, never read out of bounds
+    int RunFileReaderChecks(const uint8_t* fileData, size_t fileSize, bool animationFile, std::string_view name, std::vector<std::string>& failures);
+
     // draws a model, with transform, at a pose, with a set of optional material overrides
-    void DrawAnimatableModel(const AnimateableModel& model, Matrix transform, AnimateablePose* pose = nullptr, const std::vector<Material>* materialOverrides = nullptr);
+    void DrawAnimatableModel(const AnimateableModel& model, Matrix transform, const AnimateablePose* pose = nullptr, const std::vector<Material>* materialOverrides = nullptr);
+
+    // a memory budgeted cache of baked poses, shared by every instance that plays the same sequence.
+    // poses are sampled at a fixed number of steps between each pair of keyframes, and the least recently used samples are dropped when over budget
+    class AnimationPoseCache
+    {
+    public:
+        using PosePtr = std::shared_ptr<const AnimateablePose>;
+
+        // gets the baked pose nearest to the interpolation between a frame and the frame after it, baking it if needed.
+        // with a bone LOD the pose is baked from the reduced skeleton and kept apart from the full ones
+        PosePtr GetPose(const AnimateableModel& model, const AnimatableSequence& sequence, size_t frame, float param, const AnimatableBoneLOD* lod = nullptr);
+
+        // number of samples baked between each pair of keyframes, 0 disables the cache
+        void SetSamplesPerFrame(int samples);
+        int GetSamplesPerFrame() const { return SamplesPerFrame; }
+
+        void SetMemoryBudget(size_t bytes);
+        size_t GetMemoryBudget() const { return MemoryBudget; }
+        size_t GetUsedMemory() const { return UsedMemory; }
+
+        bool IsEnabled() const { return SamplesPerFrame > 0 && MemoryBudget > 0; }
+
+        size_t GetHitCount() const { return Hits; }
+        size_t GetMissCount() const { return Misses; }
+
+        // must be called when any cached sequence or model is unloaded
+        void Clear();
+
+    protected:
+        struct CacheKey
+        {
+            const AnimatableSequence* Sequence = nullptr;
+            size_t Sample = 0;
+            int MaxBoneDepth = -1;
+
+            bool operator == (const CacheKey& other) const { return Sequence == other.Sequence && Sample == other.Sample && MaxBoneDepth == other.MaxBoneDepth; }
+        };
+
+        struct CacheKeyHasher
+        {
+            size_t operator()(const CacheKey& key) const
+            {
+                return std::hash<const void*>()(key.Sequence) ^ (key.Sample * 0x9E3779B97F4A7C15ull) ^ (size_t(key.MaxBoneDepth + 1) * 0xC2B2AE3D27D4EB4Full);
+            }
+        };
+
+        struct CacheEntry
+        {
+            CacheKey Key;
+            PosePtr Pose;
+            size_t Size = 0;
+        };
+
+        void Trim();
+
+        int SamplesPerFrame = 4;
+        size_t MemoryBudget = 4 * 1024 * 1024;
+        size_t UsedMemory = 0;
+
+        size_t Hits = 0;
+        size_t Misses = 0;
+
+        // most recently used entries are at the front
+        std::list<CacheEntry> Entries;
+        std::unordered_map<CacheKey, std::list<CacheEntry>::iterator, CacheKeyHasher> Lookup;
+    };
 }
\ No newline at end of file
@@ -8,6 +8,13 @@ namespace Models
 {
     AnimateableModel::~AnimateableModel()
     {
+        Unload();
+    }
+
+    void AnimateableModel::Unload()
+    {
+        ReleaseBorrowedMeshData();
+
         for (auto& group : Groups)
         {
             MemFree(group.GroupMaterial.maps);
@@ -15,15 +22,61 @@ namespace Models
             for (auto& mesh : group.Meshes)
                 UnloadMesh(mesh.Geometry);
         }
+
+        Groups.clear();
+        Bones.clear();
+        RootBone = nullptr;
     }
 
     void AnimateableModel::Upload()
     {
+        ResolveTextures();
+
         for (auto& group : Groups)
         {
             for (auto& mesh : group.Meshes)
                 UploadMesh(&mesh.Geometry, false); // we only do GPU animation here
         }
+
+        ReleaseBorrowedMeshData();
+    }
+
+    void AnimateableModel::ReleaseBorrowedMeshData()
+    {
+        if (!BorrowsMeshData)
+            return;
+
+        // the indices are always owned, everything else belongs to the buffer
+        for (auto& group : Groups)
+        {
+            for (auto& mesh : group.Meshes)
+            {
+                mesh.Geometry.vertices = nullptr;
+                mesh.Geometry.texcoords = nullptr;
+                mesh.Geometry.normals = nullptr;
+                mesh.Geometry.colors = nullptr;
+                mesh.Geometry.boneWeights = nullptr;
+                mesh.Geometry.boneIds = nullptr;
+            }
+        }
+
+        BorrowsMeshData = false;
+    }
+
+    void AnimateableModel::UpdateInverseBindPose()
+    {
+        for (auto& bone : Bones)
+        {
+            Quaternion invRotation = QuaternionInvert(bone.DefaultGlobalTransform.rotation);
+
+            bone.InverseBindTransform.translation = Vector3RotateByQuaternion(Vector3Negate(bone.DefaultGlobalTransform.translation), invRotation);
+            bone.InverseBindTransform.rotation = invRotation;
+            bone.InverseBindTransform.scale = Vector3Divide(Vector3Ones, bone.DefaultGlobalTransform.scale);
+        }
+
+        PackedInverseBind.Resize(1, Bones.size());
+        for (size_t boneId = 0; boneId < Bones.size(); boneId++)
+            PackedInverseBind.SetTransform(0, boneId, Bones[boneId].InverseBindTransform);
     }
 
     BoundingBox AnimateableModel::GetBounds()
@@ -37,13 +90,14 @@ namespace Models
             {
                 for (auto& mesh : group.Meshes)
                 {
+                    // meshes that have given up their vertex data use the bounds they were loaded with
+                    BoundingBox tempBounds = mesh.Geometry.vertices ? GetMeshBoundingBox(mesh.Geometry) : mesh.Bounds;
                     if (!valid)
                     {
-                        bbox = GetMeshBoundingBox(mesh.Geometry);
+                        bbox = tempBounds;
                         valid = true;
                         break;
                     }
-                    BoundingBox tempBounds = GetMeshBoundingBox(mesh.Geometry);
 
                     temp.x = (bbox.min.x < tempBounds.min.x) ? bbox.min.x : tempBounds.min.x;
                     temp.y = (bbox.min.y < tempBounds.min.y) ? bbox.min.y : tempBounds.min.y;
@@ -74,6 +128,7 @@ namespace Models
 
             group.Meshes.emplace_back();
             group.Meshes.back().Geometry = model.meshes[i];
+            group.Meshes.back().Bounds = GetMeshBoundingBox(model.meshes[i]);
 
             // forcibly clear the bone matricides since we are going to handle them externally
             MemFree(group.Meshes.back().Geometry.boneMatrices);
@@ -108,6 +163,8 @@ namespace Models
                 animModel.Bones[bone.ParentBoneId].Children.push_back(&bone);
         }
 
+        animModel.UpdateInverseBindPose();
+
         if (model.bones)
             MemFree(model.bones);
 
@@ -136,6 +193,8 @@ namespace Models
 
             MemFree(animationsPointer[i].framePoses);
             MemFree(animationsPointer[i].bones);
+
+            PackSequence(sequence);
         }
     }
 
@@ -149,25 +208,17 @@ namespace Models
         return pose;
     }
 
-    Matrix GetBoneMatrix(const Transform& bindingTransform, const Transform& frameTransform)
+    Matrix GetBoneMatrix(const Transform& inverseBindTransform, const Transform& frameTransform)
     {
-        Vector3 inTranslation = bindingTransform.translation;
-        Quaternion inRotation = bindingTransform.rotation;
-        Vector3 inScale = bindingTransform.scale;
-
         Vector3 outTranslation = frameTransform.translation;
         Quaternion outRotation = frameTransform.rotation;
         Vector3 outScale = frameTransform.scale;
 
-        Vector3 invTranslation = Vector3RotateByQuaternion(Vector3Negate(inTranslation), QuaternionInvert(inRotation));
-        Quaternion invRotation = QuaternionInvert(inRotation);
-        Vector3 invScale = Vector3Divide(Vector3Ones, inScale);
-
         Vector3 boneTranslation = Vector3Add(
-            Vector3RotateByQuaternion(Vector3Multiply(outScale, invTranslation),
+            Vector3RotateByQuaternion(Vector3Multiply(outScale, inverseBindTransform.translation),
                 outRotation), outTranslation);
-        Quaternion boneRotation = QuaternionMultiply(outRotation, invRotation);
-        Vector3 boneScale = Vector3Multiply(outScale, invScale);
+        Quaternion boneRotation = QuaternionMultiply(outRotation, inverseBindTransform.rotation);
+        Vector3 boneScale = Vector3Multiply(outScale, inverseBindTransform.scale);
 
         Matrix boneMatrix = MatrixMultiply(MatrixMultiply(
             QuaternionToMatrix(boneRotation),
@@ -179,10 +230,13 @@ namespace Models
 
     void UpdatePoseToFrame(const AnimateableModel& model, AnimateablePose& pose, const AnimateableKeyFrame& frame)
     {
+        if (frame.GlobalTransforms.size() < model.Bones.size())
+            return;
+
         for (size_t boneId = 0; boneId < model.Bones.size(); boneId++)
         {
             const auto& bone = model.Bones[boneId];
-            pose.BoneTransforms[boneId] = GetBoneMatrix(bone.DefaultGlobalTransform, frame.GlobalTransforms[boneId]);
+            pose.BoneTransforms[boneId] = GetBoneMatrix(bone.InverseBindTransform, frame.GlobalTransforms[boneId]);
         }
     }
 
@@ -195,14 +249,78 @@ namespace Models
 
     void InterpolatePose(const AnimateableModel& model, AnimateablePose& pose, const AnimateableKeyFrame& frame1, const AnimateableKeyFrame& frame2, float param)
     {
+        if (frame1.GlobalTransforms.size() < model.Bones.size() || frame2.GlobalTransforms.size() < model.Bones.size())
+            return;
+
         for (size_t boneId = 0; boneId < model.Bones.size(); boneId++)
         {
             const auto& bone = model.Bones[boneId];
-            pose.BoneTransforms[boneId] = GetBoneMatrix(bone.DefaultGlobalTransform, TransformLerp(frame1.GlobalTransforms[boneId], frame2.GlobalTransforms[boneId], param));
+            pose.BoneTransforms[boneId] = GetBoneMatrix(bone.InverseBindTransform, TransformLerp(frame1.GlobalTransforms[boneId], frame2.GlobalTransforms[boneId], param));
+        }
+    }
+
+    Transform BlendKeyframeTransform(const Transform& t1, const Transform& t2, float param)
+    {
+        Quaternion rotation = t2.rotation;
+        if (t1.rotation.x * rotation.x + t1.rotation.y * rotation.y + t1.rotation.z * rotation.z + t1.rotation.w * rotation.w < 0)
+            rotation = QuaternionScale(rotation, -1);
+
+        return Transform{   Vector3Lerp(t1.translation, t2.translation, param),
+                            QuaternionNlerp(t1.rotation, rotation, param),
+                            Vector3Lerp(t1.scale, t2.scale, param) };
+    }
+
+    AnimatableBoneLOD BuildBoneLOD(const AnimateableModel& model, int maxDepth)
+    {
+        AnimatableBoneLOD lod;
+        lod.MaxDepth = maxDepth;
+        lod.SourceBones.resize(model.Bones.size());
+
+        for (size_t boneId = 0; boneId < model.Bones.size(); boneId++)
+        {
+            // walk up to the root to find how deep this bone is, the step limit guards against bad parent data
+            std::vector<size_t> chain = { boneId };
+            while (model.Bones[chain.back()].ParentBoneId < model.Bones.size() && chain.size() <= model.Bones.size())
+                chain.push_back(model.Bones[chain.back()].ParentBoneId);
+
+            size_t depth = chain.size() - 1;
+
+            if (maxDepth < 0 || depth <= size_t(maxDepth))
+            {
+                lod.SourceBones[boneId] = boneId;
+                lod.EvaluatedBones.push_back(boneId);
+            }
+            else
+            {
+                // the chain runs from the bone to the root, so the ancestor at the max depth is counted back from the end
+                lod.SourceBones[boneId] = chain[depth - size_t(maxDepth)];
+            }
+        }
+
+        return lod;
+    }
+
+    void InterpolateReducedPose(const AnimateableModel& model, AnimateablePose& pose, const AnimatableSequence& sequence, size_t frame1, size_t frame2, float param, const AnimatableBoneLOD& lod)
+    {
+        if (!SequenceMatchesModel(model, sequence) || frame1 >= sequence.Frames.size() || frame2 >= sequence.Frames.size() || lod.SourceBones.size() != model.Bones.size())
+            return;
+
+        const auto& from = sequence.Frames[frame1].GlobalTransforms;
+        const auto& to = sequence.Frames[frame2].GlobalTransforms;
+
+        pose.BoneTransforms.resize(model.Bones.size());
+
+        for (size_t boneId : lod.EvaluatedBones)
+            pose.BoneTransforms[boneId] = GetBoneMatrix(model.Bones[boneId].InverseBindTransform, TransformLerp(from[boneId], to[boneId], param));
+
+        for (size_t boneId = 0; boneId < model.Bones.size(); boneId++)
+        {
+            if (lod.SourceBones[boneId] != boneId)
+                pose.BoneTransforms[boneId] = pose.BoneTransforms[lod.SourceBones[boneId]];
         }
     }
 
-    void DrawAnimatableModel(const AnimateableModel& model, Matrix transform, AnimateablePose* pose, const std::vector<Material>* materialOverrides)
+    void DrawAnimatableModel(const AnimateableModel& model, Matrix transform, const AnimateablePose* pose, const std::vector<Material>* materialOverrides)
     {
         int groupId = 0;
         for (auto& group : model.Groups)
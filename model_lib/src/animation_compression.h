@@ -0,0 +1,105 @@
+#pragma once
+
+#include "raylib.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// shared encoding for the compressed (version 2) animation set format
+namespace AnimationCompression
+{
+    static constexpr int Version = 2;
+
+    // per bone track flags, a constant track stores one full precision value instead of a value per keyframe
+    static constexpr uint8_t ConstantTranslation = 0x01;
+    static constexpr uint8_t ConstantRotation = 0x02;
+    static constexpr uint8_t ConstantScale = 0x04;
+
+    // tracks that never move further than this are stored as constants
+    static constexpr float ConstantTolerance = 0.00001f;
+
+    // the three smallest components of a unit quaternion are always within +/- 1/sqrt(2)
+    static constexpr float SmallestThreeRange = 0.70710678f;
+    static constexpr uint16_t SmallestThreeMax = 0x7FFF;
+
+    static constexpr uint16_t RangeMax = 0xFFFF;
+
+    // the most bone transforms one sequence can expand to, so a corrupt count can't ask for an unreasonable amount of memory
+    static constexpr size_t MaxSequenceTransforms = 4 * 1024 * 1024;
+
+    inline float Dot(const Quaternion& a, const Quaternion& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    }
+
+    inline uint16_t Quantize(float value, float minValue, float range, uint16_t maxValue)
+    {
+        if (range <= 0)
+            return 0;
+
+        float normalized = (value - minValue) / range;
+        if (normalized < 0)
+            normalized = 0;
+        else if (normalized > 1)
+            normalized = 1;
+
+        return uint16_t(normalized * maxValue + 0.5f);
+    }
+
+    inline float Dequantize(uint16_t value, float minValue, float range, uint16_t maxValue)
+    {
+        return minValue + (value / float(maxValue)) * range;
+    }
+
+    // stores the three smallest components in 15 bits each, the index of the dropped largest component uses the top bit of the first two values
+    inline void PackQuaternion(Quaternion rotation, uint16_t values[3])
+    {
+        float components[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+
+        int largest = 0;
+        for (int i = 1; i < 4; i++)
+        {
+            if (fabsf(components[i]) > fabsf(components[largest]))
+                largest = i;
+        }
+
+        // q and -q are the same rotation, so flip it to make the dropped component positive
+        float sign = components[largest] < 0 ? -1.0f : 1.0f;
+
+        int outIndex = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            if (i == largest)
+                continue;
+
+            values[outIndex++] = Quantize(components[i] * sign, -SmallestThreeRange, SmallestThreeRange * 2, SmallestThreeMax);
+        }
+
+        values[0] |= uint16_t((largest & 1) << 15);
+        values[1] |= uint16_t((largest >> 1) << 15);
+    }
+
+    inline Quaternion UnpackQuaternion(const uint16_t values[3])
+    {
+        int largest = (values[0] >> 15) | ((values[1] >> 15) << 1);
+
+        float components[4] = { 0 };
+        float sumSquared = 0;
+
+        int inIndex = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            if (i == largest)
+                continue;
+
+            float value = Dequantize(values[inIndex++] & SmallestThreeMax, -SmallestThreeRange, SmallestThreeRange * 2, SmallestThreeMax);
+            components[i] = value;
+            sumSquared += value * value;
+        }
+
+        components[largest] = sumSquared < 1 ? sqrtf(1 - sumSquared) : 0;
+
+        return Quaternion{ components[0], components[1], components[2], components[3] };
+    }
+}
@@ -0,0 +1,97 @@
+#include "model.h"
+
+namespace Models
+{
+    AnimationPoseCache::PosePtr AnimationPoseCache::GetPose(const AnimateableModel& model, const AnimatableSequence& sequence, size_t frame, float param, const AnimatableBoneLOD* lod)
+    {
+        if (!IsEnabled() || sequence.Frames.empty())
+            return nullptr;
+
+        size_t frameCount = sequence.Frames.size();
+
+        // snap the interpolation to the nearest sample
+        size_t sample = size_t(param * SamplesPerFrame + 0.5f);
+        frame += sample / SamplesPerFrame;
+        sample %= SamplesPerFrame;
+        frame %= frameCount;
+
+        // a negative depth is the full skeleton
+        if (lod && lod->MaxDepth < 0)
+            lod = nullptr;
+
+        CacheKey key = { &sequence, frame * SamplesPerFrame + sample, lod ? lod->MaxDepth : -1 };
+
+        auto itr = Lookup.find(key);
+        if (itr != Lookup.end())
+        {
+            Hits++;
+
+            // move it to the front so it's the last thing to be dropped
+            Entries.splice(Entries.begin(), Entries, itr->second);
+            return itr->second->Pose;
+        }
+
+        Misses++;
+
+        auto pose = std::make_shared<AnimateablePose>(GetDefaultPose(model));
+
+        if (lod)
+            InterpolateReducedPose(model, *pose, sequence, frame, (frame + 1) % frameCount, sample / float(SamplesPerFrame), *lod);
+        else if (sample == 0)
+            UpdatePoseToFrame(model, *pose, sequence.Frames[frame]);
+        else
+            InterpolatePackedPose(model, *pose, sequence, frame, (frame + 1) % frameCount, sample / float(SamplesPerFrame));
+
+        CacheEntry& entry = Entries.emplace_front();
+        entry.Key = key;
+        entry.Pose = pose;
+        entry.Size = sizeof(CacheEntry) + pose->BoneTransforms.size() * sizeof(Matrix);
+
+        Lookup.insert_or_assign(key, Entries.begin());
+        UsedMemory += entry.Size;
+
+        Trim();
+
+        return pose;
+    }
+
+    void AnimationPoseCache::SetSamplesPerFrame(int samples)
+    {
+        if (samples < 0)
+            samples = 0;
+
+        if (samples == SamplesPerFrame)
+            return;
+
+        // the sample keys are only valid for one sample rate
+        Clear();
+        SamplesPerFrame = samples;
+    }
+
+    void AnimationPoseCache::SetMemoryBudget(size_t bytes)
+    {
+        MemoryBudget = bytes;
+        Trim();
+    }
+
+    void AnimationPoseCache::Clear()
+    {
+        Entries.clear();
+        Lookup.clear();
+        UsedMemory = 0;
+        Hits = 0;
+        Misses = 0;
+    }
+
+    void AnimationPoseCache::Trim()
+    {
+        // never drop the most recent entry, someone is about to use it
+        while (UsedMemory > MemoryBudget && Entries.size() > 1)
+        {
+            CacheEntry& entry = Entries.back();
+            UsedMemory -= entry.Size;
+            Lookup.erase(entry.Key);
+            Entries.pop_back();
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#include "binary_reader.h"
+
+#include <cstring>
+#include <vector>
+
+namespace Models
+{
+    BinaryReader::BinaryReader(const uint8_t* buffer, size_t size)
+        : Buffer(buffer)
+        , Size(buffer ? size : 0)
+    {
+    }
+
+    bool BinaryReader::Read(void* destination, size_t bytes)
+    {
+        if (bytes == 0)
+            return !Failed;
+
+        if (Failed || bytes > GetRemaining())
+        {
+            if (!Failed)
+                SetError("read past the end of the data");
+
+            memset(destination, 0, bytes);
+            return false;
+        }
+
+        memcpy(destination, Buffer + Position, bytes);
+        Position += bytes;
+        return true;
+    }
+
+    std::string BinaryReader::ReadFixedString(size_t bytes)
+    {
+        std::vector<char> text(bytes + 1, '\0');
+        Read(text.data(), bytes);
+        return std::string(text.data());
+    }
+
+    std::string BinaryReader::ReadString()
+    {
+        int length = Read<int>();
+        if (length < 0 || !HasRemaining(size_t(length)))
+        {
+            SetError("bad string length");
+            return std::string();
+        }
+
+        std::string text(size_t(length), '\0');
+        Read(text.data(), text.size());
+        return text;
+    }
+
+    bool BinaryReader::Skip(size_t bytes)
+    {
+        if (bytes > GetRemaining())
+        {
+            SetError("skipped past the end of the data");
+            return false;
+        }
+
+        return Seek(Position + bytes);
+    }
+
+    bool BinaryReader::Seek(size_t position)
+    {
+        if (Failed)
+            return false;
+
+        if (position > Size)
+        {
+            SetError("seeked past the end of the data");
+            return false;
+        }
+
+        Position = position;
+        return true;
+    }
+
+    const uint8_t* BinaryReader::GetDataAt(size_t position, size_t bytes) const
+    {
+        if (Failed || position > Size || bytes > Size - position)
+            return nullptr;
+
+        return Buffer + position;
+    }
+
+    void BinaryReader::SetError(std::string_view error)
+    {
+        // keep the first error, it's the one that explains the rest
+        if (!Failed)
+            Error = error;
+
+        Failed = true;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// shared layout for the version 4 mesh format.
+// the file starts with a table of mesh headers, followed by the materials, bones and root transform as in version 3,
+// then every vertex stream stored contiguously and aligned, so the streams can be used straight out of a mapped file
+namespace MeshFormat
+{
+    static constexpr int Version = 4;
+
+    // every stream starts on this boundary, relative to the start of the file
+    static constexpr size_t StreamAlignment = 16;
+
+    enum Stream
+    {
+        Vertices = 0,
+        TexCoords,
+        Normals,
+        Colors,
+        Indices,
+        BoneWeights,
+        BoneIds,
+        StreamCount
+    };
+
+    struct MeshHeader
+    {
+        int32_t VertexCount = 0;
+        int32_t TriangleCount = 0;
+        int32_t MaterialAssignment = 0;
+        int32_t Reserved = 0;
+
+        float BoundsMin[3] = { 0 };
+        float BoundsMax[3] = { 0 };
+
+        // offsets from the start of the file, 0 when the mesh does not have the stream
+        uint32_t StreamOffsets[StreamCount] = { 0 };
+        uint32_t StreamSizes[StreamCount] = { 0 };
+    };
+
+    static_assert(sizeof(MeshHeader) == 16 + 24 + StreamCount * 8, "mesh header must not have padding");
+
+    inline size_t AlignOffset(size_t offset)
+    {
+        return (offset + StreamAlignment - 1) & ~(StreamAlignment - 1);
+    }
+}
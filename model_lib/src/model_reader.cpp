@@ -1,6 +1,11 @@
 #include "model.h"
+#include "animation_compression.h"
+#include "mesh_format.h"
 #include "raymath.h"
 
+#include <algorithm>
+#include <cstring>
+
 static ResolveModelTextureCallback TextureCallback = nullptr;
 
 void SetModelTextureResolver(ResolveModelTextureCallback callback)
@@ -8,129 +13,419 @@ void SetModelTextureResolver(ResolveModelTextureCallback callback)
     TextureCallback = callback;
 }
 
-template<class T>
-T ReadData(uint8_t* buffer, size_t& offset, size_t size)
-{
-    if (offset >= size)
-        return 0;
+using Models::BinaryReader;
 
-    T value = *(T*)(buffer + offset);
-    offset += sizeof(T);
-    return value;
-}
-
-Transform ReadTransform(uint8_t* buffer, size_t& offset, size_t size)
+static Transform ReadTransform(BinaryReader& reader)
 {
     Transform xform = { 0 };
     // translation
-    xform.translation.x = ReadData<float>(buffer, offset, size);
-    xform.translation.y = ReadData<float>(buffer, offset, size);
-    xform.translation.z = ReadData<float>(buffer, offset, size);
+    xform.translation.x = reader.Read<float>();
+    xform.translation.y = reader.Read<float>();
+    xform.translation.z = reader.Read<float>();
 
     // rotation
-    xform.rotation.x = ReadData<float>(buffer, offset, size);
-    xform.rotation.y = ReadData<float>(buffer, offset, size);
-    xform.rotation.z = ReadData<float>(buffer, offset, size);
-    xform.rotation.w = ReadData<float>(buffer, offset, size);
+    xform.rotation.x = reader.Read<float>();
+    xform.rotation.y = reader.Read<float>();
+    xform.rotation.z = reader.Read<float>();
+    xform.rotation.w = reader.Read<float>();
 
     // scale
-    xform.scale.x = ReadData<float>(buffer, offset, size);
-    xform.scale.y = ReadData<float>(buffer, offset, size);
-    xform.scale.z = ReadData<float>(buffer, offset, size);
+    xform.scale.x = reader.Read<float>();
+    xform.scale.y = reader.Read<float>();
+    xform.scale.z = reader.Read<float>();
 
     return xform;
 }
 
-void ReadMesh(Mesh& mesh, int& materialAssignment, uint8_t* buffer, size_t& offset, size_t size, bool useAnims)
+static Matrix TransformToMatrix(const Transform& transform)
+{
+    Matrix matScale = MatrixScale(transform.scale.x, transform.scale.y, transform.scale.z);
+    Vector3 axis = Vector3Zeros;
+    float angle = 0;
+    QuaternionToAxisAngle(transform.rotation, &axis, &angle);
+    Matrix matRotation = MatrixRotate(axis, angle);
+    Matrix matTranslation = MatrixTranslate(transform.translation.x, transform.translation.y, transform.translation.z);
+    return MatrixMultiply(MatrixMultiply(matScale, matRotation), matTranslation);
+}
+
+template<class T>
+static T* ReadArray(BinaryReader& reader, size_t count)
+{
+    T* data = (T*)MemAlloc((unsigned int)(sizeof(T) * count));
+    reader.Read(data, sizeof(T) * count);
+    return data;
+}
+
+// reads a mesh stored inline in a version 1 to 3 file, the sizes are checked against the data before anything is allocated
+static bool ReadMesh(Mesh& mesh, int& materialAssignment, BinaryReader& reader, bool useAnims)
 {
-    mesh.vertexCount = ReadData<int>(buffer, offset, size);
-    mesh.triangleCount = ReadData<int>(buffer, offset, size);
-    materialAssignment = ReadData<int>(buffer, offset, size);
+    int vertexCount = reader.Read<int>();
+    int triangleCount = reader.Read<int>();
+    materialAssignment = reader.Read<int>();
 
-    bool hasTextureCoords = ReadData<int>(buffer, offset, size) != 0;
-    bool hasNormals = ReadData<int>(buffer, offset, size) != 0;
-    bool hasColors = ReadData<int>(buffer, offset, size) != 0;
-    bool hasIndecies = ReadData<int>(buffer, offset, size) != 0;
+    bool hasTextureCoords = reader.Read<int>() != 0;
+    bool hasNormals = reader.Read<int>() != 0;
+    bool hasColors = reader.Read<int>() != 0;
+    bool hasIndecies = reader.Read<int>() != 0;
 
     bool hasBoneWeights = false;
     bool hasBoneIDs = false;
     if (useAnims)
     {
-        hasBoneWeights = ReadData<int>(buffer, offset, size) != 0;
-        hasBoneIDs = ReadData<int>(buffer, offset, size) != 0;
+        hasBoneWeights = reader.Read<int>() != 0;
+        hasBoneIDs = reader.Read<int>() != 0;
     }
 
-    int bufferSize = 0;
+    if (!reader.IsValid())
+        return false;
 
-    bufferSize = mesh.vertexCount * 3 * sizeof(float);
-    mesh.vertices = (float*)MemAlloc(bufferSize);
-    memcpy(mesh.vertices, buffer + offset, bufferSize);
-    offset += bufferSize;
+    if (vertexCount < 0 || triangleCount < 0)
+    {
+        reader.SetError("bad mesh size");
+        return false;
+    }
 
-    bufferSize = mesh.vertexCount * 2 * sizeof(float);
-    mesh.texcoords = (float*)MemAlloc(bufferSize);
+    size_t vertices = size_t(vertexCount);
+    size_t indices = size_t(triangleCount) * 3;
+
+    size_t requiredSize = sizeof(float) * vertices * 3;
     if (hasTextureCoords)
+        requiredSize += sizeof(float) * vertices * 2;
+    if (hasNormals)
+        requiredSize += sizeof(float) * vertices * 3;
+    if (hasColors)
+        requiredSize += sizeof(unsigned char) * vertices * 4;
+    if (hasIndecies)
+        requiredSize += sizeof(unsigned short) * indices;
+    if (hasBoneWeights)
+        requiredSize += sizeof(float) * vertices * 4;
+    if (hasBoneIDs)
+        requiredSize += sizeof(unsigned char) * vertices * 4;
+
+    if (!reader.HasRemaining(requiredSize))
     {
-        memcpy(mesh.texcoords, buffer + offset, bufferSize);
-        offset += bufferSize;
+        reader.SetError("mesh data is truncated");
+        return false;
     }
 
+    mesh.vertexCount = vertexCount;
+    mesh.triangleCount = triangleCount;
+
+    mesh.vertices = ReadArray<float>(reader, vertices * 3);
+
+    // texture coordinates are always there, even if the file has none
+    if (hasTextureCoords)
+        mesh.texcoords = ReadArray<float>(reader, vertices * 2);
+    else
+        mesh.texcoords = (float*)MemAlloc((unsigned int)(sizeof(float) * vertices * 2));
+
     if (hasNormals)
+        mesh.normals = ReadArray<float>(reader, vertices * 3);
+
+    if (hasColors)
+        mesh.colors = ReadArray<unsigned char>(reader, vertices * 4);
+
+    if (hasIndecies)
+        mesh.indices = ReadArray<unsigned short>(reader, indices);
+
+    if (hasBoneWeights)
+        mesh.boneWeights = ReadArray<float>(reader, vertices * 4);
+
+    if (hasBoneIDs)
+        mesh.boneIds = ReadArray<unsigned char>(reader, vertices * 4);
+
+    return reader.IsValid();
+}
+
+// sets up a mesh from the aligned streams of a version 4 file, borrowed streams point straight into the reader's buffer, the rest are copied
+static bool ReadMeshStreams(Mesh& mesh, const MeshFormat::MeshHeader& header, BinaryReader& reader, bool borrowStreams)
+{
+    if (header.VertexCount < 0 || header.TriangleCount < 0 || header.StreamOffsets[MeshFormat::Vertices] == 0)
     {
-        bufferSize = mesh.vertexCount * 3 * sizeof(float);
-        mesh.normals = (float*)MemAlloc(bufferSize);
-        memcpy(mesh.normals, buffer + offset, bufferSize);
-        offset += bufferSize;
+        reader.SetError("bad mesh header");
+        return false;
     }
 
-    if (hasColors)
+    size_t vertexCount = size_t(header.VertexCount);
+
+    size_t expectedSizes[MeshFormat::StreamCount] =
     {
-        bufferSize = mesh.vertexCount * 4 * sizeof(uint8_t);
-        mesh.colors = (uint8_t*)MemAlloc(bufferSize);
-        memcpy(mesh.colors, buffer + offset, bufferSize);
-        offset += bufferSize;
+        sizeof(float) * vertexCount * 3,
+        sizeof(float) * vertexCount * 2,
+        sizeof(float) * vertexCount * 3,
+        sizeof(unsigned char) * vertexCount * 4,
+        sizeof(unsigned short) * size_t(header.TriangleCount) * 3,
+        sizeof(float) * vertexCount * 4,
+        sizeof(unsigned char) * vertexCount * 4
+    };
+
+    // check everything before touching the mesh so a bad file doesn't leave it half built
+    for (int stream = 0; stream < MeshFormat::StreamCount; stream++)
+    {
+        size_t streamOffset = header.StreamOffsets[stream];
+        if (streamOffset == 0)
+            continue;
+
+        if (header.StreamSizes[stream] != expectedSizes[stream] || streamOffset > reader.GetSize() || expectedSizes[stream] > reader.GetSize() - streamOffset)
+        {
+            reader.SetError("mesh stream is outside the file");
+            return false;
+        }
     }
 
-    if (hasIndecies)
+    void* streams[MeshFormat::StreamCount] = { nullptr };
+    for (int stream = 0; stream < MeshFormat::StreamCount; stream++)
     {
-        bufferSize = mesh.triangleCount * 3 * sizeof(uint16_t);
-        mesh.indices = (uint16_t*)MemAlloc(bufferSize);
-        memcpy(mesh.indices, buffer + offset, bufferSize);
-        offset += bufferSize;
+        if (header.StreamOffsets[stream] == 0)
+            continue;
+
+        // DrawMesh looks at the CPU index pointer to pick indexed drawing, so indices always get their own copy
+        const uint8_t* source = nullptr;
+        if (borrowStreams && stream != MeshFormat::Indices)
+            source = reader.GetDataAt(header.StreamOffsets[stream], expectedSizes[stream]);
+
+        if (source)
+        {
+            streams[stream] = (void*)source;
+        }
+        else
+        {
+            streams[stream] = MemAlloc((unsigned int)expectedSizes[stream]);
+            reader.Seek(header.StreamOffsets[stream]);
+            reader.Read(streams[stream], expectedSizes[stream]);
+        }
     }
 
-    if (hasBoneWeights)
+    // the streams are set even if a read failed, so they get freed with the mesh
+    mesh.vertexCount = header.VertexCount;
+    mesh.triangleCount = header.TriangleCount;
+    mesh.vertices = (float*)streams[MeshFormat::Vertices];
+    mesh.texcoords = (float*)streams[MeshFormat::TexCoords];
+    mesh.normals = (float*)streams[MeshFormat::Normals];
+    mesh.colors = (unsigned char*)streams[MeshFormat::Colors];
+    mesh.indices = (unsigned short*)streams[MeshFormat::Indices];
+    mesh.boneWeights = (float*)streams[MeshFormat::BoneWeights];
+    mesh.boneIds = (unsigned char*)streams[MeshFormat::BoneIds];
+
+    return reader.IsValid();
+}
+
+// indices or bone ids past the end of what they index would be read out of bounds when the mesh is drawn or skinned
+static bool CheckMeshReferences(const Mesh& mesh, size_t boneCount)
+{
+    if (mesh.indices)
     {
-        bufferSize = mesh.vertexCount * 4 * sizeof(float);
-        mesh.boneWeights = (float*)MemAlloc(bufferSize);
-        memcpy(mesh.boneWeights, buffer + offset, bufferSize);
-        offset += bufferSize;
+        for (int i = 0; i < mesh.triangleCount * 3; i++)
+        {
+            if (mesh.indices[i] >= mesh.vertexCount)
+                return false;
+        }
     }
 
-    if (hasBoneIDs)
+    if (mesh.boneIds && boneCount > 0)
     {
-        bufferSize = mesh.vertexCount * 4 * sizeof(unsigned char);
-        mesh.boneIds = (unsigned char*)MemAlloc(bufferSize);
-        memcpy(mesh.boneIds, buffer + offset, bufferSize);
-        offset += bufferSize;
+        for (int i = 0; i < mesh.vertexCount * 4; i++)
+        {
+            if (mesh.boneIds[i] >= boneCount)
+                return false;
+        }
     }
+
+    return true;
 }
 
-void ReadModel(Model& model, uint8_t* buffer, size_t size, bool supportCPUAnimation)
+namespace
 {
-    model.transform = MatrixIdentity();
-    size_t offset = 0;
+    struct MeshRecord
+    {
+        Mesh Geometry = { 0 };
+        int MaterialAssignment = 0;
+        BoundingBox Bounds = { 0 };
+    };
 
-    int version = ReadData<int>(buffer, offset, size);
+    struct MaterialRecord
+    {
+        Color Tint = WHITE;
+        std::string TextureName;
+    };
+
+    struct BoneRecord
+    {
+        int Parent = -1;
+        std::string Name;
+        Transform BindTransform = { 0 };
+    };
+
+    // everything in a model file, read and checked before any of it is given to a model
+    struct ModelFileContents
+    {
+        std::vector<MeshRecord> Meshes;
+        std::vector<MaterialRecord> Materials;
+        std::vector<BoneRecord> Bones;
+        Matrix RootTransform = MatrixIdentity();
 
-    if (version < 1 || version > 3)
-        return;
+        // true when the mesh streams point into the reader's buffer
+        bool BorrowsMeshData = false;
+
+        // frees the meshes of a file that could not be read
+        void FreeMeshes()
+        {
+            for (auto& record : Meshes)
+            {
+                // the indices are always owned, everything else belongs to the buffer
+                if (BorrowsMeshData)
+                {
+                    record.Geometry.vertices = nullptr;
+                    record.Geometry.texcoords = nullptr;
+                    record.Geometry.normals = nullptr;
+                    record.Geometry.colors = nullptr;
+                    record.Geometry.boneWeights = nullptr;
+                    record.Geometry.boneIds = nullptr;
+                }
+
+                UnloadMesh(record.Geometry);
+            }
+
+            Meshes.clear();
+        }
+    };
+}
+
+static bool ReadModelFile(ModelFileContents& contents, BinaryReader& reader, bool borrowMeshData)
+{
+    int version = reader.Read<int>();
+
+    if (!reader.IsValid() || version < 1 || version > MeshFormat::Version)
+    {
+        reader.SetError("unknown model version");
+        return false;
+    }
 
     bool useAnims = version >= 2;
     bool hasTransform = version >= 3;
+    bool hasStreamTable = version >= MeshFormat::Version;
+
+    int meshCount = reader.Read<int>();
+    int materialCount = reader.Read<int>();
+
+    // every mesh needs a material, and each material is at least a color and a name length
+    if (meshCount < 0 || materialCount < 0 || (meshCount > 0 && materialCount == 0) || !reader.HasRemaining(sizeof(int) * 2 * size_t(materialCount)))
+    {
+        reader.SetError("bad mesh or material count");
+        return false;
+    }
+
+    std::vector<MeshFormat::MeshHeader> meshHeaders;
+    if (hasStreamTable)
+    {
+        if (!reader.HasRemaining(sizeof(MeshFormat::MeshHeader) * size_t(meshCount)))
+        {
+            reader.SetError("mesh table is truncated");
+            return false;
+        }
+
+        meshHeaders.resize(meshCount);
+        reader.Read(meshHeaders.data(), sizeof(MeshFormat::MeshHeader) * meshHeaders.size());
+    }
+    else
+    {
+        // older files store the meshes inline, before the materials
+        for (int meshIndex = 0; meshIndex < meshCount; meshIndex++)
+        {
+            auto& record = contents.Meshes.emplace_back();
+            if (!ReadMesh(record.Geometry, record.MaterialAssignment, reader, useAnims))
+                return false;
+
+            record.Bounds = GetMeshBoundingBox(record.Geometry);
+        }
+    }
+
+    for (int matIndex = 0; matIndex < materialCount; matIndex++)
+    {
+        auto& material = contents.Materials.emplace_back();
+        material.Tint = GetColor(reader.Read<int>());
+        material.TextureName = reader.ReadString();
+    }
+
+    if (useAnims)
+    {
+        int boneCount = reader.Read<int>();
+
+        // each bone is a parent, a name and a transform
+        if (boneCount < 0 || !reader.HasRemaining((sizeof(int) + 32 + sizeof(float) * 10) * size_t(boneCount)))
+        {
+            reader.SetError("bad bone count");
+            return false;
+        }
+
+        for (int i = 0; i < boneCount; i++)
+        {
+            auto& bone = contents.Bones.emplace_back();
+            bone.Parent = reader.Read<int>();
+            bone.Name = reader.ReadFixedString(32);
+            bone.BindTransform = ReadTransform(reader);
+
+            if (bone.Parent < -1 || bone.Parent >= boneCount || bone.Parent == i)
+            {
+                reader.SetError("bad bone parent");
+                return false;
+            }
+        }
+    }
 
-    model.meshCount = ReadData<int>(buffer, offset, size);
-    model.materialCount = ReadData<int>(buffer, offset, size);
+    if (hasTransform)
+        contents.RootTransform = TransformToMatrix(ReadTransform(reader));
+
+    if (hasStreamTable)
+    {
+        contents.BorrowsMeshData = borrowMeshData;
+
+        for (const auto& header : meshHeaders)
+        {
+            auto& record = contents.Meshes.emplace_back();
+            if (!ReadMeshStreams(record.Geometry, header, reader, contents.BorrowsMeshData))
+                return false;
+
+            record.MaterialAssignment = header.MaterialAssignment;
+            record.Bounds.min = Vector3{ header.BoundsMin[0], header.BoundsMin[1], header.BoundsMin[2] };
+            record.Bounds.max = Vector3{ header.BoundsMax[0], header.BoundsMax[1], header.BoundsMax[2] };
+        }
+    }
+
+    for (auto& record : contents.Meshes)
+    {
+        if (!CheckMeshReferences(record.Geometry, contents.Bones.size()))
+        {
+            reader.SetError("mesh references missing vertices or bones");
+            return false;
+        }
+
+        if (record.MaterialAssignment < 0 || record.MaterialAssignment >= materialCount)
+            record.MaterialAssignment = 0;
+    }
+
+    return reader.IsValid();
+}
+
+bool ReadModel(Model& model, uint8_t* buffer, size_t size, bool supportCPUAnimation)
+{
+    BinaryReader reader(buffer, size);
+    return ReadModel(model, reader, supportCPUAnimation);
+}
+
+bool ReadModel(Model& model, Models::BinaryReader& reader, bool supportCPUAnimation)
+{
+    ModelFileContents contents;
+    if (!ReadModelFile(contents, reader, false))
+    {
+        contents.FreeMeshes();
+        return false;
+    }
+
+    model.transform = contents.RootTransform;
+
+    model.meshCount = int(contents.Meshes.size());
+    model.materialCount = int(contents.Materials.size());
 
     model.meshes = (Mesh*)MemAlloc(sizeof(Mesh) * model.meshCount);
     model.meshMaterial = (int*)MemAlloc(sizeof(int) * model.meshCount);
@@ -138,8 +433,8 @@ void ReadModel(Model& model, uint8_t* buffer, size_t size, bool supportCPUAnimat
 
     for (int meshIndex = 0; meshIndex < model.meshCount; meshIndex++)
     {
-        Mesh& mesh = model.meshes[meshIndex];
-        ReadMesh(mesh, model.meshMaterial[meshIndex], buffer, offset, size, useAnims);
+        model.meshes[meshIndex] = contents.Meshes[meshIndex].Geometry;
+        model.meshMaterial[meshIndex] = contents.Meshes[meshIndex].MaterialAssignment;
     }
 
     for (int matIndex = 0; matIndex < model.materialCount; matIndex++)
@@ -147,249 +442,410 @@ void ReadModel(Model& model, uint8_t* buffer, size_t size, bool supportCPUAnimat
         Material& mat = model.materials[matIndex];
         mat = LoadMaterialDefault();
 
-        mat.maps[MATERIAL_MAP_ALBEDO].color = GetColor(ReadData<int>(buffer, offset, size));
-
-        int nameSize = ReadData<int>(buffer, offset, size);
-        char* name = new char[nameSize + 1];
-        name[nameSize] = '\0';
-        memcpy(name, buffer + offset, nameSize);
-        offset += nameSize;
+        mat.maps[MATERIAL_MAP_ALBEDO].color = contents.Materials[matIndex].Tint;
 
         if (TextureCallback)
         {
-            mat.maps[MATERIAL_MAP_ALBEDO].texture = TextureCallback(name);
+            mat.maps[MATERIAL_MAP_ALBEDO].texture = TextureCallback(contents.Materials[matIndex].TextureName);
         }
     }
 
-    if (useAnims)
+    model.boneCount = int(contents.Bones.size());
+    if (model.boneCount > 0)
     {
-        model.boneCount = ReadData<int>(buffer, offset, size);
-        if (model.boneCount > 0)
+        model.bones = (BoneInfo*)MemAlloc(model.boneCount * sizeof(BoneInfo));
+        model.bindPose = (Transform*)MemAlloc(model.boneCount * sizeof(Transform));
+
+        for (int i = 0; i < model.boneCount; i++)
         {
-            model.bones = (BoneInfo*)MemAlloc(model.boneCount * sizeof(BoneInfo));
-            model.bindPose = (Transform*)MemAlloc(model.boneCount * sizeof(Transform));
+            // bone info
+            model.bones[i].parent = contents.Bones[i].Parent;
+            strncpy(model.bones[i].name, contents.Bones[i].Name.c_str(), sizeof(model.bones[i].name) - 1);
+
+            // bind pose transform
+            model.bindPose[i] = contents.Bones[i].BindTransform;
+        }
 
+        for (int meshIndex = 0; meshIndex < model.meshCount; meshIndex++)
+        {
+            auto& mesh = model.meshes[meshIndex];
+            mesh.boneCount = model.boneCount;
+            mesh.boneMatrices = (Matrix*)MemAlloc(sizeof(Matrix) * mesh.boneCount);
             for (int i = 0; i < model.boneCount; i++)
             {
-                // bone info
-                model.bones[i].parent = ReadData<int>(buffer, offset, size);
-                memcpy(model.bones[i].name, buffer + offset, 32);
-                offset += 32;
-
-                // bind pose transform
-                model.bindPose[i] = ReadTransform(buffer, offset, size);
+                mesh.boneMatrices[i] = MatrixIdentity();
             }
 
-            for (int meshIndex = 0; meshIndex < model.meshCount; meshIndex++)
+            if (supportCPUAnimation)
             {
-                auto& mesh = model.meshes[meshIndex];
-                mesh.boneCount = model.boneCount;
-                mesh.boneMatrices = (Matrix*)MemAlloc(sizeof(Matrix) * mesh.boneCount);
-                for (int i = 0; i < model.boneCount; i++)
-                {
-                    mesh.boneMatrices[i] = MatrixIdentity();
-                }
+                // Animated vertex data
+                model.meshes[meshIndex].animVertices = (float*)MemAlloc(model.meshes[meshIndex].vertexCount * 3 * sizeof(float));
+                memcpy(model.meshes[meshIndex].animVertices, model.meshes[meshIndex].vertices, model.meshes[meshIndex].vertexCount * 3 * sizeof(float));
 
-                if (supportCPUAnimation)
+                if (model.meshes[meshIndex].normals != nullptr)
                 {
-                    // Animated vertex data
-                    model.meshes[meshIndex].animVertices = (float*)MemAlloc(model.meshes[meshIndex].vertexCount * 3 * sizeof(float));
-                    memcpy(model.meshes[meshIndex].animVertices, model.meshes[meshIndex].vertices, model.meshes[meshIndex].vertexCount * 3 * sizeof(float));
-
-                    if (model.meshes[meshIndex].normals != nullptr)
-                    {
-                        model.meshes[meshIndex].animNormals = (float*)MemAlloc(model.meshes[meshIndex].vertexCount * 3 * sizeof(float));
-                        memcpy(model.meshes[meshIndex].animNormals, model.meshes[meshIndex].normals, model.meshes[meshIndex].vertexCount * 3 * sizeof(float));
-                    }
+                    model.meshes[meshIndex].animNormals = (float*)MemAlloc(model.meshes[meshIndex].vertexCount * 3 * sizeof(float));
+                    memcpy(model.meshes[meshIndex].animNormals, model.meshes[meshIndex].normals, model.meshes[meshIndex].vertexCount * 3 * sizeof(float));
                 }
             }
         }
     }
 
-    if (hasTransform)
+    return true;
+}
+
+static Vector3 ReadVector(BinaryReader& reader)
+{
+    Vector3 value = { 0 };
+    value.x = reader.Read<float>();
+    value.y = reader.Read<float>();
+    value.z = reader.Read<float>();
+    return value;
+}
+
+// reads a range quantized track into the keyed frames of one bone, translation or scale is selected by the member pointer
+static void ReadVectorTrack(std::vector<Models::AnimateableKeyFrame>& frames, const std::vector<uint32_t>& keys, size_t boneIndex, Vector3 Transform::* member, BinaryReader& reader)
+{
+    Vector3 minValue = ReadVector(reader);
+    Vector3 range = ReadVector(reader);
+
+    for (uint32_t key : keys)
+    {
+        Vector3& value = frames[key].GlobalTransforms[boneIndex].*member;
+        value.x = AnimationCompression::Dequantize(reader.Read<uint16_t>(), minValue.x, range.x, AnimationCompression::RangeMax);
+        value.y = AnimationCompression::Dequantize(reader.Read<uint16_t>(), minValue.y, range.y, AnimationCompression::RangeMax);
+        value.z = AnimationCompression::Dequantize(reader.Read<uint16_t>(), minValue.z, range.z, AnimationCompression::RangeMax);
+    }
+}
+
+// reads one sequence in the compressed format, the frames between keyframes are rebuilt by blending
+static bool ReadCompressedSequence(std::vector<Models::AnimateableKeyFrame>& frames, int boneCount, int frameCount, BinaryReader& reader)
+{
+    size_t keyCount = size_t(reader.Read<uint32_t>());
+    if (frameCount <= 0 || keyCount == 0 || keyCount > size_t(frameCount) || !reader.HasRemaining(sizeof(uint32_t) * keyCount))
+    {
+        reader.SetError("bad keyframe count");
+        return false;
+    }
+
+    // the writer always keeps the first and last frame, and the keys are in order
+    std::vector<uint32_t> keys(keyCount);
+    reader.Read(keys.data(), sizeof(uint32_t) * keyCount);
+    bool increasing = std::adjacent_find(keys.begin(), keys.end(), [](uint32_t a, uint32_t b) { return b <= a; }) == keys.end();
+
+    if (!increasing || keys.front() != 0 || keys.back() != uint32_t(frameCount - 1))
+    {
+        reader.SetError("bad keyframe list");
+        return false;
+    }
+
+    // every bone is at least its flags, a constant translation and scale and one packed rotation
+    if (!reader.HasRemaining((sizeof(uint8_t) + sizeof(Vector3) * 2 + sizeof(uint16_t) * 3) * size_t(boneCount)))
+    {
+        reader.SetError("sequence is truncated");
+        return false;
+    }
+
+    frames.resize(frameCount);
+    for (auto& frame : frames)
+        frame.GlobalTransforms.resize(boneCount);
+
+    for (size_t boneIndex = 0; boneIndex < size_t(boneCount); boneIndex++)
+    {
+        uint8_t flags = reader.Read<uint8_t>();
+
+        if (flags & AnimationCompression::ConstantTranslation)
+        {
+            Vector3 value = ReadVector(reader);
+            for (auto& frame : frames)
+                frame.GlobalTransforms[boneIndex].translation = value;
+        }
+        else
+        {
+            ReadVectorTrack(frames, keys, boneIndex, &Transform::translation, reader);
+        }
+
+        if (flags & AnimationCompression::ConstantRotation)
+        {
+            Quaternion value = { 0 };
+            value.x = reader.Read<float>();
+            value.y = reader.Read<float>();
+            value.z = reader.Read<float>();
+            value.w = reader.Read<float>();
+            for (auto& frame : frames)
+                frame.GlobalTransforms[boneIndex].rotation = value;
+        }
+        else
+        {
+            for (uint32_t key : keys)
+            {
+                uint16_t packed[3] = { 0 };
+                packed[0] = reader.Read<uint16_t>();
+                packed[1] = reader.Read<uint16_t>();
+                packed[2] = reader.Read<uint16_t>();
+                frames[key].GlobalTransforms[boneIndex].rotation = AnimationCompression::UnpackQuaternion(packed);
+            }
+        }
+
+        if (flags & AnimationCompression::ConstantScale)
+        {
+            Vector3 value = ReadVector(reader);
+            for (auto& frame : frames)
+                frame.GlobalTransforms[boneIndex].scale = value;
+        }
+        else
+        {
+            ReadVectorTrack(frames, keys, boneIndex, &Transform::scale, reader);
+        }
+
+        // a truncated file would otherwise run every remaining bone on zeroed data
+        if (!reader.IsValid())
+            return false;
+    }
+
+    // rebuild the dropped frames, constant tracks are already filled in so blending them changes nothing
+    for (size_t keyIndex = 0; keyIndex + 1 < keys.size(); keyIndex++)
+    {
+        uint32_t start = keys[keyIndex];
+        uint32_t end = keys[keyIndex + 1];
+
+        for (uint32_t frameIndex = start + 1; frameIndex < end; frameIndex++)
+        {
+            float param = float(frameIndex - start) / float(end - start);
+            for (size_t boneIndex = 0; boneIndex < size_t(boneCount); boneIndex++)
+                frames[frameIndex].GlobalTransforms[boneIndex] = Models::BlendKeyframeTransform(frames[start].GlobalTransforms[boneIndex], frames[end].GlobalTransforms[boneIndex], param);
+        }
+    }
+
+    return true;
+}
+
+// reads the name and frames of one sequence, version 1 stores every transform and version 2 is compressed
+static bool ReadSequence(std::string& name, std::vector<Models::AnimateableKeyFrame>& frames, int version, BinaryReader& reader)
+{
+    name = reader.ReadFixedString(32);
+
+    int boneCount = reader.Read<int>();
+    int frameCount = reader.Read<int>();
+
+    if (!reader.IsValid())
+        return false;
+
+    if (boneCount < 0 || frameCount < 0 || size_t(boneCount) * size_t(frameCount) > AnimationCompression::MaxSequenceTransforms)
+    {
+        reader.SetError("bad sequence size");
+        return false;
+    }
+
+    if (version == AnimationCompression::Version)
+        return ReadCompressedSequence(frames, boneCount, frameCount, reader);
+
+    if (!reader.HasRemaining(sizeof(float) * 10 * size_t(boneCount) * size_t(frameCount)))
+    {
+        reader.SetError("sequence is truncated");
+        return false;
+    }
+
+    frames.resize(frameCount);
+    for (auto& frame : frames)
+    {
+        frame.GlobalTransforms.resize(boneCount);
+        for (auto& transform : frame.GlobalTransforms)
+            transform = ReadTransform(reader);
+    }
+
+    return reader.IsValid();
+}
+
+// reads the header of an animation file, returning the version
+static int ReadAnimationHeader(size_t& count, BinaryReader& reader)
+{
+    int version = reader.Read<int>();
+
+    if (!reader.IsValid() || (version != 1 && version != AnimationCompression::Version))
     {
-        Transform temp = ReadTransform(buffer, offset, size);
+        reader.SetError("unknown animation version");
+        return 0;
+    }
 
-        Matrix matScale = MatrixScale(temp.scale.x, temp.scale.y, temp.scale.z);
-        Vector3 axis = Vector3Zeros;
-        float angle = 0;
-        QuaternionToAxisAngle(temp.rotation, &axis, &angle);
-        Matrix matRotation = MatrixRotate(axis, angle);
-        Matrix matTranslation = MatrixTranslate(temp.translation.x, temp.translation.y, temp.translation.z);
-        model.transform = MatrixMultiply(MatrixMultiply(matScale, matRotation), matTranslation);
+    count = size_t(reader.Read<uint32_t>());
+
+    // each sequence is at least a name and its counts
+    if (!reader.HasRemaining((32 + sizeof(int) * 2) * count))
+    {
+        reader.SetError("bad sequence count");
+        return 0;
     }
+
+    return version;
 }
 
 ModelAnimation* ReadModelAnimations(const Model& model, size_t& count, uint8_t* buffer, size_t size)
 {
-    size_t offset = 0;
+    BinaryReader reader(buffer, size);
+    return ReadModelAnimations(model, count, reader);
+}
 
-    int version = ReadData<int>(buffer, offset, size);
+ModelAnimation* ReadModelAnimations(const Model& model, size_t& count, Models::BinaryReader& reader)
+{
+    size_t sequenceCount = 0;
+    count = 0;
 
-    if (version != 1)
+    int version = ReadAnimationHeader(sequenceCount, reader);
+    if (version == 0)
         return nullptr;
 
-    count = size_t(ReadData<uint32_t>(buffer, offset, size));
-
-    ModelAnimation* animations = (ModelAnimation*)MemAlloc(sizeof(ModelAnimation) * (int)count);
+    ModelAnimation* animations = (ModelAnimation*)MemAlloc(sizeof(ModelAnimation) * (int)sequenceCount);
 
-    for (size_t animIndex = 0; animIndex < count; animIndex++)
+    for (size_t animIndex = 0; animIndex < sequenceCount; animIndex++)
     {
+        std::string name;
+        std::vector<Models::AnimateableKeyFrame> frames;
+        if (!ReadSequence(name, frames, version, reader))
+        {
+            // frees the animations read so far and the array
+            UnloadModelAnimations(animations, int(animIndex));
+            return nullptr;
+        }
+
         ModelAnimation& anim = animations[animIndex];
 
-        memcpy(anim.name, buffer + offset, 32);
-        offset += 32;
+        strncpy(anim.name, name.c_str(), sizeof(anim.name) - 1);
 
-        anim.boneCount = ReadData<int>(buffer, offset, size);
-        anim.frameCount = ReadData<int>(buffer, offset, size);
+        anim.frameCount = int(frames.size());
+        anim.boneCount = frames.empty() ? 0 : int(frames.front().GlobalTransforms.size());
 
-        anim.framePoses = (Transform**)MemAlloc(sizeof(Transform*) *  anim.frameCount);
+        anim.framePoses = (Transform**)MemAlloc(sizeof(Transform*) * anim.frameCount);
 
         anim.bones = (BoneInfo*)MemAlloc(sizeof(BoneInfo) * model.boneCount);
 
-        memcpy(anim.bones, model.bones, sizeof(BoneInfo) * model.boneCount);
+        if (model.boneCount > 0)
+            memcpy(anim.bones, model.bones, sizeof(BoneInfo) * model.boneCount);
 
-        for (size_t frameIndex = 0; frameIndex < anim.frameCount; frameIndex++)
+        for (size_t frameIndex = 0; frameIndex < frames.size(); frameIndex++)
         {
             anim.framePoses[frameIndex] = (Transform*)MemAlloc(sizeof(Transform) * anim.boneCount);
-
-            for (size_t boneIndex = 0; boneIndex < anim.boneCount; boneIndex++)
-            {
-                anim.framePoses[frameIndex][boneIndex] = ReadTransform(buffer, offset, size);
-            }
+            memcpy(anim.framePoses[frameIndex], frames[frameIndex].GlobalTransforms.data(), sizeof(Transform) * anim.boneCount);
         }
     }
 
+    count = sequenceCount;
     return animations;
 }
 
 namespace Models
 {
-    void AnimationSet::Read(uint8_t* buffer, size_t size)
+    bool AnimationSet::Read(uint8_t* buffer, size_t size)
     {
-        Sequences.clear();
-
-        size_t offset = 0;
-
-        int version = ReadData<int>(buffer, offset, size);
+        BinaryReader reader(buffer, size);
+        return Read(reader);
+    }
 
-        if (version != 1)
-            return;
+    bool AnimationSet::Read(BinaryReader& reader)
+    {
+        Sequences.clear();
 
-        size_t count = size_t(ReadData<uint32_t>(buffer, offset, size));
+        size_t count = 0;
+        int version = ReadAnimationHeader(count, reader);
+        if (version == 0)
+            return false;
 
         for (size_t animIndex = 0; animIndex < count; animIndex++)
         {
-            char name[32] = { 0 };
-            memcpy(name, buffer + offset, 32);
-            offset += 32;
+            std::string name;
+            std::vector<AnimateableKeyFrame> frames;
 
-            auto& anim = Sequences.try_emplace(std::string(name)).first->second;
+            // the rest of the file can't be trusted if a sequence is bad, the ones before it are kept
+            if (!ReadSequence(name, frames, version, reader))
+                return false;
 
-            int boneCount = ReadData<int>(buffer, offset, size);
-            int frameCount = ReadData<int>(buffer, offset, size);
-
-            for (size_t frameIndex = 0; frameIndex < frameCount; frameIndex++)
-            {
-                auto& frame = anim.Frames.emplace_back();
-
-                for (size_t boneIndex = 0; boneIndex < boneCount; boneIndex++)
-                {
-                    frame.GlobalTransforms.push_back(ReadTransform(buffer, offset, size));
-                }
-            }
+            auto& anim = Sequences[name];
+            anim.Frames = std::move(frames);
+            PackSequence(anim);
         }
+
+        return true;
     }
 
-    void AnimateableModel::Read(uint8_t* buffer, size_t size)
+    bool AnimateableModel::Read(uint8_t* buffer, size_t size, bool borrowMeshData)
     {
-        RootTransform = MatrixIdentity();
-
-        size_t offset = 0;
+        BinaryReader reader(buffer, size);
+        return Read(reader, borrowMeshData);
+    }
 
-        int version = ReadData<int>(buffer, offset, size);
+    bool AnimateableModel::Read(BinaryReader& reader, bool borrowMeshData)
+    {
+        ModelFileContents contents;
+        if (!ReadModelFile(contents, reader, borrowMeshData) || contents.Materials.empty())
+        {
+            // every mesh needs a material group to live in
+            if (reader.IsValid())
+                reader.SetError("model has no materials");
 
-        if (version < 1 || version > 3)
-            return;
+            contents.FreeMeshes();
+            return false;
+        }
 
-        bool useAnims = version >= 2;
-        bool hasTransform = version >= 3;
+        RootTransform = contents.RootTransform;
 
-        int meshCount = ReadData<int>(buffer, offset, size);
-        int materialCount = ReadData<int>(buffer, offset, size);
         Groups.clear();
+        Bones.clear();
+        RootBone = nullptr;
 
-        Groups.resize(materialCount);
+        Groups.resize(contents.Materials.size());
 
-        for (int meshIndex = 0; meshIndex < meshCount; meshIndex++)
-        {
-            Mesh tempMesh = { 0 };
-            int assignment = 0;
-            ReadMesh(tempMesh, assignment, buffer, offset, size, useAnims);
+        BorrowsMeshData = contents.BorrowsMeshData;
 
-            Groups[assignment].Meshes.emplace_back();
-            Groups[assignment].Meshes.back().Geometry = tempMesh;
+        for (auto& record : contents.Meshes)
+        {
+            auto& mesh = Groups[record.MaterialAssignment].Meshes.emplace_back();
+            mesh.Geometry = record.Geometry;
+            mesh.Bounds = record.Bounds;
         }
 
-        for (int matIndex = 0; matIndex < materialCount; matIndex++)
+        for (size_t matIndex = 0; matIndex < contents.Materials.size(); matIndex++)
         {
             auto& mat = Groups[matIndex];
             mat.GroupMaterial = LoadMaterialDefault();
 
-            mat.GroupMaterial.maps[MATERIAL_MAP_ALBEDO].color = GetColor(ReadData<int>(buffer, offset, size));
+            mat.GroupMaterial.maps[MATERIAL_MAP_ALBEDO].color = contents.Materials[matIndex].Tint;
 
-            int nameSize = ReadData<int>(buffer, offset, size);
-            char* name = new char[nameSize + 1];
-            name[nameSize] = '\0';
-            memcpy(name, buffer + offset, nameSize);
-            offset += nameSize;
-
-            if (TextureCallback)
-            {
-                mat.GroupMaterial.maps[MATERIAL_MAP_ALBEDO].texture = TextureCallback(name);
-            }
+            // textures are GPU resources, they get resolved when the model is uploaded
+            mat.TextureName = contents.Materials[matIndex].TextureName;
         }
 
-        if (useAnims)
+        if (!contents.Bones.empty())
         {
-            int boneCount = ReadData<int>(buffer, offset, size);
-            if (boneCount > 0)
+            for (auto& record : contents.Bones)
             {
-                for (int i = 0; i < boneCount; i++)
-                {
-                    auto& bone = Bones.emplace_back();
-                    // bone info
-                    bone.ParentBoneId = ReadData<int>(buffer, offset, size);
-                    char name[32] = { 0 };
-                    memcpy(name, buffer + offset, 32);
-                    offset += 32;
-
-                    bone.Name = name;
-                    bone.DefaultGlobalTransform = ReadTransform(buffer, offset, size);
-                }
+                auto& bone = Bones.emplace_back();
+                // bone info
+                bone.ParentBoneId = size_t(record.Parent);
+                bone.Name = record.Name;
+                bone.DefaultGlobalTransform = record.BindTransform;
+            }
 
-                // build the bone tree
-                for (auto& bone : Bones)
-                {
-                    if (bone.ParentBoneId == -1)
-                        RootBone = &bone;
-                    else
-                        Bones[bone.ParentBoneId].Children.push_back(&bone);
-                }
+            // build the bone tree
+            for (auto& bone : Bones)
+            {
+                if (bone.ParentBoneId == -1)
+                    RootBone = &bone;
+                else
+                    Bones[bone.ParentBoneId].Children.push_back(&bone);
             }
-        }
 
-        if (hasTransform)
-        {
-            Transform temp = ReadTransform(buffer, offset, size);
-
-            Matrix matScale = MatrixScale(temp.scale.x, temp.scale.y, temp.scale.z);
-            Vector3 axis = Vector3Zeros;
-            float angle = 0;
-            QuaternionToAxisAngle(temp.rotation, &axis, &angle);
-            Matrix matRotation = MatrixRotate(axis, angle);
-            Matrix matTranslation = MatrixTranslate(temp.translation.x, temp.translation.y, temp.translation.z);
-            RootTransform = MatrixMultiply(MatrixMultiply(matScale, matRotation), matTranslation);
+            UpdateInverseBindPose();
         }
+
+        return true;
+    }
+
+    void AnimateableModel::ResolveTextures()
+    {
+        if (!TextureCallback)
+            return;
+
+        for (auto& group : Groups)
+            group.GroupMaterial.maps[MATERIAL_MAP_ALBEDO].texture = TextureCallback(group.TextureName);
     }
-}
\ No newline at end of file
+}
@@ -1,4 +1,6 @@
 #include "model.h"
+#include "animation_compression.h"
+#include "mesh_format.h"
 
 #include "raymath.h"
 
@@ -6,6 +8,8 @@
 #include <string>
 #include <stdio.h>
 #include <span>
+#include <algorithm>
+#include <vector>
 
 template<class T>
 static void Write(FILE* fp, T value)
@@ -34,6 +38,287 @@ static void WriteTransform(FILE* out, const Transform& xform)
     Write(out, xform.scale.z);
 }
 
+static bool IsVectorTrackConstant(const std::vector<Vector3>& values)
+{
+    for (const auto& value : values)
+    {
+        if (fabsf(value.x - values[0].x) > AnimationCompression::ConstantTolerance
+            || fabsf(value.y - values[0].y) > AnimationCompression::ConstantTolerance
+            || fabsf(value.z - values[0].z) > AnimationCompression::ConstantTolerance)
+            return false;
+    }
+    return true;
+}
+
+static bool IsRotationTrackConstant(const std::vector<Quaternion>& values)
+{
+    for (const auto& value : values)
+    {
+        // q and -q are the same rotation
+        if (1.0f - fabsf(AnimationCompression::Dot(value, values[0])) > AnimationCompression::ConstantTolerance)
+            return false;
+    }
+    return true;
+}
+
+// how far apart two transforms are, the distance between the translations and between the scales, and the largest difference
+// in any rotation component with both rotations on the same side of the hypersphere
+static float GetTransformError(const Transform& a, const Transform& b)
+{
+    Quaternion rotation = b.rotation;
+    if (AnimationCompression::Dot(a.rotation, rotation) < 0)
+        rotation = QuaternionScale(rotation, -1);
+
+    float error = 0;
+    error = std::max(error, Vector3Distance(a.translation, b.translation));
+    error = std::max(error, fabsf(a.rotation.x - rotation.x));
+    error = std::max(error, fabsf(a.rotation.y - rotation.y));
+    error = std::max(error, fabsf(a.rotation.z - rotation.z));
+    error = std::max(error, fabsf(a.rotation.w - rotation.w));
+    error = std::max(error, Vector3Distance(a.scale, b.scale));
+
+    return error;
+}
+
+// picks the keyframes to store, every dropped frame can be rebuilt by blending the stored frames around it to within the error.
+// the blend uses the decoded frames, what the reader gets back for a stored frame after quantizing, and is compared to the original
+static std::vector<uint32_t> ReduceKeyframes(const std::vector<Models::AnimateableKeyFrame>& frames, const std::vector<Models::AnimateableKeyFrame>& decoded,
+    size_t boneCount, float keyframeError)
+{
+    std::vector<uint32_t> keys = { 0 };
+
+    if (keyframeError <= 0)
+    {
+        for (uint32_t frameIndex = 1; frameIndex < frames.size(); frameIndex++)
+            keys.push_back(frameIndex);
+
+        return keys;
+    }
+
+    size_t start = 0;
+    while (start + 1 < frames.size())
+    {
+        // grow the span from the last key for as long as every frame inside it can be blended back
+        size_t end = start + 1;
+        while (end + 1 < frames.size())
+        {
+            size_t candidate = end + 1;
+            bool fits = true;
+
+            for (size_t frameIndex = start + 1; frameIndex < candidate && fits; frameIndex++)
+            {
+                float param = float(frameIndex - start) / float(candidate - start);
+                for (size_t boneIndex = 0; boneIndex < boneCount && fits; boneIndex++)
+                {
+                    Transform blended = Models::BlendKeyframeTransform(decoded[start].GlobalTransforms[boneIndex], decoded[candidate].GlobalTransforms[boneIndex], param);
+                    fits = GetTransformError(frames[frameIndex].GlobalTransforms[boneIndex], blended) <= keyframeError;
+                }
+            }
+
+            if (!fits)
+                break;
+
+            end = candidate;
+        }
+
+        keys.push_back(uint32_t(end));
+        start = end;
+    }
+
+    return keys;
+}
+
+// the range of a quantized track covers every frame, so it is known before the keyframes are picked
+static void GetTrackRange(const std::vector<Vector3>& values, Vector3& minValue, Vector3& range)
+{
+    minValue = values[0];
+    Vector3 maxValue = values[0];
+    for (const auto& value : values)
+    {
+        minValue = Vector3Min(minValue, value);
+        maxValue = Vector3Max(maxValue, value);
+    }
+
+    range = maxValue - minValue;
+}
+
+// what the reader gets back for a value stored in a quantized track
+static Vector3 DecodeTrackValue(const Vector3& value, const Vector3& minValue, const Vector3& range)
+{
+    using namespace AnimationCompression;
+
+    return Vector3{ Dequantize(Quantize(value.x, minValue.x, range.x, RangeMax), minValue.x, range.x, RangeMax),
+                    Dequantize(Quantize(value.y, minValue.y, range.y, RangeMax), minValue.y, range.y, RangeMax),
+                    Dequantize(Quantize(value.z, minValue.z, range.z, RangeMax), minValue.z, range.z, RangeMax) };
+}
+
+static void WriteVectorTrack(FILE* out, const std::vector<Vector3>& values, const Vector3& minValue, const Vector3& range)
+{
+    Write(out, minValue.x);
+    Write(out, minValue.y);
+    Write(out, minValue.z);
+    Write(out, range.x);
+    Write(out, range.y);
+    Write(out, range.z);
+
+    for (const auto& value : values)
+    {
+        Write(out, AnimationCompression::Quantize(value.x, minValue.x, range.x, AnimationCompression::RangeMax));
+        Write(out, AnimationCompression::Quantize(value.y, minValue.y, range.y, AnimationCompression::RangeMax));
+        Write(out, AnimationCompression::Quantize(value.z, minValue.z, range.z, AnimationCompression::RangeMax));
+    }
+}
+
+static void WriteVector(FILE* out, const Vector3& value)
+{
+    Write(out, value.x);
+    Write(out, value.y);
+    Write(out, value.z);
+}
+
+// how one bone's tracks are stored in a compressed sequence
+struct BoneTrack
+{
+    uint8_t Flags = 0;
+    Vector3 TranslationMin = { 0 };
+    Vector3 TranslationRange = { 0 };
+    Vector3 ScaleMin = { 0 };
+    Vector3 ScaleRange = { 0 };
+};
+
+static void GetBoneTracks(const std::vector<Models::AnimateableKeyFrame>& frames, size_t boneIndex,
+    std::vector<Vector3>& translations, std::vector<Quaternion>& rotations, std::vector<Vector3>& scales)
+{
+    for (size_t frameIndex = 0; frameIndex < frames.size(); frameIndex++)
+    {
+        const Transform& transform = frames[frameIndex].GlobalTransforms[boneIndex];
+        translations[frameIndex] = transform.translation;
+        rotations[frameIndex] = transform.rotation;
+        scales[frameIndex] = transform.scale;
+    }
+}
+
+static void WriteCompressedSequence(FILE* out, std::string_view name, const std::vector<Models::AnimateableKeyFrame>& frames, float keyframeError)
+{
+    char nameBuffer[32] = { 0 };
+    strncpy(nameBuffer, name.data(), std::min(name.size(), size_t(31)));
+    fwrite(nameBuffer, 32, 1, out);
+
+    size_t boneCount = frames.front().GlobalTransforms.size();
+
+    Write(out, int(boneCount));
+    Write(out, int(frames.size()));
+
+    std::vector<Vector3> translations(frames.size());
+    std::vector<Quaternion> rotations(frames.size());
+    std::vector<Vector3> scales(frames.size());
+
+    // how each bone's tracks are stored, and every frame as the reader would decode it if it were kept
+    std::vector<BoneTrack> tracks(boneCount);
+    std::vector<Models::AnimateableKeyFrame> decoded(frames.size());
+    for (auto& frame : decoded)
+        frame.GlobalTransforms.resize(boneCount);
+
+    for (size_t boneIndex = 0; boneIndex < boneCount; boneIndex++)
+    {
+        GetBoneTracks(frames, boneIndex, translations, rotations, scales);
+
+        BoneTrack& track = tracks[boneIndex];
+        if (IsVectorTrackConstant(translations))
+            track.Flags |= AnimationCompression::ConstantTranslation;
+        if (IsRotationTrackConstant(rotations))
+            track.Flags |= AnimationCompression::ConstantRotation;
+        if (IsVectorTrackConstant(scales))
+            track.Flags |= AnimationCompression::ConstantScale;
+
+        GetTrackRange(translations, track.TranslationMin, track.TranslationRange);
+        GetTrackRange(scales, track.ScaleMin, track.ScaleRange);
+
+        for (size_t frameIndex = 0; frameIndex < frames.size(); frameIndex++)
+        {
+            Transform& transform = decoded[frameIndex].GlobalTransforms[boneIndex];
+
+            if (track.Flags & AnimationCompression::ConstantTranslation)
+                transform.translation = translations[0];
+            else
+                transform.translation = DecodeTrackValue(translations[frameIndex], track.TranslationMin, track.TranslationRange);
+
+            if (track.Flags & AnimationCompression::ConstantRotation)
+            {
+                transform.rotation = rotations[0];
+            }
+            else
+            {
+                uint16_t packed[3] = { 0 };
+                AnimationCompression::PackQuaternion(QuaternionNormalize(rotations[frameIndex]), packed);
+                transform.rotation = AnimationCompression::UnpackQuaternion(packed);
+            }
+
+            if (track.Flags & AnimationCompression::ConstantScale)
+                transform.scale = scales[0];
+            else
+                transform.scale = DecodeTrackValue(scales[frameIndex], track.ScaleMin, track.ScaleRange);
+        }
+    }
+
+    std::vector<uint32_t> keys = ReduceKeyframes(frames, decoded, boneCount, keyframeError);
+
+    Write(out, uint32_t(keys.size()));
+    for (uint32_t key : keys)
+        Write(out, key);
+
+    std::vector<Vector3> keyValues(keys.size());
+
+    for (size_t boneIndex = 0; boneIndex < boneCount; boneIndex++)
+    {
+        GetBoneTracks(frames, boneIndex, translations, rotations, scales);
+
+        const BoneTrack& track = tracks[boneIndex];
+        Write(out, track.Flags);
+
+        if (track.Flags & AnimationCompression::ConstantTranslation)
+        {
+            WriteVector(out, translations[0]);
+        }
+        else
+        {
+            for (size_t keyIndex = 0; keyIndex < keys.size(); keyIndex++)
+                keyValues[keyIndex] = translations[keys[keyIndex]];
+            WriteVectorTrack(out, keyValues, track.TranslationMin, track.TranslationRange);
+        }
+
+        if (track.Flags & AnimationCompression::ConstantRotation)
+        {
+            Write(out, rotations[0].x);
+            Write(out, rotations[0].y);
+            Write(out, rotations[0].z);
+            Write(out, rotations[0].w);
+        }
+        else
+        {
+            for (uint32_t key : keys)
+            {
+                uint16_t packed[3] = { 0 };
+                AnimationCompression::PackQuaternion(QuaternionNormalize(rotations[key]), packed);
+                Write(out, packed[0]);
+                Write(out, packed[1]);
+                Write(out, packed[2]);
+            }
+        }
+
+        if (track.Flags & AnimationCompression::ConstantScale)
+        {
+            WriteVector(out, scales[0]);
+        }
+        else
+        {
+            for (size_t keyIndex = 0; keyIndex < keys.size(); keyIndex++)
+                keyValues[keyIndex] = scales[keys[keyIndex]];
+            WriteVectorTrack(out, keyValues, track.ScaleMin, track.ScaleRange);
+        }
+    }
+}
+
 static void WriteMaterial(FILE* out, const Material mat)
 {
     Image texture = LoadImageFromTexture(mat.maps[MATERIAL_MAP_ALBEDO].texture);
@@ -52,37 +337,91 @@ static void WriteMaterial(FILE* out, const Material mat)
     fwrite(textureName, strlen(textureName), 1, out);
 }
 
-static void WriteMesh(FILE* out, const Mesh& mesh, int materialAssignment)
+struct MeshWriteInfo
 {
-    Write(out, mesh.vertexCount);
-    Write(out, mesh.triangleCount);
-    Write(out, materialAssignment);
+    const Mesh* Geometry = nullptr;
+    int MaterialAssignment = 0;
+};
 
-    Write(out, mesh.texcoords ? int(1) : int(0));
-    Write(out, mesh.normals ? int(1) : int(0));
-    Write(out, mesh.colors ? int(1) : int(0));
-    Write(out, mesh.indices ? int(1) : int(0));
-    Write(out, mesh.boneWeights ? int(1) : int(0));
-    Write(out, mesh.boneIds ? int(1) : int(0));
+// writes a placeholder header for each mesh, the real headers are written once the stream offsets are known
+static long WriteMeshTable(FILE* out, const std::vector<MeshWriteInfo>& meshes)
+{
+    long tableStart = ftell(out);
 
-    fwrite(mesh.vertices, sizeof(float) * mesh.vertexCount * 3, 1, out);
-    if (mesh.texcoords)
-        fwrite(mesh.texcoords, sizeof(float) * mesh.vertexCount * 2, 1, out);
+    MeshFormat::MeshHeader header;
+    for (size_t meshIndex = 0; meshIndex < meshes.size(); meshIndex++)
+        fwrite(&header, sizeof(header), 1, out);
 
-    if (mesh.normals)
-        fwrite(mesh.normals, sizeof(float) * mesh.vertexCount * 3, 1, out);
+    return tableStart;
+}
 
-    if (mesh.colors)
-        fwrite(mesh.colors, sizeof(char) * mesh.vertexCount * 4, 1, out);
+static void WriteMeshStreams(FILE* out, long tableStart, const std::vector<MeshWriteInfo>& meshes)
+{
+    std::vector<MeshFormat::MeshHeader> headers(meshes.size());
 
-    if (mesh.indices)
-        fwrite(mesh.indices, sizeof(unsigned short) * mesh.triangleCount * 3, 1, out);
+    for (size_t meshIndex = 0; meshIndex < meshes.size(); meshIndex++)
+    {
+        const Mesh& mesh = *meshes[meshIndex].Geometry;
+        auto& header = headers[meshIndex];
+
+        header.VertexCount = mesh.vertexCount;
+        header.TriangleCount = mesh.triangleCount;
+        header.MaterialAssignment = meshes[meshIndex].MaterialAssignment;
+
+        BoundingBox bounds = GetMeshBoundingBox(mesh);
+        header.BoundsMin[0] = bounds.min.x;
+        header.BoundsMin[1] = bounds.min.y;
+        header.BoundsMin[2] = bounds.min.z;
+        header.BoundsMax[0] = bounds.max.x;
+        header.BoundsMax[1] = bounds.max.y;
+        header.BoundsMax[2] = bounds.max.z;
+
+        // texture coordinates are always written, the shaders expect them
+        std::vector<float> emptyTexcoords;
+        if (!mesh.texcoords)
+            emptyTexcoords.resize(size_t(mesh.vertexCount) * 2);
+
+        const void* streams[MeshFormat::StreamCount] =
+        {
+            mesh.vertices,
+            mesh.texcoords ? mesh.texcoords : emptyTexcoords.data(),
+            mesh.normals,
+            mesh.colors,
+            mesh.indices,
+            mesh.boneWeights,
+            mesh.boneIds
+        };
+
+        size_t streamSizes[MeshFormat::StreamCount] =
+        {
+            sizeof(float) * mesh.vertexCount * 3,
+            sizeof(float) * mesh.vertexCount * 2,
+            sizeof(float) * mesh.vertexCount * 3,
+            sizeof(unsigned char) * mesh.vertexCount * 4,
+            sizeof(unsigned short) * mesh.triangleCount * 3,
+            sizeof(float) * mesh.vertexCount * 4,
+            sizeof(unsigned char) * mesh.vertexCount * 4
+        };
+
+        for (int stream = 0; stream < MeshFormat::StreamCount; stream++)
+        {
+            if (!streams[stream] || streamSizes[stream] == 0)
+                continue;
 
-    if (mesh.boneWeights)
-        fwrite(mesh.boneWeights, sizeof(float) * mesh.vertexCount * 4, 1, out);
+            long offset = ftell(out);
+            long alignedOffset = long(MeshFormat::AlignOffset(size_t(offset)));
+            for (; offset < alignedOffset; offset++)
+                fputc(0, out);
 
-    if (mesh.boneIds)
-        fwrite(mesh.boneIds, sizeof(unsigned char) * mesh.vertexCount * 4, 1, out);
+            header.StreamOffsets[stream] = uint32_t(alignedOffset);
+            header.StreamSizes[stream] = uint32_t(streamSizes[stream]);
+            fwrite(streams[stream], streamSizes[stream], 1, out);
+        }
+    }
+
+    fseek(out, tableStart, SEEK_SET);
+    fwrite(headers.data(), sizeof(MeshFormat::MeshHeader), headers.size(), out);
+    fseek(out, 0, SEEK_END);
 }
 
 using bytes = std::span<const std::byte>;
@@ -98,15 +437,15 @@ void WriteModel(Model& model, std::string_view file)
     if (!out)
         return;
 
-    Write(out, 3);
+    Write(out, MeshFormat::Version);
     Write(out, model.meshCount);
     Write(out, model.materialCount);
 
+    std::vector<MeshWriteInfo> meshes;
     for (int meshIndex = 0; meshIndex < model.meshCount; meshIndex++)
-    {
-        Mesh& mesh = model.meshes[meshIndex];
-        WriteMesh(out, mesh, model.meshMaterial[meshIndex]);
-    }
+        meshes.push_back(MeshWriteInfo{ &model.meshes[meshIndex], model.meshMaterial[meshIndex] });
+
+    long meshTable = WriteMeshTable(out, meshes);
 
     for (int matIndex = 0; matIndex < model.materialCount; matIndex++)
         WriteMaterial(out, model.materials[matIndex]);
@@ -129,15 +468,33 @@ void WriteModel(Model& model, std::string_view file)
 
     MatrixDecompose(model.transform, &modelTransform.translation, &modelTransform.rotation, &modelTransform.scale);
     WriteTransform(out, modelTransform);
-    
+
+    WriteMeshStreams(out, meshTable, meshes);
+
     fclose(out);
 }
 
-void WriteModelAnimations(ModelAnimation* animations, size_t count, std::string_view file)
+using NamedFrames = std::pair<std::string, const std::vector<Models::AnimateableKeyFrame>*>;
+
+// names are stored in 32 bytes and the reader keys sequences by name, so a name that is already used after
+// being cut to fit gets a number on the end instead of replacing the earlier sequence
+static std::string GetUniqueSequenceName(std::string_view name, std::vector<std::string>& usedNames)
 {
-    if (!animations || count == 0)
-        return;
+    std::string base(name.substr(0, std::min(name.size(), size_t(31))));
+    std::string unique = base;
+
+    for (int suffix = 2; std::find(usedNames.begin(), usedNames.end(), unique) != usedNames.end(); suffix++)
+    {
+        std::string ending = "_" + std::to_string(suffix);
+        unique = base.substr(0, std::min(base.size(), 31 - ending.size())) + ending;
+    }
 
+    usedNames.push_back(unique);
+    return unique;
+}
+
+static void WriteAnimationFile(std::string_view file, const std::vector<NamedFrames>& sequences, float keyframeError)
+{
     std::string outputPath = "resources/models/";
     outputPath += file.data();
     outputPath += ".anim";
@@ -147,28 +504,50 @@ void WriteModelAnimations(ModelAnimation* animations, size_t count, std::string_
     if (!out)
         return;
 
-    int temp = 1;
+    uint32_t count = 0;
+    for (const auto& [name, frames] : sequences)
+    {
+        if (!frames->empty())
+            count++;
+    }
+
+    Write(out, AnimationCompression::Version);
+    Write(out, count);
 
-    Write(out, 1);
-    Write(out, uint32_t(count));
+    std::vector<std::string> usedNames;
+    for (const auto& [name, frames] : sequences)
+    {
+        if (frames->empty())
+            continue;
+
+        WriteCompressedSequence(out, GetUniqueSequenceName(name, usedNames), *frames, keyframeError);
+    }
+    fclose(out);
+}
+
+void WriteModelAnimations(ModelAnimation* animations, size_t count, std::string_view file, float keyframeError)
+{
+    if (!animations || count == 0)
+        return;
+
+    // kept in the order of the source file, each animation is its own sequence even if it shares a name
+    std::vector<std::vector<Models::AnimateableKeyFrame>> frames(count);
+    std::vector<NamedFrames> sequences;
 
     for (size_t animIndex = 0; animIndex < count; animIndex++)
     {
         ModelAnimation& anim = animations[animIndex];
 
-        fwrite(anim.name, 32, 1, out);
-        Write(out, anim.boneCount);
-        Write(out, anim.frameCount);
-
         for (size_t frameIndex = 0; frameIndex < anim.frameCount; frameIndex++)
         {
-            for (size_t boneIndex = 0; boneIndex < anim.boneCount; boneIndex++)
-            {
-                WriteTransform(out, anim.framePoses[frameIndex][boneIndex]);
-            }
+            auto& frame = frames[animIndex].emplace_back();
+            frame.GlobalTransforms.assign(anim.framePoses[frameIndex], anim.framePoses[frameIndex] + anim.boneCount);
         }
+
+        sequences.emplace_back(std::string(anim.name, strnlen(anim.name, sizeof(anim.name))), &frames[animIndex]);
     }
-    fclose(out);
+
+    WriteAnimationFile(file, sequences, keyframeError);
 }
 
 namespace Models
@@ -188,28 +567,31 @@ namespace Models
         for (const auto& group : Groups)
             meshCount += int(group.Meshes.size());
 
-        ::Write(out, 3);
+        ::Write(out, MeshFormat::Version);
         ::Write(out, meshCount);
         ::Write(out, int(Groups.size()));
 
+        std::vector<MeshWriteInfo> meshes;
         int groupId = 0;
         for (const auto& group : Groups)
         {
             for (const auto& mesh : group.Meshes)
             {
-                WriteMesh(out, mesh.Geometry, groupId);
+                meshes.push_back(MeshWriteInfo{ &mesh.Geometry, groupId });
             }
             groupId++;
         }
 
+        long meshTable = WriteMeshTable(out, meshes);
+
         for (const auto& group : Groups)
             WriteMaterial(out, group.GroupMaterial);
 
         ::Write(out, int(Bones.size()));
         for (const auto & bone : Bones)
         {
-            // bone info
-            ::Write(out, bone.ParentBoneId);
+            // bone info, the reader expects an int
+            ::Write(out, int(bone.ParentBoneId));
             char name[32] = { 0 };
             strcpy(name, bone.Name.c_str());
 
@@ -225,45 +607,20 @@ namespace Models
         MatrixDecompose(RootTransform, & modelTransform.translation, & modelTransform.rotation, & modelTransform.scale);
         WriteTransform(out, modelTransform);
 
+        WriteMeshStreams(out, meshTable, meshes);
+
         fclose(out);
     }
 
-    void AnimationSet::Write(std::string_view file)
+    void AnimationSet::Write(std::string_view file, float keyframeError)
     {
-        std::string outputPath = "resources/models/";
-        outputPath += file.data();
-        outputPath += ".anim";
+        std::vector<NamedFrames> sequences;
+        for (const auto& [name, sequence] : Sequences)
+            sequences.emplace_back(name, &sequence.Frames);
 
-        FILE* out = fopen(outputPath.c_str(), "wb");
+        // the map has no order of its own, sorting keeps the file the same each time it's written
+        std::sort(sequences.begin(), sequences.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
 
-        if (!out)
-            return;
-
-        int temp = 1;
-
-        ::Write(out, 1);
-        ::Write(out, uint32_t(Sequences.size()));
-
-        for (const auto & [name, sequence] : Sequences)
-        {
-            if (sequence.Frames.size() == 0)
-                continue;
-
-            char temp[32] = { 0 };
-            strcpy(temp, name.c_str());
-
-            fwrite(temp, 32, 1, out);
-            ::Write(out, int(sequence.Frames.begin()->GlobalTransforms.size()));
-            ::Write(out, int(sequence.Frames.size()));
-
-            for (const auto & frame : sequence.Frames)
-            {
-                for (const auto& bone : frame.GlobalTransforms)
-                {
-                    WriteTransform(out, bone);
-                }
-            }
-        }
-        fclose(out);
+        WriteAnimationFile(file, sequences, keyframeError);
     }
-}
\ No newline at end of file
+}
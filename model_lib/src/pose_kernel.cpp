@@ -0,0 +1,407 @@
+#include "model.h"
+
+#include "raymath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// use SSE when the target always has it, everything else gets the plain four wide loop, which compilers will usually vectorize on their own
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MODELS_POSE_KERNEL_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+    constexpr size_t LaneWidth = Models::AnimatablePackedTransforms::LaneWidth;
+
+#ifdef MODELS_POSE_KERNEL_SSE
+    static_assert(LaneWidth == 4, "SSE kernel is 4 lanes wide");
+
+    struct Lanes
+    {
+        __m128 V;
+
+        static Lanes Load(const float* values) { return Lanes{ _mm_loadu_ps(values) }; }
+        static Lanes Set(float value) { return Lanes{ _mm_set1_ps(value) }; }
+    };
+
+    inline Lanes operator + (Lanes a, Lanes b) { return Lanes{ _mm_add_ps(a.V, b.V) }; }
+    inline Lanes operator - (Lanes a, Lanes b) { return Lanes{ _mm_sub_ps(a.V, b.V) }; }
+    inline Lanes operator * (Lanes a, Lanes b) { return Lanes{ _mm_mul_ps(a.V, b.V) }; }
+    inline Lanes operator / (Lanes a, Lanes b) { return Lanes{ _mm_div_ps(a.V, b.V) }; }
+    inline Lanes Sqrt(Lanes a) { return Lanes{ _mm_sqrt_ps(a.V) }; }
+
+    // the magnitude of a with the sign of b
+    inline Lanes CopySign(Lanes a, Lanes b)
+    {
+        __m128 signMask = _mm_set1_ps(-0.0f);
+        return Lanes{ _mm_or_ps(_mm_andnot_ps(signMask, a.V), _mm_and_ps(signMask, b.V)) };
+    }
+
+    // a where the lane of test is greater than limit, b everywhere else
+    inline Lanes SelectGreater(Lanes test, Lanes limit, Lanes a, Lanes b)
+    {
+        __m128 mask = _mm_cmpgt_ps(test.V, limit.V);
+        return Lanes{ _mm_or_ps(_mm_and_ps(mask, a.V), _mm_andnot_ps(mask, b.V)) };
+    }
+
+    // takes the 16 matrix elements (in memory order) for each lane and writes out one matrix per lane
+    inline void StoreMatrices(Lanes elements[16], float matrices[LaneWidth][16])
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            __m128 r0 = elements[row * 4 + 0].V;
+            __m128 r1 = elements[row * 4 + 1].V;
+            __m128 r2 = elements[row * 4 + 2].V;
+            __m128 r3 = elements[row * 4 + 3].V;
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+            _mm_storeu_ps(matrices[0] + row * 4, r0);
+            _mm_storeu_ps(matrices[1] + row * 4, r1);
+            _mm_storeu_ps(matrices[2] + row * 4, r2);
+            _mm_storeu_ps(matrices[3] + row * 4, r3);
+        }
+    }
+#else
+    struct Lanes
+    {
+        float V[LaneWidth];
+
+        static Lanes Load(const float* values)
+        {
+            Lanes result;
+            for (size_t i = 0; i < LaneWidth; i++)
+                result.V[i] = values[i];
+            return result;
+        }
+
+        static Lanes Set(float value)
+        {
+            Lanes result;
+            for (size_t i = 0; i < LaneWidth; i++)
+                result.V[i] = value;
+            return result;
+        }
+    };
+
+#define LANE_OPERATOR(op) \
+    inline Lanes operator op (Lanes a, Lanes b) \
+    { \
+        Lanes result; \
+        for (size_t i = 0; i < LaneWidth; i++) \
+            result.V[i] = a.V[i] op b.V[i]; \
+        return result; \
+    }
+
+    LANE_OPERATOR(+)
+    LANE_OPERATOR(-)
+    LANE_OPERATOR(*)
+    LANE_OPERATOR(/)
+
+#undef LANE_OPERATOR
+
+    inline Lanes Sqrt(Lanes a)
+    {
+        for (size_t i = 0; i < LaneWidth; i++)
+            a.V[i] = std::sqrt(a.V[i]);
+        return a;
+    }
+
+    inline Lanes CopySign(Lanes a, Lanes b)
+    {
+        for (size_t i = 0; i < LaneWidth; i++)
+            a.V[i] = std::copysign(a.V[i], b.V[i]);
+        return a;
+    }
+
+    inline Lanes SelectGreater(Lanes test, Lanes limit, Lanes a, Lanes b)
+    {
+        for (size_t i = 0; i < LaneWidth; i++)
+            a.V[i] = test.V[i] > limit.V[i] ? a.V[i] : b.V[i];
+        return a;
+    }
+
+    inline void StoreMatrices(Lanes elements[16], float matrices[LaneWidth][16])
+    {
+        for (size_t lane = 0; lane < LaneWidth; lane++)
+        {
+            for (size_t element = 0; element < 16; element++)
+                matrices[lane][element] = elements[element].V[lane];
+        }
+    }
+#endif
+
+    using Channel = Models::AnimatablePackedTransforms::Channel;
+
+    // QuaternionSlerp falls back to a normalized lerp when the rotations are closer than this
+    constexpr float SlerpCosine = 0.95f;
+
+    struct PackedTransformLanes
+    {
+        Lanes TX, TY, TZ;
+        Lanes RX, RY, RZ, RW;
+        Lanes SX, SY, SZ;
+
+        void Load(const Models::AnimatablePackedTransforms& packed, size_t frame, size_t bone)
+        {
+            TX = Lanes::Load(packed.GetChannel(frame, Channel::TranslationX) + bone);
+            TY = Lanes::Load(packed.GetChannel(frame, Channel::TranslationY) + bone);
+            TZ = Lanes::Load(packed.GetChannel(frame, Channel::TranslationZ) + bone);
+            RX = Lanes::Load(packed.GetChannel(frame, Channel::RotationX) + bone);
+            RY = Lanes::Load(packed.GetChannel(frame, Channel::RotationY) + bone);
+            RZ = Lanes::Load(packed.GetChannel(frame, Channel::RotationZ) + bone);
+            RW = Lanes::Load(packed.GetChannel(frame, Channel::RotationW) + bone);
+            SX = Lanes::Load(packed.GetChannel(frame, Channel::ScaleX) + bone);
+            SY = Lanes::Load(packed.GetChannel(frame, Channel::ScaleY) + bone);
+            SZ = Lanes::Load(packed.GetChannel(frame, Channel::ScaleZ) + bone);
+        }
+    };
+
+    // the same math as GetBoneMatrix, with the transform blend done in place, for LaneWidth bones at once
+    void EvaluateBlock(const PackedTransformLanes& frame1, const PackedTransformLanes& frame2, const PackedTransformLanes& inverseBind, Lanes param, float matrices[LaneWidth][16])
+    {
+        Lanes one = Lanes::Set(1.0f);
+        Lanes two = Lanes::Set(2.0f);
+        Lanes zero = Lanes::Set(0.0f);
+
+        // lerp the translation and scale
+        Lanes tx = frame1.TX + (frame2.TX - frame1.TX) * param;
+        Lanes ty = frame1.TY + (frame2.TY - frame1.TY) * param;
+        Lanes tz = frame1.TZ + (frame2.TZ - frame1.TZ) * param;
+
+        Lanes sx = frame1.SX + (frame2.SX - frame1.SX) * param;
+        Lanes sy = frame1.SY + (frame2.SY - frame1.SY) * param;
+        Lanes sz = frame1.SZ + (frame2.SZ - frame1.SZ) * param;
+
+        // nlerp the rotation, taking the short way around
+        Lanes dot = frame1.RX * frame2.RX + frame1.RY * frame2.RY + frame1.RZ * frame2.RZ + frame1.RW * frame2.RW;
+        Lanes side = CopySign(one, dot);
+
+        // a plain nlerp runs ahead of a slerp at the start of a blend and behind it at the end, by more the larger the turn.
+        // bending the parameter with a curve fitted to the angle between the rotations keeps it close to the slerp
+        // InterpolatePose does. raymath itself nlerps rotations closer than SlerpCosine, so those are left straight
+        Lanes cosine = dot * side;
+        Lanes centered = param - Lanes::Set(0.5f);
+        Lanes a = Lanes::Set(1.0904f) + cosine * (Lanes::Set(-3.2452f) + cosine * (Lanes::Set(3.55645f) - cosine * Lanes::Set(1.43519f)));
+        Lanes b = Lanes::Set(0.848013f) + cosine * (Lanes::Set(-1.06021f) + cosine * Lanes::Set(0.215638f));
+        Lanes k = a * centered * centered + b;
+        Lanes rotationParam = SelectGreater(cosine, Lanes::Set(SlerpCosine), param, param + param * centered * (param - one) * k);
+
+        Lanes qx = frame1.RX + (frame2.RX * side - frame1.RX) * rotationParam;
+        Lanes qy = frame1.RY + (frame2.RY * side - frame1.RY) * rotationParam;
+        Lanes qz = frame1.RZ + (frame2.RZ * side - frame1.RZ) * rotationParam;
+        Lanes qw = frame1.RW + (frame2.RW * side - frame1.RW) * rotationParam;
+
+        Lanes invLength = one / Sqrt(qx * qx + qy * qy + qz * qz + qw * qw);
+        qx = qx * invLength;
+        qy = qy * invLength;
+        qz = qz * invLength;
+        qw = qw * invLength;
+
+        // rotate the scaled inverse bind translation by the blended rotation
+        Lanes vx = sx * inverseBind.TX;
+        Lanes vy = sy * inverseBind.TY;
+        Lanes vz = sz * inverseBind.TZ;
+
+        Lanes xx = qx * qx, yy = qy * qy, zz = qz * qz, ww = qw * qw;
+        Lanes xy = qx * qy, xz = qx * qz, yz = qy * qz;
+        Lanes wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+        Lanes btx = vx * (xx + ww - yy - zz) + vy * two * (xy - wz) + vz * two * (xz + wy) + tx;
+        Lanes bty = vx * two * (wz + xy) + vy * (ww - xx + yy - zz) + vz * two * (yz - wx) + ty;
+        Lanes btz = vx * two * (xz - wy) + vy * two * (wx + yz) + vz * (ww - xx - yy + zz) + tz;
+
+        // bone rotation is the blended rotation times the inverse bind rotation
+        Lanes rx = qx * inverseBind.RW + qw * inverseBind.RX + qy * inverseBind.RZ - qz * inverseBind.RY;
+        Lanes ry = qy * inverseBind.RW + qw * inverseBind.RY + qz * inverseBind.RX - qx * inverseBind.RZ;
+        Lanes rz = qz * inverseBind.RW + qw * inverseBind.RZ + qx * inverseBind.RY - qy * inverseBind.RX;
+        Lanes rw = qw * inverseBind.RW - qx * inverseBind.RX - qy * inverseBind.RY - qz * inverseBind.RZ;
+
+        Lanes bsx = sx * inverseBind.SX;
+        Lanes bsy = sy * inverseBind.SY;
+        Lanes bsz = sz * inverseBind.SZ;
+
+        // rotation * translation * scale, written out in matrix memory order
+        Lanes a2 = rx * rx, b2 = ry * ry, c2 = rz * rz;
+        Lanes ab = rx * ry, ac = rx * rz, bc = ry * rz;
+        Lanes ad = rw * rx, bd = rw * ry, cd = rw * rz;
+
+        Lanes elements[16] =
+        {
+            (one - two * (b2 + c2)) * bsx, two * (ab - cd) * bsx, two * (ac + bd) * bsx, btx * bsx,
+            two * (ab + cd) * bsy, (one - two * (a2 + c2)) * bsy, two * (bc - ad) * bsy, bty * bsy,
+            two * (ac - bd) * bsz, two * (bc + ad) * bsz, (one - two * (a2 + b2)) * bsz, btz * bsz,
+            zero, zero, zero, one
+        };
+
+        StoreMatrices(elements, matrices);
+    }
+}
+
+namespace Models
+{
+    void AnimatablePackedTransforms::Resize(size_t frameCount, size_t boneCount)
+    {
+        FrameCount = frameCount;
+        BoneCount = boneCount;
+        BoneStride = ((boneCount + LaneWidth - 1) / LaneWidth) * LaneWidth;
+
+        Data.assign(FrameCount * ChannelCount * BoneStride, 0.0f);
+
+        for (size_t frame = 0; frame < FrameCount; frame++)
+        {
+            for (Channel channel : { RotationW, ScaleX, ScaleY, ScaleZ })
+                std::fill_n(Data.data() + (frame * ChannelCount + channel) * BoneStride, BoneStride, 1.0f);
+        }
+    }
+
+    void AnimatablePackedTransforms::SetTransform(size_t frame, size_t bone, const Transform& transform)
+    {
+        float* base = Data.data() + frame * ChannelCount * BoneStride + bone;
+
+        base[TranslationX * BoneStride] = transform.translation.x;
+        base[TranslationY * BoneStride] = transform.translation.y;
+        base[TranslationZ * BoneStride] = transform.translation.z;
+        base[RotationX * BoneStride] = transform.rotation.x;
+        base[RotationY * BoneStride] = transform.rotation.y;
+        base[RotationZ * BoneStride] = transform.rotation.z;
+        base[RotationW * BoneStride] = transform.rotation.w;
+        base[ScaleX * BoneStride] = transform.scale.x;
+        base[ScaleY * BoneStride] = transform.scale.y;
+        base[ScaleZ * BoneStride] = transform.scale.z;
+    }
+
+    void PackSequence(AnimatableSequence& sequence)
+    {
+        size_t boneCount = sequence.Frames.empty() ? 0 : sequence.Frames.front().GlobalTransforms.size();
+
+        // frames that don't agree on the skeleton can't be evaluated, the sequence is left unpacked and matches no model
+        for (const auto& frame : sequence.Frames)
+        {
+            if (frame.GlobalTransforms.size() != boneCount)
+            {
+                sequence.PackedFrames.Resize(0, 0);
+                return;
+            }
+        }
+
+        sequence.PackedFrames.Resize(sequence.Frames.size(), boneCount);
+
+        for (size_t frame = 0; frame < sequence.Frames.size(); frame++)
+        {
+            const auto& transforms = sequence.Frames[frame].GlobalTransforms;
+            for (size_t bone = 0; bone < boneCount; bone++)
+                sequence.PackedFrames.SetTransform(frame, bone, transforms[bone]);
+        }
+    }
+
+    bool SequenceMatchesModel(const AnimateableModel& model, const AnimatableSequence& sequence)
+    {
+        return sequence.PackedFrames.IsValid() && sequence.PackedFrames.FrameCount == sequence.Frames.size()
+            && sequence.PackedFrames.BoneCount == model.Bones.size();
+    }
+
+    std::vector<std::string> RemoveMismatchedSequences(const AnimateableModel& model, AnimationSet& animations)
+    {
+        std::vector<std::string> removed;
+
+        for (auto itr = animations.Sequences.begin(); itr != animations.Sequences.end();)
+        {
+            if (SequenceMatchesModel(model, itr->second))
+            {
+                ++itr;
+                continue;
+            }
+
+            removed.push_back(itr->first);
+            itr = animations.Sequences.erase(itr);
+        }
+
+        return removed;
+    }
+
+    void InterpolatePackedPose(const AnimateableModel& model, AnimateablePose& pose, const AnimatableSequence& sequence, size_t frame1, size_t frame2, float param)
+    {
+        const auto& frames = sequence.PackedFrames;
+        const auto& inverseBind = model.PackedInverseBind;
+
+        size_t boneCount = model.Bones.size();
+
+        // a sequence for a different skeleton would read past the end of its frames
+        if (!SequenceMatchesModel(model, sequence) || frame1 >= frames.FrameCount || frame2 >= frames.FrameCount)
+            return;
+
+        if (inverseBind.BoneCount != boneCount)
+        {
+            InterpolatePose(model, pose, sequence.Frames[frame1], sequence.Frames[frame2], param);
+            return;
+        }
+
+        pose.BoneTransforms.resize(boneCount);
+
+        Lanes paramLanes = Lanes::Set(param);
+
+        PackedTransformLanes from, to, bind;
+        float matrices[LaneWidth][16];
+
+        for (size_t bone = 0; bone < boneCount; bone += LaneWidth)
+        {
+            from.Load(frames, frame1, bone);
+            to.Load(frames, frame2, bone);
+            bind.Load(inverseBind, 0, bone);
+
+            EvaluateBlock(from, to, bind, paramLanes, matrices);
+
+            // the padding lanes past the last bone are thrown away
+            size_t count = std::min(LaneWidth, boneCount - bone);
+            for (size_t lane = 0; lane < count; lane++)
+                memcpy(&pose.BoneTransforms[bone + lane], matrices[lane], sizeof(Matrix));
+        }
+    }
+
+    float GetPackedPoseError(const AnimateableModel& model, const AnimatableSequence& sequence, int samplesPerFrame, bool looping)
+    {
+        if (sequence.Frames.empty() || samplesPerFrame < 1)
+            return 0;
+
+        AnimateablePose reference = GetDefaultPose(model);
+        AnimateablePose packed = GetDefaultPose(model);
+
+        float maxError = 0;
+
+        // the blend from the last frame back to the first only happens when the sequence loops, otherwise
+        // it can cover a large rotation that the normalized lerp was never meant to match a slerp on
+        size_t frameCount = sequence.Frames.size();
+        size_t pairCount = looping ? frameCount : frameCount - 1;
+
+        // a single frame is compared to itself
+        if (frameCount == 1)
+            pairCount = 1;
+
+        for (size_t frame = 0; frame < pairCount; frame++)
+        {
+            size_t nextFrame = (frame + 1) % frameCount;
+
+            for (int sample = 0; sample < samplesPerFrame; sample++)
+            {
+                float param = sample / float(samplesPerFrame);
+
+                InterpolatePose(model, reference, sequence.Frames[frame], sequence.Frames[nextFrame], param);
+                InterpolatePackedPose(model, packed, sequence, frame, nextFrame, param);
+
+                for (size_t bone = 0; bone < model.Bones.size(); bone++)
+                {
+                    float16 referenceValues = MatrixToFloatV(reference.BoneTransforms[bone]);
+                    float16 packedValues = MatrixToFloatV(packed.BoneTransforms[bone]);
+
+                    for (int i = 0; i < 16; i++)
+                        maxError = std::max(maxError, std::fabs(referenceValues.v[i] - packedValues.v[i]));
+                }
+            }
+        }
+
+        return maxError;
+    }
+}
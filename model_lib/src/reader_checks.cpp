@@ -0,0 +1,171 @@
+#include "model.h"
+#include "binary_reader.h"
+
+#include "raylib.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace Models
+{
+    // reads the data from its own exactly sized buffer, so a read past the end lands outside the allocation
+    static bool ReadFileCopy(std::vector<uint8_t> data, bool animationFile, std::string& error)
+    {
+        BinaryReader reader(data.data(), data.size());
+
+        bool read = false;
+        if (animationFile)
+        {
+            AnimationSet animations;
+            read = animations.Read(reader);
+        }
+        else
+        {
+            AnimateableModel model;
+            read = model.Read(reader, false);
+        }
+
+        error = reader.GetError();
+        return read;
+    }
+
+    int RunBinaryReaderChecks(std::vector<std::string>& failures)
+    {
+        int failed = 0;
+        auto check = [&](bool passed, const char* name)
+            {
+                if (passed)
+                    return;
+
+                failed++;
+                failures.push_back(TextFormat("reader: %s", name));
+            };
+
+        // fixed cases on a three byte buffer
+        {
+            const uint8_t data[3] = { 1, 2, 3 };
+
+            BinaryReader reader(data, sizeof(data));
+            uint32_t value = 0xFFFFFFFF;
+            check(!reader.Read(&value, sizeof(value)) && value == 0, "a read past the end fails and zeroes the output");
+            check(!reader.IsValid() && !reader.GetError().empty(), "a failed read sets the error");
+            check(reader.Read<uint8_t>() == 0 && !reader.IsValid(), "reads after an error keep failing");
+
+            BinaryReader seeker(data, sizeof(data));
+            check(!seeker.Seek(4) && !seeker.IsValid(), "a seek past the end fails");
+
+            BinaryReader skipper(data, sizeof(data));
+            check(skipper.Skip(3) && skipper.GetRemaining() == 0, "a skip to the end works");
+            check(!skipper.Skip(1) && !skipper.IsValid(), "a skip past the end fails");
+
+            BinaryReader ranges(data, sizeof(data));
+            check(ranges.GetDataAt(1, 2) == data + 1, "a range inside the data is returned");
+            check(ranges.GetDataAt(1, SIZE_MAX) == nullptr && ranges.GetDataAt(SIZE_MAX, 1) == nullptr, "ranges that wrap around are rejected");
+            check(!ranges.HasRemaining(SIZE_MAX), "huge counts are never available");
+
+            BinaryReader empty(nullptr, 16);
+            check(empty.GetSize() == 0 && !empty.Read<uint8_t>(), "a null buffer has no data");
+        }
+
+        // strings whose length is negative or runs past the end
+        for (int length : { -1, 100, 0x7FFFFFFF })
+        {
+            uint8_t data[8] = { 0 };
+            memcpy(data, &length, sizeof(length));
+
+            BinaryReader reader(data, sizeof(data));
+            check(reader.ReadString().empty() && !reader.IsValid(), "a bad string length fails");
+        }
+
+        // random reads, skips and seeks on random buffers, the position never leaves the data and an error never clears
+        std::mt19937 random(31);
+        for (int run = 0; run < 256; run++)
+        {
+            std::vector<uint8_t> data(random() % 64);
+            for (auto& byte : data)
+                byte = uint8_t(random());
+
+            BinaryReader reader(data.data(), data.size());
+            bool hadError = false;
+            bool errorCleared = false;
+            bool stayedInside = true;
+
+            for (int step = 0; step < 32; step++)
+            {
+                uint8_t scratch[16];
+                switch (random() % 5)
+                {
+                case 0: reader.Read(scratch, random() % sizeof(scratch)); break;
+                case 1: reader.Skip(random() % 16); break;
+                case 2: reader.Seek(random() % 80); break;
+                case 3: reader.ReadString(); break;
+                case 4: reader.ReadFixedString(random() % 40); break;
+                }
+
+                stayedInside &= reader.GetPosition() <= reader.GetSize();
+                errorCleared |= hadError && reader.IsValid();
+                hadError |= !reader.IsValid();
+            }
+
+            check(stayedInside, "random reads stay inside the data");
+            check(!errorCleared, "an error is never cleared");
+        }
+
+        return failed;
+    }
+
+    int RunFileReaderChecks(const uint8_t* fileData, size_t fileSize, bool animationFile, std::string_view name, std::vector<std::string>& failures)
+    {
+        int failed = 0;
+        auto check = [&](bool passed, const char* description, size_t size)
+            {
+                if (passed)
+                    return;
+
+                failed++;
+                failures.push_back(TextFormat("%s: %s at %zu bytes", std::string(name).c_str(), description, size));
+            };
+
+        std::vector<uint8_t> file(fileData, fileData + fileSize);
+        std::string error;
+
+        check(ReadFileCopy(file, animationFile, error), "the whole file doesn't read", fileSize);
+
+        // every short cut, then cuts spread over the rest of the file, none of them is a whole file
+        std::vector<size_t> cuts;
+        for (size_t size = 0; size < std::min(fileSize, size_t(256)); size++)
+            cuts.push_back(size);
+        for (size_t step = 1; step < 256 && fileSize > 256; step++)
+            cuts.push_back(256 + (fileSize - 256) * step / 256);
+
+        for (size_t size : cuts)
+        {
+            std::vector<uint8_t> cut(file.begin(), file.begin() + size);
+            bool read = ReadFileCopy(cut, animationFile, error);
+            check(!read && !error.empty(), "a cut off file was not rejected", size);
+        }
+
+        // damaged copies may read or not, but a rejected one always says why
+        uint32_t seed = uint32_t(fileSize);
+        std::mt19937 random(seed);
+        for (int run = 0; run < 256 && fileSize > 0; run++)
+        {
+            std::vector<uint8_t> damaged = file;
+
+            // the early runs damage the header and counts, later ones anywhere in the file
+            size_t range = run < 128 ? std::min(fileSize, size_t(64)) : fileSize;
+            int changes = 1 + int(random() % 8);
+            for (int change = 0; change < changes; change++)
+                damaged[random() % range] = uint8_t(random());
+
+            if (run % 4 == 3)
+                damaged.resize(random() % fileSize);
+
+            bool read = ReadFileCopy(damaged, animationFile, error);
+            check(read || !error.empty(), "a damaged file was rejected without an error", damaged.size());
+        }
+
+        return failed;
+    }
+}
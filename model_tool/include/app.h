@@ -51,6 +51,9 @@ namespace App
         std::string Sequence;
         int Frame = -1;
         Models::AnimationSet Animations;
+
+        // keyframes that can be rebuilt to within this error are dropped on save
+        float KeyframeError = 0.0005f;
     };
     AnimationState& GetAnimations();
 
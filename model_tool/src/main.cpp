@@ -113,7 +113,7 @@ namespace App
     {
         App::TheModel.Write(App::ModelName);
         if (!App::TheAnimations.Animations.Sequences.empty())
-            App::TheAnimations.Animations.Write(App::ModelName);
+            App::TheAnimations.Animations.Write(App::ModelName, App::TheAnimations.KeyframeError);
     }
 
     AnimationState& GetAnimations()
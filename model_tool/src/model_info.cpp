@@ -83,6 +83,8 @@ void ModelInfoPanel::OnShowContents()
         {
             ImGui::SliderInt("Frame", &anims.Frame, 0, int(anims.Animations.Sequences[anims.Sequence].Frames.size()) - 1);
         }
+
+        ImGui::SliderFloat("Keyframe Error", &anims.KeyframeError, 0, 0.01f, "%.4f");
         ImGui::EndChild();
     }
 }
\ No newline at end of file
@@ -57,6 +57,8 @@ namespace TransformTools
             bone.DefaultGlobalTransform.translation -= center;
         }
 
+        model.UpdateInverseBindPose();
+
         for (auto & [name, sequence] : App::GetAnimations().Animations.Sequences)
         {
             for (auto& keyframe : sequence.Frames)
@@ -66,6 +68,8 @@ namespace TransformTools
                     transform.translation -= center;
                 }
             }
+
+            Models::PackSequence(sequence);
         }
 
         App::SetSeletedMesh(App::GetSelectedMesh());
@@ -94,6 +98,8 @@ namespace TransformTools
             bone.DefaultGlobalTransform.translation.y -= bbox.min.y;
         }
 
+        model.UpdateInverseBindPose();
+
         for (auto& [name, sequence] : App::GetAnimations().Animations.Sequences)
         {
             for (auto& keyframe : sequence.Frames)
@@ -103,6 +109,8 @@ namespace TransformTools
                     transform.translation.y -= bbox.min.y;
                 }
             }
+
+            Models::PackSequence(sequence);
         }
 
         App::SetSeletedMesh(App::GetSelectedMesh());
@@ -145,6 +153,8 @@ namespace TransformTools
 
         }
 
+        model.UpdateInverseBindPose();
+
         for (auto& [name, sequence] : App::GetAnimations().Animations.Sequences)
         {
             for (auto& keyframe : sequence.Frames)
@@ -154,6 +164,8 @@ namespace TransformTools
                     transform.translation *= scale;
                 }
             }
+
+            Models::PackSequence(sequence);
         }
 
         App::SetSeletedMesh(App::GetSelectedMesh());
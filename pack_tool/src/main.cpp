@@ -0,0 +1,230 @@
+#include "raylib.h"
+
+#include "utilities/pack_format.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// builds a resource pack from every file in a folder
+// usage: pack_tool <source folder> <output pack> [-compress] [-min_ratio <ratio>]
+
+struct PackItem
+{
+    std::string SourcePath;
+    std::string Name;
+    PackFormat::PackEntry Entry;
+};
+
+static bool WritePadding(FILE* file, size_t bytes)
+{
+    static const uint8_t zeros[PackFormat::EntryAlignment] = { 0 };
+
+    while (bytes > 0)
+    {
+        size_t count = bytes < sizeof(zeros) ? bytes : sizeof(zeros);
+        if (fwrite(zeros, 1, count, file) != count)
+            return false;
+
+        bytes -= count;
+    }
+
+    return true;
+}
+
+static std::vector<PackItem> GatherFiles(const std::string& sourceFolder)
+{
+    std::vector<PackItem> items;
+
+    FilePathList files = LoadDirectoryFilesEx(sourceFolder.c_str(), nullptr, true);
+    for (unsigned int i = 0; i < files.count; i++)
+    {
+        std::string_view path = files.paths[i];
+
+        // packs are never packed into other packs
+        if (IsFileExtension(files.paths[i], ".pack"))
+            continue;
+
+        std::string_view relativePath = path.substr(std::min(sourceFolder.size(), path.size()));
+        while (!relativePath.empty() && (relativePath.front() == '/' || relativePath.front() == '\\'))
+            relativePath.remove_prefix(1);
+
+        if (relativePath.empty())
+            continue;
+
+        PackItem& item = items.emplace_back();
+        item.SourcePath = path;
+        item.Name = PackFormat::NormalizePath(relativePath);
+        item.Entry.PathHash = PackFormat::HashPath(item.Name);
+    }
+    UnloadDirectoryFiles(files);
+
+    // store the data in path order, so files from the same folder are near each other
+    std::sort(items.begin(), items.end(), [](const PackItem& a, const PackItem& b) { return a.Name < b.Name; });
+
+    return items;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        printf("usage: pack_tool <source folder> <output pack> [-compress] [-min_ratio <ratio>]\n");
+        return 1;
+    }
+
+    std::string sourceFolder = argv[1];
+    std::string outputPath = argv[2];
+
+    bool compress = false;
+
+    // compressed entries can't be read in place, so only keep the compressed data when it saves enough
+    float minRatio = 0.9f;
+
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-compress") == 0)
+            compress = true;
+        else if (strcmp(argv[i], "-min_ratio") == 0 && i + 1 < argc)
+            minRatio = float(atof(argv[++i]));
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    std::vector<PackItem> items = GatherFiles(sourceFolder);
+
+    // the index is sorted by hash, two paths with the same hash can't both be found
+    std::vector<const PackItem*> byHash;
+    for (const auto& item : items)
+        byHash.push_back(&item);
+
+    std::sort(byHash.begin(), byHash.end(), [](const PackItem* a, const PackItem* b) { return a->Entry.PathHash < b->Entry.PathHash; });
+
+    for (size_t i = 1; i < byHash.size(); i++)
+    {
+        if (byHash[i]->Entry.PathHash == byHash[i - 1]->Entry.PathHash)
+        {
+            printf("%s and %s have the same path hash, rename one of them\n", byHash[i - 1]->Name.c_str(), byHash[i]->Name.c_str());
+            return 1;
+        }
+    }
+
+    PackFormat::PackHeader header;
+    memcpy(header.Magic, PackFormat::Magic, sizeof(header.Magic));
+    header.Version = PackFormat::Version;
+    header.EntryCount = uint32_t(items.size());
+    header.EntriesOffset = sizeof(PackFormat::PackHeader);
+    header.NamesOffset = header.EntriesOffset + items.size() * sizeof(PackFormat::PackEntry);
+
+    std::string names;
+    for (auto& item : items)
+    {
+        item.Entry.NameOffset = uint32_t(names.size());
+        item.Entry.NameLength = uint32_t(item.Name.size());
+        names += item.Name;
+    }
+    header.NamesSize = names.size();
+
+    FILE* file = fopen(outputPath.c_str(), "wb");
+    if (!file)
+    {
+        printf("unable to open %s for writing\n", outputPath.c_str());
+        return 1;
+    }
+
+    // the entry table is written last, once the data offsets and sizes are known
+    fwrite(&header, sizeof(header), 1, file);
+    WritePadding(file, items.size() * sizeof(PackFormat::PackEntry));
+    fwrite(names.data(), 1, names.size(), file);
+
+    size_t offset = size_t(header.NamesOffset + header.NamesSize);
+    size_t totalSize = 0;
+    size_t totalStored = 0;
+    bool failed = false;
+
+    for (auto& item : items)
+    {
+        size_t alignedOffset = PackFormat::AlignOffset(offset);
+        if (!WritePadding(file, alignedOffset - offset))
+        {
+            failed = true;
+            break;
+        }
+        offset = alignedOffset;
+
+        int size = 0;
+        uint8_t* data = LoadFileData(item.SourcePath.c_str(), &size);
+        if (!data && size != 0)
+        {
+            printf("unable to read %s\n", item.SourcePath.c_str());
+            failed = true;
+            break;
+        }
+
+        const uint8_t* storedData = data;
+        size_t storedSize = size_t(size);
+
+        uint8_t* compressedData = nullptr;
+        if (compress && size > 0)
+        {
+            int compressedSize = 0;
+            compressedData = CompressData(data, size, &compressedSize);
+            if (compressedData && compressedSize > 0 && compressedSize < size * minRatio)
+            {
+                storedData = compressedData;
+                storedSize = size_t(compressedSize);
+                item.Entry.Flags |= PackFormat::Compressed;
+            }
+        }
+
+        item.Entry.DataOffset = offset;
+        item.Entry.StoredSize = storedSize;
+        item.Entry.Size = size_t(size);
+
+        if (storedSize > 0 && fwrite(storedData, 1, storedSize, file) != storedSize)
+            failed = true;
+
+        // every entry is followed by a zero, so text entries are terminated in place
+        if (!WritePadding(file, 1))
+            failed = true;
+
+        offset += storedSize + 1;
+
+        totalSize += size_t(size);
+        totalStored += storedSize;
+
+        MemFree(compressedData);
+        UnloadFileData(data);
+
+        if (failed)
+            break;
+    }
+
+    if (!failed)
+    {
+        // write the entry table in hash order
+        std::sort(items.begin(), items.end(), [](const PackItem& a, const PackItem& b) { return a.Entry.PathHash < b.Entry.PathHash; });
+
+        fseek(file, long(header.EntriesOffset), SEEK_SET);
+        for (const auto& item : items)
+        {
+            if (fwrite(&item.Entry, sizeof(PackFormat::PackEntry), 1, file) != 1)
+                failed = true;
+        }
+    }
+
+    fclose(file);
+
+    if (failed)
+    {
+        printf("unable to write %s\n", outputPath.c_str());
+        remove(outputPath.c_str());
+        return 1;
+    }
+
+    printf("packed %d files into %s, %d bytes stored for %d bytes of data\n", int(items.size()), outputPath.c_str(), int(totalStored), int(totalSize));
+    return 0;
+}
@@ -0,0 +1,179 @@
+#include "raylib.h"
+
+#include "utilities/texture_compression.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// compresses images into DDS files with their mip levels, written next to the source image.
+// the game loads the .dds instead of the image with the same name
+// usage: texture_tool <image or folder> [-format auto|dxt1|dxt5] [-verify] [-max_error <rmse>]
+
+static constexpr char ImageExtensions[] = ".png;.tga;.bmp;.jpg";
+
+enum class FormatChoice
+{
+    Auto,
+    DXT1,
+    DXT5,
+};
+
+struct ToolOptions
+{
+    FormatChoice Format = FormatChoice::Auto;
+    bool Verify = false;
+    float MaxError = 0;
+};
+
+struct ToolTotals
+{
+    int Converted = 0;
+    int Skipped = 0;
+    int Failed = 0;
+
+    size_t SourceBytes = 0;
+    size_t CompressedBytes = 0;
+};
+
+static std::string GetOutputPath(const std::string& sourcePath)
+{
+    size_t extension = sourcePath.find_last_of('.');
+    return sourcePath.substr(0, extension) + ".dds";
+}
+
+static void ConvertImage(const std::string& sourcePath, const ToolOptions& options, ToolTotals& totals)
+{
+    Image source = LoadImage(sourcePath.c_str());
+    if (!IsImageValid(source))
+    {
+        printf("unable to load %s\n", sourcePath.c_str());
+        totals.Failed++;
+        return;
+    }
+
+    ImageFormat(&source, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+    // blocks are 4x4, other sizes stay as images and get their mips on the GPU
+    int mipmaps = TextureCompression::GetCompressedMipCount(source.width, source.height);
+    if (mipmaps == 0)
+    {
+        printf("skipping %s, %dx%d is not a multiple of 4\n", sourcePath.c_str(), source.width, source.height);
+        totals.Skipped++;
+        UnloadImage(source);
+        return;
+    }
+
+    int format = PIXELFORMAT_COMPRESSED_DXT1_RGB;
+    if (options.Format == FormatChoice::DXT5 || (options.Format == FormatChoice::Auto && TextureCompression::HasAlpha(source)))
+        format = PIXELFORMAT_COMPRESSED_DXT5_RGBA;
+
+    Image chain = TextureCompression::BuildMipChain(source, mipmaps);
+    Image compressed = TextureCompression::CompressImage(chain, format);
+
+    bool failed = !IsImageValid(compressed);
+
+    float error = 0;
+    if (!failed && options.Verify)
+    {
+        Image decompressed = TextureCompression::DecompressImage(compressed);
+        error = TextureCompression::GetImageError(source, decompressed);
+        UnloadImage(decompressed);
+
+        if (options.MaxError > 0 && error > options.MaxError)
+        {
+            printf("%s has an error of %.2f, over the limit of %.2f\n", sourcePath.c_str(), error, options.MaxError);
+            failed = true;
+        }
+    }
+
+    std::string outputPath = GetOutputPath(sourcePath);
+    if (!failed && !TextureCompression::ExportDDS(compressed, outputPath.c_str()))
+    {
+        printf("unable to write %s\n", outputPath.c_str());
+        failed = true;
+    }
+
+    if (failed)
+    {
+        totals.Failed++;
+    }
+    else
+    {
+        size_t sourceBytes = TextureCompression::GetTextureSize(chain.width, chain.height, chain.mipmaps, chain.format);
+        size_t compressedBytes = TextureCompression::GetTextureSize(compressed.width, compressed.height, compressed.mipmaps, compressed.format);
+
+        totals.Converted++;
+        totals.SourceBytes += sourceBytes;
+        totals.CompressedBytes += compressedBytes;
+
+        if (options.Verify)
+            printf("%s %s %d mips, %d to %d bytes, rmse %.2f\n", outputPath.c_str(), format == PIXELFORMAT_COMPRESSED_DXT1_RGB ? "DXT1" : "DXT5", mipmaps, int(sourceBytes), int(compressedBytes), error);
+        else
+            printf("%s %s %d mips, %d to %d bytes\n", outputPath.c_str(), format == PIXELFORMAT_COMPRESSED_DXT1_RGB ? "DXT1" : "DXT5", mipmaps, int(sourceBytes), int(compressedBytes));
+    }
+
+    UnloadImage(compressed);
+    UnloadImage(chain);
+    UnloadImage(source);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf("usage: texture_tool <image or folder> [-format auto|dxt1|dxt5] [-verify] [-max_error <rmse>]\n");
+        return 1;
+    }
+
+    ToolOptions options;
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-format") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "dxt1") == 0)
+                options.Format = FormatChoice::DXT1;
+            else if (strcmp(argv[i], "dxt5") == 0)
+                options.Format = FormatChoice::DXT5;
+            else
+                options.Format = FormatChoice::Auto;
+        }
+        else if (strcmp(argv[i], "-verify") == 0)
+        {
+            options.Verify = true;
+        }
+        else if (strcmp(argv[i], "-max_error") == 0 && i + 1 < argc)
+        {
+            options.Verify = true;
+            options.MaxError = float(atof(argv[++i]));
+        }
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    std::vector<std::string> sourcePaths;
+    if (DirectoryExists(argv[1]))
+    {
+        FilePathList files = LoadDirectoryFilesEx(argv[1], ImageExtensions, true);
+        for (unsigned int i = 0; i < files.count; i++)
+            sourcePaths.push_back(files.paths[i]);
+        UnloadDirectoryFiles(files);
+    }
+    else
+    {
+        sourcePaths.push_back(argv[1]);
+    }
+
+    ToolTotals totals;
+    for (const auto& sourcePath : sourcePaths)
+        ConvertImage(sourcePath, options, totals);
+
+    printf("converted %d images, skipped %d, failed %d, %d bytes of mipmapped RGBA to %d bytes\n",
+        totals.Converted, totals.Skipped, totals.Failed, int(totals.SourceBytes), int(totals.CompressedBytes));
+
+    return totals.Failed > 0 ? 1 : 0;
+}